@@ -113,6 +113,30 @@ int msg_send_to_self(msg_t *m);
  */
 int msg_send_int(msg_t *m, kernel_pid_t target_pid);
 
+/**
+ * @brief Send several messages to one thread, yield once.
+ *
+ * Delivers ``m[0]`` .. ``m[n - 1]`` in order. If the target is
+ * receive-blocked, the first message is copied to it directly, the others are
+ * put into its message queue, all with interrupts disabled once. The caller
+ * yields at most once afterwards instead of after every message as with
+ * msg_send(). If called from an interrupt or with the own PID, the messages
+ * are sent one by one and this function never blocks.
+ *
+ * @param[in] m             Pointer to array of ``n`` preallocated ``msg_t``
+ *                          structures, must not be NULL.
+ * @param[in] n             Number of messages.
+ * @param[in] target_pid    PID of target thread
+ * @param[in] block         If not 0 and the target's message queue is full,
+ *                          function blocks until the target took the next
+ *                          message, then continues. If not, function returns.
+ *
+ * @return number of messages delivered, less than ``n`` only if the target's
+ *         message queue is full and ``block == 0``
+ * @return -1, on error (invalid PID)
+ */
+int msg_send_batch(msg_t *m, unsigned int n, kernel_pid_t target_pid, bool block);
+
 
 /**
  * @brief Receive a message.
@@ -139,6 +163,21 @@ int msg_receive(msg_t *m);
  */
 int msg_try_receive(msg_t *m);
 
+/**
+ * @brief Receive several messages.
+ *
+ * Blocks until a message was received like msg_receive(), then takes up to
+ * ``n - 1`` further messages from the thread's message queue without
+ * blocking.
+ *
+ * @param[out] m    Pointer to array of ``n`` preallocated ``msg_t``
+ *                  structures, must not be NULL.
+ * @param[in] n     Maximum number of messages to receive.
+ *
+ * @return  number of messages received, at least 1 if ``n > 0``.
+ */
+int msg_receive_many(msg_t *m, unsigned int n);
+
 /**
  * @brief Send a message, block until reply received.
  *
@@ -169,6 +169,100 @@ int msg_send_int(msg_t *m, kernel_pid_t target_pid)
     }
 }
 
+/* Deliver as many of n messages as possible without blocking or yielding,
+ * sets *woken if the target was receive-blocked */
+static int _msg_send_many(msg_t *m, unsigned int n, kernel_pid_t target_pid, int *woken)
+{
+    unsigned int state = disableIRQ();
+    tcb_t *target = (tcb_t*) sched_threads[target_pid];
+    unsigned int sent = 0;
+
+    if (target == NULL) {
+        DEBUG("msg_send_batch(): target thread does not exist\n");
+        restoreIRQ(state);
+        return -1;
+    }
+
+    if (target->status == STATUS_RECEIVE_BLOCKED) {
+        DEBUG("msg_send_batch: %s: Direct msg copy from %" PRIkernel_pid " to %" PRIkernel_pid ".\n", sched_active_thread->name, thread_getpid(), target_pid);
+        m[0].sender_pid = sched_active_pid;
+
+        /* copy msg to target, its queue is empty */
+        msg_t *target_message = (msg_t*) target->wait_data;
+        *target_message = m[0];
+        sched_set_status(target, STATUS_PENDING);
+
+        *woken = 1;
+        sent = 1;
+    }
+
+    if (target->msg_array) {
+        while (sent < n) {
+            m[sent].sender_pid = sched_active_pid;
+
+            if (!queue_msg(target, &m[sent])) {
+                break;
+            }
+
+            sent++;
+        }
+    }
+
+    DEBUG("msg_send_batch: %s: %u of %u messages to %" PRIkernel_pid ".\n", sched_active_thread->name, sent, n, target_pid);
+    restoreIRQ(state);
+    return sent;
+}
+
+int msg_send_batch(msg_t *m, unsigned int n, kernel_pid_t target_pid, bool block)
+{
+    unsigned int sent = 0;
+    int woken = 0;
+
+    if (inISR() || (sched_active_pid == target_pid)) {
+        /* never yields nor blocks */
+        while (sent < n) {
+            int res = msg_send(&m[sent], target_pid, false);
+
+            if (res <= 0) {
+                return (sent || res == 0) ? (int) sent : -1;
+            }
+
+            sent++;
+        }
+
+        return sent;
+    }
+
+    while (sent < n) {
+        int res = _msg_send_many(&m[sent], n - sent, target_pid, &woken);
+
+        if (res < 0) {
+            return sent ? (int) sent : -1;
+        }
+
+        sent += res;
+
+        if ((sent == n) || !block) {
+            break;
+        }
+
+        /* queue full, wait until the target took the next message */
+        if (msg_send(&m[sent], target_pid, true) < 0) {
+            return sent ? (int) sent : -1;
+        }
+
+        /* msg_send() yielded */
+        woken = 0;
+        sent++;
+    }
+
+    if (woken) {
+        thread_yield();
+    }
+
+    return sent;
+}
+
 int msg_send_receive(msg_t *m, msg_t *reply, kernel_pid_t target_pid)
 {
     dINT();
@@ -235,6 +329,49 @@ int msg_receive(msg_t *m)
     return _msg_receive(m, 1);
 }
 
+int msg_receive_many(msg_t *m, unsigned int n)
+{
+    if (n == 0) {
+        return 0;
+    }
+
+    _msg_receive(m, 1);
+
+    unsigned int received = 1;
+    unsigned int state = disableIRQ();
+    tcb_t *me = (tcb_t*) sched_threads[sched_active_pid];
+
+    if (me->msg_array) {
+        while (received < n) {
+            int queue_index = cib_get(&(me->msg_queue));
+
+            if (queue_index < 0) {
+                break;
+            }
+
+            m[received++] = me->msg_array[queue_index];
+
+            /* take the message of a waiting thread into the freed queue
+             * space, as _msg_receive() does */
+            priority_queue_node_t *node = priority_queue_remove_head(&(me->msg_waiters));
+
+            if (node != NULL) {
+                tcb_t *sender = (tcb_t*) node->data;
+                me->msg_array[cib_put(&(me->msg_queue))] = *((msg_t*) sender->wait_data);
+
+                if (sender->status != STATUS_REPLY_BLOCKED) {
+                    sender->wait_data = NULL;
+                    sched_set_status(sender, STATUS_PENDING);
+                }
+            }
+        }
+    }
+
+    DEBUG("msg_receive_many: %s: %u messages.\n", sched_active_thread->name, received);
+    restoreIRQ(state);
+    return received;
+}
+
 static int _msg_receive(msg_t *m, int block)
 {
     dINT();
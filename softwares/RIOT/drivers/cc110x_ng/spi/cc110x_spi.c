@@ -29,17 +29,26 @@
 //                      CC1100 SPI access
 /*---------------------------------------------------------------------------*/
 
+__attribute__((weak)) void cc110x_txrx_burst(const uint8_t *tx_buf, uint8_t *rx_buf,
+        uint8_t count)
+{
+    uint8_t data;
+
+    for (int i = 0; i < count; i++) {
+        data = cc110x_txrx((tx_buf != NULL) ? tx_buf[i] : CC1100_NOBYTE);
+
+        if (rx_buf != NULL) {
+            rx_buf[i] = data;
+        }
+    }
+}
+
 uint8_t cc110x_writeburst_reg(uint8_t addr, char *src, uint8_t count)
 {
-    int i = 0;
     unsigned int cpsr = disableIRQ();
     cc110x_spi_select();
     cc110x_txrx(addr | CC1100_WRITE_BURST);
-
-    while (i < count) {
-        cc110x_txrx(src[i]);
-        i++;
-    }
+    cc110x_txrx_burst((const uint8_t *) src, NULL, count);
 
     cc110x_spi_unselect();
     restoreIRQ(cpsr);
@@ -48,15 +57,10 @@ uint8_t cc110x_writeburst_reg(uint8_t addr, char *src, uint8_t count)
 
 void cc110x_readburst_reg(uint8_t addr, char *buffer, uint8_t count)
 {
-    int i = 0;
     unsigned int cpsr = disableIRQ();
     cc110x_spi_select();
     cc110x_txrx(addr | CC1100_READ_BURST);
-
-    while (i < count) {
-        buffer[i] = cc110x_txrx(CC1100_NOBYTE);
-        i++;
-    }
+    cc110x_txrx_burst(NULL, (uint8_t *) buffer, count);
 
     cc110x_spi_unselect();
     restoreIRQ(cpsr);
@@ -23,6 +23,17 @@
 
 uint8_t cc110x_txrx(uint8_t c);
 
+/**
+ * @brief   Send and receive a burst of bytes (e.g. FIFO access).
+ *          Default implementation calls cc110x_txrx() for every byte,
+ *          platforms with DMA may override it.
+ *
+ * @param[in]   tx_buf  bytes to send, NULL to send CC1100_NOBYTE
+ * @param[out]  rx_buf  received bytes, NULL to discard them
+ * @param[in]   count   number of bytes
+ */
+void cc110x_txrx_burst(const uint8_t *tx_buf, uint8_t *rx_buf, uint8_t count);
+
 void cc110x_gdo0_enable(void);
 void cc110x_gdo0_disable(void);
 void cc110x_gdo2_enable(void);
@@ -31,35 +31,123 @@ void printArrayRange(uint8_t *array, uint16_t len, char *str)
     printf("\n-----------%u-------------\n", len);
 }
 
+/* word loads from the byte buffers of the network stack */
+typedef uint16_t __attribute__((__may_alias__)) csum_u16_t;
+typedef uint32_t __attribute__((__may_alias__)) csum_u32_t;
+
+static inline uint16_t csum_fold(uint32_t acc)
+{
+    acc = (acc & 0xffff) + (acc >> 16);
+    acc = (acc & 0xffff) + (acc >> 16);
+
+    return acc;
+}
+
+static inline uint16_t csum_swap(uint16_t sum)
+{
+    return (sum << 8) | (sum >> 8);
+}
+
 uint16_t csum(uint16_t sum, uint8_t *buf, uint16_t len)
 {
-    int count = len >> 1;
+    const csum_u32_t *words;
+    uint32_t acc = 0;
+    int odd = (uintptr_t) buf & 1;
 
-    if (count) {
-        uint16_t carry = 0;
+    /*
+     * 16-bit words are summed in host byte order, the one's complement sum
+     * is byte order independent (RFC 1071). Starting at an odd address
+     * shifts all bytes to the other half of their words, the sum is
+     * swapped back at the end.
+     */
+    if (odd && len) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        acc = *buf;
+#else
+        acc = *buf << 8;
+#endif
+        buf++;
+        len--;
+    }
+
+    if (((uintptr_t) buf & 2) && (len >= 2)) {
+        acc += *(const csum_u16_t *) buf;
+        buf += 2;
+        len -= 2;
+    }
+
+    /* at most 32768 halves of 0xffff, acc can't overflow */
+    words = (const csum_u32_t *) buf;
+
+    for (; len >= 16; len -= 16, words += 4) {
+        acc += (words[0] & 0xffff) + (words[0] >> 16);
+        acc += (words[1] & 0xffff) + (words[1] >> 16);
+        acc += (words[2] & 0xffff) + (words[2] >> 16);
+        acc += (words[3] & 0xffff) + (words[3] >> 16);
+    }
+
+    for (; len >= 4; len -= 4, words++) {
+        acc += (*words & 0xffff) + (*words >> 16);
+    }
 
-        do {
-            uint16_t t = (*buf << 8) + *(buf + 1);
-            count--;
-            buf += 2;
-            sum += carry;
-            sum += t;
-            carry = (t > sum);
-        } while (count);
+    buf = (uint8_t *) words;
 
-        sum += carry;
+    if (len >= 2) {
+        acc += *(const csum_u16_t *) buf;
+        buf += 2;
+        len -= 2;
     }
 
-    if (len & 1) {
-        uint16_t u = (*buf << 8);
-        sum += (*buf << 8);
+    if (len) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        acc += *buf << 8;
+#else
+        acc += *buf;
+#endif
+    }
+
+    acc = csum_fold(acc);
+
+    if (odd) {
+        acc = csum_swap(acc);
+    }
+
+#if __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+    acc = csum_swap(acc);
+#endif
+
+    return csum_fold(acc + sum);
+}
+
+uint16_t csum_update16(uint16_t checksum, uint16_t old_value, uint16_t new_value)
+{
+    /* RFC 1624, eqn. 3: HC' = ~(~HC + ~m + m') */
+    uint32_t acc = (uint16_t) ~checksum;
+
+    acc += (uint16_t) ~old_value;
+    acc += new_value;
+
+    return ~csum_fold(acc);
+}
+
+uint16_t csum_update(uint16_t checksum, const void *old_data,
+                     const void *new_data, uint16_t len)
+{
+    const uint8_t *old_bytes = old_data;
+    const uint8_t *new_bytes = new_data;
+    uint32_t acc = (uint16_t) ~checksum;
+
+    /* memcpy, the data may be unaligned (e.g. addresses in headers) */
+    for (uint16_t i = 0; i < len; i += 2) {
+        uint16_t old_value, new_value;
 
-        if (sum < u) {
-            sum++;
-        }
+        memcpy(&old_value, old_bytes + i, 2);
+        memcpy(&new_value, new_bytes + i, 2);
+        acc += (uint16_t) ~old_value;
+        acc += new_value;
     }
 
-    return sum;
+    return ~csum_fold(acc);
 }
 
 /**
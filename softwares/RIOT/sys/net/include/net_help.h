@@ -47,7 +47,50 @@
 
 #define CMP_IPV6_ADDR(a, b) (memcmp(a, b, 16))
 
+/**
+ * @brief   Add the bytes of a buffer, as 16-bit words in network byte order,
+ *          to a one's complement sum (RFC 1071). Words are read 32 bits at a
+ *          time from aligned addresses.
+ *
+ * @param[in] sum   One's complement sum so far, host byte order.
+ * @param[in] buf   Buffer, any alignment.
+ * @param[in] len   Length of buf, an odd last byte is padded with zero.
+ *
+ * @return  New one's complement sum, host byte order, 0 only if all added
+ *          words and sum are 0.
+ */
 uint16_t csum(uint16_t sum, uint8_t *buf, uint16_t len);
+
+/**
+ * @brief   Update a checksum for a changed 16-bit word (RFC 1624, eqn. 3),
+ *          instead of computing it again over the whole packet.
+ *
+ *          checksum, old_value and new_value are in the same byte order,
+ *          e.g. all as read from the packet.
+ *
+ * @param[in] checksum  Checksum (complemented sum) before the change.
+ * @param[in] old_value Old value of the word.
+ * @param[in] new_value New value of the word.
+ *
+ * @return  Checksum after the change.
+ */
+uint16_t csum_update16(uint16_t checksum, uint16_t old_value, uint16_t new_value);
+
+/**
+ * @brief   Update a checksum for a changed field, e.g. an address in the
+ *          pseudo header (RFC 1624, eqn. 3).
+ *
+ * @param[in] checksum  Checksum as read from the packet, before the change.
+ * @param[in] old_data  Old content of the field.
+ * @param[in] new_data  New content of the field.
+ * @param[in] len       Length of the field, even, at a 16-bit word boundary
+ *                      of the checksummed data.
+ *
+ * @return  Checksum after the change, as to write to the packet.
+ */
+uint16_t csum_update(uint16_t checksum, const void *old_data,
+                     const void *new_data, uint16_t len);
+
 void printArrayRange(uint8_t *array, uint16_t len, char *str);
 
 /** @} */
@@ -118,7 +118,7 @@ void send_DIO(ipv6_addr_t *destination);
  * @param[in] start_index       Describes whether a DAO must be split because of too many routing entries.
  *
  */
-void send_DAO(ipv6_addr_t *destination, uint8_t lifetime, bool default_lifetime, uint8_t start_index);
+void send_DAO(ipv6_addr_t *destination, uint8_t lifetime, bool default_lifetime, uint16_t start_index);
 
 /**
  * @brief Sends a DIS-message to a given destination
@@ -263,5 +263,23 @@ void rpl_clear_routing_table(void);
  * */
 rpl_routing_entry_t *rpl_get_routing_table(void);
 
+/**
+ * @brief Returns remaining lifetime of a routing entry.
+ *
+ * @param[in] entry                 Routing entry
+ *
+ * @return Seconds until the entry is removed
+ *
+ * */
+uint32_t rpl_get_routing_entry_lifetime(rpl_routing_entry_t *entry);
+
+/**
+ * @brief Advances the routing table clock by one second and removes the
+ * entries whose lifetime is over. Only the entries expiring in this second
+ * modulo RPL_ROUTING_WHEEL_SIZE are visited.
+ *
+ * */
+void rpl_expire_routing_entries(void);
+
 /** @} */
 #endif /* __RPL_H */
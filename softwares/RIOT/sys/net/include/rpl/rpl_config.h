@@ -119,7 +119,17 @@ static inline bool RPL_COUNTER_GREATER_THAN(uint8_t A,uint8_t B)
 #define RPL_MAX_DODAGS 3
 #define RPL_MAX_INSTANCES 1
 #define RPL_MAX_PARENTS 5
+/* routing table capacity, at most 0xfffe, a DODAG root stores a route to
+ * every node of the DODAG */
+#ifndef RPL_MAX_ROUTING_ENTRIES
 #define RPL_MAX_ROUTING_ENTRIES 128
+#endif
+/* hash chains of the routing table, power of 2 */
+#ifndef RPL_ROUTING_HASH_SIZE
+#define RPL_ROUTING_HASH_SIZE 64
+#endif
+/* slots of the routing table lifetime wheel, one per second, power of 2 */
+#define RPL_ROUTING_WHEEL_SIZE 64
 #define RPL_ROOT_RANK 256
 #define RPL_DEFAULT_LIFETIME 0xff
 #define RPL_LIFETIME_UNIT 2
@@ -175,7 +175,10 @@ typedef struct rpl_of_t {
 typedef struct {
     ipv6_addr_t address;
     ipv6_addr_t next_hop;
-    uint16_t lifetime;
+    uint32_t expires;       /* routing table clock when the lifetime is over */
+    uint16_t hash_next;     /* next entry in hash chain or free list */
+    uint16_t wheel_next;    /* next entry in lifetime wheel slot */
+    uint16_t wheel_prev;    /* previous entry in lifetime wheel slot */
     uint8_t used;
 } rpl_routing_entry_t;
 
@@ -162,9 +162,12 @@ typedef uint32_t  socklen_t;    ///< POSIX compatible type for address length.
 #define TRANSPORT_LAYER_SOCKET_STATIC_MSS       48  ///< Static TCP maxmimum segment size.
 
 /**
- * Static TCP flow control window for window size 1.
+ * Static TCP flow control window, default is window size 1. A larger window
+ * lets the peer have several segments in flight, at most 255 bytes.
  */
+#ifndef TRANSPORT_LAYER_SOCKET_STATIC_WINDOW
 #define TRANSPORT_LAYER_SOCKET_STATIC_WINDOW    1 * TRANSPORT_LAYER_SOCKET_STATIC_MSS
+#endif
 
 /**
  * Maximum size of TCP buffer.
@@ -376,11 +376,11 @@ void icmpv6_send_router_sol(uint8_t sllao)
 void recv_echo_req(void)
 {
     ipv6_buf = ipv6_get_buf();
+
+#ifdef DEBUG_ENABLED
     icmpv6_echo_request_hdr_t *echo_buf = get_echo_req_buf(ipv6_ext_hdr_len);
     uint8_t *echo_data_buf = ((uint8_t *)echo_buf) + sizeof(icmpv6_echo_reply_hdr_t);
     size_t data_len = NTOHS(ipv6_buf->length) - ICMPV6_HDR_LEN - ECHO_REQ_LEN;
-
-#ifdef DEBUG_ENABLED
     char addr_str[IPV6_MAX_ADDR_STR_LEN];
     printf("INFO: received echo request from: %s\n",
            ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN,
@@ -398,8 +398,41 @@ void recv_echo_req(void)
     }
 
 #endif
-    icmpv6_send_echo_reply(&ipv6_buf->srcaddr, NTOHS(echo_buf->id),
-                           NTOHS(echo_buf->seq), echo_data_buf, data_len);
+    /* The reply is the request turned around in place: id, seq and data
+     * stay, only type and pseudo header source change, so the checksum is
+     * updated instead of computed again over the data (RFC 1624). The old
+     * source becomes the destination, it stays in the pseudo header. */
+    ipv6_addr_t old_dest;
+    uint8_t old_type[2], new_type[2];
+
+    icmp_buf = get_icmpv6_buf(ipv6_ext_hdr_len);
+    old_type[0] = icmp_buf->type;
+    old_type[1] = icmp_buf->code;
+    new_type[0] = ICMPV6_TYPE_ECHO_REPLY;
+    new_type[1] = 0;
+    icmp_buf->type = new_type[0];
+    icmp_buf->code = new_type[1];
+
+    memcpy(&old_dest, &ipv6_buf->destaddr, sizeof(ipv6_addr_t));
+    memcpy(&ipv6_buf->destaddr, &ipv6_buf->srcaddr, sizeof(ipv6_addr_t));
+    ipv6_net_if_get_best_src_addr(&ipv6_buf->srcaddr, &ipv6_buf->destaddr);
+
+    ipv6_buf->version_trafficclass = IPV6_VER;
+    ipv6_buf->trafficclass_flowlabel = 0;
+    ipv6_buf->flowlabel = 0;
+    ipv6_buf->hoplimit = ipv6_get_default_hop_limit();
+
+    icmp_buf->checksum = csum_update(icmp_buf->checksum, old_type, new_type, 2);
+    icmp_buf->checksum = csum_update(icmp_buf->checksum, &old_dest,
+                                     &ipv6_buf->srcaddr, sizeof(ipv6_addr_t));
+
+#ifdef DEBUG_ENABLED
+    printf("INFO: send echo reply (id = %04x, seq = %d, data_len = %zu) to: %s\n",
+           NTOHS(echo_buf->id), NTOHS(echo_buf->seq), data_len,
+           ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN,
+                            &ipv6_buf->destaddr));
+#endif
+    ipv6_send_packet(ipv6_buf);
 }
 
 void recv_echo_repl(void)
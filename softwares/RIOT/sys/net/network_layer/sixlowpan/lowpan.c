@@ -28,6 +28,7 @@
 #include "vtimer.h"
 #include "timex.h"
 #include "thread.h"
+#include "irq.h"
 #include "mutex.h"
 #include "hwtimer.h"
 #include "msg.h"
@@ -36,6 +37,7 @@
 #include "sixlowpan/ndp.h"
 
 #include "lowpan.h"
+#include "reassembly.h"
 #ifdef MODULE_SIXLOWBORDER
 #include "border/border.h"
 #endif
@@ -58,52 +60,10 @@ char addr_str[IPV6_MAX_ADDR_STR_LEN];
 
 #define SIXLOWPAN_MAX_REGISTERED        (4)
 
-#define LOWPAN_REAS_BUF_TIMEOUT         (15 * 1000 * 1000)
-/* TODO: Set back to 3 * 1000 * (1000) */
-
 #define IPV6_LL_ADDR_LEN                (8)
 
 #define SIXLOWPAN_FRAG_HDR_MASK         (0xf8)
 
-typedef struct lowpan_interval_list_t {
-    uint8_t                         start;
-    uint8_t                         end;
-    struct lowpan_interval_list_t   *next;
-} lowpan_interval_list_t;
-
-/**
- * @brief   6LoWPAN reassembly buffer.
- *
- * @see <a href="http://tools.ietf.org/html/rfc4944#section-5.3">
- *          RFC 4944, section 5.3
- *      </a>
- */
-typedef struct lowpan_reas_buf_t {
-    net_if_eui64_t s_addr;      ///< Source address
-    net_if_eui64_t d_addr;      ///< Destination address
-    uint16_t tag;               ///< Fragment tag
-    timex_t timestamp;          ///< Timestamp of last packet fragment
-    /**
-     * @brief   Size of reassembled packet with possible IPHC header
-     */
-    uint16_t packet_size;
-    /**
-     * @brief   Additive size of currently already received fragments
-     */
-    uint16_t current_packet_size;
-    /**
-     * @brief   Pointer to allocated memory for reassembled packet + 6LoWPAN
-     *          Dispatch Byte
-     */
-    uint8_t *packet;
-    /**
-     * @brief   Pointer to list of intervals of received packet fragments
-     *          (if any)
-     */
-    lowpan_interval_list_t *interval_list_head;
-    struct lowpan_reas_buf_t *next;
-} lowpan_reas_buf_t;
-
 extern mutex_t lowpan_context_mutex;
 uint16_t tag = 0;
 uint8_t max_frag_initial = 0;
@@ -112,16 +72,12 @@ uint8_t max_frag;
 static uint16_t packet_length;
 static sixlowpan_lowpan_iphc_status_t iphc_status = LOWPAN_IPHC_ENABLE;
 static ipv6_hdr_t *ipv6_buf;
-static lowpan_reas_buf_t *head = NULL;
-static lowpan_reas_buf_t *packet_fifo = NULL;
 
 /* length of compressed packet */
 uint16_t comp_len;
 uint8_t frag_size;
-uint8_t reas_buf[512];
 uint8_t comp_buf[512];
 uint8_t first_frag = 0;
-mutex_t fifo_mutex = MUTEX_INIT;
 
 kernel_pid_t ip_process_pid = KERNEL_PID_UNDEF;
 kernel_pid_t nd_nbr_cache_rem_pid = KERNEL_PID_UNDEF;
@@ -146,11 +102,6 @@ uint8_t lowpan_iphc_encoding(int if_id, const uint8_t *dest, int dest_len,
                              ipv6_hdr_t *ipv6_buf_extra, uint8_t *ptr);
 void lowpan_iphc_decoding(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
                           net_if_eui64_t *d_addr);
-void add_fifo_packet(lowpan_reas_buf_t *current_packet);
-lowpan_reas_buf_t *collect_garbage_fifo(lowpan_reas_buf_t *current_buf);
-lowpan_reas_buf_t *collect_garbage(lowpan_reas_buf_t *current_buf);
-void init_reas_bufs(lowpan_reas_buf_t *buf);
-void check_timeout(void);
 void print_long_local_addr(net_if_eui64_t *saddr);
 
 lowpan_context_t *lowpan_context_lookup(ipv6_addr_t *addr);
@@ -310,50 +261,14 @@ void print_long_local_addr(net_if_eui64_t *saddr)
 
 void sixlowpan_lowpan_print_reassembly_buffers(void)
 {
-    lowpan_reas_buf_t *temp_buffer;
-    lowpan_interval_list_t *temp_interval;
-    temp_buffer = head;
-
     printf("\n\n--- Reassembly Buffers ---\n");
-
-    while (temp_buffer != NULL) {
-        print_long_local_addr(&temp_buffer->s_addr);
-        printf("Ident.: %i, Packet Size: %i/%i, Timestamp: %"PRIu64"\n",
-               temp_buffer->tag, temp_buffer->current_packet_size,
-               temp_buffer->packet_size, timex_uint64(temp_buffer->timestamp));
-        temp_interval = temp_buffer->interval_list_head;
-
-        while (temp_interval != NULL) {
-            printf("\t%i - %i\n", temp_interval->start, temp_interval->end);
-            temp_interval = temp_interval->next;
-        }
-
-        temp_buffer = temp_buffer->next;
-    }
+    lowpan_reas_print_incomplete();
 }
 
 void sixlowpan_lowpan_print_fifo_buffers(void)
 {
-    lowpan_reas_buf_t *temp_buffer;
-    lowpan_interval_list_t *temp_interval;
-    temp_buffer = packet_fifo;
-
     printf("\n\n--- Reassembly Buffers ---\n");
-
-    while (temp_buffer != NULL) {
-        print_long_local_addr(&temp_buffer->s_addr);
-        printf("Ident.: %i, Packet Size: %i/%i, Timestamp: %"PRIu64"\n",
-               temp_buffer->tag, temp_buffer->current_packet_size,
-               temp_buffer->packet_size, timex_uint64(temp_buffer->timestamp));
-        temp_interval = temp_buffer->interval_list_head;
-
-        while (temp_interval != NULL) {
-            printf("\t%i - %i\n", temp_interval->start, temp_interval->end);
-            temp_interval = temp_interval->next;
-        }
-
-        temp_buffer = temp_buffer->next;
-    }
+    lowpan_reas_print_fifo();
 }
 #endif
 
@@ -366,57 +281,53 @@ static void *lowpan_transfer(void *arg)
     lowpan_reas_buf_t *current_buf;
 
     while (1) {
-        uint8_t gotosleep = 1;
-        mutex_lock(&fifo_mutex);
-        current_buf = packet_fifo;
-
-        if (current_buf != NULL) {
-            mutex_unlock(&fifo_mutex);
-
-            if (current_buf->packet[0] == SIXLOWPAN_IPV6_DISPATCH) {
-                DEBUG("INFO: Uncompressed IPv6 dispatch (0x%02x) received\n",
-                      current_buf->packet[0]);
-                ipv6_buf = ipv6_get_buf();
-                memcpy(ipv6_buf, (current_buf->packet) + 1, current_buf->packet_size - 1);
-                m_send.content.ptr = (char *)ipv6_buf;
-                packet_length = current_buf->packet_size - 1;
-                msg_send_receive(&m_send, &m_recv, ip_process_pid);
-            }
-            else if (((current_buf->packet[0] & 0xf0) == IPV6_VER) &&
-                     (iphc_status == LOWPAN_IPHC_DISABLE)) {
-                ipv6_buf = ipv6_get_buf();
-                memcpy(ipv6_buf, (current_buf->packet), current_buf->packet_size);
-                m_send.content.ptr = (char *)ipv6_buf;
-                packet_length = current_buf->packet_size;
-                msg_send_receive(&m_send, &m_recv, ip_process_pid);
-            }
-            else if (((current_buf->packet[0] & 0xe0) == SIXLOWPAN_IPHC1_DISPATCH) &&
-                     (iphc_status == LOWPAN_IPHC_ENABLE)) {
-                DEBUG("INFO: IPHC1 dispatch 0x%02x received, decompress\n",
-                      current_buf->packet[0]);
-                lowpan_iphc_decoding(current_buf->packet,
-                                     current_buf->packet_size,
-                                     &(current_buf->s_addr),
-                                     &(current_buf->d_addr));
-
-                ipv6_buf = ipv6_get_buf();
-                m_send.content.ptr = (char *) ipv6_buf;
-                msg_send_receive(&m_send, &m_recv, ip_process_pid);
-            }
-            else {
-                DEBUG("ERROR: packet with unknown dispatch 0x%02x received\n",
-                      current_buf->packet[0]);
-            }
-
-            collect_garbage_fifo(current_buf);
-            gotosleep = 0;
-        }
-
+        unsigned state = disableIRQ();
 
-        if (gotosleep == 1) {
-            mutex_unlock(&fifo_mutex);
+        /* thread_sleep() enables interrupts after the thread is marked as
+         * sleeping, a completed datagram can't be missed */
+        while ((current_buf = lowpan_reas_fifo_first()) == NULL) {
             thread_sleep();
+            disableIRQ();
+        }
+
+        restoreIRQ(state);
+
+        if (current_buf->packet[0] == SIXLOWPAN_IPV6_DISPATCH) {
+            DEBUG("INFO: Uncompressed IPv6 dispatch (0x%02x) received\n",
+                  current_buf->packet[0]);
+            ipv6_buf = ipv6_get_buf();
+            memcpy(ipv6_buf, (current_buf->packet) + 1, current_buf->packet_size - 1);
+            m_send.content.ptr = (char *)ipv6_buf;
+            packet_length = current_buf->packet_size - 1;
+            msg_send_receive(&m_send, &m_recv, ip_process_pid);
+        }
+        else if (((current_buf->packet[0] & 0xf0) == IPV6_VER) &&
+                 (iphc_status == LOWPAN_IPHC_DISABLE)) {
+            ipv6_buf = ipv6_get_buf();
+            memcpy(ipv6_buf, (current_buf->packet), current_buf->packet_size);
+            m_send.content.ptr = (char *)ipv6_buf;
+            packet_length = current_buf->packet_size;
+            msg_send_receive(&m_send, &m_recv, ip_process_pid);
+        }
+        else if (((current_buf->packet[0] & 0xe0) == SIXLOWPAN_IPHC1_DISPATCH) &&
+                 (iphc_status == LOWPAN_IPHC_ENABLE)) {
+            DEBUG("INFO: IPHC1 dispatch 0x%02x received, decompress\n",
+                  current_buf->packet[0]);
+            lowpan_iphc_decoding(current_buf->packet,
+                                 current_buf->packet_size,
+                                 &(current_buf->s_addr),
+                                 &(current_buf->d_addr));
+
+            ipv6_buf = ipv6_get_buf();
+            m_send.content.ptr = (char *) ipv6_buf;
+            msg_send_receive(&m_send, &m_recv, ip_process_pid);
         }
+        else {
+            DEBUG("ERROR: packet with unknown dispatch 0x%02x received\n",
+                  current_buf->packet[0]);
+        }
+
+        lowpan_reas_fifo_release();
     }
 
     return NULL;
@@ -450,315 +361,32 @@ uint8_t ll_get_addr_match(net_if_eui64_t *src, net_if_eui64_t *dst)
     return val;
 }
 
-lowpan_reas_buf_t *new_packet_buffer(uint16_t datagram_size,
-                                     uint16_t datagram_tag,
-                                     net_if_eui64_t *s_addr,
-                                     net_if_eui64_t *d_addr,
-                                     lowpan_reas_buf_t *current_buf,
-                                     lowpan_reas_buf_t *temp_buf)
-{
-    lowpan_reas_buf_t *new_buf = NULL;
-
-    /* Allocate new memory for a new packet to be reassembled */
-    new_buf = malloc(sizeof(lowpan_reas_buf_t));
-
-    if (new_buf != NULL) {
-        init_reas_bufs(new_buf);
-
-        new_buf->packet = malloc(datagram_size);
-
-        if (new_buf->packet != NULL) {
-            memcpy(&new_buf->s_addr, s_addr, 8);
-            memcpy(&new_buf->d_addr, d_addr, 8);
-
-            new_buf->tag = datagram_tag;
-            new_buf->packet_size = datagram_size;
-
-            vtimer_now(&new_buf->timestamp);
-
-            if ((current_buf == NULL) && (temp_buf == NULL)) {
-                head = new_buf;
-            }
-            else {
-                temp_buf->next = new_buf;
-            }
-
-            return new_buf;
-        }
-        else {
-            return NULL;
-        }
-    }
-    else {
-        return NULL;
-    }
-}
-
-lowpan_reas_buf_t *get_packet_frag_buf(uint16_t datagram_size,
-                                       uint16_t datagram_tag,
-                                       net_if_eui64_t *s_addr,
-                                       net_if_eui64_t *d_addr)
-{
-    lowpan_reas_buf_t *current_buf = NULL, *temp_buf = NULL;
-    current_buf = head;
-
-    while (current_buf != NULL) {
-        if (((ll_get_addr_match(&current_buf->s_addr, s_addr)) == 64) &&
-            ((ll_get_addr_match(&current_buf->d_addr, d_addr)) == 64) &&
-            (current_buf->packet_size == datagram_size) &&
-            (current_buf->tag == datagram_tag) &&
-            current_buf->interval_list_head != NULL) {
-            /* Found buffer for current packet fragment */
-            vtimer_now(&current_buf->timestamp);
-            return current_buf;
-        }
-
-        temp_buf = current_buf;
-        current_buf = current_buf->next;
-    }
-
-    return new_packet_buffer(datagram_size, datagram_tag, s_addr, d_addr,
-                             current_buf, temp_buf);
-}
-
-uint8_t is_in_interval(uint8_t start1, uint8_t end1, uint8_t start2, uint8_t end2)
-{
-    /* 1: Interval 1 and 2 are the same or overlapping */
-    /* 0: Interval 1 and 2 are not overlapping or the same */
-
-    if (((start1 < start2) && (start2 <= end1)) ||
-        ((start2 < start1) && (start1 <= end2)) ||
-        ((start1 == start2) && (end1 == end2))) {
-        return 1;
-    }
-    else {
-        return 0;
-    }
-}
-
-uint8_t handle_packet_frag_interval(lowpan_reas_buf_t *current_buf,
-                                    uint8_t datagram_offset,  uint8_t frag_size)
-{
-    /* 0: Error, discard fragment */
-    /* 1: Finished correctly */
-    lowpan_interval_list_t *temp_interval = NULL, *current_interval = NULL, *new_interval = NULL;
-    current_interval = current_buf->interval_list_head;
-
-    while (current_interval != NULL) {
-        if (is_in_interval(current_interval->start, current_interval->end, datagram_offset, datagram_offset + frag_size) == 1) {
-            /* Interval is overlapping or the same as one of a previous fragment, discard fragment */
-            return 0;
-        }
-
-        temp_interval = current_interval;
-        current_interval = current_interval->next;
-    }
-
-    new_interval = malloc(sizeof(lowpan_interval_list_t));
-
-    if (new_interval != NULL) {
-        new_interval->start = datagram_offset;
-        new_interval->end = datagram_offset + frag_size - 1;
-        new_interval->next = NULL;
-
-        if ((current_interval == NULL) && (temp_interval == NULL)) {
-            current_buf->interval_list_head = new_interval;
-        }
-        else {
-            temp_interval->next = new_interval;
-        }
-
-        return 1;
-    }
-
-    return 0;
-}
-
-lowpan_reas_buf_t *collect_garbage_fifo(lowpan_reas_buf_t *current_buf)
-{
-    lowpan_interval_list_t *temp_list, *current_list;
-    lowpan_reas_buf_t *temp_buf, *my_buf, *return_buf;
-
-    mutex_lock(&fifo_mutex);
-
-    temp_buf = packet_fifo;
-    my_buf = temp_buf;
-
-    if (packet_fifo == current_buf) {
-        packet_fifo = current_buf->next;
-        return_buf = packet_fifo;
-    }
-    else {
-        while (temp_buf != current_buf) {
-            my_buf = temp_buf;
-            temp_buf = temp_buf->next;
-        }
-
-        my_buf->next = current_buf->next;
-
-        return_buf = my_buf->next;
-    }
-
-    mutex_unlock(&fifo_mutex);
-
-    current_list = current_buf->interval_list_head;
-    temp_list = current_list;
-
-    while (current_list != NULL) {
-        temp_list = current_list->next;
-        free(current_list);
-        current_list = temp_list;
-    }
-
-    free(current_buf->packet);
-    free(current_buf);
-
-    return return_buf;
-}
-
-lowpan_reas_buf_t *collect_garbage(lowpan_reas_buf_t *current_buf)
-{
-    lowpan_interval_list_t *temp_list, *current_list;
-    lowpan_reas_buf_t *temp_buf, *my_buf, *return_buf;
-
-    temp_buf = head;
-    my_buf = temp_buf;
-
-    if (head == current_buf) {
-        head = current_buf->next;
-        return_buf = head;
-    }
-    else {
-        while (temp_buf != current_buf) {
-            my_buf = temp_buf;
-            temp_buf = temp_buf->next;
-        }
-
-        my_buf->next = current_buf->next;
-
-        return_buf = my_buf->next;
-    }
-
-    current_list = current_buf->interval_list_head;
-    temp_list = current_list;
-
-    while (current_list != NULL) {
-        temp_list = current_list->next;
-        free(current_list);
-        current_list = temp_list;
-    }
-
-    free(current_buf->packet);
-    free(current_buf);
-
-    return return_buf;
-}
-
-void handle_packet_fragment(uint8_t *data, uint8_t datagram_offset,
+void handle_packet_fragment(uint8_t *data, uint16_t datagram_offset,
                             uint16_t datagram_size, uint16_t datagram_tag,
                             net_if_eui64_t *s_addr, net_if_eui64_t *d_addr,
                             uint8_t hdr_length, uint8_t frag_size)
 {
     lowpan_reas_buf_t *current_buf;
-    /* Is there already a reassembly buffer for this packet fragment? */
-    current_buf = get_packet_frag_buf(datagram_size, datagram_tag, s_addr,
-                                      d_addr);
-
-    if ((current_buf != NULL) && (handle_packet_frag_interval(current_buf,
-                                  datagram_offset,
-                                  frag_size) == 1)) {
-        /* Copy fragment bytes into corresponding packet space area */
-        memcpy(current_buf->packet + datagram_offset, data + hdr_length, frag_size);
-        current_buf->current_packet_size += frag_size;
+    int res;
 
-        if (current_buf->current_packet_size == current_buf->packet_size) {
-            add_fifo_packet(current_buf);
-
-            if (thread_getstatus(transfer_pid) == STATUS_SLEEPING) {
-                thread_wakeup(transfer_pid);
-            }
-        }
-    }
-    else {
-        /* No memory left or duplicate */
-        if (current_buf == NULL) {
-            printf("ERROR: no memory left!\n");
-        }
-        else {
-            printf("ERROR: duplicate fragment!\n");
-        }
-    }
-}
-
-void check_timeout(void)
-{
-    lowpan_reas_buf_t *temp_buf, *smallest_time = NULL;
-    int count = 0;
-
-    timex_t now;
-    vtimer_now(&now);
-    temp_buf = head;
-
-    while (temp_buf != NULL) {
-        if ((timex_uint64(now) - timex_uint64(temp_buf->timestamp)) >= LOWPAN_REAS_BUF_TIMEOUT) {
-            printf("TIMEOUT!cur_time: %" PRIu64 ", temp_buf: %" PRIu64 "\n", timex_uint64(now),
-                   timex_uint64(temp_buf->timestamp));
-            temp_buf = collect_garbage(temp_buf);
-        }
-        else {
-            if (smallest_time == NULL) {
-                smallest_time = temp_buf;
-            }
-            else if (timex_cmp(temp_buf->timestamp, smallest_time->timestamp) < 0) {
-                smallest_time = temp_buf;
-            }
-
-            temp_buf = temp_buf->next;
-            count++;
-        }
-    }
-
-    if ((count > 10) && (smallest_time != NULL)) {
-        collect_garbage(smallest_time);
-    }
-}
-
-void add_fifo_packet(lowpan_reas_buf_t *current_packet)
-{
-    lowpan_reas_buf_t *temp_buf, *my_buf;
+    /* Is there already a reassembly buffer for this packet fragment? */
+    current_buf = lowpan_reas_get(datagram_size, datagram_tag, s_addr, d_addr);
 
-    if (head == current_packet) {
-        head = current_packet->next;
+    if (current_buf == NULL) {
+        printf("ERROR: no memory left!\n");
+        return;
     }
-    else {
-        temp_buf = head;
 
-        while (temp_buf != current_packet) {
-            my_buf = temp_buf;
-            temp_buf = temp_buf->next;
-        }
+    /* Copy fragment bytes into corresponding packet space area */
+    res = lowpan_reas_add(current_buf, data + hdr_length, datagram_offset,
+                          frag_size);
 
-        my_buf->next = current_packet->next;
+    if (res < 0) {
+        printf("ERROR: duplicate fragment!\n");
     }
-
-    mutex_lock(&fifo_mutex);
-
-    if (packet_fifo == NULL) {
-        packet_fifo = current_packet;
+    else if ((res > 0) && (thread_getstatus(transfer_pid) == STATUS_SLEEPING)) {
+        thread_wakeup(transfer_pid);
     }
-    else {
-        temp_buf = packet_fifo;
-
-        while (temp_buf != NULL) {
-            my_buf = temp_buf;
-            temp_buf = temp_buf->next;
-        }
-
-        my_buf->next = current_packet;
-    }
-
-    mutex_unlock(&fifo_mutex);
-    current_packet->next = NULL;
 }
 
 /* Register an upper layer thread */
@@ -786,7 +414,7 @@ void lowpan_read(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
     /* check if packet is fragmented */
     short i;
 
-    check_timeout();
+    lowpan_reas_check_timeout();
 
     for (i = 0; i < SIXLOWPAN_MAX_REGISTERED; i++) {
         if (sixlowpan_reg[i]) {
@@ -855,13 +483,11 @@ void lowpan_read(uint8_t *data, uint8_t length, net_if_eui64_t *s_addr,
     else {
         DEBUG("INFO: unfragmentated packet with first byte 0x%02x received\n",
               data[0]);
-        lowpan_reas_buf_t *current_buf = get_packet_frag_buf(length, 0, s_addr, d_addr);
+        lowpan_reas_buf_t *current_buf = lowpan_reas_new(length, 0, s_addr, d_addr);
 
-        if (current_buf && current_buf->packet) {
+        if (current_buf) {
             /* Copy packet bytes into corresponding packet space area */
-            memcpy(current_buf->packet, data, length);
-            current_buf->current_packet_size += length;
-            add_fifo_packet(current_buf);
+            lowpan_reas_add(current_buf, data, 0, length);
         }
         else {
             DEBUG("ERROR: no memory left in packet buffer!\n");
@@ -1663,19 +1289,6 @@ static void *lowpan_context_auto_remove(void *arg)
     return NULL;
 }
 
-void init_reas_bufs(lowpan_reas_buf_t *buf)
-{
-    memset(&buf->s_addr, 0, sizeof(net_if_eui64_t));
-    memset(&buf->d_addr, 0, sizeof(net_if_eui64_t));
-    buf->tag = 0;
-    memset(&buf->timestamp, 0, sizeof(timex_t));
-    buf->packet_size = 0;
-    buf->current_packet_size = 0;
-    buf->packet = NULL;
-    buf->interval_list_head = NULL;
-    buf->next = NULL;
-}
-
 int sixlowpan_lowpan_init_adhoc_interface(int if_id, const ipv6_addr_t *prefix)
 {
     ipv6_addr_t tmp;
@@ -1783,6 +1396,8 @@ int sixlowpan_lowpan_init(void)
 {
     short i;
 
+    lowpan_reas_init();
+
     /* init mac-layer and radio transceiver */
     sixlowpan_mac_init();
 
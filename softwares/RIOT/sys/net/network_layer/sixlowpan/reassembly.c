@@ -0,0 +1,315 @@
+/*
+ * 6LoWPAN reassembly buffers
+ *
+ * Copyright (C) 2014  Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ *
+ * @ingroup sixlowpan
+ * @{
+ * @file    reassembly.c
+ * @brief   Preallocated 6LoWPAN reassembly buffers
+ * @author  DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ * @}
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "irq.h"
+#include "vtimer.h"
+
+#include "reassembly.h"
+
+#define LOWPAN_REAS_NONE            (0xff)
+
+#define LOWPAN_REAS_FREE            (0)
+#define LOWPAN_REAS_INCOMPLETE      (1)
+#define LOWPAN_REAS_COMPLETE        (2)
+
+static lowpan_reas_buf_t reas_bufs[LOWPAN_REAS_BUF_COUNT];
+
+/* first incomplete datagram of each hash chain */
+static uint8_t reas_hash[LOWPAN_REAS_HASH_SIZE];
+
+static volatile uint8_t reas_free = LOWPAN_REAS_NONE;
+static volatile uint8_t reas_fifo_head = LOWPAN_REAS_NONE;
+static volatile uint8_t reas_fifo_tail = LOWPAN_REAS_NONE;
+
+static uint8_t reas_hash_key(uint16_t datagram_size, uint16_t datagram_tag,
+                             net_if_eui64_t *s_addr)
+{
+    uint16_t key = datagram_size ^ datagram_tag ^ s_addr->uint16[3];
+
+    key ^= key >> 8;
+    key ^= key >> 4;
+
+    return key & (LOWPAN_REAS_HASH_SIZE - 1);
+}
+
+static void reas_hash_remove(lowpan_reas_buf_t *buf)
+{
+    uint8_t *link = &reas_hash[reas_hash_key(buf->packet_size, buf->tag,
+                                             &buf->s_addr)];
+    uint8_t index = buf - reas_bufs;
+
+    while (*link != LOWPAN_REAS_NONE) {
+        if (*link == index) {
+            *link = buf->next;
+            return;
+        }
+
+        link = &reas_bufs[*link].next;
+    }
+}
+
+static void reas_free_push(lowpan_reas_buf_t *buf)
+{
+    unsigned state = disableIRQ();
+
+    buf->state = LOWPAN_REAS_FREE;
+    buf->next = reas_free;
+    reas_free = buf - reas_bufs;
+
+    restoreIRQ(state);
+}
+
+static lowpan_reas_buf_t *reas_free_pop(void)
+{
+    lowpan_reas_buf_t *buf = NULL;
+    unsigned state = disableIRQ();
+
+    if (reas_free != LOWPAN_REAS_NONE) {
+        buf = &reas_bufs[reas_free];
+        reas_free = buf->next;
+    }
+
+    restoreIRQ(state);
+
+    return buf;
+}
+
+static void reas_fifo_push(lowpan_reas_buf_t *buf)
+{
+    unsigned state = disableIRQ();
+
+    buf->state = LOWPAN_REAS_COMPLETE;
+    buf->next = LOWPAN_REAS_NONE;
+
+    if (reas_fifo_tail == LOWPAN_REAS_NONE) {
+        reas_fifo_head = buf - reas_bufs;
+    }
+    else {
+        reas_bufs[reas_fifo_tail].next = buf - reas_bufs;
+    }
+
+    reas_fifo_tail = buf - reas_bufs;
+
+    restoreIRQ(state);
+}
+
+void lowpan_reas_init(void)
+{
+    reas_free = LOWPAN_REAS_NONE;
+    reas_fifo_head = LOWPAN_REAS_NONE;
+    reas_fifo_tail = LOWPAN_REAS_NONE;
+    memset(reas_hash, LOWPAN_REAS_NONE, sizeof(reas_hash));
+
+    for (int i = LOWPAN_REAS_BUF_COUNT - 1; i >= 0; i--) {
+        reas_free_push(&reas_bufs[i]);
+    }
+}
+
+lowpan_reas_buf_t *lowpan_reas_new(uint16_t datagram_size,
+                                   uint16_t datagram_tag,
+                                   net_if_eui64_t *s_addr,
+                                   net_if_eui64_t *d_addr)
+{
+    lowpan_reas_buf_t *buf;
+    uint8_t key;
+
+    if ((datagram_size == 0) || (datagram_size > LOWPAN_REAS_BUF_SIZE)) {
+        return NULL;
+    }
+
+    buf = reas_free_pop();
+
+    if (buf == NULL) {
+        /* drop the oldest incomplete datagram */
+        for (int i = 0; i < LOWPAN_REAS_BUF_COUNT; i++) {
+            if ((reas_bufs[i].state == LOWPAN_REAS_INCOMPLETE) &&
+                ((buf == NULL) ||
+                 (timex_cmp(reas_bufs[i].timestamp, buf->timestamp) < 0))) {
+                buf = &reas_bufs[i];
+            }
+        }
+
+        if (buf == NULL) {
+            return NULL;
+        }
+
+        reas_hash_remove(buf);
+    }
+
+    memcpy(&buf->s_addr, s_addr, sizeof(net_if_eui64_t));
+    memcpy(&buf->d_addr, d_addr, sizeof(net_if_eui64_t));
+    buf->tag = datagram_tag;
+    buf->packet_size = datagram_size;
+    buf->current_packet_size = 0;
+    memset(buf->frag_bitmap, 0, sizeof(buf->frag_bitmap));
+    vtimer_now(&buf->timestamp);
+
+    key = reas_hash_key(datagram_size, datagram_tag, s_addr);
+    buf->state = LOWPAN_REAS_INCOMPLETE;
+    buf->next = reas_hash[key];
+    reas_hash[key] = buf - reas_bufs;
+
+    return buf;
+}
+
+lowpan_reas_buf_t *lowpan_reas_get(uint16_t datagram_size,
+                                   uint16_t datagram_tag,
+                                   net_if_eui64_t *s_addr,
+                                   net_if_eui64_t *d_addr)
+{
+    uint8_t index = reas_hash[reas_hash_key(datagram_size, datagram_tag,
+                                            s_addr)];
+
+    while (index != LOWPAN_REAS_NONE) {
+        lowpan_reas_buf_t *buf = &reas_bufs[index];
+
+        if ((buf->tag == datagram_tag) &&
+            (buf->packet_size == datagram_size) &&
+            (buf->s_addr.uint64 == s_addr->uint64) &&
+            (buf->d_addr.uint64 == d_addr->uint64)) {
+            /* Found buffer for current packet fragment */
+            vtimer_now(&buf->timestamp);
+            return buf;
+        }
+
+        index = buf->next;
+    }
+
+    return lowpan_reas_new(datagram_size, datagram_tag, s_addr, d_addr);
+}
+
+int lowpan_reas_add(lowpan_reas_buf_t *buf, const uint8_t *data,
+                    uint16_t offset, uint16_t size)
+{
+    uint16_t unit, last_unit;
+
+    if ((size == 0) || (offset + size > buf->packet_size)) {
+        return -1;
+    }
+
+    /* fragments start at 8-byte units, only the last one ends inside a unit,
+     * so fragments overlap iff they share a unit */
+    last_unit = (offset + size - 1) / 8;
+
+    for (unit = offset / 8; unit <= last_unit; unit++) {
+        if (buf->frag_bitmap[unit / 8] & (1 << (unit % 8))) {
+            return -1;
+        }
+    }
+
+    for (unit = offset / 8; unit <= last_unit; unit++) {
+        buf->frag_bitmap[unit / 8] |= (1 << (unit % 8));
+    }
+
+    memcpy(buf->packet + offset, data, size);
+    buf->current_packet_size += size;
+
+    if (buf->current_packet_size < buf->packet_size) {
+        return 0;
+    }
+
+    reas_hash_remove(buf);
+    reas_fifo_push(buf);
+
+    return 1;
+}
+
+lowpan_reas_buf_t *lowpan_reas_fifo_first(void)
+{
+    uint8_t index = reas_fifo_head;
+
+    return (index == LOWPAN_REAS_NONE) ? NULL : &reas_bufs[index];
+}
+
+void lowpan_reas_fifo_release(void)
+{
+    lowpan_reas_buf_t *buf;
+    unsigned state = disableIRQ();
+
+    if (reas_fifo_head == LOWPAN_REAS_NONE) {
+        restoreIRQ(state);
+        return;
+    }
+
+    buf = &reas_bufs[reas_fifo_head];
+    reas_fifo_head = buf->next;
+
+    if (reas_fifo_head == LOWPAN_REAS_NONE) {
+        reas_fifo_tail = LOWPAN_REAS_NONE;
+    }
+
+    restoreIRQ(state);
+
+    reas_free_push(buf);
+}
+
+void lowpan_reas_check_timeout(void)
+{
+    timex_t now;
+
+    vtimer_now(&now);
+
+    for (int i = 0; i < LOWPAN_REAS_BUF_COUNT; i++) {
+        lowpan_reas_buf_t *buf = &reas_bufs[i];
+
+        if ((buf->state == LOWPAN_REAS_INCOMPLETE) &&
+            ((timex_uint64(now) - timex_uint64(buf->timestamp)) >= LOWPAN_REAS_BUF_TIMEOUT)) {
+            printf("TIMEOUT!cur_time: %" PRIu64 ", temp_buf: %" PRIu64 "\n", timex_uint64(now),
+                   timex_uint64(buf->timestamp));
+            reas_hash_remove(buf);
+            reas_free_push(buf);
+        }
+    }
+}
+
+static void reas_print(lowpan_reas_buf_t *buf)
+{
+    printf("%02x%02x:%02x%02x:%02x%02x:%02x%02x\n",
+           buf->s_addr.uint8[0], buf->s_addr.uint8[1], buf->s_addr.uint8[2],
+           buf->s_addr.uint8[3], buf->s_addr.uint8[4], buf->s_addr.uint8[5],
+           buf->s_addr.uint8[6], buf->s_addr.uint8[7]);
+    printf("Ident.: %i, Packet Size: %i/%i, Timestamp: %"PRIu64"\n",
+           buf->tag, buf->current_packet_size, buf->packet_size,
+           timex_uint64(buf->timestamp));
+    printf("\t");
+
+    for (unsigned i = 0; i < sizeof(buf->frag_bitmap); i++) {
+        printf("%02x", buf->frag_bitmap[i]);
+    }
+
+    printf("\n");
+}
+
+void lowpan_reas_print_incomplete(void)
+{
+    for (int i = 0; i < LOWPAN_REAS_BUF_COUNT; i++) {
+        if (reas_bufs[i].state == LOWPAN_REAS_INCOMPLETE) {
+            reas_print(&reas_bufs[i]);
+        }
+    }
+}
+
+void lowpan_reas_print_fifo(void)
+{
+    for (uint8_t i = reas_fifo_head; i != LOWPAN_REAS_NONE; i = reas_bufs[i].next) {
+        reas_print(&reas_bufs[i]);
+    }
+}
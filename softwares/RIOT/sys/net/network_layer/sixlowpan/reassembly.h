@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2014  Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file        network_layer/sixlowpan/reassembly.h
+ * @brief       6LoWPAN reassembly buffers
+ *
+ *              A fixed number of reassembly buffers of LOWPAN_REAS_BUF_SIZE
+ *              bytes is allocated statically. Received 8-byte units of a
+ *              datagram are marked in a bitmap, incomplete datagrams are
+ *              found by a hash on (source, tag, size). Completed datagrams
+ *              wait in a FIFO for the transfer thread.
+ *
+ *              Incomplete datagrams are only handled by the receiving
+ *              thread. Free buffers and the FIFO are shared with the
+ *              transfer thread, they are changed with interrupts disabled
+ *              (a few instructions), so the transfer thread can check the
+ *              FIFO and sleep atomically.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef _SIXLOWPAN_REASSEMBLY_H
+#define _SIXLOWPAN_REASSEMBLY_H
+
+#include <stdint.h>
+
+#include "timex.h"
+#include "net_if.h"
+#include "sixlowpan/ip.h"
+
+/**
+ * @brief   Number of reassembly buffers, incomplete and completed datagrams.
+ */
+#ifndef LOWPAN_REAS_BUF_COUNT
+#define LOWPAN_REAS_BUF_COUNT       (4)
+#endif
+
+/**
+ * @brief   Size of a reassembly buffer, largest IPv6 packet and dispatch byte.
+ */
+#define LOWPAN_REAS_BUF_SIZE        (IPV6_MTU + 1)
+
+/**
+ * @brief   Number of hash chains of incomplete datagrams, power of 2.
+ */
+#define LOWPAN_REAS_HASH_SIZE       (8)
+
+#define LOWPAN_REAS_BUF_TIMEOUT     (15 * 1000 * 1000)
+/* TODO: Set back to 3 * 1000 * (1000) */
+
+#define LOWPAN_REAS_UNITS           ((LOWPAN_REAS_BUF_SIZE + 7) / 8)
+
+/**
+ * @brief   6LoWPAN reassembly buffer.
+ *
+ * @see <a href="http://tools.ietf.org/html/rfc4944#section-5.3">
+ *          RFC 4944, section 5.3
+ *      </a>
+ */
+typedef struct lowpan_reas_buf_t {
+    net_if_eui64_t s_addr;      ///< Source address
+    net_if_eui64_t d_addr;      ///< Destination address
+    uint16_t tag;               ///< Fragment tag
+    timex_t timestamp;          ///< Timestamp of last packet fragment
+    /**
+     * @brief   Size of reassembled packet with possible IPHC header
+     */
+    uint16_t packet_size;
+    /**
+     * @brief   Additive size of currently already received fragments
+     */
+    uint16_t current_packet_size;
+    uint8_t state;              ///< Free, incomplete or completed
+    uint8_t next;               ///< Next buffer in hash chain, FIFO or free list
+    /**
+     * @brief   Received 8-byte units of the packet, bit n is bytes 8n..8n+7
+     */
+    uint8_t frag_bitmap[(LOWPAN_REAS_UNITS + 7) / 8];
+    /**
+     * @brief   Reassembled packet + 6LoWPAN Dispatch Byte
+     */
+    uint8_t packet[LOWPAN_REAS_BUF_SIZE];
+} lowpan_reas_buf_t;
+
+/**
+ * @brief   Initialize reassembly buffers, all free.
+ */
+void lowpan_reas_init(void);
+
+/**
+ * @brief   Get the buffer of an incomplete datagram, a new one if there
+ *          is none. If all buffers are used, the oldest incomplete
+ *          datagram is dropped.
+ *
+ * @param[in] datagram_size Size of the datagram.
+ * @param[in] datagram_tag  Fragment tag.
+ * @param[in] s_addr        Source address.
+ * @param[in] d_addr        Destination address.
+ *
+ * @return  The buffer, NULL if the datagram is larger than
+ *          LOWPAN_REAS_BUF_SIZE or all buffers wait in the FIFO.
+ */
+lowpan_reas_buf_t *lowpan_reas_get(uint16_t datagram_size,
+                                   uint16_t datagram_tag,
+                                   net_if_eui64_t *s_addr,
+                                   net_if_eui64_t *d_addr);
+
+/**
+ * @brief   Get a new buffer, also if an incomplete datagram with same
+ *          source, tag and size exists. Used for unfragmented packets.
+ *
+ * @see lowpan_reas_get
+ */
+lowpan_reas_buf_t *lowpan_reas_new(uint16_t datagram_size,
+                                   uint16_t datagram_tag,
+                                   net_if_eui64_t *s_addr,
+                                   net_if_eui64_t *d_addr);
+
+/**
+ * @brief   Copy a fragment into its buffer. The buffer is moved to the FIFO
+ *          when the datagram is complete.
+ *
+ * @param[in] buf       Buffer of the datagram.
+ * @param[in] data      Fragment payload.
+ * @param[in] offset    Offset of the fragment in the datagram, multiple of 8.
+ * @param[in] size      Size of the fragment payload.
+ *
+ * @return  1 if the datagram is complete, 0 if not, -1 if the fragment is
+ *          discarded (overlapping, duplicate or out of datagram).
+ */
+int lowpan_reas_add(lowpan_reas_buf_t *buf, const uint8_t *data,
+                    uint16_t offset, uint16_t size);
+
+/**
+ * @brief   Oldest completed datagram.
+ *
+ * @return  Its buffer, NULL if the FIFO is empty.
+ */
+lowpan_reas_buf_t *lowpan_reas_fifo_first(void);
+
+/**
+ * @brief   Free the oldest completed datagram, returned by
+ *          lowpan_reas_fifo_first().
+ */
+void lowpan_reas_fifo_release(void);
+
+/**
+ * @brief   Drop incomplete datagrams older than LOWPAN_REAS_BUF_TIMEOUT.
+ */
+void lowpan_reas_check_timeout(void);
+
+/**
+ * @brief   Print incomplete datagrams.
+ */
+void lowpan_reas_print_incomplete(void);
+
+/**
+ * @brief   Print completed datagrams in FIFO.
+ */
+void lowpan_reas_print_fifo(void);
+
+#endif  /* _SIXLOWPAN_REASSEMBLY_H */
@@ -46,6 +46,12 @@ char addr_str[IPV6_MAX_ADDR_STR_LEN];
 #endif
 #include "debug.h"
 
+#define RPL_ROUTING_NONE (0xffff)
+
+#if RPL_MAX_ROUTING_ENTRIES >= RPL_ROUTING_NONE
+#error "routing entries are indexed by uint16_t"
+#endif
+
 /* global variables */
 rpl_of_t *rpl_objective_functions[NUMBER_IMPLEMENTED_OFS];
 rpl_routing_entry_t rpl_routing_table[RPL_MAX_ROUTING_ENTRIES];
@@ -59,6 +65,16 @@ uint8_t rpl_buffer[BUFFER_SIZE - LL_HDR_LEN];
 /* IPv6 message buffer */
 ipv6_hdr_t *ipv6_buf;
 
+/* routing entries by interface identifier, lookups don't lock, changes are
+ * serialized by rt_mutex */
+static uint16_t rt_hash[RPL_ROUTING_HASH_SIZE];
+/* routing entries by expiry second modulo RPL_ROUTING_WHEEL_SIZE */
+static uint16_t rt_wheel[RPL_ROUTING_WHEEL_SIZE];
+static uint16_t rt_free = RPL_ROUTING_NONE;
+/* seconds counted by rpl_expire_routing_entries() */
+static uint32_t rt_clock;
+static mutex_t rt_mutex = MUTEX_INIT;
+
 /* find implemented OF via objective code point */
 rpl_of_t *rpl_get_of_for_ocp(uint16_t ocp)
 {
@@ -172,7 +188,7 @@ void send_DIO(ipv6_addr_t *destination)
     mutex_unlock(&rpl_send_mutex);
 }
 
-void send_DAO(ipv6_addr_t *destination, uint8_t lifetime, bool default_lifetime, uint8_t start_index)
+void send_DAO(ipv6_addr_t *destination, uint8_t lifetime, bool default_lifetime, uint16_t start_index)
 {
     DEBUG("Send DAO to %s\n", ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN, destination));
 
@@ -235,17 +251,78 @@ void recv_rpl_DAO_ACK(void)
 /* Routing related functions are obsolete and will be replaced in near future */
 /******************************************************************************/
 
+static uint16_t rt_hash_key(ipv6_addr_t *addr)
+{
+    uint32_t key = addr->uint32[2] ^ addr->uint32[3];
+
+    key ^= key >> 16;
+    key ^= key >> 8;
+
+    return key & (RPL_ROUTING_HASH_SIZE - 1);
+}
+
+static void rt_wheel_insert(uint16_t index, uint16_t lifetime)
+{
+    rpl_routing_entry_t *entry = &rpl_routing_table[index];
+    uint16_t *slot;
+
+    /* removed at the lifetime-th clock tick, lifetime 0 at the next one */
+    entry->expires = rt_clock + ((lifetime > 0) ? lifetime : 1);
+    slot = &rt_wheel[entry->expires & (RPL_ROUTING_WHEEL_SIZE - 1)];
+    entry->wheel_prev = RPL_ROUTING_NONE;
+    entry->wheel_next = *slot;
+
+    if (*slot != RPL_ROUTING_NONE) {
+        rpl_routing_table[*slot].wheel_prev = index;
+    }
+
+    *slot = index;
+}
+
+static void rt_wheel_remove(uint16_t index)
+{
+    rpl_routing_entry_t *entry = &rpl_routing_table[index];
+
+    if (entry->wheel_prev == RPL_ROUTING_NONE) {
+        rt_wheel[entry->expires & (RPL_ROUTING_WHEEL_SIZE - 1)] = entry->wheel_next;
+    }
+    else {
+        rpl_routing_table[entry->wheel_prev].wheel_next = entry->wheel_next;
+    }
+
+    if (entry->wheel_next != RPL_ROUTING_NONE) {
+        rpl_routing_table[entry->wheel_next].wheel_prev = entry->wheel_prev;
+    }
+}
+
+static void rt_remove(uint16_t index)
+{
+    rpl_routing_entry_t *entry = &rpl_routing_table[index];
+    uint16_t *link = &rt_hash[rt_hash_key(&entry->address)];
+
+    while (*link != RPL_ROUTING_NONE) {
+        if (*link == index) {
+            *link = entry->hash_next;
+            break;
+        }
+
+        link = &rpl_routing_table[*link].hash_next;
+    }
+
+    rt_wheel_remove(index);
+    memset(entry, 0, sizeof(*entry));
+    entry->hash_next = rt_free;
+    rt_free = index;
+}
+
 ipv6_addr_t *rpl_get_next_hop(ipv6_addr_t *addr)
 {
     DEBUGF("looking up the next hop to %s\n", ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN, addr));
-    for (uint8_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
-        if (rpl_routing_table[i].used) {
-            DEBUGF("checking %d: %s\n", i, ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN, &rpl_routing_table[i].address));
-        }
-        if (rpl_routing_table[i].used && rpl_equal_id(&rpl_routing_table[i].address, addr)) {
-            DEBUGF("found %d: %s\n", i, ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN, &rpl_routing_table[i].next_hop));
-            return &rpl_routing_table[i].next_hop;
-        }
+    rpl_routing_entry_t *entry = rpl_find_routing_entry(addr);
+
+    if (entry != NULL) {
+        DEBUGF("found %d: %s\n", (int)(entry - rpl_routing_table), ipv6_addr_to_str(addr_str, IPV6_MAX_ADDR_STR_LEN, &entry->next_hop));
+        return &entry->next_hop;
     }
 
     return (rpl_get_my_preferred_parent());
@@ -253,40 +330,61 @@ ipv6_addr_t *rpl_get_next_hop(ipv6_addr_t *addr)
 
 void rpl_add_routing_entry(ipv6_addr_t *addr, ipv6_addr_t *next_hop, uint16_t lifetime)
 {
+    mutex_lock(&rt_mutex);
     rpl_routing_entry_t *entry = rpl_find_routing_entry(addr);
+    uint16_t index;
 
     if (entry != NULL) {
-        entry->lifetime = lifetime;
+        index = entry - rpl_routing_table;
+        rt_wheel_remove(index);
+        rt_wheel_insert(index, lifetime);
+        mutex_unlock(&rt_mutex);
         return;
     }
 
-    for (uint8_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
-        if (!rpl_routing_table[i].used) {
-            memcpy(&rpl_routing_table[i].address, addr, sizeof(ipv6_addr_t));
-            memcpy(&rpl_routing_table[i].next_hop, next_hop, sizeof(ipv6_addr_t));
-            rpl_routing_table[i].lifetime = lifetime;
-            rpl_routing_table[i].used = 1;
-            break;
-        }
+    /* table full */
+    if (rt_free == RPL_ROUTING_NONE) {
+        mutex_unlock(&rt_mutex);
+        return;
     }
+
+    index = rt_free;
+    entry = &rpl_routing_table[index];
+    rt_free = entry->hash_next;
+
+    memcpy(&entry->address, addr, sizeof(ipv6_addr_t));
+    memcpy(&entry->next_hop, next_hop, sizeof(ipv6_addr_t));
+    entry->used = 1;
+    rt_wheel_insert(index, lifetime);
+
+    /* complete entry before it is found by lookups */
+    entry->hash_next = rt_hash[rt_hash_key(addr)];
+    rt_hash[rt_hash_key(addr)] = index;
+    mutex_unlock(&rt_mutex);
 }
 
 void rpl_del_routing_entry(ipv6_addr_t *addr)
 {
-    for (uint8_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
-        if (rpl_routing_table[i].used && rpl_equal_id(&rpl_routing_table[i].address, addr)) {
-            memset(&rpl_routing_table[i], 0, sizeof(rpl_routing_table[i]));
-            return;
-        }
+    mutex_lock(&rt_mutex);
+    rpl_routing_entry_t *entry = rpl_find_routing_entry(addr);
+
+    if (entry != NULL) {
+        rt_remove(entry - rpl_routing_table);
     }
+
+    mutex_unlock(&rt_mutex);
 }
 
 rpl_routing_entry_t *rpl_find_routing_entry(ipv6_addr_t *addr)
 {
-    for (uint8_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
-        if (rpl_routing_table[i].used && rpl_equal_id(&rpl_routing_table[i].address, addr)) {
-            return &rpl_routing_table[i];
+    uint16_t index = rt_hash[rt_hash_key(addr)];
+
+    while (index != RPL_ROUTING_NONE) {
+        if (rpl_equal_id(&rpl_routing_table[index].address, addr)) {
+            return &rpl_routing_table[index];
         }
+
+        index = rpl_routing_table[index].hash_next;
     }
 
     return NULL;
@@ -294,10 +392,26 @@ rpl_routing_entry_t *rpl_find_routing_entry(ipv6_addr_t *addr)
 
 void rpl_clear_routing_table(void)
 {
-    for (uint8_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
-        memset(&rpl_routing_table[i], 0, sizeof(rpl_routing_table[i]));
+    mutex_lock(&rt_mutex);
+    memset(rpl_routing_table, 0, sizeof(rpl_routing_table));
+
+    for (uint16_t i = 0; i < RPL_ROUTING_HASH_SIZE; i++) {
+        rt_hash[i] = RPL_ROUTING_NONE;
     }
 
+    for (uint16_t i = 0; i < RPL_ROUTING_WHEEL_SIZE; i++) {
+        rt_wheel[i] = RPL_ROUTING_NONE;
+    }
+
+    /* free list in table order */
+    for (uint16_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
+        rpl_routing_table[i].hash_next = i + 1;
+    }
+
+    rpl_routing_table[RPL_MAX_ROUTING_ENTRIES - 1].hash_next = RPL_ROUTING_NONE;
+    rt_free = 0;
+    rt_clock = 0;
+    mutex_unlock(&rt_mutex);
 }
 
 rpl_routing_entry_t *rpl_get_routing_table(void)
@@ -305,5 +419,31 @@ rpl_routing_entry_t *rpl_get_routing_table(void)
     return rpl_routing_table;
 }
 
+uint32_t rpl_get_routing_entry_lifetime(rpl_routing_entry_t *entry)
+{
+    return entry->expires - rt_clock;
+}
+
+void rpl_expire_routing_entries(void)
+{
+    mutex_lock(&rt_mutex);
+    rt_clock++;
+
+    /* entries of later wheel rounds stay */
+    uint16_t index = rt_wheel[rt_clock & (RPL_ROUTING_WHEEL_SIZE - 1)];
+
+    while (index != RPL_ROUTING_NONE) {
+        uint16_t next = rpl_routing_table[index].wheel_next;
+
+        if (rpl_routing_table[index].expires == rt_clock) {
+            rt_remove(index);
+        }
+
+        index = next;
+    }
+
+    mutex_unlock(&rt_mutex);
+}
+
 /******************************************************************************/
 /******************************************************************************/
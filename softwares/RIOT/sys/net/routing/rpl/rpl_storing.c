@@ -268,7 +268,7 @@ void send_DIO_mode(ipv6_addr_t *destination)
     rpl_send(destination, (uint8_t *)icmp_send_buf, plen, IPV6_PROTO_NUM_ICMPV6);
 }
 
-void send_DAO_mode(ipv6_addr_t *destination, uint8_t lifetime, bool default_lifetime, uint8_t start_index)
+void send_DAO_mode(ipv6_addr_t *destination, uint8_t lifetime, bool default_lifetime, uint16_t start_index)
 {
     if (i_am_root) {
         return;
@@ -308,9 +308,9 @@ void send_DAO_mode(ipv6_addr_t *destination, uint8_t lifetime, bool default_life
     rpl_send_opt_target_buf = get_rpl_send_opt_target_buf(DAO_BASE_LEN);
     /* add all targets from routing table as targets */
     uint8_t entries = 0;
-    uint8_t continue_index = 0;
+    uint16_t continue_index = 0;
 
-    for (uint8_t i = start_index; i < RPL_MAX_ROUTING_ENTRIES; i++) {
+    for (uint16_t i = start_index; i < RPL_MAX_ROUTING_ENTRIES; i++) {
         if (rpl_get_routing_table()[i].used) {
             rpl_send_opt_target_buf->type = RPL_OPT_TARGET;
             rpl_send_opt_target_buf->length = RPL_OPT_TARGET_LEN;
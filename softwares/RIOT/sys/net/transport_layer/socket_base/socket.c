@@ -24,6 +24,7 @@
 
 #include "hwtimer.h"
 #include "ipv6.h"
+#include "irq.h"
 #include "thread.h"
 #include "vtimer.h"
 
@@ -35,8 +36,20 @@
 
 #define EPHEMERAL_PORTS     49152
 
+#define SOCKET_NONE         0   /* socket IDs start at 1 */
+
 socket_internal_t socket_base_sockets[MAX_SOCKETS];
 
+/* first socket ID of each chain, sockets by (protocol, local port) */
+static uint8_t port_hash[SOCKET_BASE_HASH_SIZE];
+
+/* first socket ID of each chain, TCP sockets by
+ * (local port, foreign port, foreign address) */
+static uint8_t conn_hash[SOCKET_BASE_HASH_SIZE];
+
+/* next ephemeral port of TCP and UDP, kept until a socket binds it */
+static uint16_t free_port[2] = { EPHEMERAL_PORTS, EPHEMERAL_PORTS };
+
 int __attribute__((weak)) tcp_connect(int socket, sockaddr6_t *addr, uint32_t addrlen)
 {
     (void) socket;
@@ -211,12 +224,196 @@ void socket_base_print_sockets(void)
     }
 }
 
+static uint8_t socket_protocol(socket_t *current_socket)
+{
+    /* protocol 0 is the default protocol of the socket type */
+    switch (current_socket->type) {
+        case SOCK_STREAM:
+            return IPPROTO_TCP;
+
+        case SOCK_DGRAM:
+            return IPPROTO_UDP;
+
+        default:
+            return current_socket->protocol;
+    }
+}
+
+static uint8_t hash_fold(uint16_t key)
+{
+    key ^= key >> 8;
+    key ^= key >> 4;
+
+    return key & (SOCKET_BASE_HASH_SIZE - 1);
+}
+
+static uint8_t port_key(uint8_t protocol, uint16_t port)
+{
+    return hash_fold(port ^ protocol);
+}
+
+static uint8_t conn_key(uint16_t local_port, ipv6_addr_t *foreign_addr,
+                        uint16_t foreign_port)
+{
+    /* multiplied, peers counting up address and port together don't cancel */
+    uint16_t key = (foreign_addr->uint16[6] ^ foreign_addr->uint16[7]) * 40503u;
+
+    return hash_fold(key ^ local_port ^ foreign_port);
+}
+
+static bool is_connected(socket_t *current_socket)
+{
+    return (socket_protocol(current_socket) == IPPROTO_TCP) &&
+           (current_socket->foreign_address.sin6_port != 0);
+}
+
+static uint8_t *port_link(uint8_t id)
+{
+    return &socket_base_sockets[id - 1].port_next;
+}
+
+static uint8_t *conn_link(uint8_t id)
+{
+    return &socket_base_sockets[id - 1].conn_next;
+}
+
+static void chain_remove(uint8_t *link, uint8_t id, uint8_t *(*next)(uint8_t))
+{
+    while (*link != SOCKET_NONE) {
+        if (*link == id) {
+            *link = *next(id);
+            return;
+        }
+
+        link = next(*link);
+    }
+}
+
+void socket_base_init(void)
+{
+    memset(socket_base_sockets, 0, MAX_SOCKETS * sizeof(socket_internal_t));
+    memset(port_hash, SOCKET_NONE, sizeof(port_hash));
+    memset(conn_hash, SOCKET_NONE, sizeof(conn_hash));
+}
+
+void socket_base_demux_add(socket_internal_t *current_socket)
+{
+    socket_t *values = &current_socket->socket_values;
+    uint8_t *link;
+    unsigned state;
+
+    socket_base_demux_remove(current_socket);
+    state = disableIRQ();
+
+    if (values->local_address.sin6_port != 0) {
+        link = &port_hash[port_key(socket_protocol(values),
+                                   values->local_address.sin6_port)];
+
+        /* connections behind the sockets without foreign end point, so a
+         * listening socket is found first */
+        if (is_connected(values)) {
+            while (*link != SOCKET_NONE) {
+                link = port_link(*link);
+            }
+        }
+
+        current_socket->port_next = *link;
+        *link = current_socket->socket_id;
+    }
+
+    if (is_connected(values)) {
+        link = &conn_hash[conn_key(values->local_address.sin6_port,
+                                   &values->foreign_address.sin6_addr,
+                                   values->foreign_address.sin6_port)];
+        current_socket->conn_next = *link;
+        *link = current_socket->socket_id;
+    }
+
+    restoreIRQ(state);
+}
+
+void socket_base_demux_remove(socket_internal_t *current_socket)
+{
+    socket_t *values = &current_socket->socket_values;
+    unsigned state = disableIRQ();
+
+    if (values->local_address.sin6_port != 0) {
+        chain_remove(&port_hash[port_key(socket_protocol(values),
+                                         values->local_address.sin6_port)],
+                     current_socket->socket_id, port_link);
+    }
+
+    if (is_connected(values)) {
+        chain_remove(&conn_hash[conn_key(values->local_address.sin6_port,
+                                         &values->foreign_address.sin6_addr,
+                                         values->foreign_address.sin6_port)],
+                     current_socket->socket_id, conn_link);
+    }
+
+    current_socket->port_next = SOCKET_NONE;
+    current_socket->conn_next = SOCKET_NONE;
+
+    restoreIRQ(state);
+}
+
+socket_internal_t *socket_base_demux_port(uint8_t protocol, uint16_t port,
+                                          socket_internal_t *prev)
+{
+    uint8_t id = (prev == NULL) ? port_hash[port_key(protocol, port)] :
+                 prev->port_next;
+
+    while (id != SOCKET_NONE) {
+        socket_internal_t *current_socket = &socket_base_sockets[id - 1];
+
+        if ((current_socket->socket_values.local_address.sin6_port == port) &&
+            (socket_protocol(&current_socket->socket_values) == protocol)) {
+            return current_socket;
+        }
+
+        id = current_socket->port_next;
+    }
+
+    return NULL;
+}
+
+socket_internal_t *socket_base_demux_connection(uint16_t local_port,
+                                                ipv6_addr_t *foreign_addr,
+                                                uint16_t foreign_port,
+                                                socket_internal_t *prev)
+{
+    uint8_t id = (prev == NULL) ?
+                 conn_hash[conn_key(local_port, foreign_addr, foreign_port)] :
+                 prev->conn_next;
+
+    while (id != SOCKET_NONE) {
+        socket_internal_t *current_socket = &socket_base_sockets[id - 1];
+        socket_t *values = &current_socket->socket_values;
+
+        if ((values->local_address.sin6_port == local_port) &&
+            (values->foreign_address.sin6_port == foreign_port) &&
+            ipv6_addr_is_equal(&values->foreign_address.sin6_addr,
+                               foreign_addr)) {
+            return current_socket;
+        }
+
+        id = current_socket->conn_next;
+    }
+
+    return NULL;
+}
+
+void socket_base_free_socket(socket_internal_t *current_socket)
+{
+    socket_base_demux_remove(current_socket);
+    memset(current_socket, 0, sizeof(socket_internal_t));
+}
+
 int socket_base_close(int s)
 {
     socket_internal_t *current_socket = socket_base_get_socket(s);
 
     if (udp_socket_compliancy(s)) {
-        memset(current_socket, 0, sizeof(socket_internal_t));
+        socket_base_free_socket(current_socket);
         return 0;
     }
     else if (tcp_socket_compliancy(s)) {
@@ -229,18 +426,14 @@ int socket_base_close(int s)
 
 uint16_t socket_base_get_free_source_port(uint8_t protocol)
 {
-    int i;
-    uint16_t biggest_port = EPHEMERAL_PORTS - 1;
+    uint16_t *port = &free_port[(protocol == IPPROTO_TCP) ? 0 : 1];
 
-    /* Remember biggest ephemeral port number used so far and add 1 */
-    for (i = 0; i < MAX_SOCKETS; i++) {
-        if ((socket_base_sockets[i].socket_values.protocol == protocol) &&
-            (socket_base_sockets[i].socket_values.local_address.sin6_port > biggest_port)) {
-            biggest_port = socket_base_sockets[i].socket_values.local_address.sin6_port;
-        }
+    /* at most MAX_SOCKETS ports are in use, the first free one is near */
+    while (socket_base_demux_port(protocol, HTONS(*port), NULL) != NULL) {
+        *port = (*port == 0xffff) ? EPHEMERAL_PORTS : *port + 1;
     }
 
-    return biggest_port + 1;
+    return *port;
 }
 
 int socket_base_socket(int domain, int type, int protocol)
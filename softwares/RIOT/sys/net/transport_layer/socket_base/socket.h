@@ -21,7 +21,22 @@
 #include "tcp.h"
 #endif
 
+#ifndef MAX_SOCKETS
 #define MAX_SOCKETS         5
+#endif
+
+#if MAX_SOCKETS > 255
+#error "socket IDs are uint8_t"
+#endif
+
+/* Hash chains of the socket demultiplexing index, power of 2, at most 256 */
+#ifndef SOCKET_BASE_HASH_SIZE
+#define SOCKET_BASE_HASH_SIZE   (16)
+#endif
+
+#if TRANSPORT_LAYER_SOCKET_MAX_TCP_BUFFER > 255
+#error "TCP input buffer is indexed by uint8_t"
+#endif
 // #define MAX_QUEUED_SOCKETS   2
 
 #define INC_PACKET          0
@@ -80,6 +95,8 @@ typedef struct {
     uint8_t             socket_id;
     uint8_t             recv_pid;
     uint8_t             send_pid;
+    uint8_t             port_next;  /* next socket ID in port hash chain */
+    uint8_t             conn_next;  /* next socket ID in connection hash chain */
     socket_t            socket_values;
 #ifdef MODULE_TCP
     uint8_t             tcp_input_buffer_end;
@@ -90,9 +107,34 @@ typedef struct {
 
 extern socket_internal_t socket_base_sockets[MAX_SOCKETS];
 
+void socket_base_init(void);
 socket_internal_t *socket_base_get_socket(int s);
+void socket_base_free_socket(socket_internal_t *current_socket);
 uint16_t socket_base_get_free_source_port(uint8_t protocol);
 int socket_base_exists_socket(int socket);
+
+/*
+ * Demultiplexing index of received packets. Sockets with a local port are
+ * hashed by (protocol, local port), TCP sockets with a foreign end point also
+ * by (local port, foreign port, foreign address). A socket is added after its
+ * addresses are set and removed before they change or it is freed, chains are
+ * changed with interrupts disabled.
+ */
+void socket_base_demux_add(socket_internal_t *current_socket);
+void socket_base_demux_remove(socket_internal_t *current_socket);
+
+/* Next socket bound to port (network byte order) after prev, first if prev is
+ * NULL. Sockets without foreign end point come first. */
+socket_internal_t *socket_base_demux_port(uint8_t protocol, uint16_t port,
+                                          socket_internal_t *prev);
+
+/* Next TCP socket connected to foreign_port at foreign_addr from local_port
+ * after prev, first if prev is NULL. */
+socket_internal_t *socket_base_demux_connection(uint16_t local_port,
+                                                ipv6_addr_t *foreign_addr,
+                                                uint16_t foreign_port,
+                                                socket_internal_t *prev);
+
 int socket_base_socket(int domain, int type, int protocol);
 void socket_base_print_sockets(void);
 
@@ -17,6 +17,7 @@
  */
 
 #include <inttypes.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -182,19 +183,23 @@ uint16_t tcp_csum(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header)
 int check_tcp_consistency(socket_t *current_tcp_socket, tcp_hdr_t *tcp_header, uint8_t tcp_payload_len)
 {
     if (tcp_payload_len == 0) {
-        if (tcp_header->ack_nr > (current_tcp_socket->tcp_control.send_nxt)) {
+        if (TCP_SEQ_GT(tcp_header->ack_nr, current_tcp_socket->tcp_control.send_nxt)) {
             /* ACK of not yet sent byte, discard */
             return ACK_NO_TOO_BIG;
         }
-        else if (tcp_header->ack_nr <= (current_tcp_socket->tcp_control.send_una)) {
+        else if (!TCP_SEQ_GT(tcp_header->ack_nr, current_tcp_socket->tcp_control.send_una)) {
             /* ACK of previous segments, maybe dropped? */
             return ACK_NO_TOO_SMALL;
         }
     }
-    else if ((current_tcp_socket->tcp_control.rcv_nxt > 0) && (tcp_header->seq_nr < current_tcp_socket->tcp_control.rcv_nxt)) {
+    else if ((current_tcp_socket->tcp_control.rcv_nxt > 0) && TCP_SEQ_LT(tcp_header->seq_nr, current_tcp_socket->tcp_control.rcv_nxt)) {
         /* segment repetition, maybe ACK got lost? */
         return SEQ_NO_TOO_SMALL;
     }
+    else if ((current_tcp_socket->tcp_control.rcv_nxt > 0) && TCP_SEQ_GT(tcp_header->seq_nr, current_tcp_socket->tcp_control.rcv_nxt)) {
+        /* previous segment missing, out of order segments are not kept */
+        return SEQ_NO_TOO_BIG;
+    }
 
     return PACKET_OK;
 }
@@ -250,8 +255,9 @@ void set_tcp_packet(tcp_hdr_t *tcp_hdr, uint16_t src_port, uint16_t dst_port,
     tcp_hdr->window         = window;
 }
 
-int send_tcp(socket_internal_t *current_socket, tcp_hdr_t *current_tcp_packet,
-             ipv6_hdr_t *temp_ipv6_header, uint8_t flags, uint8_t payload_length)
+int send_tcp_segment(socket_internal_t *current_socket,
+                     tcp_hdr_t *current_tcp_packet, ipv6_hdr_t *temp_ipv6_header,
+                     uint8_t flags, uint32_t seq_nr, uint8_t payload_length)
 {
     socket_t *current_tcp_socket = &current_socket->socket_values;
     uint8_t header_length = TCP_HDR_LEN / 4;
@@ -268,8 +274,7 @@ int send_tcp(socket_internal_t *current_socket, tcp_hdr_t *current_tcp_packet,
     }
 
     set_tcp_packet(current_tcp_packet, current_tcp_socket->local_address.sin6_port,
-                   current_tcp_socket->foreign_address.sin6_port,
-                   current_tcp_socket->tcp_control.send_una,
+                   current_tcp_socket->foreign_address.sin6_port, seq_nr,
                    (IS_TCP_ACK(flags) ? current_tcp_socket->tcp_control.rcv_nxt : 0x00), header_length, flags,
                    current_tcp_socket->tcp_control.rcv_wnd, 0, 0);
 
@@ -306,6 +311,14 @@ int send_tcp(socket_internal_t *current_socket, tcp_hdr_t *current_tcp_packet,
 #endif
 }
 
+int send_tcp(socket_internal_t *current_socket, tcp_hdr_t *current_tcp_packet,
+             ipv6_hdr_t *temp_ipv6_header, uint8_t flags, uint8_t payload_length)
+{
+    return send_tcp_segment(current_socket, current_tcp_packet, temp_ipv6_header,
+                            flags, current_socket->socket_values.tcp_control.send_una,
+                            payload_length);
+}
+
 bool is_four_touple(socket_internal_t *current_socket, ipv6_hdr_t *ipv6_header,
                     tcp_hdr_t *tcp_header)
 {
@@ -321,28 +334,26 @@ socket_internal_t *get_waiting_connection_socket(int socket,
         ipv6_hdr_t *ipv6_header,
         tcp_hdr_t *tcp_header)
 {
-    int i;
+    socket_internal_t *current_socket = NULL;
     socket_internal_t *listening_socket = socket_base_get_socket(socket);
 
-    for (i = 1; i < MAX_SOCKETS + 1; i++) {
-        socket_internal_t *current_socket = socket_base_get_socket(i);
-
-        if (!current_socket) {
-            continue;
-        }
-
-        /* Connection establishment ACK, Check for 4 touple and state */
-        if ((ipv6_header != NULL) && (tcp_header != NULL)) {
+    /* Connection establishment ACK, Check for 4 touple and state */
+    if ((ipv6_header != NULL) && (tcp_header != NULL)) {
+        while ((current_socket = socket_base_demux_connection(tcp_header->dst_port,
+                                 &ipv6_header->srcaddr, tcp_header->src_port,
+                                 current_socket)) != NULL) {
             if (is_four_touple(current_socket, ipv6_header, tcp_header) &&
                 (current_socket->socket_values.tcp_control.state == TCP_SYN_RCVD)) {
                 return current_socket;
             }
         }
-        /* Connection establishment SYN ACK, check only for port and state */
-        else {
-            if ((current_socket->socket_values.tcp_control.state == TCP_SYN_RCVD) &&
-                (current_socket->socket_values.local_address.sin6_port ==
-                 listening_socket->socket_values.local_address.sin6_port)) {
+    }
+    /* Connection establishment SYN ACK, check only for port and state */
+    else {
+        while ((current_socket = socket_base_demux_port(IPPROTO_TCP,
+                                 listening_socket->socket_values.local_address.sin6_port,
+                                 current_socket)) != NULL) {
+            if (current_socket->socket_values.tcp_control.state == TCP_SYN_RCVD) {
                 return current_socket;
             }
         }
@@ -391,45 +402,42 @@ socket_internal_t *new_tcp_queued_socket(ipv6_hdr_t *ipv6_header,
                current_queued_socket->socket_values.tcp_control.send_iss + 1,
                current_queued_socket->socket_values.tcp_control.send_iss,
                tcp_header->window);
+    socket_base_demux_add(current_queued_socket);
 
     return current_queued_socket;
 }
 
 socket_internal_t *get_tcp_socket(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header)
 {
-    uint8_t i = 1;
     socket_internal_t *current_socket = NULL;
-    socket_internal_t *listening_socket = NULL;
-    uint8_t compare[16];
-    memset(compare, 0, 16);
-
-    while (i < MAX_SOCKETS + 1) {
-        current_socket = socket_base_get_socket(i);
 
-        /* Check for matching 4 touple, TCP_ESTABLISHED connection */
-        if (tcp_socket_compliancy(i) && is_four_touple(current_socket, ipv6_header,
-                                               tcp_header)) {
+    /* Check for matching 4 touple, TCP_ESTABLISHED connection */
+    while ((current_socket = socket_base_demux_connection(tcp_header->dst_port,
+                             &ipv6_header->srcaddr, tcp_header->src_port,
+                             current_socket)) != NULL) {
+        if (tcp_socket_compliancy(current_socket->socket_id) &&
+            is_four_touple(current_socket, ipv6_header, tcp_header)) {
             return current_socket;
         }
-        /* Sockets in TCP_LISTEN and TCP_SYN_RCVD state should only be tested on local TCP values */
-        else if (tcp_socket_compliancy(i) &&
-                 ((current_socket->socket_values.tcp_control.state == TCP_LISTEN) ||
-                  (current_socket->socket_values.tcp_control.state == TCP_SYN_RCVD)) &&
-                 (current_socket->socket_values.local_address.sin6_addr.uint8[15] ==
-                  ipv6_header->destaddr.uint8[15]) &&
-                 (current_socket->socket_values.local_address.sin6_port ==
-                  tcp_header->dst_port) &&
-                 (current_socket->socket_values.foreign_address.sin6_addr.uint8[15] ==
-                  0x00) &&
-                 (current_socket->socket_values.foreign_address.sin6_port == 0)) {
-            listening_socket = current_socket;
-        }
+    }
 
-        i++;
+    /* Sockets in TCP_LISTEN and TCP_SYN_RCVD state should only be tested on local TCP values */
+    while ((current_socket = socket_base_demux_port(IPPROTO_TCP, tcp_header->dst_port,
+                             current_socket)) != NULL) {
+        if (tcp_socket_compliancy(current_socket->socket_id) &&
+            ((current_socket->socket_values.tcp_control.state == TCP_LISTEN) ||
+             (current_socket->socket_values.tcp_control.state == TCP_SYN_RCVD)) &&
+            (current_socket->socket_values.local_address.sin6_addr.uint8[15] ==
+             ipv6_header->destaddr.uint8[15]) &&
+            (current_socket->socket_values.foreign_address.sin6_addr.uint8[15] ==
+             0x00) &&
+            (current_socket->socket_values.foreign_address.sin6_port == 0)) {
+            return current_socket;
+        }
     }
 
-    /* Return either NULL if nothing was matched or the listening 2 touple socket */
-    return listening_socket;
+    /* Nothing was matched */
+    return NULL;
 }
 
 uint8_t handle_payload(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
@@ -441,19 +449,21 @@ uint8_t handle_payload(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
     uint8_t tcp_payload_len = NTOHS(ipv6_header->length) - TCP_HDR_LEN;
     uint8_t acknowledged_bytes = 0;
 
+    /* several segments may arrive before the application reads, append */
     if (tcp_payload_len > tcp_socket->socket_values.tcp_control.rcv_wnd) {
         mutex_lock(&tcp_socket->tcp_buffer_mutex);
-        memcpy(tcp_socket->tcp_input_buffer, payload,
-               tcp_socket->socket_values.tcp_control.rcv_wnd);
+        memcpy(tcp_socket->tcp_input_buffer + tcp_socket->tcp_input_buffer_end,
+               payload, tcp_socket->socket_values.tcp_control.rcv_wnd);
         acknowledged_bytes = tcp_socket->socket_values.tcp_control.rcv_wnd;
-        tcp_socket->socket_values.tcp_control.rcv_wnd = 0;
         tcp_socket->tcp_input_buffer_end = tcp_socket->tcp_input_buffer_end +
                                            tcp_socket->socket_values.tcp_control.rcv_wnd;
+        tcp_socket->socket_values.tcp_control.rcv_wnd = 0;
         mutex_unlock(&tcp_socket->tcp_buffer_mutex);
     }
     else {
         mutex_lock(&tcp_socket->tcp_buffer_mutex);
-        memcpy(tcp_socket->tcp_input_buffer, payload, tcp_payload_len);
+        memcpy(tcp_socket->tcp_input_buffer + tcp_socket->tcp_input_buffer_end,
+               payload, tcp_payload_len);
         tcp_socket->socket_values.tcp_control.rcv_wnd =
             tcp_socket->socket_values.tcp_control.rcv_wnd - tcp_payload_len;
         acknowledged_bytes = tcp_payload_len;
@@ -476,7 +486,7 @@ void handle_tcp_ack_packet(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
 
     if (tcp_socket->socket_values.tcp_control.state == TCP_LAST_ACK) {
         uint8_t target_pid = tcp_socket->recv_pid;
-        memset(tcp_socket, 0, sizeof(socket_internal_t));
+        socket_base_free_socket(tcp_socket);
         msg_send(&m_send_tcp, target_pid, 0);
         return;
     }
@@ -492,7 +502,15 @@ void handle_tcp_ack_packet(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header,
         return;
     }
     else if (tcp_socket->socket_values.tcp_control.state == TCP_ESTABLISHED) {
-        if (check_tcp_consistency(&tcp_socket->socket_values, tcp_header, 0) == PACKET_OK) {
+        tcp_cb_t *tcp_control = &tcp_socket->socket_values.tcp_control;
+        int consistency = check_tcp_consistency(&tcp_socket->socket_values, tcp_header, 0);
+
+        /* duplicate ACKs while data is in flight are counted by tcp_send()
+         * for fast retransmit */
+        if ((consistency == PACKET_OK) ||
+            ((consistency == ACK_NO_TOO_SMALL) &&
+             (tcp_header->ack_nr == tcp_control->send_una) &&
+             (tcp_control->send_nxt != tcp_control->send_una))) {
             m_send_tcp.content.ptr = (char *)tcp_header;
             socket_base_net_msg_send(&m_send_tcp, tcp_socket->send_pid, 0, TCP_ACK);
             return;
@@ -780,7 +798,7 @@ bool tcp_socket_compliancy(int s)
 
 int tcp_bind_socket(int s, sockaddr6_t *name, int namelen, uint8_t pid)
 {
-    int i;
+    socket_internal_t *current_socket = NULL;
 
     socket_internal_t *sock = socket_base_get_socket(s);
 
@@ -788,24 +806,26 @@ int tcp_bind_socket(int s, sockaddr6_t *name, int namelen, uint8_t pid)
         return -1;
     }
 
-    for (i = 1; i < MAX_SOCKETS + 1; i++) {
-        if (tcp_socket_compliancy(i) &&
-            (socket_base_get_socket(i)->socket_values.local_address.sin6_port == name->sin6_port)) {
+    while ((current_socket = socket_base_demux_port(IPPROTO_TCP, name->sin6_port,
+                                                    current_socket)) != NULL) {
+        if (tcp_socket_compliancy(current_socket->socket_id)) {
             return -1;
         }
     }
 
     (void) namelen;
+    socket_base_demux_remove(sock);
     sock->socket_values.local_address = *name;
+    socket_base_demux_add(sock);
     sock->socket_values.tcp_control.rto = TCP_INITIAL_ACK_TIMEOUT;
     sock->recv_pid = pid;
 
     return 0;
 }
 
-void calculate_rto(tcp_cb_t *tcp_control, timex_t current_time)
+void calculate_rto(tcp_cb_t *tcp_control, timex_t send_time, timex_t current_time)
 {
-    double rtt = (double) timex_uint64(timex_sub(current_time, tcp_control->last_packet_time));
+    double rtt = (double) timex_uint64(timex_sub(current_time, send_time));
     double srtt = tcp_control->srtt;
     double rttvar = tcp_control->rttvar;
     double rto = tcp_control->rto;
@@ -820,7 +840,7 @@ void calculate_rto(tcp_cb_t *tcp_control, timex_t current_time)
     else {
         /* every other calculation */
         srtt = (1 - TCP_ALPHA) * srtt + TCP_ALPHA * rtt;
-        rttvar = (1 - TCP_BETA) * rttvar + TCP_BETA * abs(srtt - rtt);
+        rttvar = (1 - TCP_BETA) * rttvar + TCP_BETA * fabs(srtt - rtt);
         rto = srtt + (((4 * rttvar) < TCP_TIMER_RESOLUTION) ?
                       (TCP_TIMER_RESOLUTION) : (4 * rttvar));
     }
@@ -874,7 +894,7 @@ int handle_new_tcp_connection(socket_internal_t *current_queued_int_socket,
         if (msg_recv_client_ack.type == TCP_TIMEOUT) {
             /* Set status of internal socket back to TCP_LISTEN */
             server_socket->socket_values.tcp_control.state = TCP_LISTEN;
-            memset(current_queued_int_socket, 0, sizeof(socket_internal_t));
+            socket_base_free_socket(current_queued_int_socket);
             return -1;
         }
     }
@@ -921,20 +941,59 @@ int handle_new_tcp_connection(socket_internal_t *current_queued_int_socket,
     return current_queued_int_socket->socket_id;
 }
 
+static int send_queued_segment(socket_internal_t *current_int_tcp_socket,
+                               uint8_t *send_buffer, tcp_send_segment_t *segment,
+                               const uint8_t *data)
+{
+    ipv6_hdr_t *temp_ipv6_header = ((ipv6_hdr_t *)(send_buffer));
+    tcp_hdr_t *current_tcp_packet = ((tcp_hdr_t *)(&send_buffer[IPV6_HDR_LEN]));
+
+    memcpy(&send_buffer[IPV6_HDR_LEN + TCP_HDR_LEN], data, segment->length);
+    vtimer_now(&segment->send_time);
+
+    return send_tcp_segment(current_int_tcp_socket, current_tcp_packet,
+                            temp_ipv6_header, TCP_ACK, segment->seq_nr,
+                            segment->length);
+}
+
+static void retransmit_segment(socket_internal_t *current_int_tcp_socket,
+                               uint8_t *send_buffer, tcp_send_segment_t *segment,
+                               const uint8_t *data)
+{
+#ifdef TCP_HC
+    /* full header, the context of the peer may not know later segments */
+    current_int_tcp_socket->socket_values.tcp_control.tcp_context.hc_type =
+        FULL_HEADER;
+#endif
+    segment->retransmitted = 1;
+
+    if (send_queued_segment(current_int_tcp_socket, send_buffer, segment,
+                            data) < 0) {
+        printf("Error while retransmitting, waiting for next timeout!\n");
+    }
+
+    current_int_tcp_socket->socket_values.tcp_control.last_packet_time =
+        segment->send_time;
+}
+
 int32_t tcp_send(int s, const void *buf, uint32_t len, int flags)
 {
     (void) flags;
 
     /* Variables */
     msg_t recv_msg;
-    int32_t sent_bytes = 0;
     uint32_t total_sent_bytes = 0;
+    uint32_t first_seq_nr;
     socket_internal_t *current_int_tcp_socket;
     socket_t *current_tcp_socket;
+    tcp_cb_t *tcp_control;
+    /* unacknowledged segments, oldest at queue_head */
+    tcp_send_segment_t queue[TCP_SEND_QUEUE_SIZE];
+    uint8_t queue_head = 0;
+    uint8_t queue_count = 0;
+    uint8_t dup_acks = 0;
     uint8_t send_buffer[BUFFER_SIZE];
     memset(send_buffer, 0, BUFFER_SIZE);
-    ipv6_hdr_t *temp_ipv6_header = ((ipv6_hdr_t *)(&send_buffer));
-    tcp_hdr_t *current_tcp_packet = ((tcp_hdr_t *)(&send_buffer[IPV6_HDR_LEN]));
 
     /* Check if socket exists and is TCP socket */
     if (!tcp_socket_compliancy(s)) {
@@ -943,156 +1002,176 @@ int32_t tcp_send(int s, const void *buf, uint32_t len, int flags)
 
     current_int_tcp_socket = socket_base_get_socket(s);
     current_tcp_socket = &current_int_tcp_socket->socket_values;
+    tcp_control = &current_tcp_socket->tcp_control;
 
     /* Check for TCP_ESTABLISHED STATE */
-    if (current_tcp_socket->tcp_control.state != TCP_ESTABLISHED) {
+    if (tcp_control->state != TCP_ESTABLISHED) {
         return -1;
     }
 
     /* Add thread PID */
     current_int_tcp_socket->send_pid = thread_getpid();
 
-    recv_msg.type = UNDEFINED;
+    /* byte seq_nr is at buf[seq_nr - first_seq_nr] */
+    first_seq_nr = tcp_control->send_nxt;
+    tcp_control->no_of_retries = 0;
 
     while (1) {
-        current_tcp_socket->tcp_control.no_of_retries = 0;
-
-#ifdef TCP_HC
-        current_tcp_socket->tcp_control.tcp_context.hc_type = COMPRESSED_HEADER;
-        /* Remember TCP Context for possible TCP_RETRY */
-        tcp_hc_context_t saved_tcp_context;
-        memcpy(&saved_tcp_context, &current_tcp_socket->tcp_control.tcp_context,
-               sizeof(tcp_hc_context_t) - 1);
-#endif
+        /* Fill the window of the peer with new segments */
+        while ((total_sent_bytes < len) && (queue_count < TCP_SEND_QUEUE_SIZE)) {
+            uint32_t in_flight = tcp_control->send_nxt - tcp_control->send_una;
+            uint32_t segment_length = len - total_sent_bytes;
+            tcp_send_segment_t *segment;
+
+            if (segment_length > tcp_control->mss) {
+                segment_length = tcp_control->mss;
+            }
 
-        while (recv_msg.type != TCP_ACK) {
-            /* Add packet data */
-            if (current_tcp_socket->tcp_control.send_wnd >
-                current_tcp_socket->tcp_control.mss) {
-                /* Window size > Maximum Segment Size */
-                if ((len - total_sent_bytes) > current_tcp_socket->tcp_control.mss) {
-                    memcpy(&send_buffer[IPV6_HDR_LEN + TCP_HDR_LEN], buf,
-                           current_tcp_socket->tcp_control.mss);
-                    sent_bytes = current_tcp_socket->tcp_control.mss;
-                    total_sent_bytes += sent_bytes;
-                }
-                else {
-                    memcpy(&send_buffer[IPV6_HDR_LEN + TCP_HDR_LEN],
-                           (uint8_t *) buf + total_sent_bytes, len - total_sent_bytes);
-                    sent_bytes = len - total_sent_bytes;
-                    total_sent_bytes = len;
+            if (in_flight < tcp_control->send_wnd) {
+                if (segment_length > tcp_control->send_wnd - in_flight) {
+                    segment_length = tcp_control->send_wnd - in_flight;
                 }
             }
+            else if (queue_count == 0) {
+                /* Window closed, probe it with one byte, retransmitted by
+                 * the timer until the window opens */
+                segment_length = 1;
+            }
             else {
-                /* Window size <= Maximum Segment Size */
-                if ((len - total_sent_bytes) > current_tcp_socket->tcp_control.send_wnd) {
-                    memcpy(&send_buffer[IPV6_HDR_LEN + TCP_HDR_LEN], buf,
-                           current_tcp_socket->tcp_control.send_wnd);
-                    sent_bytes = current_tcp_socket->tcp_control.send_wnd;
-                    total_sent_bytes += sent_bytes;
-                }
-                else {
-                    memcpy(&send_buffer[IPV6_HDR_LEN + TCP_HDR_LEN],
-                           (uint8_t *) buf + total_sent_bytes, len - total_sent_bytes);
-                    sent_bytes = len - total_sent_bytes;
-                    total_sent_bytes = len;
-                }
+                break;
             }
 
-            current_tcp_socket->tcp_control.send_nxt += sent_bytes;
-            current_tcp_socket->tcp_control.send_wnd -= sent_bytes;
-
-            if (send_tcp(current_int_tcp_socket, current_tcp_packet,
-                         temp_ipv6_header, TCP_ACK, sent_bytes) < 0) {
-                /* Error while sending tcp data */
-                current_tcp_socket->tcp_control.send_nxt -= sent_bytes;
-                current_tcp_socket->tcp_control.send_wnd += sent_bytes;
+            segment = &queue[(queue_head + queue_count) % TCP_SEND_QUEUE_SIZE];
+            segment->seq_nr = tcp_control->send_nxt;
+            segment->length = segment_length;
+            segment->retransmitted = 0;
 #ifdef TCP_HC
-                memcpy(&current_tcp_socket->tcp_control.tcp_context,
-                       &saved_tcp_context, sizeof(tcp_hc_context_t));
-                current_tcp_socket->tcp_control.tcp_context.hc_type =
-                    COMPRESSED_HEADER;
+            tcp_control->tcp_context.hc_type = COMPRESSED_HEADER;
 #endif
+
+            if (send_queued_segment(current_int_tcp_socket, send_buffer, segment,
+                                    (const uint8_t *) buf + total_sent_bytes) < 0) {
+                /* Error while sending tcp data, segments in flight are
+                 * given up */
+                tcp_control->send_nxt = tcp_control->send_una;
                 printf("Error while sending, returning to application thread!\n");
                 return -1;
             }
 
-            /* Remember current time */
-            vtimer_now(&current_tcp_socket->tcp_control.last_packet_time);
-            socket_base_net_msg_receive(&recv_msg);
+            if (queue_count == 0) {
+                /* Retransmission timer runs for the oldest segment */
+                tcp_control->last_packet_time = segment->send_time;
+            }
 
-            switch (recv_msg.type) {
-                case TCP_ACK: {
-                    if (current_tcp_socket->tcp_control.no_of_retries == 0) {
-                        calculate_rto(&current_tcp_socket->tcp_control,
-                                      current_tcp_socket->tcp_control.last_packet_time);
+            queue_count++;
+            tcp_control->send_nxt += segment_length;
+            total_sent_bytes += segment_length;
+        }
+
+        if (queue_count == 0) {
+            /* Got ACK for every sent byte */
+            return total_sent_bytes;
+        }
+
+        socket_base_net_msg_receive(&recv_msg);
+
+        switch (recv_msg.type) {
+            case TCP_ACK: {
+                tcp_hdr_t *tcp_header = ((tcp_hdr_t *)(recv_msg.content.ptr));
+                uint32_t ack_nr = tcp_header->ack_nr;
+                tcp_send_segment_t *segment = &queue[queue_head];
+                timex_t now, rtt_send_time;
+                bool rtt_sample = false;
+                bool recovering = false;
+
+                tcp_control->send_wnd = tcp_header->window;
+
+                if (ack_nr == tcp_control->send_una) {
+                    /* Duplicate ACK, the peer got a later segment */
+                    if (++dup_acks == TCP_DUP_ACK_THRESHOLD) {
+                        retransmit_segment(current_int_tcp_socket, send_buffer,
+                                           segment, (const uint8_t *) buf +
+                                           (segment->seq_nr - first_seq_nr));
                     }
 
-                    tcp_hdr_t *tcp_header = ((tcp_hdr_t *)(recv_msg.content.ptr));
+                    break;
+                }
 
-                    if ((current_tcp_socket->tcp_control.send_nxt ==
-                         tcp_header->ack_nr) && (total_sent_bytes == len)) {
-                        current_tcp_socket->tcp_control.send_una = tcp_header->ack_nr;
-                        current_tcp_socket->tcp_control.send_nxt = tcp_header->ack_nr;
-                        current_tcp_socket->tcp_control.send_wnd = tcp_header->window;
-                        /* Got ACK for every sent byte */
-#ifdef TCP_HC
-                        current_tcp_socket->tcp_control.tcp_context.hc_type =
-                            COMPRESSED_HEADER;
-#endif
-                        return sent_bytes;
+                if (TCP_SEQ_LT(ack_nr, tcp_control->send_una) ||
+                    TCP_SEQ_GT(ack_nr, tcp_control->send_nxt)) {
+                    break;
+                }
+
+                /* Cumulative ACK, remove acknowledged segments */
+                vtimer_now(&now);
+
+                while ((queue_count > 0) &&
+                       !TCP_SEQ_LT(ack_nr, segment->seq_nr + segment->length)) {
+                    if (!segment->retransmitted) {
+                        rtt_send_time = segment->send_time;
+                        rtt_sample = true;
                     }
-                    else if ((current_tcp_socket->tcp_control.send_nxt ==
-                              tcp_header->ack_nr) && (total_sent_bytes != len)) {
-                        current_tcp_socket->tcp_control.send_una = tcp_header->ack_nr;
-                        current_tcp_socket->tcp_control.send_nxt = tcp_header->ack_nr;
-                        current_tcp_socket->tcp_control.send_wnd = tcp_header->window;
-                        /* Got ACK for every sent byte */
-#ifdef TCP_HC
-                        current_tcp_socket->tcp_control.tcp_context.hc_type =
-                            COMPRESSED_HEADER;
-#endif
-                        break;
+                    else {
+                        recovering = true;
                     }
 
-                    /* else {
-                     *     TODO: If window size > MSS, ACK was valid only for
-                     *     a few segments, handle retransmit of missing
-                     *     segments
-                     *  break;
-                     * } */
-                    break;
+                    queue_head = (queue_head + 1) % TCP_SEND_QUEUE_SIZE;
+                    queue_count--;
+                    segment = &queue[queue_head];
+                }
+
+                if ((queue_count > 0) && TCP_SEQ_GT(ack_nr, segment->seq_nr)) {
+                    /* Peer took only a part of the segment */
+                    segment->length -= ack_nr - segment->seq_nr;
+                    segment->seq_nr = ack_nr;
+                }
+
+                /* One RTT sample per ACK, from the latest acknowledged
+                 * segment that was not retransmitted */
+                if (rtt_sample) {
+                    calculate_rto(tcp_control, rtt_send_time, now);
                 }
 
-                case TCP_RETRY: {
-                    current_tcp_socket->tcp_control.send_nxt -= sent_bytes;
-                    current_tcp_socket->tcp_control.send_wnd += sent_bytes;
-                    total_sent_bytes -= sent_bytes;
+                tcp_control->send_una = ack_nr;
+                tcp_control->no_of_retries = 0;
+                tcp_control->last_packet_time = now;
+                dup_acks = 0;
 #ifdef TCP_HC
-                    memcpy(&current_tcp_socket->tcp_control.tcp_context,
-                           $&saved_tcp_context, sizeof(tcp_hc_context_t));
-                    current_tcp_socket->tcp_control.tcp_context.hc_type =
-                        MOSTLY_COMPRESSED_HEADER;
+                tcp_control->tcp_context.hc_type = COMPRESSED_HEADER;
 #endif
-                    break;
+
+                if (recovering && (queue_count > 0)) {
+                    /* Partial ACK of a retransmission (RFC 6582): the peer
+                     * drops out of order data, so the next segment is lost
+                     * too, resend it now instead of after a timeout */
+                    retransmit_segment(current_int_tcp_socket, send_buffer,
+                                       segment, (const uint8_t *) buf +
+                                       (segment->seq_nr - first_seq_nr));
                 }
 
-                case TCP_TIMEOUT: {
-                    current_tcp_socket->tcp_control.send_nxt -= sent_bytes;
-                    current_tcp_socket->tcp_control.send_wnd += sent_bytes;
+                break;
+            }
+
+            case TCP_RETRY: {
+                /* Retransmission timeout of the oldest segment */
+                tcp_send_segment_t *segment = &queue[queue_head];
+
+                retransmit_segment(current_int_tcp_socket, send_buffer, segment,
+                                   (const uint8_t *) buf +
+                                   (segment->seq_nr - first_seq_nr));
+                dup_acks = 0;
+                break;
+            }
+
+            case TCP_TIMEOUT: {
+                tcp_control->send_nxt = tcp_control->send_una;
 #ifdef TCP_HC
-                    memcpy(&current_tcp_socket->tcp_control.tcp_context,
-                           &saved_tcp_context, sizeof(tcp_hc_context_t));
-                    current_tcp_socket->tcp_control.tcp_context.hc_type =
-                        COMPRESSED_HEADER;
+                tcp_control->tcp_context.hc_type = COMPRESSED_HEADER;
 #endif
-                    return -1;
-                }
+                return -1;
             }
         }
     }
-
-    return sent_bytes;
 }
 
 int tcp_accept(int s, sockaddr6_t *addr, uint32_t *addrlen)
@@ -1155,6 +1234,7 @@ int tcp_connect(int socket, sockaddr6_t *addr, uint32_t addrlen)
     current_int_tcp_socket->recv_pid = thread_getpid();
 
     /* Local address information */
+    socket_base_demux_remove(current_int_tcp_socket);
     ipv6_net_if_get_best_src_addr(&src_addr, &addr->sin6_addr);
     set_socket_address(&current_tcp_socket->local_address, PF_INET6,
                        HTONS(socket_base_get_free_source_port(IPPROTO_TCP)), 0, &src_addr);
@@ -1162,6 +1242,7 @@ int tcp_connect(int socket, sockaddr6_t *addr, uint32_t addrlen)
     /* Foreign address information */
     set_socket_address(&current_tcp_socket->foreign_address, addr->sin6_family,
                        addr->sin6_port, addr->sin6_flowinfo, &addr->sin6_addr);
+    socket_base_demux_add(current_int_tcp_socket);
 
     /* Fill lcoal TCP socket information */
     srand(addr->sin6_port);
@@ -1389,7 +1470,7 @@ int tcp_teardown(socket_internal_t *current_socket)
 
     /* Check for TCP_ESTABLISHED STATE */
     if (current_socket->socket_values.tcp_control.state != TCP_ESTABLISHED) {
-        memset(current_socket, 0, sizeof(socket_internal_t));
+        socket_base_free_socket(current_socket);
         return 0;
     }
 
@@ -1405,7 +1486,7 @@ int tcp_teardown(socket_internal_t *current_socket)
     send_tcp(current_socket, current_tcp_packet, temp_ipv6_header,
              TCP_FIN_ACK, 0);
     msg_receive(&m_recv);
-    memset(current_socket, 0, sizeof(socket_internal_t));
+    socket_base_free_socket(current_socket);
     return 1;
 }
 
@@ -62,7 +62,8 @@ enum tcp_codes {
     CLOSE_CONN          = 2,
     SEQ_NO_TOO_SMALL    = 3,
     ACK_NO_TOO_SMALL    = 4,
-    ACK_NO_TOO_BIG      = 5
+    ACK_NO_TOO_BIG      = 5,
+    SEQ_NO_TOO_BIG      = 6
 };
 
 #define REMOVE_RESERVED         (0xFC)
@@ -74,6 +75,10 @@ enum tcp_codes {
 #define IS_TCP_FIN(a)           (((a) & TCP_FIN)      == TCP_FIN)
 #define IS_TCP_FIN_ACK(a)       (((a) & TCP_FIN_ACK)  == TCP_FIN_ACK)
 
+/* Sequence number comparison modulo 2^32 (RFC 793, 3.3) */
+#define TCP_SEQ_LT(a, b)        ((int32_t)((uint32_t)(a) - (uint32_t)(b)) < 0)
+#define TCP_SEQ_GT(a, b)        ((int32_t)((uint32_t)(a) - (uint32_t)(b)) > 0)
+
 #define SET_TCP_ACK(a)          (a) = TCP_ACK
 #define SET_TCP_RST(a)          (a) = TCP_RST
 #define SET_TCP_SYN(a)          (a) = TCP_SYN
@@ -83,12 +88,29 @@ enum tcp_codes {
 
 #define TCP_STACK_SIZE          (KERNEL_CONF_STACKSIZE_MAIN)
 
+/* Unacknowledged segments tcp_send() keeps in flight, 1 is stop-and-wait */
+#ifndef TCP_SEND_QUEUE_SIZE
+#define TCP_SEND_QUEUE_SIZE     (4)
+#endif
+
+/* Duplicate ACKs that trigger a fast retransmit (RFC 5681) */
+#define TCP_DUP_ACK_THRESHOLD   (3)
+
 typedef struct __attribute__((packed)) tcp_mms_o_t {
     uint8_t     kind;
     uint8_t     len;
     uint16_t    mss;
 } tcp_mss_option_t;
 
+/* Segment sent by tcp_send() and not yet acknowledged, its data stays in the
+ * buffer of the application until tcp_send() returns */
+typedef struct tcp_send_segment_t {
+    uint32_t    seq_nr;
+    uint8_t     length;
+    uint8_t     retransmitted;  /* no RTT sample from it (Karn) */
+    timex_t     send_time;
+} tcp_send_segment_t;
+
 #ifdef TCP_HC
 extern mutex_t             global_context_counter_mutex;
 extern uint8_t             global_context_counter;
@@ -69,8 +69,8 @@ void handle_established(socket_internal_t *current_socket)
     }
 
 
-    if ((current_socket->socket_values.tcp_control.send_nxt >
-         current_socket->socket_values.tcp_control.send_una) &&
+    if (TCP_SEQ_GT(current_socket->socket_values.tcp_control.send_nxt,
+                   current_socket->socket_values.tcp_control.send_una) &&
         (thread_getstatus(current_socket->send_pid) == STATUS_RECEIVE_BLOCKED)) {
         for (uint8_t i = 0; i < current_socket->socket_values.tcp_control.no_of_retries;
              i++) {
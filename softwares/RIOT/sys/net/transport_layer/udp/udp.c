@@ -50,16 +50,13 @@ uint16_t udp_csum(ipv6_hdr_t *ipv6_header, udp_hdr_t *udp_header)
 
 socket_internal_t *get_udp_socket(udp_hdr_t *udp_header)
 {
-    uint8_t i = 1;
+    socket_internal_t *current_socket = NULL;
 
-    while (i < MAX_SOCKETS + 1) {
-        if (udp_socket_compliancy(i) &&
-            (socket_base_get_socket(i)->socket_values.local_address.sin6_port ==
-             udp_header->dst_port)) {
-            return socket_base_get_socket(i);
+    while ((current_socket = socket_base_demux_port(IPPROTO_UDP, udp_header->dst_port,
+                                                    current_socket)) != NULL) {
+        if (udp_socket_compliancy(current_socket->socket_id)) {
+            return current_socket;
         }
-
-        i++;
     }
 
     return NULL;
@@ -116,21 +113,24 @@ bool udp_socket_compliancy(int s)
 
 int udp_bind_socket(int s, sockaddr6_t *name, int namelen, uint8_t pid)
 {
-    int i;
+    socket_internal_t *current_socket = NULL;
 
     if (!socket_base_exists_socket(s)) {
         return -1;
     }
 
-    for (i = 1; i < MAX_SOCKETS + 1; i++) {
-        if (udp_socket_compliancy(i) &&
-            (socket_base_get_socket(i)->socket_values.local_address.sin6_port == name->sin6_port)) {
+    while ((current_socket = socket_base_demux_port(IPPROTO_UDP, name->sin6_port,
+                                                    current_socket)) != NULL) {
+        if (udp_socket_compliancy(current_socket->socket_id)) {
             return -1;
         }
     }
 
-    memcpy(&socket_base_get_socket(s)->socket_values.local_address, name, namelen);
-    socket_base_get_socket(s)->recv_pid = pid;
+    current_socket = socket_base_get_socket(s);
+    socket_base_demux_remove(current_socket);
+    memcpy(&current_socket->socket_values.local_address, name, namelen);
+    current_socket->recv_pid = pid;
+    socket_base_demux_add(current_socket);
     return 0;
 }
 
@@ -179,7 +179,7 @@ int32_t udp_sendto(int s, const void *buf, uint32_t len, int flags,
         memcpy(&(temp_ipv6_header->destaddr), &to->sin6_addr, 16);
         ipv6_net_if_get_best_src_addr(&(temp_ipv6_header->srcaddr), &(temp_ipv6_header->destaddr));
 
-        current_udp_packet->src_port = socket_base_get_free_source_port(IPPROTO_UDP);
+        current_udp_packet->src_port = HTONS(socket_base_get_free_source_port(IPPROTO_UDP));
         current_udp_packet->dst_port = to->sin6_port;
         current_udp_packet->checksum = 0;
 
@@ -205,7 +205,7 @@ int udp_init_transport_layer(void)
 {
     printf("Initializing transport layer protocol: udp\n");
     /* SOCKETS */
-    memset(socket_base_sockets, 0, MAX_SOCKETS * sizeof(socket_internal_t));
+    socket_base_init();
 
     int udp_thread_pid = thread_create(udp_stack_buffer, UDP_STACK_SIZE, PRIORITY_MAIN,
                                         CREATE_STACKTEST, udp_packet_handler, NULL, "udp_packet_handler");
@@ -11,7 +11,8 @@
  * @{
  *
  * @file
- * @brief       IPC pingpong test
+ * @brief       IPC pingpong test, messages per second of single and
+ *              batched sending
  *
  * @author      Kaspar Schleiser <kaspar@schleiser.de>
  * @author      René Kijewski <rene.kijewski@fu-berlin.de>
@@ -21,6 +22,7 @@
 
 #include <stdio.h>
 
+#include "hwtimer.h"
 #include "thread.h"
 #include "msg.h"
 
@@ -29,8 +31,19 @@
 
 #define LIMIT 1000
 
-static char stacks[3][KERNEL_CONF_STACKSIZE_MAIN];
-static kernel_pid_t pids[3];
+#define BENCH_BURST     (8)
+#define BENCH_BURSTS    (2000)
+#define BENCH_QUEUE     (16)
+
+#define BENCH_DATA      (1)
+#define BENCH_STOP      (2)
+
+static char stacks[5][KERNEL_CONF_STACKSIZE_MAIN];
+static kernel_pid_t pids[5];
+
+/* consumer receives with msg_receive_many() instead of msg_receive() */
+static volatile int bench_many;
+static unsigned bench_errors;
 
 static void *first_thread(void *arg)
 {
@@ -104,6 +117,98 @@ static void *third_thread(void *arg)
     return NULL;
 }
 
+/* higher priority than the producer, woken by every message it gets */
+static void *consumer_thread(void *arg)
+{
+    (void) arg;
+
+    msg_t queue[BENCH_QUEUE];
+    msg_t m[BENCH_BURST];
+    uint32_t expected = 0;
+
+    msg_init_queue(queue, BENCH_QUEUE);
+
+    while (1) {
+        int n = bench_many ? msg_receive_many(m, BENCH_BURST) : msg_receive(m);
+
+        for (int i = 0; i < n; ++i) {
+            if (m[i].type == BENCH_STOP) {
+                expected = 0;
+                msg_reply(&m[i], &m[i]);
+                continue;
+            }
+
+            if (m[i].content.value != expected) {
+                ++bench_errors;
+            }
+
+            ++expected;
+        }
+    }
+
+    return NULL;
+}
+
+static unsigned long bench(int batch)
+{
+    msg_t m[BENCH_BURST];
+    uint32_t value = 0;
+
+    bench_many = batch;
+    unsigned long start = hwtimer_now();
+
+    for (unsigned b = 0; b < BENCH_BURSTS; ++b) {
+        for (unsigned i = 0; i < BENCH_BURST; ++i) {
+            m[i].type = BENCH_DATA;
+            m[i].content.value = value++;
+        }
+
+        if (batch) {
+            if (msg_send_batch(m, BENCH_BURST, pids[4], true) != BENCH_BURST) {
+                ++bench_errors;
+            }
+        }
+        else {
+            for (unsigned i = 0; i < BENCH_BURST; ++i) {
+                if (msg_send(&m[i], pids[4], true) != 1) {
+                    ++bench_errors;
+                }
+            }
+        }
+    }
+
+    /* wait until the consumer got everything */
+    m[0].type = BENCH_STOP;
+    msg_send_receive(&m[0], &m[0], pids[4]);
+
+    unsigned long us = HWTIMER_TICKS_TO_US(hwtimer_now() - start);
+
+    return (unsigned long)((uint64_t) BENCH_BURSTS * BENCH_BURST * 1000000 / (us ? us : 1));
+}
+
+/* runs once the pingpong threads are done */
+static void *producer_thread(void *arg)
+{
+    (void) arg;
+
+    puts("Benchmark starting.");
+
+    unsigned long single = bench(0);
+    unsigned long batched = bench(1);
+
+    printf("msg_send: %lu msg/s, msg_send_batch/msg_receive_many: %lu msg/s "
+           "(bursts of %u)\n", single, batched, BENCH_BURST);
+
+    if (bench_errors) {
+        printf("FAILURE: %u errors\n", bench_errors);
+        return NULL;
+    }
+
+    puts("SUCCESS");
+
+    return NULL;
+}
+
 int main(void)
 {
     puts("Main thread start.");
@@ -117,6 +222,12 @@ int main(void)
     pids[2] = thread_create(stacks[2], sizeof(stacks[2]),
                             PRIORITY_MAIN - 3, CREATE_WOUT_YIELD | CREATE_STACKTEST,
                             third_thread, NULL, "3nd");
+    pids[4] = thread_create(stacks[4], sizeof(stacks[4]),
+                            PRIORITY_MAIN, CREATE_WOUT_YIELD | CREATE_STACKTEST,
+                            consumer_thread, NULL, "consumer");
+    pids[3] = thread_create(stacks[3], sizeof(stacks[3]),
+                            PRIORITY_MAIN + 1, CREATE_WOUT_YIELD | CREATE_STACKTEST,
+                            producer_thread, NULL, "producer");
 
     puts("Main thread done.");
     return 0;
@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2014  Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup tests
+ * @{
+ *
+ * @file
+ * @brief   6LoWPAN reassembly buffers: interleaved out-of-order fragment
+ *          streams with duplicates, reassembly throughput and worst-case
+ *          latency per fragment
+ *
+ * @author  DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hwtimer.h"
+#include "reassembly.h"
+
+#define DATAGRAMS       (2000)
+#define STREAMS         (LOWPAN_REAS_BUF_COUNT)
+#define FRAG_SIZE       (80)    /* 8-byte units, as in 802.15.4 frames */
+#define MAX_FRAGS       ((LOWPAN_REAS_BUF_SIZE + FRAG_SIZE - 1) / FRAG_SIZE)
+
+typedef struct {
+    net_if_eui64_t s_addr;
+    net_if_eui64_t d_addr;
+    uint16_t tag;
+    uint16_t size;
+    uint8_t num_frags;
+    uint8_t sent;
+    uint8_t order[MAX_FRAGS];
+} stream_t;
+
+static stream_t streams[STREAMS];
+static uint8_t frag_data[FRAG_SIZE];
+static uint32_t rand_state = 12345;
+static uint16_t next_tag;
+static int failures;
+
+static uint32_t rand_next(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 16;
+}
+
+static uint8_t pattern(uint16_t tag, uint16_t pos)
+{
+    return (uint8_t)(tag * 31 + pos);
+}
+
+static void stream_start(stream_t *s, uint8_t node)
+{
+    memset(&s->s_addr, 0, sizeof(s->s_addr));
+    memset(&s->d_addr, 0, sizeof(s->d_addr));
+    s->s_addr.uint8[7] = node;
+    s->d_addr.uint8[7] = 0xff;
+    s->tag = next_tag++;
+    s->size = 9 + rand_next() % (LOWPAN_REAS_BUF_SIZE - 8);
+    s->num_frags = (s->size + FRAG_SIZE - 1) / FRAG_SIZE;
+    s->sent = 0;
+
+    /* shuffled fragment order */
+    for (uint8_t i = 0; i < s->num_frags; i++) {
+        s->order[i] = i;
+    }
+
+    for (uint8_t i = s->num_frags - 1; i > 0; i--) {
+        uint8_t j = rand_next() % (i + 1);
+        uint8_t tmp = s->order[i];
+        s->order[i] = s->order[j];
+        s->order[j] = tmp;
+    }
+}
+
+static int frag_receive(stream_t *s, uint8_t frag, unsigned long *ticks)
+{
+    uint16_t offset = frag * FRAG_SIZE;
+    uint16_t size = s->size - offset;
+    lowpan_reas_buf_t *buf;
+    unsigned long start;
+    int res = -2;
+
+    if (size > FRAG_SIZE) {
+        size = FRAG_SIZE;
+    }
+
+    for (uint16_t i = 0; i < size; i++) {
+        frag_data[i] = pattern(s->tag, offset + i);
+    }
+
+    start = hwtimer_now();
+    buf = lowpan_reas_get(s->size, s->tag, &s->s_addr, &s->d_addr);
+
+    if (buf != NULL) {
+        res = lowpan_reas_add(buf, frag_data, offset, size);
+    }
+
+    *ticks = hwtimer_now() - start;
+
+    return res;
+}
+
+static void datagram_check(stream_t *s)
+{
+    lowpan_reas_buf_t *buf = lowpan_reas_fifo_first();
+
+    if ((buf == NULL) || (buf->tag != s->tag) || (buf->packet_size != s->size)) {
+        printf("tag %u: not in FIFO\n", s->tag);
+        failures++;
+        return;
+    }
+
+    for (uint16_t i = 0; i < s->size; i++) {
+        if (buf->packet[i] != pattern(s->tag, i)) {
+            printf("tag %u: byte %u is wrong\n", s->tag, i);
+            failures++;
+            break;
+        }
+    }
+
+    lowpan_reas_fifo_release();
+}
+
+static void test_streams(void)
+{
+    unsigned long ticks, total_ticks = 0, max_ticks = 0;
+    unsigned long bytes = 0, frags = 0, dups = 0, total_us;
+    unsigned datagrams = 0;
+    int res;
+
+    for (uint8_t i = 0; i < STREAMS; i++) {
+        stream_start(&streams[i], i);
+    }
+
+    while (datagrams < DATAGRAMS) {
+        stream_t *s = &streams[rand_next() % STREAMS];
+
+        /* duplicate of an already received fragment */
+        if ((s->sent > 0) && (rand_next() % 16 == 0)) {
+            if (frag_receive(s, s->order[rand_next() % s->sent], &ticks) != -1) {
+                printf("tag %u: duplicate not discarded\n", s->tag);
+                failures++;
+            }
+
+            dups++;
+            continue;
+        }
+
+        res = frag_receive(s, s->order[s->sent], &ticks);
+        s->sent++;
+        frags++;
+        total_ticks += ticks;
+
+        if (ticks > max_ticks) {
+            max_ticks = ticks;
+        }
+
+        if (res < 0) {
+            printf("tag %u: fragment discarded (%d)\n", s->tag, res);
+            failures++;
+        }
+
+        if ((res == 1) != (s->sent == s->num_frags)) {
+            printf("tag %u: completed after %u of %u fragments\n", s->tag,
+                   s->sent, s->num_frags);
+            failures++;
+        }
+
+        if (s->sent == s->num_frags) {
+            datagram_check(s);
+            bytes += s->size;
+            datagrams++;
+            stream_start(s, s - streams);
+        }
+    }
+
+    printf("+ %u datagrams, %lu fragments, %lu duplicates\n", datagrams, frags,
+           dups);
+    total_us = HWTIMER_TICKS_TO_US(total_ticks);
+
+    if (total_us == 0) {
+        total_us = 1;
+    }
+
+    printf("+ throughput: %lu bytes in %lu us, %lu kB/s\n", bytes, total_us,
+           (unsigned long)((uint64_t) bytes * 1000 / total_us));
+    printf("+ latency per fragment: average %lu ns, worst case %lu us\n",
+           (unsigned long)((uint64_t) total_us * 1000 / frags),
+           (unsigned long) HWTIMER_TICKS_TO_US(max_ticks));
+}
+
+static void test_full(void)
+{
+    unsigned long ticks;
+    lowpan_reas_buf_t *buf;
+
+    /* all buffers incomplete, a new datagram drops the oldest one */
+    for (uint8_t i = 0; i < STREAMS; i++) {
+        stream_start(&streams[i], i);
+        streams[i].size = 2 * FRAG_SIZE;
+        frag_receive(&streams[i], 0, &ticks);
+    }
+
+    stream_start(&streams[0], STREAMS);
+    streams[0].size = FRAG_SIZE;
+
+    if (frag_receive(&streams[0], 0, &ticks) != 1) {
+        printf("full: new datagram not reassembled\n");
+        failures++;
+    }
+
+    lowpan_reas_fifo_release();
+
+    /* second fragment of the dropped datagram starts a new one */
+    stream_start(&streams[0], 0);
+    streams[0].tag = streams[1].tag - 1;
+    streams[0].size = 2 * FRAG_SIZE;
+
+    if (frag_receive(&streams[0], 1, &ticks) != 0) {
+        printf("full: dropped datagram completed\n");
+        failures++;
+    }
+
+    /* all buffers in FIFO, nothing left */
+    for (uint8_t i = 0; i < STREAMS; i++) {
+        stream_start(&streams[i], i);
+        streams[i].size = FRAG_SIZE;
+        frag_receive(&streams[i], 0, &ticks);
+    }
+
+    stream_start(&streams[0], STREAMS);
+    buf = lowpan_reas_get(streams[0].size, streams[0].tag, &streams[0].s_addr,
+                          &streams[0].d_addr);
+
+    if (buf != NULL) {
+        printf("full: buffer in FIFO reused\n");
+        failures++;
+    }
+
+    while (lowpan_reas_fifo_first() != NULL) {
+        lowpan_reas_fifo_release();
+    }
+}
+
+int main(void)
+{
+    puts("6LoWPAN reassembly test.");
+
+    lowpan_reas_init();
+    test_streams();
+
+    lowpan_reas_init();
+    test_full();
+
+    if (failures) {
+        printf("FAILURE: %d errors\n", failures);
+        return 1;
+    }
+
+    puts("SUCCESS");
+
+    return 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2014  Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup tests
+ * @{
+ *
+ * @file
+ * @brief   Internet checksum: random buffers, lengths and alignments against
+ *          the former byte-wise csum(), RFC 1624 incremental updates against
+ *          computing again, speed of both csum() versions
+ *
+ * @author  DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hwtimer.h"
+#include "net_help.h"
+
+#define FUZZ_ROUNDS     (20000)
+#define BENCH_ROUNDS    (2000)
+#define PACKET_LEN      (1280)  /* IPv6 minimum MTU */
+
+static uint8_t data[PACKET_LEN + 8] __attribute__((aligned(4)));
+static uint32_t rand_state = 12345;
+static int failures;
+
+static uint32_t rand_next(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 16;
+}
+
+static void rand_fill(uint8_t *buf, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        buf[i] = rand_next();
+    }
+}
+
+/* former csum() of net_help.c, 16 bits per iteration */
+static uint16_t csum_ref(uint16_t sum, uint8_t *buf, uint16_t len)
+{
+    int count = len >> 1;
+
+    if (count) {
+        uint16_t carry = 0;
+
+        do {
+            uint16_t t = (*buf << 8) + *(buf + 1);
+            count--;
+            buf += 2;
+            sum += carry;
+            sum += t;
+            carry = (t > sum);
+        } while (count);
+
+        sum += carry;
+    }
+
+    if (len & 1) {
+        uint16_t u = (*buf << 8);
+        sum += (*buf << 8);
+
+        if (sum < u) {
+            sum++;
+        }
+    }
+
+    return sum;
+}
+
+static void test_fuzz(void)
+{
+    static const uint16_t edge_sums[] = { 0x0000, 0x0001, 0xfffe, 0xffff };
+
+    for (unsigned round = 0; round < FUZZ_ROUNDS; round++) {
+        uint8_t offset = rand_next() % 8;
+        uint16_t len = rand_next() % (PACKET_LEN + 1);
+        uint16_t sum = (round < 4) ? edge_sums[round] : rand_next();
+
+        if (round % 4 == 1) {
+            /* carries everywhere */
+            memset(data + offset, 0xff, len);
+        }
+        else if (round % 64 == 2) {
+            memset(data + offset, 0, len);
+        }
+        else {
+            rand_fill(data + offset, len);
+        }
+
+        if (csum(sum, data + offset, len) != csum_ref(sum, data + offset, len)) {
+            printf("csum differs: sum %04x, offset %u, len %u: %04x, expected %04x\n",
+                   sum, offset, len, csum(sum, data + offset, len),
+                   csum_ref(sum, data + offset, len));
+            failures++;
+        }
+    }
+
+    printf("+ fuzz: %u buffers\n", FUZZ_ROUNDS);
+}
+
+static void test_update(void)
+{
+    uint8_t old_field[16], new_field[16];
+
+    for (unsigned round = 0; round < FUZZ_ROUNDS; round++) {
+        uint16_t len = 16 + 2 * (rand_next() % (PACKET_LEN / 2 - 8));
+        uint16_t pos = 2 * (rand_next() % ((len - 16) / 2 + 1));
+        uint16_t field_len = (round & 1) ? 16 : 2;
+        uint16_t check, updated, expected, old_value, new_value;
+
+        rand_fill(data, len);
+
+        /* host byte order, as returned by csum() */
+        check = ~csum(0, data, len);
+        old_value = (data[pos] << 8) | data[pos + 1];
+        new_value = rand_next();
+        data[pos] = new_value >> 8;
+        data[pos + 1] = new_value;
+        updated = csum_update16(check, old_value, new_value);
+        expected = ~csum(0, data, len);
+
+        if (updated != expected) {
+            printf("csum_update16: %04x, expected %04x\n", updated, expected);
+            failures++;
+        }
+
+        /* network byte order, as read from the packet */
+        check = HTONS(expected);
+        memcpy(old_field, data + pos, field_len);
+        rand_fill(new_field, field_len);
+        memcpy(data + pos, new_field, field_len);
+        updated = csum_update(check, old_field, new_field, field_len);
+        expected = HTONS((uint16_t) ~csum(0, data, len));
+
+        if (updated != expected) {
+            printf("csum_update: %04x, expected %04x\n", updated, expected);
+            failures++;
+        }
+    }
+
+    printf("+ incremental update: %u changes\n", FUZZ_ROUNDS);
+}
+
+static unsigned long bench(uint16_t (*f)(uint16_t, uint8_t *, uint16_t),
+                           uint8_t *buf)
+{
+    volatile uint16_t sum;
+    unsigned long start = hwtimer_now();
+
+    for (unsigned i = 0; i < BENCH_ROUNDS; i++) {
+        sum = f(i, buf, PACKET_LEN);
+    }
+
+    (void) sum;
+
+    return HWTIMER_TICKS_TO_US(hwtimer_now() - start);
+}
+
+static void print_speed(const char *name, unsigned long us)
+{
+    if (us == 0) {
+        us = 1;
+    }
+
+    printf("+ %s: %lu us for %u x %u bytes, %lu kB/s\n", name, us,
+           BENCH_ROUNDS, PACKET_LEN,
+           (unsigned long)((uint64_t) BENCH_ROUNDS * PACKET_LEN * 1000 / us));
+}
+
+static void test_speed(void)
+{
+    volatile uint16_t check = 0;
+    unsigned long start, us;
+
+    rand_fill(data, sizeof(data));
+
+    print_speed("byte-wise csum, aligned", bench(csum_ref, data));
+    print_speed("csum, aligned", bench(csum, data));
+    print_speed("byte-wise csum, odd address", bench(csum_ref, data + 1));
+    print_speed("csum, odd address", bench(csum, data + 1));
+
+    /* echo reply: type and a source address change */
+    start = hwtimer_now();
+
+    for (unsigned i = 0; i < BENCH_ROUNDS; i++) {
+        check = csum_update(check, data, data + 2, 2);
+        check = csum_update(check, data + 16, data + 32, 16);
+    }
+
+    us = HWTIMER_TICKS_TO_US(hwtimer_now() - start);
+    printf("+ csum_update of 18 bytes: %lu us for %u updates\n", us,
+           BENCH_ROUNDS);
+}
+
+int main(void)
+{
+    puts("Internet checksum test.");
+
+    test_fuzz();
+    test_update();
+    test_speed();
+
+    if (failures) {
+        printf("FAILURE: %d errors\n", failures);
+        return 1;
+    }
+
+    puts("SUCCESS");
+
+    return 0;
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2014  Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup tests
+ * @{
+ *
+ * @file
+ * @brief   RPL routing table: random adds, refreshes and deletes checked
+ *          against a model while the lifetime wheel expires entries, lookup
+ *          and expiry time of a full table
+ *
+ * @author  DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hwtimer.h"
+#include "rpl.h"
+
+#define NODES           (RPL_MAX_ROUTING_ENTRIES + RPL_MAX_ROUTING_ENTRIES / 4)
+#define SECONDS         (1000)
+#define ROUNDS          (20)
+
+/* remaining lifetime of the route to each node, 0 if there is none */
+static uint32_t model[NODES];
+static uint32_t routes;
+static uint32_t rand_state = 12345;
+static int failures;
+
+static uint32_t rand_next(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 16;
+}
+
+/* global address from a node number, as derived from a 16 bit short
+ * address */
+static void node_addr(ipv6_addr_t *addr, uint16_t node)
+{
+    memset(addr, 0, sizeof(ipv6_addr_t));
+    addr->uint16[0] = HTONS(0xabcd);
+    addr->uint16[5] = HTONS(0x00ff);
+    addr->uint16[6] = HTONS(0xfe00);
+    addr->uint16[7] = HTONS(node + 1);
+}
+
+static void check_routes(uint32_t second)
+{
+    ipv6_addr_t addr, next_hop;
+
+    for (uint16_t node = 0; node < NODES; node++) {
+        rpl_routing_entry_t *entry;
+
+        node_addr(&addr, node);
+        entry = rpl_find_routing_entry(&addr);
+
+        if ((entry == NULL) != (model[node] == 0)) {
+            printf("second %lu: route to node %u %s\n", (unsigned long) second, node,
+                   (entry == NULL) ? "missing" : "not expired");
+            failures++;
+            continue;
+        }
+
+        if (entry == NULL) {
+            continue;
+        }
+
+        node_addr(&next_hop, node / 8);
+
+        if (!rpl_equal_id(&entry->next_hop, &next_hop) ||
+            (rpl_get_next_hop(&addr) != &entry->next_hop) ||
+            (rpl_get_routing_entry_lifetime(entry) != model[node])) {
+            printf("second %lu: route to node %u wrong\n", (unsigned long) second, node);
+            failures++;
+        }
+    }
+}
+
+static void test_lifetimes(void)
+{
+    ipv6_addr_t addr, next_hop;
+
+    rpl_clear_routing_table();
+    memset(model, 0, sizeof(model));
+    routes = 0;
+
+    for (uint32_t second = 1; second <= SECONDS; second++) {
+        /* DAOs of this second */
+        for (unsigned i = 0; i < 64; i++) {
+            uint16_t node = rand_next() % NODES;
+            uint16_t lifetime = rand_next() % 300;
+
+            node_addr(&addr, node);
+
+            if (rand_next() % 16 == 0) {
+                rpl_del_routing_entry(&addr);
+                routes -= (model[node] != 0);
+                model[node] = 0;
+                continue;
+            }
+
+            /* routing table full, a new route is dropped */
+            if ((model[node] == 0) && (routes == RPL_MAX_ROUTING_ENTRIES)) {
+                continue;
+            }
+
+            node_addr(&next_hop, node / 8);
+            rpl_add_routing_entry(&addr, &next_hop, lifetime);
+            routes += (model[node] == 0);
+            model[node] = (lifetime > 0) ? lifetime : 1;
+        }
+
+        rpl_expire_routing_entries();
+
+        for (uint16_t node = 0; node < NODES; node++) {
+            if (model[node] > 0) {
+                model[node]--;
+                routes -= (model[node] == 0);
+            }
+        }
+
+        if (second % 50 == 0) {
+            check_routes(second);
+        }
+    }
+
+    printf("+ %lu seconds, %lu routes at the end\n", (unsigned long) SECONDS,
+           (unsigned long) routes);
+}
+
+/* lookup of the former routing table */
+static rpl_routing_entry_t *linear_find(ipv6_addr_t *addr)
+{
+    rpl_routing_entry_t *rt = rpl_get_routing_table();
+
+    for (uint16_t i = 0; i < RPL_MAX_ROUTING_ENTRIES; i++) {
+        if (rt[i].used && rpl_equal_id(&rt[i].address, addr)) {
+            return &rt[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void bench_full_table(void)
+{
+    static ipv6_addr_t addrs[RPL_MAX_ROUTING_ENTRIES];
+    unsigned long start, hashed, linear, expiry;
+    ipv6_addr_t next_hop;
+
+    rpl_clear_routing_table();
+
+    for (uint16_t node = 0; node < RPL_MAX_ROUTING_ENTRIES; node++) {
+        node_addr(&addrs[node], node);
+        node_addr(&next_hop, node / 8);
+        rpl_add_routing_entry(&addrs[node], &next_hop, 60 + node % 240);
+    }
+
+    start = hwtimer_now();
+
+    for (unsigned r = 0; r < ROUNDS; r++) {
+        for (uint16_t node = 0; node < RPL_MAX_ROUTING_ENTRIES; node++) {
+            if (rpl_find_routing_entry(&addrs[node]) == NULL) {
+                failures++;
+            }
+        }
+    }
+
+    hashed = hwtimer_now() - start;
+    start = hwtimer_now();
+
+    for (unsigned r = 0; r < ROUNDS; r++) {
+        for (uint16_t node = 0; node < RPL_MAX_ROUTING_ENTRIES; node++) {
+            if (linear_find(&addrs[node]) == NULL) {
+                failures++;
+            }
+        }
+    }
+
+    linear = hwtimer_now() - start;
+
+    /* one expiry second, no entry is due yet */
+    start = hwtimer_now();
+
+    for (unsigned r = 0; r < ROUNDS; r++) {
+        rpl_expire_routing_entries();
+    }
+
+    expiry = hwtimer_now() - start;
+
+    printf("+ %u routes, lookup: hashed %lu ns, linear %lu ns\n",
+           RPL_MAX_ROUTING_ENTRIES,
+           (unsigned long)((uint64_t) HWTIMER_TICKS_TO_US(hashed) * 1000 /
+                           (ROUNDS * RPL_MAX_ROUTING_ENTRIES)),
+           (unsigned long)((uint64_t) HWTIMER_TICKS_TO_US(linear) * 1000 /
+                           (ROUNDS * RPL_MAX_ROUTING_ENTRIES)));
+    printf("+ expiry per second: %lu ns\n",
+           (unsigned long)((uint64_t) HWTIMER_TICKS_TO_US(expiry) * 1000 / ROUNDS));
+}
+
+int main(void)
+{
+    puts("RPL routing table test.");
+
+    test_lifetimes();
+    bench_full_table();
+
+    if (failures) {
+        printf("FAILURE: %d errors\n", failures);
+        return 1;
+    }
+
+    puts("SUCCESS");
+
+    return 0;
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2014  Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup tests
+ * @{
+ *
+ * @file
+ * @brief   Socket demultiplexing: lookup time of received UDP and TCP
+ *          packets against the number of sockets, hashed index and former
+ *          linear scan, and the free source port allocator
+ *
+ * @author  DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hwtimer.h"
+#include "net_help.h"
+#include "socket.h"
+
+#define ROUNDS          (200)
+#define UDP_PORT        (5683)
+#define TCP_PORT        (80)
+#define EPHEMERAL_PORTS (49152)
+
+/* tcp_states of the TCP module */
+#define TCP_LISTEN      (1)
+#define TCP_ESTABLISHED (4)
+
+/* receive path lookups of the UDP and TCP modules */
+socket_internal_t *get_udp_socket(udp_hdr_t *udp_header);
+socket_internal_t *get_tcp_socket(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header);
+bool is_four_touple(socket_internal_t *current_socket, ipv6_hdr_t *ipv6_header,
+                    tcp_hdr_t *tcp_header);
+
+/* one received packet per socket, a SYN from a new peer for the listener */
+static udp_hdr_t udp_headers[MAX_SOCKETS];
+static ipv6_hdr_t ipv6_headers[MAX_SOCKETS];
+static tcp_hdr_t tcp_headers[MAX_SOCKETS];
+static unsigned udp_count, tcp_count;
+static int failures;
+
+static void set_addr(ipv6_addr_t *addr, uint16_t node)
+{
+    memset(addr, 0, sizeof(ipv6_addr_t));
+    addr->uint16[0] = HTONS(0xfe80);
+    addr->uint16[7] = HTONS(node);
+}
+
+/* half UDP sockets on their own ports, half TCP on one port: a listening
+ * socket and connections from different peers */
+static void setup(unsigned count)
+{
+    socket_base_init();
+    udp_count = 0;
+    tcp_count = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+        socket_internal_t *sock;
+        socket_t *values;
+
+        if (i % 2 == 0) {
+            sock = socket_base_get_socket(socket_base_socket(PF_INET6, SOCK_DGRAM,
+                                                             IPPROTO_UDP));
+            values = &sock->socket_values;
+            values->local_address.sin6_port = HTONS(UDP_PORT + i);
+            udp_headers[udp_count++].dst_port = values->local_address.sin6_port;
+        }
+        else {
+            sock = socket_base_get_socket(socket_base_socket(PF_INET6, SOCK_STREAM,
+                                                             IPPROTO_TCP));
+            values = &sock->socket_values;
+            set_addr(&values->local_address.sin6_addr, 1);
+            values->local_address.sin6_port = HTONS(TCP_PORT);
+            values->tcp_control.state = (i == 1) ? TCP_LISTEN : TCP_ESTABLISHED;
+
+            if (i > 1) {
+                set_addr(&values->foreign_address.sin6_addr, i);
+                values->foreign_address.sin6_port = HTONS(EPHEMERAL_PORTS + i);
+            }
+
+            set_addr(&ipv6_headers[tcp_count].destaddr, 1);
+            set_addr(&ipv6_headers[tcp_count].srcaddr, (i > 1) ? i : 0xffff);
+            tcp_headers[tcp_count].dst_port = HTONS(TCP_PORT);
+            tcp_headers[tcp_count].src_port = HTONS(EPHEMERAL_PORTS + i);
+            tcp_count++;
+        }
+
+        socket_base_demux_add(sock);
+    }
+}
+
+/* lookups before the demultiplexing index */
+static socket_internal_t *linear_udp(udp_hdr_t *udp_header)
+{
+    for (int i = 1; i < MAX_SOCKETS + 1; i++) {
+        if (udp_socket_compliancy(i) &&
+            (socket_base_get_socket(i)->socket_values.local_address.sin6_port ==
+             udp_header->dst_port)) {
+            return socket_base_get_socket(i);
+        }
+    }
+
+    return NULL;
+}
+
+static socket_internal_t *linear_tcp(ipv6_hdr_t *ipv6_header, tcp_hdr_t *tcp_header)
+{
+    socket_internal_t *listening_socket = NULL;
+
+    for (int i = 1; i < MAX_SOCKETS + 1; i++) {
+        socket_internal_t *current_socket = socket_base_get_socket(i);
+
+        if (!tcp_socket_compliancy(i)) {
+            continue;
+        }
+
+        if (is_four_touple(current_socket, ipv6_header, tcp_header)) {
+            return current_socket;
+        }
+        else if ((current_socket->socket_values.tcp_control.state == TCP_LISTEN) &&
+                 (current_socket->socket_values.local_address.sin6_port ==
+                  tcp_header->dst_port) &&
+                 (current_socket->socket_values.foreign_address.sin6_port == 0)) {
+            listening_socket = current_socket;
+        }
+    }
+
+    return listening_socket;
+}
+
+static void check_lookups(unsigned count)
+{
+    for (unsigned i = 0; i < udp_count; i++) {
+        socket_internal_t *sock = get_udp_socket(&udp_headers[i]);
+
+        if ((sock == NULL) || (sock != linear_udp(&udp_headers[i]))) {
+            printf("%u sockets: UDP port %u not found\n", count,
+                   NTOHS(udp_headers[i].dst_port));
+            failures++;
+        }
+    }
+
+    for (unsigned i = 0; i < tcp_count; i++) {
+        socket_internal_t *sock = get_tcp_socket(&ipv6_headers[i], &tcp_headers[i]);
+
+        if ((sock == NULL) || (sock != linear_tcp(&ipv6_headers[i], &tcp_headers[i]))) {
+            printf("%u sockets: TCP peer %u not found\n", count,
+                   NTOHS(tcp_headers[i].src_port));
+            failures++;
+        }
+    }
+}
+
+static unsigned long ns_per_lookup(unsigned long ticks, unsigned lookups)
+{
+    return (unsigned long)((uint64_t) HWTIMER_TICKS_TO_US(ticks) * 1000 /
+                           (ROUNDS * lookups));
+}
+
+static void bench_lookups(unsigned count)
+{
+    unsigned long udp_hashed, udp_linear, tcp_hashed, tcp_linear, start;
+
+    start = hwtimer_now();
+
+    for (unsigned r = 0; r < ROUNDS; r++) {
+        for (unsigned i = 0; i < udp_count; i++) {
+            get_udp_socket(&udp_headers[i]);
+        }
+    }
+
+    udp_hashed = hwtimer_now() - start;
+    start = hwtimer_now();
+
+    for (unsigned r = 0; r < ROUNDS; r++) {
+        for (unsigned i = 0; i < udp_count; i++) {
+            linear_udp(&udp_headers[i]);
+        }
+    }
+
+    udp_linear = hwtimer_now() - start;
+    start = hwtimer_now();
+
+    for (unsigned r = 0; r < ROUNDS; r++) {
+        for (unsigned i = 0; i < tcp_count; i++) {
+            get_tcp_socket(&ipv6_headers[i], &tcp_headers[i]);
+        }
+    }
+
+    tcp_hashed = hwtimer_now() - start;
+    start = hwtimer_now();
+
+    for (unsigned r = 0; r < ROUNDS; r++) {
+        for (unsigned i = 0; i < tcp_count; i++) {
+            linear_tcp(&ipv6_headers[i], &tcp_headers[i]);
+        }
+    }
+
+    tcp_linear = hwtimer_now() - start;
+
+    printf("%7u %10lu %10lu %10lu %10lu\n", count,
+           ns_per_lookup(udp_hashed, udp_count), ns_per_lookup(udp_linear, udp_count),
+           ns_per_lookup(tcp_hashed, tcp_count), ns_per_lookup(tcp_linear, tcp_count));
+}
+
+static void test_free_port(void)
+{
+    uint16_t port, ports[MAX_SOCKETS];
+
+    socket_base_init();
+
+    for (int i = 0; i < MAX_SOCKETS; i++) {
+        socket_internal_t *sock;
+
+        port = socket_base_get_free_source_port(IPPROTO_UDP);
+
+        if ((port < EPHEMERAL_PORTS) ||
+            (socket_base_get_free_source_port(IPPROTO_UDP) != port)) {
+            printf("free port: %u not stable\n", port);
+            failures++;
+        }
+
+        for (int j = 0; j < i; j++) {
+            if (ports[j] == port) {
+                printf("free port: %u in use\n", port);
+                failures++;
+            }
+        }
+
+        ports[i] = port;
+        sock = socket_base_get_socket(socket_base_socket(PF_INET6, SOCK_DGRAM,
+                                                         IPPROTO_UDP));
+        sock->socket_values.local_address.sin6_port = HTONS(port);
+        socket_base_demux_add(sock);
+    }
+
+    /* a freed port is not reused before the others */
+    socket_base_free_socket(socket_base_get_socket(1));
+    port = socket_base_get_free_source_port(IPPROTO_UDP);
+
+    if (port != ports[MAX_SOCKETS - 1] + 1) {
+        printf("free port: %u after freeing %u\n", port, ports[0]);
+        failures++;
+    }
+}
+
+int main(void)
+{
+    puts("Socket demultiplexing test.");
+    puts("sockets  UDP hashed UDP linear TCP hashed TCP linear (ns per lookup)");
+
+    for (unsigned count = 2; count <= MAX_SOCKETS; count *= 2) {
+        setup(count);
+        check_lookups(count);
+        bench_lookups(count);
+    }
+
+    test_free_port();
+
+    if (failures) {
+        printf("FAILURE: %d errors\n", failures);
+        return 1;
+    }
+
+    puts("SUCCESS");
+
+    return 0;
+}
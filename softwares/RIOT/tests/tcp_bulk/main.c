@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2014  Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup tests
+ * @{
+ *
+ * @file
+ * @brief   TCP bulk transfer between two native nodes, throughput of
+ *          tcp_send()
+ *
+ * @author  DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ *
+ * @}
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "net_if.h"
+#include "sixlowpan.h"
+#include "ipv6.h"
+#include "socket_base/socket.h"
+#include "vtimer.h"
+
+#define RECEIVER_ADDR   (1)
+#define SENDER_ADDR     (2)
+
+#define PORT            (1234)
+#define BULK_SIZE       (4096)
+#define SECOND          (1000 * 1000)
+
+static uint8_t data[BULK_SIZE];
+
+static uint8_t pattern(uint32_t pos)
+{
+    return (uint8_t)(pos * 7 + (pos >> 8));
+}
+
+static int init_local_address(uint16_t r_addr)
+{
+    ipv6_addr_t std_addr;
+    ipv6_addr_init(&std_addr, 0xabcd, 0xef12, 0, 0, 0x1034, 0x00ff, 0xfe00,
+                   0);
+    net_if_set_src_address_mode(0, NET_IF_TRANS_ADDR_M_SHORT);
+    return net_if_set_hardware_address(0, r_addr) &&
+           sixlowpan_lowpan_init_adhoc_interface(0, &std_addr);
+}
+
+static void set_address(sockaddr6_t *addr, uint16_t r_addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sin6_family = AF_INET6;
+    addr->sin6_port = HTONS(PORT);
+    ipv6_addr_init(&addr->sin6_addr, 0xabcd, 0xef12, 0, 0, 0, 0x00ff, 0xfe00,
+                   r_addr);
+}
+
+#ifdef SENDER
+static void sender(void)
+{
+    sockaddr6_t addr;
+    timex_t start, end;
+    unsigned long ms;
+    int s;
+
+    for (uint32_t i = 0; i < BULK_SIZE; i++) {
+        data[i] = pattern(i);
+    }
+
+    set_address(&addr, RECEIVER_ADDR);
+    s = socket_base_socket(PF_INET6, SOCK_STREAM, IPPROTO_TCP);
+
+    if (socket_base_connect(s, &addr, sizeof(addr)) < 0) {
+        puts("Connection failed");
+        return;
+    }
+
+    vtimer_now(&start);
+
+    if (socket_base_send(s, data, BULK_SIZE, 0) != BULK_SIZE) {
+        puts("Sending failed");
+        return;
+    }
+
+    vtimer_now(&end);
+    ms = timex_uint64(timex_sub(end, start)) / 1000;
+
+    if (ms == 0) {
+        ms = 1;
+    }
+
+    printf("+ sent %u bytes in %lu ms, %lu B/s\n", BULK_SIZE, ms,
+           (unsigned long) BULK_SIZE * 1000 / ms);
+
+    socket_base_close(s);
+}
+#else
+static void receiver(void)
+{
+    sockaddr6_t addr;
+    uint8_t buf[TRANSPORT_LAYER_SOCKET_MAX_TCP_BUFFER];
+    uint32_t received = 0;
+    int32_t len;
+    int s, conn, errors = 0;
+
+    set_address(&addr, RECEIVER_ADDR);
+    s = socket_base_socket(PF_INET6, SOCK_STREAM, IPPROTO_TCP);
+
+    if ((socket_base_bind(s, &addr, sizeof(addr)) < 0) ||
+        (socket_base_listen(s, 1) < 0)) {
+        puts("Listening failed");
+        return;
+    }
+
+    puts("Waiting for connection");
+    conn = socket_base_accept(s, NULL, NULL);
+
+    if (conn < 0) {
+        puts("Accept failed");
+        return;
+    }
+
+    while (received < BULK_SIZE) {
+        len = socket_base_recv(conn, buf, sizeof(buf), 0);
+
+        if (len <= 0) {
+            break;
+        }
+
+        for (int32_t i = 0; i < len; i++) {
+            if (buf[i] != pattern(received + i)) {
+                errors++;
+            }
+        }
+
+        received += len;
+    }
+
+    printf("received %lu bytes, %s\n", (unsigned long) received,
+           ((received == BULK_SIZE) && (errors == 0)) ? "SUCCESS" : "FAILURE");
+
+    socket_base_close(conn);
+}
+#endif
+
+int main(void)
+{
+#ifdef SENDER
+    uint16_t r_addr = SENDER_ADDR;
+#else
+    uint16_t r_addr = RECEIVER_ADDR;
+#endif
+
+    puts("TCP bulk transfer test.");
+
+    if (!init_local_address(r_addr)) {
+        printf("Can not initialize IP for hardware address %u.\n", r_addr);
+        return 1;
+    }
+
+#ifdef SENDER
+    /* receiver is started first */
+    vtimer_usleep(SECOND);
+    sender();
+#else
+    receiver();
+#endif
+
+    return 0;
+}
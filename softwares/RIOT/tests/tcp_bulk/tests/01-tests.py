@@ -0,0 +1,32 @@
+#! /usr/bin/env python
+
+import sys
+from pexpect import spawn
+
+def run(sender_elf):
+    receiver = spawn("bin/native/tcp_bulk.elf tap0", timeout=300)
+    sender = spawn(sender_elf + " tap1", timeout=300)
+
+    receiver.expect("Waiting for connection")
+    sender.expect(r"\+ sent (\d+) bytes in (\d+) ms, (\d+) B/s")
+    throughput = int(sender.match.group(3))
+    receiver.expect(r"received (\d+) bytes, (\w+)")
+    result = receiver.match.group(2)
+
+    if not sender.terminate():
+        sender.terminate(force=True)
+    if not receiver.terminate():
+        receiver.terminate(force=True)
+
+    if result != "SUCCESS":
+        sys.stderr.write("Data received by " + sender_elf + " is wrong\n")
+        sys.exit(1)
+
+    return throughput
+
+if __name__ == "__main__":
+    before = run("bin/stopwait/native/tcp_bulk_stopwait.elf")
+    after = run("bin/sender/native/tcp_bulk_sender.elf")
+
+    print("stop-and-wait: " + str(before) + " B/s")
+    print("sliding window: " + str(after) + " B/s")
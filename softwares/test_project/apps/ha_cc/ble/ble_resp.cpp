@@ -21,8 +21,6 @@ extern "C" {
 #define HA_DEBUG_EN (0)
 #include "ha_debug.h"
 
-extern ble_ack_s ble_ack;
-
 /******************************************************************************
  * Private variables and buffers
  ******************************************************************************/
@@ -96,9 +94,10 @@ void ble_evt_attributes_value(const struct ble_msg_attributes_value_evt_t *msg)
 
     if(msg->handle == 0x13){
         numOfMsg = 0;                      // reset counter
-        ble_ack_timeout_count = 0;
         totalMsgLen = 0;
-        thread_wakeup(ble_thread_ns::ble_thread_pid);
+        /* drop outstanding packets */
+        msg_ble_thread.type = ha_cc_ns::BLE_WINDOW_RESET;
+        msg_send_int(&msg_ble_thread, ble_thread_ns::ble_thread_pid);
         return;
     }
 
@@ -107,14 +106,21 @@ void ble_evt_attributes_value(const struct ble_msg_attributes_value_evt_t *msg)
 
     if (1 == numOfMsg) {
         if (msg->value.data[0] == ha_ble_ns::BLE_MSG_ACK) { //if message is ACK
-            /* get index, if true wake-up ble_thread */
-            HA_DEBUG(" receive ACK %d\n", ble_ack.packet_index);
             numOfMsg = 0;                      // reset counter
-            ble_ack_timeout_count = 0;
             totalMsgLen = 0;
-            if(ble_ack.need_to_wait_ack == true){
-                thread_wakeup(ble_thread_ns::ble_thread_pid);
+            if (msg->value.len < ha_ble_ns::ble_msg_hdr_size) {
+                return;
+            }
+
+            /* packet index and selective ack bitmap to ble_thread */
+            msg_ble_thread.type = ha_cc_ns::BLE_ACK_RECEIVED;
+            msg_ble_thread.content.value = buf2uint16((uint8_t *)&msg->value.data[1]);
+            if (msg->value.len > ha_ble_ns::ble_msg_hdr_size) {
+                msg_ble_thread.content.value |=
+                        (uint32_t)msg->value.data[ha_ble_ns::ble_msg_hdr_size] << 16;
             }
+            HA_DEBUG(" receive ACK %lx\n", msg_ble_thread.content.value);
+            msg_send_int(&msg_ble_thread, ble_thread_ns::ble_thread_pid);
             return;
         } else {                                    // case message is data
             msgLen = msg->value.data[3] + ha_ns::GFF_CMD_SIZE
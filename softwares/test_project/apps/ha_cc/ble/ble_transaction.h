@@ -12,6 +12,7 @@
 #include "apitypes.h"
 #include "cmd_def.h"
 #include "cir_queue.h"
+#include "gff_queue.h"
 #include "cc_msg_id.h"
 
 #define ATT_WRITE_ADDR    	(0x08)
@@ -25,6 +26,19 @@ enum ble_msg_type_id
     BLE_MSG_DATA,
 };
 
+/*
+ * Data to mobile: | BLE_MSG_DATA (1) | packet index (2) | GFF frame | GFF frame | ... |
+ * Ack from mobile: | BLE_MSG_ACK (1) | packet index (2) | bitmap (1, optional) |
+ *      bit i of bitmap also acks packet index + 1 + i (selective ack).
+ * Up to ble_window_size packets can be outstanding, unacked packets are
+ * retransmitted every ble_ack_timeout ms (driven by ble_timeout_TIM6_ISR).
+ */
+const uint8_t ble_msg_hdr_size = 3;
+const uint8_t ble_att_max_len = 128;     /* max length of an attribute write */
+const uint8_t ble_window_size = 4;       /* max number of outstanding packets */
+const uint16_t ble_ack_timeout = 300;    /* ms */
+const uint8_t ble_max_retransmissions = 5;
+
 const gpio_ns::gpio_params_t ble_reset_pin_param = {
         gpio_ns::port_C,
         10,
@@ -37,17 +51,12 @@ extern gpio ble_reset_pin;
 
 namespace ble_thread_ns {
 extern int16_t ble_thread_pid;
-/*controller message queue */
-extern cir_queue controller_to_ble_msg_queue;
+/* controller message queue, GFF_PENDING messages carry handle of the frame */
+extern gff_queue controller_to_ble_msg_queue;
 }
 
 extern volatile uint16_t ble_ack_timeout_count;
 
-struct ble_ack_s {
-    bool need_to_wait_ack = false;
-    uint16_t packet_index = 0;
-};
-
 /* initial usart3 interrupt */
 void USART3_RxInit(void);
 
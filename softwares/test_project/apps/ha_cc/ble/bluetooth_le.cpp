@@ -36,8 +36,17 @@ extern "C" {
  * Variables and buffers
  ******************************************************************************/
 
-/* data structure to process ACK from Mobile */
-ble_ack_s ble_ack;
+/* sliding window of packets sent to Mobile */
+typedef struct ble_window_slot_s {
+    bool acked;
+    uint8_t retransmissions;
+    uint8_t len;
+    uint8_t buf[ha_ble_ns::ble_att_max_len];
+} ble_window_slot_t;
+
+static ble_window_slot_t ble_window[ha_ble_ns::ble_window_size];
+static uint16_t ble_window_base = 0;    /* index of the oldest outstanding packet */
+static uint16_t ble_next_index = 0;     /* index of the next packet */
 
 /* ble message queue */
 static const uint16_t ble_message_queue_size = 128;
@@ -49,9 +58,11 @@ static char ble_thread_stack[ble_thread_stack_size];
 static const char ble_thread_prio = PRIORITY_MAIN - 1;
 static void *ble_transaction(void *arg);
 
-/* circle queue to save data received from controller thread */
+/* frame queue to save data received from controller thread */
 static const uint16_t controller_to_ble_msg_queue_size = 1280;
 static uint8_t controller_to_ble_msg_queue_buf[controller_to_ble_msg_queue_size];
+static const uint8_t controller_to_ble_msg_queue_slots = 64; /* power of 2 */
+static gff_queue_ns::slot_t controller_to_ble_msg_queue_slots_buf[controller_to_ble_msg_queue_slots];
 
 /* ble reset pin */
 namespace ha_ble_ns {
@@ -62,8 +73,9 @@ namespace ble_thread_ns {
 kernel_pid_t ble_thread_pid;
 
 /*controller message queue */
-cir_queue controller_to_ble_msg_queue(controller_to_ble_msg_queue_buf,
-        controller_to_ble_msg_queue_size);
+gff_queue controller_to_ble_msg_queue(controller_to_ble_msg_queue_buf,
+        controller_to_ble_msg_queue_size, controller_to_ble_msg_queue_slots_buf,
+        controller_to_ble_msg_queue_slots);
 }
 
 // timer 6 timeout
@@ -78,25 +90,46 @@ volatile uint16_t ble_ack_timeout_count = 0;
  */
 static void ble_write_att(uint16_t handle, uint8_t *dataBuf, uint8_t len);
 /**
- * @brief:  process message from controller
+ * @brief:  pack messages from controller into packets and send them to Mobile
+ *          while the window is not full.
  */
-static void receive_msg_from_controller(cir_queue* mCirQueue, uint16_t msgIndex,
+static void receive_msg_from_controller(gff_queue* mFrameQueue,
 bool mMoblieConnected);
 
 /**
- * @brief: thread wait ack from Mobile
+ * @brief:  mark a packet in the window as acked.
  */
-void wait_mobile_ack(uint16_t mSec);
+static void ble_window_ack(uint16_t index);
+
+/**
+ * @brief:  slide the window over acked packets.
+ *
+ * @return: true if the window has been slid.
+ */
+static bool ble_window_slide(void);
+
+/**
+ * @brief:  retransmit unacked packets, give up packets retransmitted too many times.
+ */
+static void ble_window_retransmit(void);
+
+/**
+ * @brief:  drop all outstanding packets.
+ */
+static void ble_window_reset(void);
 /*******************************************************************************
  * Public functions
  ******************************************************************************/
 
 void ble_timeout_TIM6_ISR(void)
 {
+    msg_t msg;
+
     if (ble_ack_timeout_count > 0) {
         ble_ack_timeout_count--;
         if (ble_ack_timeout_count == 0) {
-            thread_wakeup(ble_thread_ns::ble_thread_pid);
+            msg.type = ha_cc_ns::BLE_ACK_TIMEOUT;
+            msg_send_int(&msg, ble_thread_ns::ble_thread_pid);
         }
     }
 }
@@ -112,6 +145,12 @@ void ble_thread_start(void)
             ble_transaction,
             NULL, "ble thread");
 
+    /* retransmission timer */
+    if (MB1_ISRs.subISR_assign(ISRMgr_ns::ISRMgr_TIM6, ble_timeout_TIM6_ISR) !=
+            ISRMgr_ns::successful) {
+        HA_DEBUG("ble_thread_start: failed to add ble_timeout_TIM6_ISR to TIM6 int\n");
+    }
+
     /* init and reset ble */
     ha_ble_ns::ble_reset_pin.gpio_init(&ha_ble_ns::ble_reset_pin_param);
     HA_NOTIFY("Reseting ble module...\n");
@@ -137,8 +176,11 @@ void *ble_transaction(void *arg)
     msg_t msg;
     bool mConnect = false;
     uint16_t usart_msg_len;
-    uint8_t usartBuf[ha_ns::GFF_MAX_FRAME_SIZE];
+    uint8_t *gff_frame;
     cir_queue* usartQueue;
+    gff_queue* controllerQueue = &ble_thread_ns::controller_to_ble_msg_queue;
+    uint16_t ack_index;
+    uint8_t ack_bitmap;
 
     msg_init_queue(ble_message_queue, ble_message_queue_size);
     while (1) {
@@ -155,9 +197,11 @@ void *ble_transaction(void *arg)
             break;
         case ha_cc_ns::BLE_CLIENT_CONNECT:
             mConnect = true;
+            ble_window_reset();
             break;
         case ha_cc_ns::BLE_CLIENT_DISCONNECT:
             mConnect = false;
+            ble_window_reset();
             ble_cmd_gap_set_mode(gap_general_discoverable,
                     gap_undirected_connectable);
             break;
@@ -170,29 +214,38 @@ void *ble_transaction(void *arg)
                     + ha_ns::GFF_LEN_SIZE + ha_ns::GFF_CMD_SIZE;
 
             if(usartQueue->get_size() > 30){
-                usartQueue->get_data(usartBuf, usartQueue->get_size());
+                while (usartQueue->get_size() > 0) {
+                    usartQueue->get_data();
+                }
                 break;
             }
 
             if (usart_msg_len <= usartQueue->get_size()) {
-                usartQueue->get_data(usartBuf, usart_msg_len);
+                /* put data directly to controller's queue */
+                gff_frame = controller_ns::ble_to_controller_queue.reserve(usart_msg_len);
+                if (gff_frame == NULL) {
+                    HA_NOTIFY("ble_thread: controller queue is full, message dropped (%lu)\n",
+                            controller_ns::ble_to_controller_queue.get_drops());
+                    for (uint16_t i = 0; i < usart_msg_len; i++) {
+                        usartQueue->get_data();
+                    }
+                    break;
+                }
+                usartQueue->get_data(gff_frame, usart_msg_len);
 
                 /* send ACK to mobile*/
 //                send_ack_to_mobile();
 
                 //DEBUG
                 for (uint8_t i = 0; i < usart_msg_len; i++) {
-                    HA_DEBUG("%d ", usartBuf[i]);
+                    HA_DEBUG("%d ", gff_frame[i]);
                 }HA_DEBUG("\n");
 
-                /* put data to controller's queue */
-                controller_ns::ble_to_controller_queue.add_data(usartBuf,
-                        usart_msg_len);
-                /* Send data to Controller thread */
+                /* Send handle of the frame to Controller thread */
                 msg_t msg_ble_thread;
                 msg_ble_thread.type = ha_cc_ns::BLE_GFF_PENDING;
-                msg_ble_thread.content.ptr =
-                        (char*) &controller_ns::ble_to_controller_queue;
+                msg_ble_thread.content.value =
+                        controller_ns::ble_to_controller_queue.commit();
                 msg_send(&msg_ble_thread, controller_ns::controller_pid, false);
             } else {
                 HA_DEBUG(" usart queue overflow\n");
@@ -200,8 +253,37 @@ void *ble_transaction(void *arg)
             break;
         case ha_ns::GFF_PENDING:
             // Get message from thread Controller, and send to Mobile
-            receive_msg_from_controller((cir_queue *) msg.content.ptr,
-                    ble_ack.packet_index, mConnect);
+            // (all pending frames are packed, handle is not needed)
+            receive_msg_from_controller(controllerQueue, mConnect);
+            break;
+        case ha_cc_ns::BLE_ACK_RECEIVED:
+            ack_index = (uint16_t) msg.content.value;
+            ack_bitmap = (uint8_t) (msg.content.value >> 16);
+            ble_window_ack(ack_index);
+            for (uint8_t i = 0; i < 8; i++) {
+                if (ack_bitmap & (1 << i)) {
+                    ble_window_ack(ack_index + 1 + i);
+                }
+            }
+
+            if (ble_window_slide()) {
+                /* restart timer for the remaining packets */
+                ble_ack_timeout_count =
+                        (ble_window_base != ble_next_index) ? ha_ble_ns::ble_ack_timeout : 0;
+                receive_msg_from_controller(controllerQueue, mConnect);
+            }
+            break;
+        case ha_cc_ns::BLE_ACK_TIMEOUT:
+            ble_window_retransmit();
+            ble_window_slide();
+            if (ble_window_base != ble_next_index) {
+                ble_ack_timeout_count = ha_ble_ns::ble_ack_timeout;
+            }
+            receive_msg_from_controller(controllerQueue, mConnect);
+            break;
+        case ha_cc_ns::BLE_WINDOW_RESET:
+            ble_window_reset();
+            receive_msg_from_controller(controllerQueue, mConnect);
             break;
         default:
             HA_DEBUG("error\n");
@@ -215,51 +297,115 @@ void *ble_transaction(void *arg)
 /**
  * @brief: Receive message from controller thread
  */
-void receive_msg_from_controller(cir_queue* mCirQueue, uint16_t msgIndex,
+void receive_msg_from_controller(gff_queue* mFrameQueue,
 bool mMoblieConnected)
 {
-    uint8_t bufLen = mCirQueue->preview_data(false) + ha_ns::GFF_CMD_SIZE
-            + ha_ns::GFF_LEN_SIZE;
-    uint8_t dataBuf[ha_ns::GFF_MAX_FRAME_SIZE];
-
-    uint8_t indexBuf[2];
-    int32_t qBufSize;
-
-    uint162buf(msgIndex, indexBuf);
-    qBufSize = mCirQueue->get_size();
-    HA_DEBUG("len = %d\n", bufLen);HA_DEBUG("qsize = %d\n", qBufSize);
-    if (bufLen <= qBufSize) {
-        mCirQueue->get_data(dataBuf, bufLen);
-        // add header(msg type + index) to message
-        add_hdr_to_ble_msg(ha_ble_ns::BLE_MSG_DATA, indexBuf, dataBuf, bufLen);
-        if (mMoblieConnected) {
-            HA_DEBUG("packet index START\n");
-            ble_write_att(ATT_WRITE_ADDR, dataBuf, bufLen + 3);
-            // sleep to wait ack from mobile
-            if (bufLen >= 27) {
-                wait_mobile_ack(400); // 150ms
-            } else {
-                wait_mobile_ack(300);
+    ble_window_slot_t *slot;
+    uint16_t frameLen;
+    uint8_t *frame;
+
+    while ((frame = mFrameQueue->get_frame()) != NULL) {
+        frameLen = frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
+                + ha_ns::GFF_LEN_SIZE;
+
+        if (!mMoblieConnected) {
+            /* nobody to send to, drop */
+            mFrameQueue->release();
+            continue;
+        }
+
+        if (frameLen + ha_ble_ns::ble_msg_hdr_size > ha_ble_ns::ble_att_max_len) {
+            HA_DEBUG("Frame too long (%d), dropped\n", frameLen);
+            mFrameQueue->release();
+            continue;
+        }
+
+        if ((uint16_t) (ble_next_index - ble_window_base) >= ha_ble_ns::ble_window_size) {
+            /* window is full, wait for acks */
+            return;
+        }
+
+        /* pack as many frames as possible into a new packet */
+        slot = &ble_window[ble_next_index % ha_ble_ns::ble_window_size];
+        slot->buf[0] = ha_ble_ns::BLE_MSG_DATA;
+        uint162buf(ble_next_index, &slot->buf[1]);
+        slot->len = ha_ble_ns::ble_msg_hdr_size;
+        slot->acked = false;
+        slot->retransmissions = 0;
+
+        while ((frame = mFrameQueue->get_frame()) != NULL) {
+            frameLen = frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
+                    + ha_ns::GFF_LEN_SIZE;
+            if (slot->len + frameLen > ha_ble_ns::ble_att_max_len) {
+                break;
             }
-            ble_ack.packet_index++;
-            ble_ack.need_to_wait_ack = false;
-            HA_DEBUG("packet index END\n");
+            memcpy(&slot->buf[slot->len], frame, frameLen);
+            mFrameQueue->release();
+            slot->len += frameLen;
         }
 
-    } else {
-        HA_DEBUG("Frame error\n");
+        HA_DEBUG("packet index %d, len %d\n", ble_next_index, slot->len);
+        ble_write_att(ATT_WRITE_ADDR, slot->buf, slot->len);
+        ble_next_index++;
+
+        if (ble_ack_timeout_count == 0) {
+            ble_ack_timeout_count = ha_ble_ns::ble_ack_timeout;
+        }
     }
+}
 
+/*----------------------------------------------------------------------------*/
+static void ble_window_ack(uint16_t index)
+{
+    /* only outstanding packets */
+    if ((uint16_t) (index - ble_window_base)
+            < (uint16_t) (ble_next_index - ble_window_base)) {
+        ble_window[index % ha_ble_ns::ble_window_size].acked = true;
+    }
 }
 
-/**
- * @brief: thread wait ack from Mobile
- */
-void wait_mobile_ack(uint16_t mSec)
+/*----------------------------------------------------------------------------*/
+static bool ble_window_slide(void)
+{
+    bool slid = false;
+
+    while (ble_window_base != ble_next_index
+            && ble_window[ble_window_base % ha_ble_ns::ble_window_size].acked) {
+        ble_window_base++;
+        slid = true;
+    }
+
+    return slid;
+}
+
+/*----------------------------------------------------------------------------*/
+static void ble_window_retransmit(void)
+{
+    ble_window_slot_t *slot;
+
+    for (uint16_t index = ble_window_base; index != ble_next_index; index++) {
+        slot = &ble_window[index % ha_ble_ns::ble_window_size];
+        if (slot->acked) {
+            continue;
+        }
+
+        if (slot->retransmissions >= ha_ble_ns::ble_max_retransmissions) {
+            HA_DEBUG("packet index %d, no ack, dropped\n", index);
+            slot->acked = true;
+            continue;
+        }
+
+        HA_DEBUG("packet index %d, retransmit\n", index);
+        ble_write_att(ATT_WRITE_ADDR, slot->buf, slot->len);
+        slot->retransmissions++;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void ble_window_reset(void)
 {
-    ble_ack_timeout_count = mSec;
-    ble_ack.need_to_wait_ack = true;
-    thread_sleep();
+    ble_ack_timeout_count = 0;
+    ble_window_base = ble_next_index;
 }
 
 /**
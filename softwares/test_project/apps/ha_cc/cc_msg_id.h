@@ -26,6 +26,9 @@ enum cc_msg_id: uint16_t {
     BLE_CLIENT_CONNECT,
     BLE_CLIENT_DISCONNECT,
     BLE_CLIENT_WRITE,
+    BLE_ACK_RECEIVED,   /* content.value = packet index | selective ack bitmap << 16 */
+    BLE_ACK_TIMEOUT,
+    BLE_WINDOW_RESET,
 };
 
 }
@@ -38,12 +38,18 @@ extern "C" {
 #define HA_DEBUG_EN (0)
 #include "ha_debug.h"
 
-/* Data Cir_queues */
-static const uint16_t slp_to_controller_queue_size = 256;
+/* GFF frame queues */
+/* frames never wrap around the buffer, a max size frame is sure to fit only in an
+ * empty queue of at least 2 max size frames, keep room for a few of them */
+static const uint16_t slp_to_controller_queue_size = 4 * ha_ns::GFF_MAX_FRAME_SIZE;
 static uint8_t slp_to_controller_queue_buffer[slp_to_controller_queue_size];
+static const uint8_t slp_to_controller_queue_slots = 16; /* power of 2 */
+static gff_queue_ns::slot_t slp_to_controller_queue_slots_buffer[slp_to_controller_queue_slots];
 
 static const uint16_t ble_to_controller_queue_size = 1024;
 static uint8_t ble_to_controller_queue_buffer[ble_to_controller_queue_size];
+static const uint8_t ble_to_controller_queue_slots = 32; /* power of 2 */
+static gff_queue_ns::slot_t ble_to_controller_queue_slots_buffer[ble_to_controller_queue_slots];
 
 /* Message queue */
 static const uint16_t controller_message_queue_size = 64;
@@ -56,15 +62,31 @@ static const char controller_prio = PRIORITY_MAIN;
 static void *controller_func(void *arg);
 
 /* Device management */
-static const uint16_t controller_max_num_of_devs = 64;
+static const uint16_t controller_max_num_of_devs = 256;
 static ha_device controller_devs_buffer[controller_max_num_of_devs];
+static ha_device_mng_ns::dev_entry_t controller_dev_entries_buffer[controller_max_num_of_devs];
+static const uint16_t controller_dev_hash_size = 512; /* power of 2, > max num of devs */
+static uint16_t controller_dev_hash_buffer[controller_dev_hash_size];
+static const uint16_t controller_dev_ttl_wheel_size = 512; /* power of 2, > alive ttl */
+static uint16_t controller_dev_ttl_wheel_buffer[controller_dev_ttl_wheel_size];
 static const char controller_dev_list_filename[] = "dev_lst";
-static ha_device_mng controller_dev_mng(controller_devs_buffer,
-        controller_max_num_of_devs, controller_dev_list_filename);
+static const char controller_seq_epoch_filename[] = "seq_epch";
+static ha_device_mng controller_dev_mng(controller_devs_buffer, controller_dev_entries_buffer,
+        controller_max_num_of_devs, controller_dev_hash_buffer, controller_dev_hash_size,
+        controller_dev_ttl_wheel_buffer, controller_dev_ttl_wheel_size,
+        controller_dev_list_filename);
 
 /* Time to live for every ALIVE messages */
 static const int16_t alive_ttl = 300; /* in second */
 
+/* Devices dump, a SET_DEVS_DUMP frame must fit in a BLE attribute write */
+static const uint8_t controller_devs_dump_ble_max_records = (ha_ble_ns::ble_att_max_len
+        - ha_ble_ns::ble_msg_hdr_size - ha_ns::GFF_LEN_SIZE - ha_ns::GFF_CMD_SIZE
+        - ha_ns::DEVS_DUMP_HDR_LEN) / ha_ns::DEVS_DUMP_RECORD_LEN;
+static const uint8_t controller_devs_dump_max_records =
+        (controller_devs_dump_ble_max_records < ha_ns::DEVS_DUMP_MAX_RECORDS) ?
+        controller_devs_dump_ble_max_records : ha_ns::DEVS_DUMP_MAX_RECORDS;
+
 /* Time period to save device data */
 static const uint8_t dev_list_save_period = 30; /* in seconds */
 
@@ -94,11 +116,13 @@ namespace controller_ns {
 
 kernel_pid_t controller_pid;
 
-/* Data Cir_queues */
-cir_queue slp_to_controller_queue(slp_to_controller_queue_buffer,
-        slp_to_controller_queue_size);
-cir_queue ble_to_controller_queue(ble_to_controller_queue_buffer,
-        ble_to_controller_queue_size);
+/* GFF frame queues */
+gff_queue slp_to_controller_queue(slp_to_controller_queue_buffer,
+        slp_to_controller_queue_size, slp_to_controller_queue_slots_buffer,
+        slp_to_controller_queue_slots);
+gff_queue ble_to_controller_queue(ble_to_controller_queue_buffer,
+        ble_to_controller_queue_size, ble_to_controller_queue_slots_buffer,
+        ble_to_controller_queue_slots);
 
 }
 
@@ -124,16 +148,29 @@ void controller_start(void)
 /*----------------------------- Static functions -----------------------------*/
 /* Prototypes */
 static void slp_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
-        scene_mng *scene_mng_p, kernel_pid_t to_ble_pid,
-        cir_queue *from_ble_queue, cir_queue *to_ble_queue,
-        kernel_pid_t to_slp_pid, cir_queue *from_slp_queue,
-        cir_queue *to_slp_queue);
+        scene_mng *scene_mng_p, kernel_pid_t to_ble_pid, gff_queue *to_ble_queue,
+        kernel_pid_t to_slp_pid, gff_queue *to_slp_queue);
 
 static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
-        scene_mng *scene_mng_p, kernel_pid_t to_ble_pid,
-        cir_queue *from_ble_queue, cir_queue *to_ble_queue,
-        kernel_pid_t to_slp_pid, cir_queue *from_slp_queue,
-        cir_queue *to_slp_queue);
+        scene_mng *scene_mng_p, kernel_pid_t to_ble_pid, gff_queue *to_ble_queue,
+        kernel_pid_t to_slp_pid, gff_queue *to_slp_queue);
+
+/**
+ * @brief   Reserve a frame in queue and fill its len and cmd id.
+ *
+ * @return  pointer to the frame, or NULL if the queue is full.
+ */
+static uint8_t *reserve_gff_frame(gff_queue *queue, uint16_t cmd_id, uint8_t data_len);
+
+/**
+ * @brief   Commit the frame reserved in queue and send its handle to pid.
+ */
+static void commit_gff_frame(gff_queue *queue, kernel_pid_t pid);
+
+/**
+ * @brief   Copy a frame to queue and send its handle to pid.
+ */
+static void push_gff_frame(uint8_t *gff_frame, gff_queue *queue, kernel_pid_t pid);
 
 static void save_dev_list_with_1sec(uint8_t save_period,
         ha_device_mng *dev_mng);
@@ -142,30 +179,33 @@ static void process_scene_with_1sec(rtc_ns::time_t &cur_time,
         scene_mng *scene_mng_p);
 
 static void set_dev_with_index_to_ble(uint32_t index, ha_device_mng *dev_mng,
-        kernel_pid_t ble_pid, cir_queue *to_ble_queue);
+        kernel_pid_t ble_pid, gff_queue *to_ble_queue);
+
+static void set_devs_dump_to_ble(uint16_t start_index, uint32_t since_seq,
+        ha_device_mng *dev_mng, kernel_pid_t ble_pid, gff_queue *to_ble_queue);
 
 static void set_inact_scene_name_with_index_to_ble(uint8_t index,
-        scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue);
+        scene_mng *scene_mng_p, kernel_pid_t ble_pid, gff_queue *to_ble_queue);
 
 static void set_rule_with_index_to_ble(uint16_t index, char *scene_name,
-        scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue);
+        scene_mng *scene_mng_p, kernel_pid_t ble_pid, gff_queue *to_ble_queue);
 
 static void new_scene_check_timeout_with_1sec(const uint8_t timeout_period, uint8_t &timeout_counter,
         bool &new_scene_state, scene_mng *scene_mng_p);
 
 static void new_scene_set_rule_timeout_handler(uint8_t &resend_count, bool &new_scene_state,
-        scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue);
+        scene_mng *scene_mng_p, kernel_pid_t ble_pid, gff_queue *to_ble_queue);
 
 static void new_scene_set_rule_1msTIM_ISR(void);
 
 static void set_zone_name_to_ble(uint8_t index,
-        zone *zone_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue);
+        zone *zone_p, kernel_pid_t ble_pid, gff_queue *to_ble_queue);
 
 /* Functions */
 static void *controller_func(void *)
 {
     msg_t mesg;
-    uint8_t gff_frame[ha_ns::GFF_MAX_FRAME_SIZE];
+    uint8_t *gff_frame;
 
     /* Init message queue */
     msg_init_queue(controller_message_queue, controller_message_queue_size);
@@ -181,6 +221,8 @@ static void *controller_func(void *)
 
     /* restore old data */
     controller_dev_mng.restore();
+    controller_dev_mng.start_change_seq_epoch(controller_seq_epoch_filename,
+            MB1_rtc.get_time_raw());
     controller_scene_mng.restore();
 
     /* Wait for message */
@@ -190,21 +232,27 @@ static void *controller_func(void *)
         switch (mesg.type) {
         case ha_cc_ns::SLP_GFF_PENDING:
             HA_DEBUG("controller: SLP_GFF_PENDING\n");
-            slp_gff_handler(gff_frame, &controller_dev_mng,
-                    &controller_scene_mng, ble_thread_ns::ble_thread_pid,
-                    NULL, &ble_thread_ns::controller_to_ble_msg_queue,
-                    ha_ns::sixlowpan_sender_pid, (cir_queue *) mesg.content.ptr,
-                    &ha_ns::sixlowpan_sender_gff_queue);
+            /* frames are parsed in place, up to the one of this message */
+            while ((gff_frame = slp_to_controller_queue.get_frame(
+                    (uint16_t) mesg.content.value)) != NULL) {
+                slp_gff_handler(gff_frame, &controller_dev_mng,
+                        &controller_scene_mng, ble_thread_ns::ble_thread_pid,
+                        &ble_thread_ns::controller_to_ble_msg_queue,
+                        ha_ns::sixlowpan_sender_pid, &ha_ns::sixlowpan_sender_gff_queue);
+                slp_to_controller_queue.release();
+            }
             break;
 
         case ha_cc_ns::BLE_GFF_PENDING:
             HA_DEBUG("controller: BLE_GFF_PENDING\n");
-            ble_gff_handler(gff_frame, &controller_dev_mng,
-                    &controller_scene_mng, ble_thread_ns::ble_thread_pid,
-                    (cir_queue *) mesg.content.ptr,
-                    &ble_thread_ns::controller_to_ble_msg_queue,
-                    ha_ns::sixlowpan_sender_pid,
-                    NULL, &ha_ns::sixlowpan_sender_gff_queue);
+            while ((gff_frame = ble_to_controller_queue.get_frame(
+                    (uint16_t) mesg.content.value)) != NULL) {
+                ble_gff_handler(gff_frame, &controller_dev_mng,
+                        &controller_scene_mng, ble_thread_ns::ble_thread_pid,
+                        &ble_thread_ns::controller_to_ble_msg_queue,
+                        ha_ns::sixlowpan_sender_pid, &ha_ns::sixlowpan_sender_gff_queue);
+                ble_to_controller_queue.release();
+            }
             break;
 
         case ha_cc_ns::ONE_SEC_INTERRUPT:
@@ -237,31 +285,15 @@ static void *controller_func(void *)
 
 /*----------------------------------------------------------------------------*/
 static void slp_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
-        scene_mng *scene_mng_p, kernel_pid_t to_ble_pid,
-        cir_queue *from_ble_queue, cir_queue *to_ble_queue,
-        kernel_pid_t to_slp_pid, cir_queue *from_slp_queue,
-        cir_queue *to_slp_queue)
+        scene_mng *scene_mng_p, kernel_pid_t to_ble_pid, gff_queue *to_ble_queue,
+        kernel_pid_t to_slp_pid, gff_queue *to_slp_queue)
 {
-    uint8_t data_len;
     uint16_t cmd_id;
     uint32_t device_id;
     int16_t value, old_value;
-    msg_t mesg;
     ha_device device_rpt;
-
-    /* Check data */
-    data_len = from_slp_queue->preview_data(false);
-    if ((data_len + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE)
-            > from_slp_queue->get_size()) {
-        HA_DEBUG(
-                "slp_gff_handler: Err, data len %hu + cmd_size + len_size != queue_size %ld\n",
-                data_len, from_slp_queue->get_size());
-        return;
-    }
-
-    /* Get data from queue */
-    from_slp_queue->get_data(gff_frame,
-            data_len + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
+    uint8_t num_of_devs, count;
+    uint8_t *dev_p;
 
     /* parse GFF frame */
     cmd_id = buf2uint16(&gff_frame[ha_ns::GFF_CMD_POS]);
@@ -288,12 +320,7 @@ static void slp_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         dev_mng->set_dev_ttl(device_id, alive_ttl);
 
         /* forward to BLE */
-        to_ble_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char *) to_ble_queue;
-        msg_send(&mesg, to_ble_pid, false);
+        push_gff_frame(gff_frame, to_ble_queue, to_ble_pid);
         HA_DEBUG("slp_gff_handler: SET_DEV_VAL forwarded to ble\n");
 
         break;
@@ -305,6 +332,23 @@ static void slp_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         dev_mng->set_dev_ttl(device_id, alive_ttl);
         break;
 
+    case ha_ns::NODE_ALIVE:
+        /* | num of devices (1) | device_id (4) * num of devices |, refresh all in one pass */
+        num_of_devs = gff_frame[ha_ns::GFF_DATA_POS];
+        if (ha_ns::NODE_ALIVE_HDR_LEN + num_of_devs * ha_ns::NODE_ALIVE_RECORD_LEN
+                > gff_frame[ha_ns::GFF_LEN_POS]) {
+            HA_DEBUG("slp_gff_handler: NODE_ALIVE, wrong length\n");
+            break;
+        }
+        HA_DEBUG("slp_gff_handler: NODE_ALIVE (%u devices)\n", num_of_devs);
+
+        dev_p = &gff_frame[ha_ns::GFF_DATA_POS + ha_ns::NODE_ALIVE_HDR_LEN];
+        for (count = 0; count < num_of_devs; count++) {
+            dev_mng->set_dev_ttl(buf2uint32(dev_p), alive_ttl);
+            dev_p += ha_ns::NODE_ALIVE_RECORD_LEN;
+        }
+        break;
+
     default:
         HA_DEBUG("slp_gff_handler: unknown cmd id %x\n", cmd_id);
         break;
@@ -313,14 +357,12 @@ static void slp_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
 
 /*----------------------------------------------------------------------------*/
 static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
-        scene_mng *scene_mng_p, kernel_pid_t to_ble_pid,
-        cir_queue *from_ble_queue, cir_queue *to_ble_queue,
-        kernel_pid_t to_slp_pid, cir_queue *from_slp_queue,
-        cir_queue *to_slp_queue)
+        scene_mng *scene_mng_p, kernel_pid_t to_ble_pid, gff_queue *to_ble_queue,
+        kernel_pid_t to_slp_pid, gff_queue *to_slp_queue)
 {
     uint8_t data_len;
     uint16_t cmd_id;
-    msg_t mesg;
+    uint8_t *resp_frame;
     uint16_t count;
 
     uint8_t index, num_scene;
@@ -332,21 +374,11 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
 
     uint8_t zone_id;
 
-    /* Check data */
-    data_len = from_ble_queue->preview_data(false);
-    if ((data_len + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE)
-            > from_ble_queue->get_size()) {
-        HA_DEBUG(
-                "ble_gff_handler: Err, data len %hu + cmd_size + len_size != queue_size %ld\n",
-                data_len, from_ble_queue->get_size());
-        return;
-    }
-
-    /* Get data from queue */
-    from_ble_queue->get_data(gff_frame,
-            data_len + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
-
-    /* parse GFF frame */
+    /*
+     * parse GFF frame in place, responses are written directly to to_ble_queue
+     * (they may be longer than the request).
+     */
+    data_len = gff_frame[ha_ns::GFF_LEN_POS];
     cmd_id = buf2uint16(&gff_frame[ha_ns::GFF_CMD_POS]);
 
     switch (cmd_id) {
@@ -354,17 +386,14 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         HA_DEBUG("ble_gff_handler: GET_NUM_OF_DEVS\n");
 
         /* Send SET_NUM_OF_DEVS back */
-        gff_frame[ha_ns::GFF_LEN_POS] = ha_ns::SET_NUM_OF_DEVS_DATA_LEN;
-        uint162buf(ha_ns::SET_NUM_OF_DEVS, &gff_frame[ha_ns::GFF_CMD_POS]);
+        resp_frame = reserve_gff_frame(to_ble_queue, ha_ns::SET_NUM_OF_DEVS,
+                ha_ns::SET_NUM_OF_DEVS_DATA_LEN);
+        if (resp_frame == NULL) {
+            break;
+        }
         uint322buf((uint32_t) dev_mng->get_current_numofdev(),
-                &gff_frame[ha_ns::GFF_DATA_POS]);
-
-        to_ble_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char*) to_ble_queue;
-        msg_send(&mesg, to_ble_pid, false);
+                &resp_frame[ha_ns::GFF_DATA_POS]);
+        commit_gff_frame(to_ble_queue, to_ble_pid);
 
         HA_DEBUG("ble_gff_handler: sent SET_NUM_OF_DEVS (%hu) to ble\n",
                 dev_mng->get_current_numofdev());
@@ -380,18 +409,26 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         }
         break;
 
+    case ha_ns::GET_DEVS_DUMP:
+        HA_DEBUG("ble_gff_handler: GET_DEVS_DUMP\n");
+
+        if (data_len < ha_ns::GET_DEVS_DUMP_DATA_LEN) {
+            HA_DEBUG("ble_gff_handler: GET_DEVS_DUMP, wrong data len %hu\n", data_len);
+            break;
+        }
+
+        set_devs_dump_to_ble(buf2uint16(&gff_frame[ha_ns::GFF_DATA_POS]),
+                buf2uint32(&gff_frame[ha_ns::GFF_DATA_POS + 2]),
+                dev_mng, to_ble_pid, to_ble_queue);
+        break;
+
     case ha_ns::SET_DEV_VAL:
         HA_DEBUG("ble_gff_handler: SET_DEV_VAL (%lx, %d)\n",
                 buf2uint32(&gff_frame[ha_ns::GFF_DATA_POS]),
                 (int16_t )buf2uint16(&gff_frame[ha_ns::GFF_DATA_POS + 4]));
 
         /* forward to slp */
-        to_slp_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char *) to_slp_queue;
-        msg_send(&mesg, to_slp_pid, false);
+        push_gff_frame(gff_frame, to_slp_queue, to_slp_pid);
 
         HA_DEBUG("ble_gff_handler: forwarded GFF SET_DEV_VAL to slp\n");
         break;
@@ -420,19 +457,16 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         HA_DEBUG("ble_gff_handler: GET_NUM_OF_SCENES\n");
 
         /* Set back SET_NUM_OF_SCENES */
-        gff_frame[ha_ns::GFF_LEN_POS] = ha_ns::SET_NUM_OF_SCENES_DATA_LEN;
-        uint162buf(ha_ns::SET_NUM_OF_SCENES, &gff_frame[ha_ns::GFF_CMD_POS]);
-        gff_frame[ha_ns::GFF_DATA_POS] =
+        resp_frame = reserve_gff_frame(to_ble_queue, ha_ns::SET_NUM_OF_SCENES,
+                ha_ns::SET_NUM_OF_SCENES_DATA_LEN);
+        if (resp_frame == NULL) {
+            break;
+        }
+        resp_frame[ha_ns::GFF_DATA_POS] =
                 scene_mng_p->get_num_of_active_scenes();
-        gff_frame[ha_ns::GFF_DATA_POS + 1] =
+        resp_frame[ha_ns::GFF_DATA_POS + 1] =
                 scene_mng_p->get_num_of_inactive_scenes();
-
-        to_ble_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char*) to_ble_queue;
-        msg_send(&mesg, to_ble_pid, false);
+        commit_gff_frame(to_ble_queue, to_ble_pid);
         break;
 
     case ha_ns::GET_ACT_SCENE_NAME_WITH_INDEXS:
@@ -452,19 +486,15 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         scene_mng_p->get_active_scene(scene_name);
 
         /* Send back SET_ACT_SCENE_NAME_WITH_INDEXS */
-        gff_frame[ha_ns::GFF_LEN_POS] =
-                ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS_DATA_LEN;
-        uint162buf(ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS,
-                &gff_frame[ha_ns::GFF_CMD_POS]);
-        gff_frame[ha_ns::GFF_DATA_POS] = 0;
-        memcpy(&gff_frame[ha_ns::GFF_DATA_POS + 1], scene_name, 8);
-
-        to_ble_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char*) to_ble_queue;
-        msg_send(&mesg, to_ble_pid, false);
+        resp_frame = reserve_gff_frame(to_ble_queue,
+                ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS,
+                ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS_DATA_LEN);
+        if (resp_frame == NULL) {
+            break;
+        }
+        resp_frame[ha_ns::GFF_DATA_POS] = 0;
+        memcpy(&resp_frame[ha_ns::GFF_DATA_POS + 1], scene_name, 8);
+        commit_gff_frame(to_ble_queue, to_ble_pid);
 
         HA_DEBUG("ble_gff_handler: sent active scene name back to ble (%s)\n",
                 scene_name);
@@ -513,18 +543,14 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         }
 
         /* Get num of rules of current running scene name and send back */
-        gff_frame[ha_ns::GFF_LEN_POS] = ha_ns::SET_NUM_OF_RULES_DATA_LEN;
-        uint162buf(ha_ns::SET_NUM_OF_RULES, &gff_frame[ha_ns::GFF_CMD_POS]);
-        memcpy(&gff_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
-        uint162buf(scene_mng_p->get_user_scene_ptr()->get_cur_num_rules(),
-                &gff_frame[ha_ns::GFF_DATA_POS + 8]);
-
-        to_ble_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char*) to_ble_queue;
-        msg_send(&mesg, to_ble_pid, false);
+        resp_frame = reserve_gff_frame(to_ble_queue, ha_ns::SET_NUM_OF_RULES,
+                ha_ns::SET_NUM_OF_RULES_DATA_LEN);
+        if (resp_frame != NULL) {
+            memcpy(&resp_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
+            uint162buf(scene_mng_p->get_user_scene_ptr()->get_cur_num_rules(),
+                    &resp_frame[ha_ns::GFF_DATA_POS + 8]);
+            commit_gff_frame(to_ble_queue, to_ble_pid);
+        }
 
         HA_DEBUG("ble_gff_handler: sent num of rules back to ble (%s, %hu)\n",
                 scene_name, scene_mng_p->get_user_scene_ptr()->get_cur_num_rules());
@@ -599,13 +625,16 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
 
         /* feedback to ble */
         scene_mng_p->get_user_scene(scene_name);
-        memcpy(&gff_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
-        to_ble_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char*) to_ble_queue;
-        msg_send(&mesg, to_ble_pid, false);
+        resp_frame = reserve_gff_frame(to_ble_queue, ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS,
+                ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS_DATA_LEN);
+        if (resp_frame == NULL) {
+            break;
+        }
+        memcpy(&resp_frame[ha_ns::GFF_DATA_POS], &gff_frame[ha_ns::GFF_DATA_POS],
+                (data_len < ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS_DATA_LEN) ?
+                data_len : ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS_DATA_LEN);
+        memcpy(&resp_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
+        commit_gff_frame(to_ble_queue, to_ble_pid);
 
         HA_DEBUG("ble_gff_handler: sent SET_ACT_SCENE_NAME_WITH_INDEXS (%s) back to ble\n",
                 scene_name);
@@ -636,13 +665,13 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         }
 
         /* Send SET_REMOVE_SCENE back */
-        memcpy(&gff_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
-        to_ble_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char*) to_ble_queue;
-        msg_send(&mesg, to_ble_pid, false);
+        resp_frame = reserve_gff_frame(to_ble_queue, ha_ns::SET_REMOVE_SCENE,
+                ha_ns::SET_REMOVE_SCENE_DATA_LEN);
+        if (resp_frame == NULL) {
+            break;
+        }
+        memcpy(&resp_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
+        commit_gff_frame(to_ble_queue, to_ble_pid);
 
         HA_DEBUG("ble_gff_handler: sent SET_REMOVE_SCENE (%s) back to ble\n",
                 scene_name);
@@ -669,15 +698,14 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         }
 
         /* send SET_RENAME_INACT_SCENE back to ble */
-        memcpy(&gff_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
-        memcpy(&gff_frame[ha_ns::GFF_DATA_POS+8], scene_name2, 8);
-
-        to_ble_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char*) to_ble_queue;
-        msg_send(&mesg, to_ble_pid, false);
+        resp_frame = reserve_gff_frame(to_ble_queue, ha_ns::SET_RENAME_INACT_SCENE,
+                ha_ns::SET_RENAME_INACT_SCENE_DATA_LEN);
+        if (resp_frame == NULL) {
+            break;
+        }
+        memcpy(&resp_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
+        memcpy(&resp_frame[ha_ns::GFF_DATA_POS+8], scene_name2, 8);
+        commit_gff_frame(to_ble_queue, to_ble_pid);
 
         HA_DEBUG("ble_gff_handler: sent SET_RENAME_INACT_SCENE (%s -> %s) back to ble\n",
                 scene_name, scene_name2);
@@ -706,16 +734,12 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         }
 
         /* send GET_NUM_OF_RULES */
-        gff_frame[ha_ns::GFF_LEN_POS] = ha_ns::GET_NUM_OF_RULES_DATA_LEN;
-        uint162buf(ha_ns::GET_NUM_OF_RULES, &gff_frame[ha_ns::GFF_CMD_POS]);
-        memcpy(&gff_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
-
-        to_ble_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char*) to_ble_queue;
-        msg_send(&mesg, to_ble_pid, false);
+        resp_frame = reserve_gff_frame(to_ble_queue, ha_ns::GET_NUM_OF_RULES,
+                ha_ns::GET_NUM_OF_RULES_DATA_LEN);
+        if (resp_frame != NULL) {
+            memcpy(&resp_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
+            commit_gff_frame(to_ble_queue, to_ble_pid);
+        }
 
         HA_DEBUG("ble_gff_handler: sent GET_NUM_OF_RULES (%s) to ble\n",
                 scene_name);
@@ -762,17 +786,12 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         new_scene_num_rule = buf2uint16(&gff_frame[ha_ns::GFF_DATA_POS + 8]);
 
         /* Send GET_RULE_WITH_INDEXS */
-        gff_frame[ha_ns::GFF_LEN_POS] = 10;
-        uint162buf(ha_ns::GET_RULE_WITH_INDEXS, &gff_frame[ha_ns::GFF_CMD_POS]);
-        memcpy(&gff_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
-        uint162buf(0xFFFF, &gff_frame[ha_ns::GFF_DATA_POS + 8]);
-
-        to_ble_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char*) to_ble_queue;
-        msg_send(&mesg, to_ble_pid, false);
+        resp_frame = reserve_gff_frame(to_ble_queue, ha_ns::GET_RULE_WITH_INDEXS, 10);
+        if (resp_frame != NULL) {
+            memcpy(&resp_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
+            uint162buf(0xFFFF, &resp_frame[ha_ns::GFF_DATA_POS + 8]);
+            commit_gff_frame(to_ble_queue, to_ble_pid);
+        }
 
         HA_DEBUG("ble_gff_handler: sent GET_RULE_WITH_INDEXS (%s, %hx) to ble\n",
                 scene_name, 0xFFFF);
@@ -882,16 +901,77 @@ void controller_list_devices(int argc, char** argv)
     controller_dev_mng.print_all_devices();
 }
 
+/*----------------------------------------------------------------------------*/
+static void set_devs_dump_to_ble(uint16_t start_index, uint32_t since_seq,
+        ha_device_mng *dev_mng, kernel_pid_t ble_pid, gff_queue *to_ble_queue)
+{
+    uint8_t *devs_dump_gff_frame;
+    uint8_t *record_p;
+    uint32_t device_id, changed_seq;
+    int16_t value, ttl;
+    uint16_t index, max_num_of_dev;
+    uint8_t num_records;
+    bool full_dump;
+
+    /* reserve a full page, the frame will be shrunk to the actual num of records */
+    devs_dump_gff_frame = reserve_gff_frame(to_ble_queue, ha_ns::SET_DEVS_DUMP,
+            ha_ns::DEVS_DUMP_HDR_LEN
+            + controller_devs_dump_max_records * ha_ns::DEVS_DUMP_RECORD_LEN);
+    if (devs_dump_gff_frame == NULL) {
+        return;
+    }
+
+    /* delta is not available if some devices have been removed since since_seq */
+    full_dump = (since_seq == 0) || !dev_mng->is_delta_available(since_seq);
+
+    num_records = 0;
+    record_p = &devs_dump_gff_frame[ha_ns::GFF_DATA_POS + ha_ns::DEVS_DUMP_HDR_LEN];
+    max_num_of_dev = dev_mng->get_max_numofdev();
+
+    for (index = start_index; index < max_num_of_dev; index++) {
+        if (dev_mng->get_dev_with_index(index, device_id, value, ttl, changed_seq) != 0) {
+            continue;
+        }
+
+        if (!full_dump && changed_seq <= since_seq) {
+            continue;
+        }
+
+        if (num_records == controller_devs_dump_max_records) {
+            /* frame is full, continue from this index in the next page */
+            break;
+        }
+
+        uint322buf(device_id, record_p);
+        uint162buf((uint16_t) value, record_p + 4);
+        uint162buf((uint16_t) ttl, record_p + 6);
+        record_p += ha_ns::DEVS_DUMP_RECORD_LEN;
+        num_records++;
+    }
+
+    /* pack gff frame */
+    devs_dump_gff_frame[ha_ns::GFF_LEN_POS] = ha_ns::DEVS_DUMP_HDR_LEN
+            + num_records * ha_ns::DEVS_DUMP_RECORD_LEN;
+    uint322buf(dev_mng->get_change_seq(), &devs_dump_gff_frame[ha_ns::GFF_DATA_POS]);
+    devs_dump_gff_frame[ha_ns::GFF_DATA_POS + 4] = full_dump ? ha_ns::DEVS_DUMP_FULL : 0;
+    uint162buf((index < max_num_of_dev) ? index : ha_ns::DEVS_DUMP_NO_MORE_PAGE,
+            &devs_dump_gff_frame[ha_ns::GFF_DATA_POS + 5]);
+    devs_dump_gff_frame[ha_ns::GFF_DATA_POS + 7] = num_records;
+
+    commit_gff_frame(to_ble_queue, ble_pid);
+
+    HA_DEBUG("set_devs_dump_to_ble: sent %hu devices from index %hu, full %hu\n",
+            num_records, start_index, full_dump);
+}
+
 /*----------------------------------------------------------------------------*/
 static void set_dev_with_index_to_ble(uint32_t index, ha_device_mng *dev_mng,
-        kernel_pid_t ble_pid, cir_queue *to_ble_queue)
+        kernel_pid_t ble_pid, gff_queue *to_ble_queue)
 {
-    uint8_t set_dev_windex_gff_frame[ha_ns::SET_DEVICE_WITH_INDEX_DATA_LEN
-            + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
+    uint8_t *set_dev_windex_gff_frame;
     uint32_t device_id;
     int16_t value;
     uint16_t count;
-    msg_t mesg;
 
     if (index == ha_ns::SET_DEV_WITH_INDEX_ALL_DEVS) {
         /* All device */
@@ -899,34 +979,7 @@ static void set_dev_with_index_to_ble(uint32_t index, ha_device_mng *dev_mng,
         dev_mng->reorder();
 
         for (count = 0; count < dev_mng->get_current_numofdev(); count++) {
-            /* Get device id and value from index */
-            dev_mng->get_dev_val_with_index(count, device_id, value);
-
-            /* pack GFF */
-            set_dev_windex_gff_frame[ha_ns::GFF_LEN_POS] =
-                    ha_ns::SET_DEVICE_WITH_INDEX_DATA_LEN;
-            uint162buf(ha_ns::SET_DEV_WITH_INDEXS,
-                    &set_dev_windex_gff_frame[ha_ns::GFF_CMD_POS]);
-            uint322buf(count, &set_dev_windex_gff_frame[ha_ns::GFF_DATA_POS]);
-            uint322buf(device_id,
-                    &set_dev_windex_gff_frame[ha_ns::GFF_DATA_POS + 4]);
-            uint162buf((uint16_t) value,
-                    &set_dev_windex_gff_frame[ha_ns::GFF_DATA_POS + 8]);
-
-            /* push data to ble_queue */
-            to_ble_queue->add_data(set_dev_windex_gff_frame,
-                    ha_ns::SET_DEVICE_WITH_INDEX_DATA_LEN + ha_ns::GFF_CMD_SIZE
-                            + ha_ns::GFF_LEN_SIZE);
-
-            /* pack and send message to ble */
-            mesg.type = ha_ns::GFF_PENDING;
-            mesg.content.ptr = (char *) to_ble_queue;
-
-            msg_send(&mesg, ble_pid, false);
-
-            HA_DEBUG(
-                    "set_dev_windex_2_ble: GFF Sent, index %hu, device_id %lu, value %hd\n",
-                    count, device_id, value);
+            set_dev_with_index_to_ble(count, dev_mng, ble_pid, to_ble_queue);
         }
 
         return;
@@ -936,26 +989,19 @@ static void set_dev_with_index_to_ble(uint32_t index, ha_device_mng *dev_mng,
     /* Get device id and value from index */
     dev_mng->get_dev_val_with_index(index, device_id, value);
 
-    /* pack GFF */
-    set_dev_windex_gff_frame[ha_ns::GFF_LEN_POS] =
-            ha_ns::SET_DEVICE_WITH_INDEX_DATA_LEN;
-    uint162buf(ha_ns::SET_DEV_WITH_INDEXS,
-            &set_dev_windex_gff_frame[ha_ns::GFF_CMD_POS]);
+    /* pack GFF directly in ble_queue */
+    set_dev_windex_gff_frame = reserve_gff_frame(to_ble_queue, ha_ns::SET_DEV_WITH_INDEXS,
+            ha_ns::SET_DEVICE_WITH_INDEX_DATA_LEN);
+    if (set_dev_windex_gff_frame == NULL) {
+        return;
+    }
     uint322buf(index, &set_dev_windex_gff_frame[ha_ns::GFF_DATA_POS]);
     uint322buf(device_id, &set_dev_windex_gff_frame[ha_ns::GFF_DATA_POS + 4]);
     uint162buf((uint16_t) value,
             &set_dev_windex_gff_frame[ha_ns::GFF_DATA_POS + 8]);
 
-    /* push data to ble_queue */
-    to_ble_queue->add_data(set_dev_windex_gff_frame,
-            ha_ns::SET_DEVICE_WITH_INDEX_DATA_LEN + ha_ns::GFF_CMD_SIZE
-                    + ha_ns::GFF_LEN_SIZE);
-
-    /* pack and send message to ble */
-    mesg.type = ha_ns::GFF_PENDING;
-    mesg.content.ptr = (char *) to_ble_queue;
-
-    msg_send(&mesg, ble_pid, false);
+    /* send message to ble */
+    commit_gff_frame(to_ble_queue, ble_pid);
 
     HA_DEBUG(
             "set_dev_windex_2_ble: GFF Sent, index %lu, device_id %lu, value %hd\n",
@@ -964,12 +1010,10 @@ static void set_dev_with_index_to_ble(uint32_t index, ha_device_mng *dev_mng,
 
 /*----------------------------------------------------------------------------*/
 static void set_inact_scene_name_with_index_to_ble(uint8_t index,
-        scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue)
+        scene_mng *scene_mng_p, kernel_pid_t ble_pid, gff_queue *to_ble_queue)
 {
     char scene_name[scene_ns::scene_max_name_chars_wout_folders];
-    msg_t mesg;
-    uint8_t set_inact_scene_name_windex_gff_frame[ha_ns::SET_INACT_SCENE_NAME_WITH_INDEXS_DATA_LEN
-            + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
+    uint8_t *set_inact_scene_name_windex_gff_frame;
 
     if (index == 0xFF) {
         return;
@@ -980,20 +1024,17 @@ static void set_inact_scene_name_with_index_to_ble(uint8_t index,
     scene_mng_p->get_inactive_scene_with_index(index, scene_name);
 
     /* pack gff frame and send to ble */
-    set_inact_scene_name_windex_gff_frame[ha_ns::GFF_LEN_POS] =
-            ha_ns::SET_INACT_SCENE_NAME_WITH_INDEXS_DATA_LEN;
-    uint162buf(ha_ns::SET_INACT_SCENE_NAME_WITH_INDEXS,
-            &set_inact_scene_name_windex_gff_frame[ha_ns::GFF_CMD_POS]);
+    set_inact_scene_name_windex_gff_frame = reserve_gff_frame(to_ble_queue,
+            ha_ns::SET_INACT_SCENE_NAME_WITH_INDEXS,
+            ha_ns::SET_INACT_SCENE_NAME_WITH_INDEXS_DATA_LEN);
+    if (set_inact_scene_name_windex_gff_frame == NULL) {
+        return;
+    }
     set_inact_scene_name_windex_gff_frame[ha_ns::GFF_DATA_POS] = index;
     memcpy(&set_inact_scene_name_windex_gff_frame[ha_ns::GFF_DATA_POS + 1],
             scene_name, 8);
 
-    to_ble_queue->add_data(set_inact_scene_name_windex_gff_frame,
-            set_inact_scene_name_windex_gff_frame[ha_ns::GFF_LEN_POS]
-                    + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
-    mesg.type = ha_ns::GFF_PENDING;
-    mesg.content.ptr = (char*) to_ble_queue;
-    msg_send(&mesg, ble_pid, false);
+    commit_gff_frame(to_ble_queue, ble_pid);
 
     HA_DEBUG("ble_gff_handler: sent inactive scene name back to ble (%hu, %s)\n",
             index, scene_name);
@@ -1001,12 +1042,11 @@ static void set_inact_scene_name_with_index_to_ble(uint8_t index,
 
 /*----------------------------------------------------------------------------*/
 static void set_rule_with_index_to_ble(uint16_t index, char *scene_name,
-        scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue)
+        scene_mng *scene_mng_p, kernel_pid_t ble_pid, gff_queue *to_ble_queue)
 {
     scene_ns::rule_t a_rule;
     uint8_t set_rule_windex_gff_frame[ha_ns::SET_RULE_WITH_INDEXS_DATA_LEN
                 + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
-    msg_t mesg;
 
     if (index == 0xFFFF) {
         return;
@@ -1052,12 +1092,7 @@ static void set_rule_with_index_to_ble(uint16_t index, char *scene_name,
     uint162buf(a_rule.outputs[0].dev_val.value,
             &set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS + 25]);
 
-    to_ble_queue->add_data(set_rule_windex_gff_frame,
-            set_rule_windex_gff_frame[ha_ns::GFF_LEN_POS]
-                    + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
-    mesg.type = ha_ns::GFF_PENDING;
-    mesg.content.ptr = (char*) to_ble_queue;
-    msg_send(&mesg, ble_pid, false);
+    push_gff_frame(set_rule_windex_gff_frame, to_ble_queue, ble_pid);
 
     HA_DEBUG("ble_gff_handler: sent rule with index (%hu) back to ble\n",
             index);
@@ -1115,11 +1150,10 @@ static void new_scene_set_rule_1msTIM_ISR(void)
 
 /*----------------------------------------------------------------------------*/
 static void new_scene_set_rule_timeout_handler(uint8_t &resend_count, bool &new_scene_state,
-        scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue)
+        scene_mng *scene_mng_p, kernel_pid_t ble_pid, gff_queue *to_ble_queue)
 {
     uint16_t invalid_index;
     uint8_t a_gff_frame[10 + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
-    msg_t mesg;
     char scene_name[scene_ns::scene_max_name_chars_wout_folders];
 
     if (!new_scene_state) {
@@ -1137,12 +1171,7 @@ static void new_scene_set_rule_timeout_handler(uint8_t &resend_count, bool &new_
                 memcpy(&a_gff_frame[ha_ns::GFF_DATA_POS], new_scene_name, 8);
                 uint162buf(invalid_index, &a_gff_frame[ha_ns::GFF_DATA_POS + 8]);
 
-                to_ble_queue->add_data(a_gff_frame,
-                        a_gff_frame[ha_ns::GFF_LEN_POS]
-                                + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
-                mesg.type = ha_ns::GFF_PENDING;
-                mesg.content.ptr = (char*) to_ble_queue;
-                msg_send(&mesg, ble_pid, false);
+                push_gff_frame(a_gff_frame, to_ble_queue, ble_pid);
 
                 HA_DEBUG("new_scene_set_rule_timeout_handler: Resend GET_RULE_WITH_INDEXS"
                         "(%s, %hu) to ble\n", new_scene_name, invalid_index);
@@ -1165,12 +1194,7 @@ static void new_scene_set_rule_timeout_handler(uint8_t &resend_count, bool &new_
             uint162buf(ha_ns::SET_NEW_SCENE, &a_gff_frame[ha_ns::GFF_CMD_POS]);
             memcpy(&a_gff_frame[ha_ns::GFF_DATA_POS], new_scene_name, 8);
 
-            to_ble_queue->add_data(a_gff_frame,
-                    a_gff_frame[ha_ns::GFF_LEN_POS]
-                            + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
-            mesg.type = ha_ns::GFF_PENDING;
-            mesg.content.ptr = (char*) to_ble_queue;
-            msg_send(&mesg, ble_pid, false);
+            push_gff_frame(a_gff_frame, to_ble_queue, ble_pid);
 
             HA_DEBUG("new_scene_set_rule_timeout_handler: Resend SET_NEW_SCENE (%s)"
                     "to ble\n", new_scene_name);
@@ -1198,12 +1222,7 @@ static void new_scene_set_rule_timeout_handler(uint8_t &resend_count, bool &new_
             uint162buf(ha_ns::SET_NEW_SCENE, &a_gff_frame[ha_ns::GFF_CMD_POS]);
             memcpy(&a_gff_frame[ha_ns::GFF_DATA_POS], new_scene_name, 8);
 
-            to_ble_queue->add_data(a_gff_frame,
-                    a_gff_frame[ha_ns::GFF_LEN_POS]
-                            + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
-            mesg.type = ha_ns::GFF_PENDING;
-            mesg.content.ptr = (char*) to_ble_queue;
-            msg_send(&mesg, ble_pid, false);
+            push_gff_frame(a_gff_frame, to_ble_queue, ble_pid);
 
             HA_DEBUG("new_scene_set_rule_timeout_handler: Resend SET_NEW_SCENE (%s)"
                     "to ble\n", new_scene_name);
@@ -1225,14 +1244,13 @@ static void new_scene_set_rule_timeout_handler(uint8_t &resend_count, bool &new_
 
 /*----------------------------------------------------------------------------*/
 static void set_zone_name_to_ble(uint8_t index,
-        zone *zone_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue)
+        zone *zone_p, kernel_pid_t ble_pid, gff_queue *to_ble_queue)
 {
     char zone_name[zone_ns::zone_name_max_size];
     uint8_t zone_id;
     FRESULT fres;
     DIR dir;
     FILINFO finfo;
-    msg_t mesg;
     uint8_t set_zone_name_gff_frame[ha_ns::SET_ZONE_NAME_DATA_LEN
             + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
 
@@ -1270,12 +1288,7 @@ static void set_zone_name_to_ble(uint8_t index,
             memcpy(&set_zone_name_gff_frame[ha_ns::GFF_DATA_POS + 1], zone_name,
                        zone_ns::zone_name_max_size);
 
-            to_ble_queue->add_data(set_zone_name_gff_frame,
-                  set_zone_name_gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                         + ha_ns::GFF_LEN_SIZE);
-            mesg.type = ha_ns::GFF_PENDING;
-            mesg.content.ptr = (char*) to_ble_queue;
-            msg_send(&mesg, ble_pid, false);
+            push_gff_frame(set_zone_name_gff_frame, to_ble_queue, ble_pid);
 
             HA_DEBUG("ble_gff_handler: sent SET_ZONE_NAME (%hu, %s) to ble\n",
                    zone_id, zone_name);
@@ -1297,18 +1310,58 @@ static void set_zone_name_to_ble(uint8_t index,
     memcpy(&set_zone_name_gff_frame[ha_ns::GFF_DATA_POS + 1], zone_name,
            zone_ns::zone_name_max_size);
 
-    to_ble_queue->add_data(set_zone_name_gff_frame,
-            set_zone_name_gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                   + ha_ns::GFF_LEN_SIZE);
-    mesg.type = ha_ns::GFF_PENDING;
-    mesg.content.ptr = (char*) to_ble_queue;
-    msg_send(&mesg, ble_pid, false);
+    push_gff_frame(set_zone_name_gff_frame, to_ble_queue, ble_pid);
 
     HA_DEBUG("ble_gff_handler: sent SET_ZONE_NAME (%hu, %s) to ble\n",
            zone_id, zone_name);
 
 }
 
+/*----------------------------------------------------------------------------*/
+static uint8_t *reserve_gff_frame(gff_queue *queue, uint16_t cmd_id, uint8_t data_len)
+{
+    uint8_t *gff_frame;
+
+    gff_frame = queue->reserve(data_len + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
+    if (gff_frame == NULL) {
+        HA_DEBUG("reserve_gff_frame: queue is full, cmd id %x dropped (%lu)\n",
+                cmd_id, queue->get_drops());
+        return NULL;
+    }
+
+    gff_frame[ha_ns::GFF_LEN_POS] = data_len;
+    uint162buf(cmd_id, &gff_frame[ha_ns::GFF_CMD_POS]);
+
+    return gff_frame;
+}
+
+/*----------------------------------------------------------------------------*/
+static void commit_gff_frame(gff_queue *queue, kernel_pid_t pid)
+{
+    msg_t mesg;
+
+    mesg.type = ha_ns::GFF_PENDING;
+    mesg.content.value = queue->commit();
+    msg_send(&mesg, pid, false);
+}
+
+/*----------------------------------------------------------------------------*/
+static void push_gff_frame(uint8_t *gff_frame, gff_queue *queue, kernel_pid_t pid)
+{
+    msg_t mesg;
+    int32_t handle;
+
+    handle = queue->add_frame(gff_frame);
+    if (handle == gff_queue_ns::invalid_handle) {
+        HA_DEBUG("push_gff_frame: queue is full, frame dropped (%lu)\n",
+                queue->get_drops());
+        return;
+    }
+
+    mesg.type = ha_ns::GFF_PENDING;
+    mesg.content.value = (uint32_t) handle;
+    msg_send(&mesg, pid, false);
+}
 
 /*----------------------- Scenes shell command -------------------------------*/
 void controller_scene_cmd(int argc, char** argv)
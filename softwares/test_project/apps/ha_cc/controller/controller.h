@@ -21,15 +21,16 @@ extern "C" {
 #include "thread.h"
 }
 
-#include "cir_queue.h"
+#include "gff_queue.h"
 
 namespace controller_ns {
 
 extern kernel_pid_t controller_pid;
 
-/* Data cir_queue */
-extern cir_queue slp_to_controller_queue;
-extern cir_queue ble_to_controller_queue;
+/* GFF frame queues, single producer (slp receiver, ble thread), single consumer (controller).
+ * SLP_GFF_PENDING and BLE_GFF_PENDING messages carry handle of the frame. */
+extern gff_queue slp_to_controller_queue;
+extern gff_queue ble_to_controller_queue;
 
 }
 
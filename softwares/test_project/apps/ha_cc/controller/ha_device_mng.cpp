@@ -19,6 +19,7 @@
 #include "ha_gff_misc.h"
 #include "ff.h"
 #include "shell_cmds_fatfs.h"
+#include "snapshot.h"
 
 #define HA_NOTIFICATION (1)
 #define HA_DEBUG_EN (0)
@@ -29,17 +30,32 @@ using namespace ha_device_mng_ns;
 /* print list of devices */
 static const char print_line_pattern[] = "| %-3d | %08lx | %-8d | %-3d | %-4d | %-17s |\n";
 
-/* save and restore */
+/* restore from old text format */
 static const char devices_list_line_pattern[] = "%lx %d %d\n";
 
 /*----------------------------------------------------------------------------*/
-ha_device_mng::ha_device_mng(ha_device *devices_buffer, uint16_t num_of_dev,
+ha_device_mng::ha_device_mng(ha_device *devices_buffer, dev_entry_t *entries_buffer,
+        uint16_t num_of_dev, uint16_t *hash_buffer, uint16_t hash_size,
+        uint16_t *ttl_wheel_buffer, uint16_t ttl_wheel_size,
         const char *devices_list_filename)
 {
     cur_size = 0;
 
     max_num_of_dev = num_of_dev;
     this->devices_buffer = devices_buffer;
+    entries = entries_buffer;
+
+    hash_table = hash_buffer;
+    hash_mask = hash_size - 1;
+
+    ttl_wheel = ttl_wheel_buffer;
+    ttl_wheel_mask = ttl_wheel_size - 1;
+    ttl_tick = 0;
+
+    change_seq = 0;
+    removed_seq = 0;
+    seq_epoch = 0;
+    seq_epoch_file = NULL;
 
     devices_list_file = devices_list_filename;
 
@@ -56,7 +72,10 @@ int8_t ha_device_mng::set_dev_val(uint32_t device_id, int16_t value)
     device_p = find_device(device_id);
 
     if (device_p != NULL) { /* device found */
-        device_p->set_value(value);
+        if (device_p->get_value() != value) {
+            device_p->set_value(value);
+            entries[device_p - devices_buffer].changed_seq = next_change_seq();
+        }
         return 0;
     }
 
@@ -67,7 +86,6 @@ int8_t ha_device_mng::set_dev_val(uint32_t device_id, int16_t value)
     }
 
     device_p->set_value(value);
-    cur_size++;
     return 0;
 }
 
@@ -94,46 +112,107 @@ int8_t ha_device_mng::get_dev_val_with_index(uint16_t index, uint32_t &device_id
     return 0;
 }
 
+/*----------------------------------------------------------------------------*/
+int8_t ha_device_mng::get_dev_with_index(uint16_t index, uint32_t &device_id, int16_t &value,
+        int16_t &ttl, uint32_t &changed_seq)
+{
+    if (index >= max_num_of_dev || devices_buffer[index].is_no_device()) {
+        return -1;
+    }
+
+    device_id = devices_buffer[index].get_device_id();
+    value = devices_buffer[index].get_value();
+    ttl = wheel_get_ttl(index);
+    changed_seq = entries[index].changed_seq;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::start_change_seq_epoch(const char *epoch_filename, uint32_t seed)
+{
+    int32_t num_of_records = -1;
+
+    seq_epoch_file = epoch_filename;
+    if (seq_epoch_file != NULL) {
+        num_of_records = snapshot_restore(seq_epoch_file, epoch_snapshot_magic,
+                epoch_snapshot_version, &seq_epoch, sizeof(seq_epoch), 1);
+    }
+
+    if (num_of_records != 1) {
+        /* epoch of the last boot is unknown */
+        seq_epoch = seed;
+    }
+
+    new_change_seq_epoch();
+}
+
+/*----------------------------------------------------------------------------*/
+bool ha_device_mng::is_delta_available(uint32_t since_seq)
+{
+    return ((since_seq >> seq_epoch_shift) == seq_epoch
+            && since_seq >= removed_seq && since_seq <= change_seq);
+}
+
 /*----------------------------------------------------------------------------*/
 int16_t ha_device_mng::set_dev_ttl(uint32_t device_id, int16_t ttl)
 {
-    ha_device *device_p;
+    uint16_t index;
+    int16_t old_ttl;
 
-    device_p = find_device(device_id);
-    if (device_p == NULL) {
+    index = hash_find(device_id);
+    if (index == no_entry) {
         return -1;
     }
 
-    device_p->set_ttl(ttl);
+    old_ttl = wheel_get_ttl(index);
+    wheel_remove(index);
+    wheel_insert(index, ttl);
+
+    /* a plain refresh is not a change, only reaching or leaving zero is */
+    if ((old_ttl > 0) != (ttl > 0)) {
+        entries[index].changed_seq = next_change_seq();
+    }
     return 0;
 }
 
 /*----------------------------------------------------------------------------*/
 int16_t ha_device_mng::get_dev_ttl(uint32_t device_id, int16_t &ttl)
 {
-    ha_device *device_p;
+    uint16_t index;
 
-    device_p = find_device(device_id);
-    if (device_p == NULL) {
+    index = hash_find(device_id);
+    if (index == no_entry) {
         return -1;
     }
 
-    ttl = device_p->get_ttl();
+    ttl = wheel_get_ttl(index);
     return 0;
 }
 
 /*----------------------------------------------------------------------------*/
 int16_t ha_device_mng::chag_dev_ttl(uint32_t device_id, int16_t val)
 {
-    ha_device *device_p;
+    uint16_t index;
+    int16_t old_ttl, ttl;
 
-    device_p = find_device(device_id);
-    if (device_p == NULL) {
+    index = hash_find(device_id);
+    if (index == no_entry) {
         return -1;
     }
 
-    device_p->set_ttl(device_p->get_ttl() + val);
-    if (device_p->get_ttl() == 0) {
+    old_ttl = wheel_get_ttl(index);
+    ttl = old_ttl + val;
+    if (ttl < 0) {
+        ttl = 0;
+    }
+
+    wheel_remove(index);
+    wheel_insert(index, ttl);
+    if ((old_ttl > 0) != (ttl > 0)) {
+        entries[index].changed_seq = next_change_seq();
+    }
+    if (ttl == 0) {
         return TTL_IS_ZERO;
     }
 
@@ -143,64 +222,68 @@ int16_t ha_device_mng::chag_dev_ttl(uint32_t device_id, int16_t val)
 /*----------------------------------------------------------------------------*/
 void ha_device_mng::dec_all_devs_ttl(void)
 {
-    uint16_t count;
+    uint16_t index, next;
 
-    for (count = 0; count < max_num_of_dev; count++) {
-        if (!devices_buffer[count].is_no_device()) {
-            devices_buffer[count].set_ttl(devices_buffer[count].get_ttl() - 1);
-            if (devices_buffer[count].get_ttl() == 0) {
-                devices_buffer[count].set_to_no_device();
-                cur_size--;
-            }
+    ttl_tick++;
+
+    /* only devices in current slot, devices of later rounds will be skipped */
+    index = ttl_wheel[ttl_tick & ttl_wheel_mask];
+    while (index != no_entry) {
+        next = entries[index].next;
+        if (entries[index].expire_tick == ttl_tick) {
+            HA_DEBUG("dec_all_devs_ttl: %08lx expired\n", devices_buffer[index].get_device_id());
+            remove_device_at(index);
         }
+        index = next;
     }
 }
 
 /*----------------------------------------------------------------------------*/
 int8_t ha_device_mng::remove_device(uint32_t device_id)
 {
-    ha_device *device_p;
+    uint16_t index;
 
-    device_p = find_device(device_id);
-    if (device_p == NULL) {
+    index = hash_find(device_id);
+    if (index == no_entry) {
         return -1;
     }
 
-    device_p->set_to_no_device();
-    cur_size--;
+    remove_device_at(index);
     return 0;
 }
 
 /*----------------------------------------------------------------------------*/
 void ha_device_mng::reorder(void)
 {
-    ha_device *empty_dev_p = NULL;
-    ha_device *last_dev_p = NULL;
-    uint16_t count;
+    uint16_t empty, last;
 
     if (cur_size < 2) {
         return;
     }
 
+    /* move the last devices to the first empty slots */
+    empty = 0;
+    last = max_num_of_dev - 1;
     while (1) {
-        /* find an empty slot */
-        empty_dev_p = find_an_empty_slot();
-        if (empty_dev_p == NULL) {
-            /* No empty slot */
-            return;
+        while (empty < max_num_of_dev && !devices_buffer[empty].is_no_device()) {
+            empty++;
+        }
+        while (last > 0 && devices_buffer[last].is_no_device()) {
+            last--;
         }
 
-        /* find the last device in the buffer */
-        for (count = max_num_of_dev - 1; count >= 0; count--) {
-            if (!devices_buffer[count].is_no_device()) {
-                /* the last device in buffer */
-                last_dev_p = &devices_buffer[count];
-                memcpy(empty_dev_p, last_dev_p, sizeof(ha_device));
-                last_dev_p->set_to_no_device();
-                break;
-            }
+        if (empty >= last) {
+            break;
         }
+
+        memcpy(&devices_buffer[empty], &devices_buffer[last], sizeof(ha_device));
+        entries[empty].expire_tick = entries[last].expire_tick;
+        entries[empty].ttl_zero = entries[last].ttl_zero;
+        entries[empty].changed_seq = entries[last].changed_seq;
+        devices_buffer[last].set_to_no_device();
     }
+
+    rebuild();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -221,7 +304,7 @@ void ha_device_mng::print_all_devices(void)
                     devices_buffer[count].get_device_id(),
                     devices_buffer[count].get_value(),
                     devices_buffer[count].get_io_type(),
-                    devices_buffer[count].get_ttl(),
+                    wheel_get_ttl(count),
                     device_type_to_name(devices_buffer[count].get_device_type()));
 
             num_of_dev_count++;
@@ -237,47 +320,69 @@ void ha_device_mng::print_all_devices(void)
 /*----------------------------------------------------------------------------*/
 void ha_device_mng::save(void)
 {
-    FIL file;
-    FRESULT fres;
     uint16_t count;
-    uint16_t num_of_dev_count;
+    uint16_t num_of_records = 0;
 
     if (devices_list_file == NULL) {
         return;
     }
 
-    /* open file */
-    fres = f_open(&file, devices_list_file, FA_WRITE | FA_CREATE_ALWAYS);
-    if (fres != FR_OK) {
-        HA_DEBUG("ha_dev_mng::save: Error when open file %s\n", devices_list_file);
-        print_ferr(fres);
+    /* update ttl of devices from TTL timing wheel, find the last device */
+    for (count = 0; count < max_num_of_dev; count++) {
+        if (!devices_buffer[count].is_no_device()) {
+            devices_buffer[count].set_ttl(wheel_get_ttl(count));
+            num_of_records = count + 1;
+        }
+    }
+
+    if (snapshot_save(devices_list_file, snapshot_magic, snapshot_version,
+            devices_buffer, sizeof(ha_device), num_of_records) != 0) {
+        HA_DEBUG("ha_dev_mng::save: Error when save snapshot %s\n", devices_list_file);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::restore(void)
+{
+    int32_t num_of_records;
+    uint16_t count;
+    int16_t ttl;
+
+    if (devices_list_file == NULL) {
         return;
     }
-    f_sync(&file);
 
-    /* write data */
-    num_of_dev_count = 0;
-    for (count = 0; count < max_num_of_dev; count++) {
-        if (!devices_buffer[count].is_no_device()) {
-            f_printf(&file, devices_list_line_pattern,
-                    devices_buffer[count].get_device_id(),
-                    devices_buffer[count].get_value(),
-                    devices_buffer[count].get_ttl());
-            f_sync(&file);
+    num_of_records = snapshot_restore(devices_list_file, snapshot_magic, snapshot_version,
+            devices_buffer, sizeof(ha_device), max_num_of_dev);
 
-            num_of_dev_count++;
-            if (num_of_dev_count == cur_size) {
-                f_close(&file);
-                return;
-            }
-        }/* end not empty device */
-    }/* end for */
+    if (num_of_records == snapshot_ns::SNAPSHOT_LEGACY) {
+        HA_NOTIFY("ha_device_mng::restore: importing %s in text format\n", devices_list_file);
+        clear_all_devices();
+        restore_text();
+        return;
+    }
 
-    f_close(&file);
+    if (num_of_records < 0) {
+        /* devices buffer may have been overwritten */
+        clear_all_devices();
+        return;
+    }
+
+    for (count = num_of_records; count < max_num_of_dev; count++) {
+        devices_buffer[count].set_to_no_device();
+    }
+
+    for (count = 0; count < num_of_records; count++) {
+        ttl = devices_buffer[count].get_ttl();
+        entries[count].expire_tick = ttl_tick + (ttl > 0 ? ttl : 1);
+        entries[count].ttl_zero = (ttl <= 0);
+    }
+
+    rebuild();
 }
 
 /*----------------------------------------------------------------------------*/
-void ha_device_mng::restore(void)
+void ha_device_mng::restore_text(void)
 {
     FIL file;
     FRESULT fres;
@@ -292,7 +397,7 @@ void ha_device_mng::restore(void)
     /* open file */
     fres = f_open(&file, devices_list_file, FA_READ | FA_OPEN_ALWAYS);
     if (fres != FR_OK) {
-        HA_DEBUG("ha_device_mng::restore: Error when open file %s\n", devices_list_file);
+        HA_DEBUG("ha_device_mng::restore_text: Error when open file %s\n", devices_list_file);
         print_ferr(fres);
         return;
     }
@@ -301,63 +406,264 @@ void ha_device_mng::restore(void)
     while( f_gets(line, sizeof(line), &file) ){
         sscanf(line, devices_list_line_pattern, &device_id, &value_i, &ttl_i);
         set_dev_val(device_id, (int16_t)value_i);
-        set_dev_ttl(device_id, (int8_t)ttl_i);
+        set_dev_ttl(device_id, (int16_t)ttl_i);
     }
 
     f_close(&file);
 }
 
 /*----------------------------------------------------------------------------*/
-ha_device *ha_device_mng::find_an_empty_slot(void)
+ha_device *ha_device_mng::find_device(uint32_t device_id)
+{
+    uint16_t index;
+
+    index = hash_find(device_id);
+    if (index == no_entry) {
+        return NULL;
+    }
+
+    return &devices_buffer[index];
+}
+
+/*----------------------------------------------------------------------------*/
+ha_device *ha_device_mng::add_device(uint32_t device_id)
+{
+    uint16_t index;
+
+    if (device_id == ha_device_ns::no_device_id || free_head == no_entry) {
+        return NULL;
+    }
+
+    /* take a slot from free slots list */
+    index = free_head;
+    free_head = entries[index].next;
+
+    devices_buffer[index].set_device_id(device_id);
+    entries[index].changed_seq = next_change_seq();
+    hash_insert(index);
+
+    /* new device without ttl will be removed in the next tick */
+    wheel_insert(index, 0);
+
+    cur_size++;
+    return &devices_buffer[index];
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::remove_device_at(uint16_t index)
+{
+    hash_remove(devices_buffer[index].get_device_id());
+    wheel_remove(index);
+    devices_buffer[index].set_to_no_device();
+    removed_seq = next_change_seq();
+
+    /* put back to free slots list */
+    entries[index].next = free_head;
+    free_head = index;
+
+    cur_size--;
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::clear_all_devices(void)
 {
-    uint16_t num_of_dev_count = 0;
     for (uint16_t count = 0; count < max_num_of_dev; count++) {
-        if (devices_buffer[count].is_no_device()) {
-            /* empty slot here */
-            return &devices_buffer[count];
-        }
+        devices_buffer[count].set_to_no_device();
+    }
 
-        /* not empty slot */
-        num_of_dev_count++;
-        if (num_of_dev_count == cur_size) {
-            return NULL;
-        }
+    rebuild();
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t ha_device_mng::next_change_seq(void)
+{
+    if ((change_seq & seq_counter_mask) == seq_counter_mask) {
+        /* counter would run into epoch bits */
+        new_change_seq_epoch();
     }
 
-    return NULL;
+    return ++change_seq;
 }
 
 /*----------------------------------------------------------------------------*/
-ha_device *ha_device_mng::find_device(uint32_t device_id)
+void ha_device_mng::new_change_seq_epoch(void)
 {
+    /* 1 to 255, 0 is never used */
+    seq_epoch = (seq_epoch % 255) + 1;
+
+    if (seq_epoch_file != NULL &&
+            snapshot_save(seq_epoch_file, epoch_snapshot_magic, epoch_snapshot_version,
+                    &seq_epoch, sizeof(seq_epoch), 1) != 0) {
+        HA_DEBUG("ha_dev_mng::new_change_seq_epoch: Error when save %s\n", seq_epoch_file);
+    }
+
+    change_seq = seq_epoch << seq_epoch_shift;
+    removed_seq = change_seq;
+
     for (uint16_t count = 0; count < max_num_of_dev; count++) {
-        if (devices_buffer[count].get_device_id() == device_id) {
-            return &devices_buffer[count];
+        entries[count].changed_seq = change_seq;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t ha_device_mng::hash_home(uint32_t device_id)
+{
+    /* mix bits so devices on the same node (same 16 MSBs) are spread */
+    device_id ^= device_id >> 16;
+    device_id *= 0x45d9f3b;
+    device_id ^= device_id >> 16;
+
+    return (uint16_t)(device_id & hash_mask);
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t ha_device_mng::hash_find(uint32_t device_id)
+{
+    uint16_t pos;
+
+    if (device_id == ha_device_ns::no_device_id) {
+        return no_entry;
+    }
+
+    /* linear probing, hash table always has empty positions because hash_size > num_of_dev */
+    for (pos = hash_home(device_id); hash_table[pos] != no_entry; pos = (pos + 1) & hash_mask) {
+        if (devices_buffer[hash_table[pos]].get_device_id() == device_id) {
+            return hash_table[pos];
         }
     }
 
-    return NULL;
+    return no_entry;
 }
 
 /*----------------------------------------------------------------------------*/
-ha_device *ha_device_mng::add_device(uint32_t device_id)
+void ha_device_mng::hash_insert(uint16_t index)
 {
-    for (uint16_t count = 0; count < max_num_of_dev; count++) {
-        if (devices_buffer[count].is_no_device()) {
-            devices_buffer[count].set_device_id(device_id);
-            return &devices_buffer[count];
+    uint16_t pos;
+
+    pos = hash_home(devices_buffer[index].get_device_id());
+    while (hash_table[pos] != no_entry) {
+        pos = (pos + 1) & hash_mask;
+    }
+
+    hash_table[pos] = index;
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::hash_remove(uint32_t device_id)
+{
+    uint16_t pos, next, home;
+
+    for (pos = hash_home(device_id); hash_table[pos] != no_entry; pos = (pos + 1) & hash_mask) {
+        if (devices_buffer[hash_table[pos]].get_device_id() == device_id) {
+            break;
         }
     }
 
-    return NULL;
+    if (hash_table[pos] == no_entry) {
+        return;
+    }
+
+    /* backward shift deletion, so no tombstone is needed */
+    hash_table[pos] = no_entry;
+    next = pos;
+    while (1) {
+        next = (next + 1) & hash_mask;
+        if (hash_table[next] == no_entry) {
+            break;
+        }
+
+        /* move entry back if its home is not in (pos, next] */
+        home = hash_home(devices_buffer[hash_table[next]].get_device_id());
+        if (((next - home) & hash_mask) >= ((next - pos) & hash_mask)) {
+            hash_table[pos] = hash_table[next];
+            hash_table[next] = no_entry;
+            pos = next;
+        }
+    }
 }
 
 /*----------------------------------------------------------------------------*/
-void ha_device_mng::clear_all_devices(void)
+void ha_device_mng::wheel_insert(uint16_t index, int16_t ttl)
 {
-    for (uint16_t count = 0; count < max_num_of_dev; count++) {
-        devices_buffer[count].set_to_no_device();
+    uint16_t slot;
+
+    /* ttl 0 expires in the next tick as with decrease-by-one */
+    entries[index].ttl_zero = (ttl < 1);
+    if (ttl < 1) {
+        ttl = 1;
+    }
+
+    entries[index].expire_tick = ttl_tick + ttl;
+    slot = entries[index].expire_tick & ttl_wheel_mask;
+
+    entries[index].prev = no_entry;
+    entries[index].next = ttl_wheel[slot];
+    if (ttl_wheel[slot] != no_entry) {
+        entries[ttl_wheel[slot]].prev = index;
+    }
+    ttl_wheel[slot] = index;
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::wheel_remove(uint16_t index)
+{
+    if (entries[index].prev != no_entry) {
+        entries[entries[index].prev].next = entries[index].next;
+    }
+    else {
+        ttl_wheel[entries[index].expire_tick & ttl_wheel_mask] = entries[index].next;
+    }
+
+    if (entries[index].next != no_entry) {
+        entries[entries[index].next].prev = entries[index].prev;
     }
 
+    entries[index].next = no_entry;
+    entries[index].prev = no_entry;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t ha_device_mng::wheel_get_ttl(uint16_t index)
+{
+    if (entries[index].ttl_zero) {
+        return 0;
+    }
+
+    return (int16_t)(entries[index].expire_tick - ttl_tick);
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::rebuild(void)
+{
+    uint16_t count;
+    uint16_t slot;
+
+    memset(hash_table, 0xFF, (hash_mask + 1) * sizeof(uint16_t));
+    memset(ttl_wheel, 0xFF, (ttl_wheel_mask + 1) * sizeof(uint16_t));
+    free_head = no_entry;
     cur_size = 0;
+
+    /* from the last one, so free slots list will start with the lowest index */
+    count = max_num_of_dev;
+    while (count > 0) {
+        count--;
+
+        if (devices_buffer[count].is_no_device()) {
+            entries[count].next = free_head;
+            free_head = count;
+            continue;
+        }
+
+        hash_insert(count);
+
+        slot = entries[count].expire_tick & ttl_wheel_mask;
+        entries[count].prev = no_entry;
+        entries[count].next = ttl_wheel[slot];
+        if (ttl_wheel[slot] != no_entry) {
+            entries[ttl_wheel[slot]].prev = count;
+        }
+        ttl_wheel[slot] = count;
+
+        cur_size++;
+    }
 }
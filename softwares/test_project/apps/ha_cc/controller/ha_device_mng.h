@@ -26,6 +26,35 @@ enum errcode_e: int8_t {
     TTL_IS_ZERO,
 };
 
+const uint16_t no_entry = 0xFFFF;
+
+/* device list snapshot, records are ha_device objects (ttl is up to date) */
+const uint32_t snapshot_magic = 0x53564544; /* "DEVS" */
+const uint16_t snapshot_version = 1;
+
+/*
+ * Change sequence number: | epoch (8) | counter (24) |. Epoch is incremented at
+ * every boot and saved in its own snapshot, so a sequence number of an earlier boot
+ * never matches the current epoch. Epoch 0 is never used (since seq 0 is a full dump).
+ */
+const uint8_t seq_epoch_shift = 24;
+const uint32_t seq_counter_mask = 0x00FFFFFF;
+const uint32_t epoch_snapshot_magic = 0x48435045; /* "EPCH" */
+const uint16_t epoch_snapshot_version = 1;
+
+/**
+ * @brief   Bookkeeping of a slot in devices buffer, used by TTL timing wheel
+ *          (or free slots list for empty slots).
+ */
+typedef struct {
+    uint16_t next;
+    uint16_t prev;
+    uint16_t expire_tick; /* tick when ttl of this device reaches zero */
+    bool ttl_zero; /* ttl was set to zero, device expires in the next tick */
+    uint32_t changed_seq; /* change sequence number when this device was added, changed value
+                             or its ttl reached or left zero */
+} dev_entry_t;
+
 }
 
 class ha_device_mng {
@@ -34,13 +63,27 @@ public:
      * @brief   constructor,
      *          User must provide buffer to hold devices and size of this buffer.
      *          All devices in buffer will be clear with no_device ids.
+     *          Devices are indexed by an open-addressing hash table (keyed by device id),
+     *          TTLs are expired by a timing wheel, so lookup and 1s tick cost don't depend
+     *          on num_of_dev.
      *
      * @param[in]   devices_buffer, pointer to buffer holding devices.
+     * @param[in]   entries_buffer, buffer holding bookkeeping of devices, must have
+     *              num_of_dev members.
      * @param[in]   num_of_dev, number of devices in device_buffer
+     * @param[in]   hash_buffer, buffer for hash index.
+     * @param[in]   hash_size, size of hash_buffer, must be a power of 2 and > num_of_dev
+     *              (2 * num_of_dev is recommended).
+     * @param[in]   ttl_wheel_buffer, buffer for TTL timing wheel.
+     * @param[in]   ttl_wheel_size, size of ttl_wheel_buffer, must be a power of 2. Devices with
+     *              TTL < ttl_wheel_size will only be touched when they expire.
      * @param[in]   devices_list_filename, file name will hold list of devices.
      *              NULL to disable save/restore operations.
      */
-    ha_device_mng(ha_device *devices_buffer, uint16_t num_of_dev, const char *devices_list_filename);
+    ha_device_mng(ha_device *devices_buffer, ha_device_mng_ns::dev_entry_t *entries_buffer,
+            uint16_t num_of_dev, uint16_t *hash_buffer, uint16_t hash_size,
+            uint16_t *ttl_wheel_buffer, uint16_t ttl_wheel_size,
+            const char *devices_list_filename);
     
     /**
      * @brief   Find a device with device_id and set its value. If this device id
@@ -74,6 +117,57 @@ public:
      */
     int8_t get_dev_val_with_index(uint16_t index, uint32_t &device_id, int16_t &value);
 
+    /**
+     * @brief   Get device at a index position in devices buffer with its ttl and
+     *          change sequence number (for delta dumps).
+     *
+     * @param[in]   index
+     * @param[out]  device_id.
+     * @param[out]  value.
+     * @param[out]  ttl.
+     * @param[out]  changed_seq, change sequence number when the device was added or
+     *              its value was changed.
+     *
+     * @return      0 if success, -1 if index is out of range or there is no device at index.
+     */
+    int8_t get_dev_with_index(uint16_t index, uint32_t &device_id, int16_t &value,
+            int16_t &ttl, uint32_t &changed_seq);
+
+    /**
+     * @brief   Start a new epoch of change sequence number (call once at boot, after
+     *          restore()). Epoch is read from epoch file, incremented and saved back.
+     *          All current devices will be considered as changed at the start of the epoch.
+     *
+     * @param[in]   epoch_filename, file name will hold the last epoch, NULL to not save it.
+     * @param[in]   seed, used when epoch file can't be read (e.g. RTC counter).
+     */
+    void start_change_seq_epoch(const char *epoch_filename, uint32_t seed);
+
+    /**
+     * @brief   Get current change sequence number (incremented when a device is added,
+     *          removed or its value is changed).
+     *
+     * @return  current change sequence number.
+     */
+    uint32_t get_change_seq(void) {return change_seq;};
+
+    /**
+     * @brief   Check whether changes since a sequence number can be listed by changed_seq
+     *          of devices (same epoch and no device has been removed since then).
+     *
+     * @param[in]   since_seq.
+     *
+     * @return  true if delta is available, false if a full list is needed.
+     */
+    bool is_delta_available(uint32_t since_seq);
+
+    /**
+     * @brief   Get size of devices buffer.
+     *
+     * @return  max number of devices.
+     */
+    uint16_t get_max_numofdev(void) {return max_num_of_dev;};
+
     /**
      * @brief   Find and set TTL of a device.
      *
@@ -107,6 +201,7 @@ public:
 
     /**
      * @brief   Decrease all device's ttls by one, and remove device(s) if TTL_IS_ZERO.
+     *          (Only devices in current slot of TTL timing wheel will be touched)
      */
     void dec_all_devs_ttl(void);
 
@@ -120,7 +215,8 @@ public:
     int8_t remove_device(uint32_t device_id);
 
     /**
-     * @brief   Re-order devices buffer to get a contiguous block.
+     * @brief   Re-order devices buffer to get a contiguous block. Hash index and TTL
+     *          timing wheel will be rebuilt.
      */
     void reorder(void);
 
@@ -137,12 +233,13 @@ public:
     void print_all_devices(void);
 
     /**
-     * @brief   Save current list of devices to file.
+     * @brief   Save current list of devices to file (binary snapshot, see snapshot.h).
      */
     void save(void);
 
     /**
-     * @brief   Read device list file and restore devices buffer.
+     * @brief   Read device list file and restore devices buffer. Device list file
+     *          in old text format will be imported.
      */
     void restore(void);
 
@@ -158,14 +255,6 @@ private:
      */
     ha_device *find_device(uint32_t device_id);
 
-    /**
-     * @brief   Find an empty slot in devices buffer.
-     *
-     * @return      pointer to a ha_device object with no device id (empty slot),
-     *              NULL if not found.
-     */
-    ha_device *find_an_empty_slot(void);
-
     /**
      * @brief   Find a empty device in buffer and add new device. NOTE: this function
      *          will not check whether this device has existed in buffer or not.
@@ -178,16 +267,64 @@ private:
      */
     ha_device *add_device(uint32_t device_id);
 
+    /**
+     * @brief   Remove device at an index of devices buffer from hash index, TTL wheel
+     *          and put it back to free slots list. Current size will be updated.
+     *
+     * @param[in]   index, index of device in devices buffer.
+     */
+    void remove_device_at(uint16_t index);
+
     /**
      * @brief   Set all devices in devices buffer to no device.
      */
     void clear_all_devices(void);
 
+    /**
+     * @brief   Import device list file in old text format ("%lx %d %d\n" per device).
+     */
+    void restore_text(void);
+
+    /*----------------------------- Change sequence --------------------------*/
+    uint32_t next_change_seq(void);
+    void new_change_seq_epoch(void);
+
+    /*----------------------------- Hash index -------------------------------*/
+    uint16_t hash_home(uint32_t device_id);
+    uint16_t hash_find(uint32_t device_id);
+    void hash_insert(uint16_t index);
+    void hash_remove(uint32_t device_id);
+
+    /*----------------------------- TTL timing wheel -------------------------*/
+    void wheel_insert(uint16_t index, int16_t ttl);
+    void wheel_remove(uint16_t index);
+    int16_t wheel_get_ttl(uint16_t index);
+
+    /**
+     * @brief   Rebuild hash index, TTL timing wheel and free slots list from devices buffer
+     *          and expire ticks in entries.
+     */
+    void rebuild(void);
+
     /*----------------------------- Variables --------------------------------*/
     uint16_t cur_size;
 
     uint16_t max_num_of_dev;
     ha_device *devices_buffer;
+    ha_device_mng_ns::dev_entry_t *entries;
+    uint16_t free_head; /* free slots list in devices buffer */
+
+    uint16_t *hash_table;
+    uint16_t hash_mask;
+
+    uint16_t *ttl_wheel;
+    uint16_t ttl_wheel_mask;
+    uint16_t ttl_tick;
+
+    uint32_t change_seq;
+    uint32_t removed_seq; /* change sequence number of the last removal */
+    uint32_t seq_epoch;
+    const char *seq_epoch_file;
 
     const char *devices_list_file;
 };
@@ -20,6 +20,7 @@
 #include "gff_mesg_id.h"
 #include "common_msg_id.h"
 #include "ha_gff_misc.h"
+#include "snapshot.h"
 
 #define HA_NOTIFICATION (1)
 #define HA_DEBUG_EN (0)
@@ -27,6 +28,7 @@
 
 using namespace scene_ns;
 
+/* old text format, for importing */
 static const char save_line_rule[] = "R: %u %u %u %u\n"; /* is_valid, is_active, num_in, num_out */
 static const char save_line_i0[] = "I: %u\n";          /* cond */
 static const char save_line_i1_devval[] = "%lx %d\n"; /* device id, value */
@@ -42,6 +44,13 @@ scene::scene(void)
     clear_all_rules();
 
     last_invalid_index = 0;
+
+    num_dev_refs = 0;
+    num_abs_refs = 0;
+    num_day_refs = 0;
+    index_valid = false;
+    time_synced = false;
+    last_time = 0;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -73,6 +82,7 @@ uint16_t scene::get_cur_num_rules(void)
 void scene::set_cur_num_rules(uint16_t num_rules)
 {
     cur_num_rules = num_rules;
+    index_valid = false;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -80,6 +90,7 @@ void scene::new_scene(void)
 {
     cur_num_rules = 0;
     clear_all_rules();
+    index_valid = false;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -93,6 +104,7 @@ int8_t scene::add_rule_with_index(rule_t &rule, uint16_t index)
     if (index >= cur_num_rules) {
         cur_num_rules = index + 1;
     }
+    index_valid = false;
 
     return 0;
 }
@@ -117,6 +129,7 @@ void scene::remove_rule_with_index(uint16_t index)
     }
 
     rules_list[index].is_valid = false;
+    index_valid = false;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -147,65 +160,56 @@ bool scene::find_invalid_rule(uint16_t &index, bool cont)
 /*----------------------------------------------------------------------------*/
 int8_t scene::save(void)
 {
-    FIL file;
-    FRESULT fres;
-    uint8_t count_io, count_rule;
+    uint16_t num_rules;
 
-    if(name == NULL) {
-        return -1;
-    }
+    num_rules = (cur_num_rules < scene_max_rules) ? cur_num_rules : scene_max_rules;
 
-    /* open file */
-    fres = f_open(&file, name, FA_WRITE | FA_CREATE_ALWAYS);
-    if (fres != FR_OK) {
-        HA_DEBUG("scene::save: Error when open file %s\n", name);
-        print_ferr(fres);
+    if (snapshot_save(name, scene_snapshot_magic, scene_snapshot_version,
+            rules_list, sizeof(rule_t), num_rules) != 0) {
+        HA_DEBUG("scene::save: Error when save snapshot %s\n", name);
         return -1;
     }
-    f_sync(&file);
-
-    /* write data */
-    for (count_rule = 0; count_rule < cur_num_rules; count_rule++) {
-        /* Save rule */
-        f_printf(&file, save_line_rule,
-                rules_list[count_rule].is_valid, rules_list[count_rule].is_active,
-                rules_list[count_rule].num_in, rules_list[count_rule].num_out);
-
-        /* Save input */
-        for (count_io = 0; count_io < rules_list[count_rule].num_in; count_io++){
-            f_printf(&file, save_line_i0, rules_list[count_rule].inputs[count_io].cond);
-
-            if (rules_list[count_rule].inputs[count_io].cond == COND_IN_RANGE ||
-                    rules_list[count_rule].inputs[count_io].cond == COND_IN_RANGE_EVDAY) {
-                f_printf(&file, save_line_i1_time,
-                        rules_list[count_rule].inputs[count_io].time_range.start,
-                        rules_list[count_rule].inputs[count_io].time_range.end);
-            }
-            else {
-                f_printf(&file, save_line_i1_devval,
-                        rules_list[count_rule].inputs[count_io].dev_val.device_id,
-                        rules_list[count_rule].inputs[count_io].dev_val.value);
-            }
-        }
 
-        /* Save output */
-        for (count_io = 0; count_io < rules_list[count_rule].num_out; count_io++) {
-            f_printf(&file, save_line_o0, rules_list[count_rule].outputs[count_io].action);
-            f_printf(&file, save_line_o1_devval,
-                    rules_list[count_rule].outputs[count_io].dev_val.device_id,
-                    rules_list[count_rule].outputs[count_io].dev_val.value);
-        }
+    return 0;
+}
 
-        f_sync(&file);
+/*----------------------------------------------------------------------------*/
+int8_t scene::restore(void)
+{
+    int32_t num_rules;
+
+    /* new scene */
+    new_scene();
+
+    num_rules = snapshot_restore(name, scene_snapshot_magic, scene_snapshot_version,
+            rules_list, sizeof(rule_t), scene_max_rules);
+
+    switch (num_rules) {
+    case snapshot_ns::SNAPSHOT_LEGACY:
+        HA_NOTIFY("scene::restore: importing %s in text format\n", name);
+        return restore_text();
+
+    case snapshot_ns::SNAPSHOT_NOT_FOUND:
+        /* empty scene */
+        return 0;
+
+    case snapshot_ns::SNAPSHOT_ERR:
+        /* rules list may have been overwritten */
+        new_scene();
+        return -1;
+
+    default:
+        break;
     }
 
-    f_close(&file);
+    cur_num_rules = num_rules;
+    index_valid = false;
 
     return 0;
 }
 
 /*----------------------------------------------------------------------------*/
-int8_t scene::restore(void)
+int8_t scene::restore_text(void)
 {
     FIL file;
     FRESULT fres;
@@ -227,7 +231,7 @@ int8_t scene::restore(void)
     /* open file */
     fres = f_open(&file, name, FA_READ | FA_OPEN_ALWAYS);
     if (fres != FR_OK) {
-        HA_DEBUG("scene::restore: Error when open file %s\n", name);
+        HA_DEBUG("scene::restore_text: Error when open file %s\n", name);
         print_ferr(fres);
         return -1;
     }
@@ -246,6 +250,10 @@ int8_t scene::restore(void)
         read_rule.is_active = (bool) is_active_ui;
         read_rule.num_in = (uint8_t)num_in_ui;
         read_rule.num_out = (uint8_t)num_out_ui;
+        if (read_rule.num_in > rule_max_input || read_rule.num_out > rule_max_output) {
+            HA_DEBUG("scene::restore_text: too much inputs or outputs, stopped\n");
+            break;
+        }
 
         /* Read input */
         for (count_io = 0; count_io < read_rule.num_in; count_io++) {
@@ -317,261 +325,381 @@ int8_t scene::restore(void)
 void scene::process(bool trigger_by_report,
         ha_device *device_rpt, ha_device_mng *cur_device_mng,
         rtc *rtc_obj,
-        cir_queue *out_queue, kernel_pid_t out_pid)
+        gff_queue *out_queue, kernel_pid_t out_pid)
+{
+    uint8_t rules_marks[(scene_max_rules + 7) / 8];
+    uint16_t abs_start, day_start;
+    uint32_t cur_time, cur_day, last_day;
+    msg_t out_mesgs[scene_out_batch_size];
+    uint8_t num_out_mesgs = 0;
+
+    if (!index_valid) {
+        build_index();
+    }
+
+    memset(rules_marks, 0, sizeof(rules_marks));
+    abs_start = num_dev_refs;
+    day_start = num_dev_refs + num_abs_refs;
+
+    if (trigger_by_report) {
+        /* only rules having inputs with this device */
+        process_refs(0, num_dev_refs,
+                device_rpt->get_device_id(), device_rpt->get_device_id(), rules_marks,
+                trigger_by_report, device_rpt, cur_device_mng, rtc_obj, out_queue, out_pid,
+                out_mesgs, num_out_mesgs);
+        send_out_mesgs(out_mesgs, num_out_mesgs, out_pid);
+        return;
+    }
+
+    cur_time = rtc_obj->get_time_packed();
+
+    if (!time_synced || cur_time < last_time) {
+        /* first time or time has been set back, all rules having time inputs */
+        HA_DEBUG("scene::process: time resync, cur_time %lx\n", cur_time);
+        process_refs(abs_start, day_start + num_day_refs, 0, 0xFFFFFFFF, rules_marks,
+                trigger_by_report, device_rpt, cur_device_mng, rtc_obj, out_queue, out_pid,
+                out_mesgs, num_out_mesgs);
+    }
+    else {
+        /* only rules with start time in (last_time, cur_time] */
+        if (cur_time != last_time) {
+            process_refs(abs_start, day_start, last_time + 1, cur_time, rules_marks,
+                    trigger_by_report, device_rpt, cur_device_mng, rtc_obj, out_queue, out_pid,
+                    out_mesgs, num_out_mesgs);
+        }
+
+        cur_day = cur_time & 0xFFFF;
+        last_day = last_time & 0xFFFF;
+        if (cur_day > last_day) {
+            process_refs(day_start, day_start + num_day_refs, last_day + 1, cur_day, rules_marks,
+                    trigger_by_report, device_rpt, cur_device_mng, rtc_obj, out_queue, out_pid,
+                    out_mesgs, num_out_mesgs);
+        }
+        else if (cur_day < last_day) {
+            /* passed midnight */
+            process_refs(day_start, day_start + num_day_refs, last_day + 1, 0xFFFF, rules_marks,
+                    trigger_by_report, device_rpt, cur_device_mng, rtc_obj, out_queue, out_pid,
+                    out_mesgs, num_out_mesgs);
+            process_refs(day_start, day_start + num_day_refs, 0, cur_day, rules_marks,
+                    trigger_by_report, device_rpt, cur_device_mng, rtc_obj, out_queue, out_pid,
+                    out_mesgs, num_out_mesgs);
+        }
+    }
+
+    last_time = cur_time;
+    time_synced = true;
+
+    send_out_mesgs(out_mesgs, num_out_mesgs, out_pid);
+}
+
+/*----------------------------------------------------------------------------*/
+void scene::process_refs(uint16_t refs_start, uint16_t refs_end,
+        uint32_t key_from, uint32_t key_to, uint8_t *rules_marks,
+        bool trigger_by_report, ha_device *device_rpt, ha_device_mng *cur_device_mng,
+        rtc *rtc_obj,
+        gff_queue *out_queue, kernel_pid_t out_pid,
+        msg_t *out_mesgs, uint8_t &num_out_mesgs)
+{
+    uint16_t low, high, mid;
+    uint8_t c_rule;
+
+    /* binary search for the first ref with key >= key_from */
+    low = refs_start;
+    high = refs_end;
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (refs_key[mid] < key_from) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    for (; low < refs_end && refs_key[low] <= key_to; low++) {
+        c_rule = refs_rule[low];
+        if (rules_marks[c_rule / 8] & (1 << (c_rule % 8))) {
+            /* has been evaluated */
+            continue;
+        }
+        rules_marks[c_rule / 8] |= (1 << (c_rule % 8));
+
+        process_rule(c_rule, trigger_by_report, device_rpt, cur_device_mng, rtc_obj,
+                out_queue, out_pid, out_mesgs, num_out_mesgs);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void scene::process_rule(uint16_t c_rule, bool trigger_by_report,
+        ha_device *device_rpt, ha_device_mng *cur_device_mng,
+        rtc *rtc_obj,
+        gff_queue *out_queue, kernel_pid_t out_pid,
+        msg_t *out_mesgs, uint8_t &num_out_mesgs)
 {
     bool all_cond_satisfied, has_trigger_src;
-    uint16_t c_rule, c_in, c_out;
+    uint16_t c_in, c_out;
     uint32_t cur_time;
     int16_t value;
-    uint8_t act_gff[ha_ns::SET_DEV_VAL_DATA_LEN + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
-    msg_t mesg;
+    uint8_t *act_gff;
 
-    for (c_rule = 0; c_rule < cur_num_rules; c_rule++) {
+    /* Check valid and active */
+    if (!rules_list[c_rule].is_valid || !rules_list[c_rule].is_active) {
+        HA_DEBUG("scene::process: Rule %hu is not valid or active\n", c_rule);
+        return;
+    }
 
-        /* Check valid and active */
-        if (!rules_list[c_rule].is_valid || !rules_list[c_rule].is_active) {
-            HA_DEBUG("scene::process: Rule %hu is not valid or active\n", c_rule);
-            continue;
-        }
+    /* process inputs */
+    all_cond_satisfied = true;
+    has_trigger_src = false;
+    for (c_in = 0; c_in < rules_list[c_rule].num_in; c_in++) {
+        input_t *input_p = &rules_list[c_rule].inputs[c_in];
 
-        /* process inputs */
-        all_cond_satisfied = true;
-        has_trigger_src = false;
-        for (c_in = 0; c_in < rules_list[c_rule].num_in; c_in++) {
-            input_t *input_p = &rules_list[c_rule].inputs[c_in];
+        switch (input_p->cond) {
 
-            switch (input_p->cond) {
+        case COND_IN_RANGE:
+            HA_DEBUG("scene::process: COND_IN_RANGE\n");
 
-            case COND_IN_RANGE:
-                HA_DEBUG("scene::process: COND_IN_RANGE\n");
+            if (!trigger_by_report) {
+                has_trigger_src = true;
+            }
 
-                if (!trigger_by_report) {
-                    has_trigger_src = true;
-                }
+            cur_time = rtc_obj->get_time_packed();
+            if (cur_time < input_p->time_range.start ||
+                    cur_time > input_p->time_range.end) {
+                all_cond_satisfied = false;
+            }
 
-                cur_time = rtc_obj->get_time_packed();
-                if (cur_time < input_p->time_range.start ||
-                        cur_time > input_p->time_range.end) {
-                    all_cond_satisfied = false;
-                }
+            HA_DEBUG("scene::process: acs %hd, hts %hd, cur_time %lx, start %lx, end %lx\n",
+                    all_cond_satisfied, has_trigger_src,
+                    cur_time, input_p->time_range.start, input_p->time_range.end);
+            break;
 
-                HA_DEBUG("scene::process: acs %hd, hts %hd, cur_time %lx, start %lx, end %lx\n",
-                        all_cond_satisfied, has_trigger_src,
-                        cur_time, input_p->time_range.start, input_p->time_range.end);
-                break;
+        case COND_IN_RANGE_EVDAY:
+            if (!trigger_by_report) {
+                has_trigger_src = true;
+            }
 
-            case COND_IN_RANGE_EVDAY:
-                if (!trigger_by_report) {
-                    has_trigger_src = true;
-                }
+            HA_DEBUG("scene::process: COND_IN_RANGE_EVDAY\n");
 
-                HA_DEBUG("scene::process: COND_IN_RANGE_EVDAY\n");
+            cur_time = rtc_obj->get_time_packed();
+            cur_time = cur_time & 0xFFFF;
 
-                cur_time = rtc_obj->get_time_packed();
-                cur_time = cur_time & 0xFFFF;
+            /* only hour, min, sec will be cared */
+            if ( cur_time < (input_p->time_range.start & 0xFFFF) ||
+                    cur_time > (input_p->time_range.end & 0xFFFF)) {
+                all_cond_satisfied = false;
+            }
 
-                /* only hour, min, sec will be cared */
-                if ( cur_time < (input_p->time_range.start & 0xFFFF) ||
-                        cur_time > (input_p->time_range.end & 0xFFFF)) {
-                    all_cond_satisfied = false;
-                }
+            HA_DEBUG("scene::process: acs %hd, hts %hd, cur_time %lx, start %lx, end %lx\n",
+                    all_cond_satisfied, has_trigger_src,
+                    cur_time,
+                    input_p->time_range.start & 0xFFFF, input_p->time_range.end & 0xFFFF);
+            break;
 
-                HA_DEBUG("scene::process: acs %hd, hts %hd, cur_time %lx, start %lx, end %lx\n",
-                        all_cond_satisfied, has_trigger_src,
-                        cur_time,
-                        input_p->time_range.start & 0xFFFF, input_p->time_range.end & 0xFFFF);
-                break;
+        case COND_EQUAL_THR:
+        case COND_LESS_THAN_THR:
+        case COND_LESS_OR_EQUAL_THR:
+        case COND_GREATER_THAN_THR:
+        case COND_GREATER_OR_EQUAL_THR:
 
+            switch (input_p->cond) {
             case COND_EQUAL_THR:
+                HA_DEBUG("scene::process: COND_EQUAL_THR\n");
+                break;
             case COND_LESS_THAN_THR:
+                HA_DEBUG("scene::process: COND_LESS_THAN_THR\n");
+                break;
             case COND_LESS_OR_EQUAL_THR:
+                HA_DEBUG("scene::process: COND_LESS_OR_EQUAL_THR\n");
+                break;
             case COND_GREATER_THAN_THR:
+                HA_DEBUG("scene::process: COND_GREATER_THAN_THR\n");
+                break;
             case COND_GREATER_OR_EQUAL_THR:
+                HA_DEBUG("scene::process: COND_GREATER_OR_EQUAL_THR\n");
+                break;
+            default:
+                break;
+            }
 
-                switch (input_p->cond) {
-                case COND_EQUAL_THR:
-                    HA_DEBUG("scene::process: COND_EQUAL_THR\n");
-                    break;
-                case COND_LESS_THAN_THR:
-                    HA_DEBUG("scene::process: COND_LESS_THAN_THR\n");
-                    break;
-                case COND_LESS_OR_EQUAL_THR:
-                    HA_DEBUG("scene::process: COND_LESS_OR_EQUAL_THR\n");
-                    break;
-                case COND_GREATER_THAN_THR:
-                    HA_DEBUG("scene::process: COND_GREATER_THAN_THR\n");
-                    break;
-                case COND_GREATER_OR_EQUAL_THR:
-                    HA_DEBUG("scene::process: COND_GREATER_OR_EQUAL_THR\n");
-                    break;
-                default:
+            if (trigger_by_report &&
+                (device_rpt->get_device_id() == input_p->dev_val.device_id)) {
+                has_trigger_src = true;
+
+                /* check new status of this device */
+                value = device_rpt->get_value();
+            }
+            else {
+                /* check old status in cur_device_mng */
+                if (cur_device_mng->get_dev_val(input_p->dev_val.device_id, value) == -1) {
+                    HA_DEBUG("scene::process: can't find dev %lx -> false\n",
+                            input_p->dev_val.device_id);
+                    /* TODO: check again */
+                    all_cond_satisfied = false;
                     break;
                 }
+            }
 
-                if (trigger_by_report &&
-                    (device_rpt->get_device_id() == input_p->dev_val.device_id)) {
-                    has_trigger_src = true;
+            /* compare value */
+            switch (input_p->cond) {
 
-                    /* check new status of this device */
-                    value = device_rpt->get_value();
-                }
-                else {
-                    /* check old status in cur_device_mng */
-                    if (cur_device_mng->get_dev_val(input_p->dev_val.device_id, value) == -1) {
-                        HA_DEBUG("scene::process: can't find dev %lx -> false\n",
-                                input_p->dev_val.device_id);
-                        /* TODO: check again */
-                        all_cond_satisfied = false;
-                        break;
-                    }
+            case COND_EQUAL_THR:
+                if (value != input_p->dev_val.value) {
+                    all_cond_satisfied = false;
                 }
+                break;
 
-                /* compare value */
-                switch (input_p->cond) {
-
-                case COND_EQUAL_THR:
-                    if (value != input_p->dev_val.value) {
-                        all_cond_satisfied = false;
-                    }
-                    break;
-
-                case COND_LESS_THAN_THR:
-                    if (value >= input_p->dev_val.value) {
-                        all_cond_satisfied = false;
-                    }
-                    break;
-
-                case COND_LESS_OR_EQUAL_THR:
-                    if (value > input_p->dev_val.value) {
-                        all_cond_satisfied = false;
-                    }
-                    break;
-
-                case COND_GREATER_THAN_THR:
-                    if (value <= input_p->dev_val.value) {
-                        all_cond_satisfied = false;
-                    }
-                    break;
-
-                case COND_GREATER_OR_EQUAL_THR:
-                    if (value < input_p->dev_val.value) {
-                        all_cond_satisfied = false;
-                    }
-                    break;
-
-                default:
-                    break;
+            case COND_LESS_THAN_THR:
+                if (value >= input_p->dev_val.value) {
+                    all_cond_satisfied = false;
                 }
-
-                HA_DEBUG("scene::process: acs %hd, hts %hd, dev_rpt %lx, val %hd,"
-                        "dev_i %lx, thres %hd\n",
-                        all_cond_satisfied, has_trigger_src,
-                        device_rpt->get_device_id(), value,
-                        input_p->dev_val.device_id, input_p->dev_val.value);
                 break;
 
-            case COND_CHANGE_VAL:
-            case COND_CHANGE_VAL_OVER_THR:
-                switch (input_p->cond) {
-                case COND_CHANGE_VAL:
-                    HA_DEBUG("scene::process: COND_CHANGE_VAL\n");
-                    break;
-                case COND_CHANGE_VAL_OVER_THR:
-                    HA_DEBUG("scene::process: COND_CHANGE_VAL_OVER_THR\n");
-                    break;
+            case COND_LESS_OR_EQUAL_THR:
+                if (value > input_p->dev_val.value) {
+                    all_cond_satisfied = false;
                 }
+                break;
 
-                if (trigger_by_report &&
-                    (device_rpt->get_device_id() == input_p->dev_val.device_id)) {
-                    has_trigger_src = true;
-
-                    /* compare new value of this device with old value */
-                    if (cur_device_mng->get_dev_val(device_rpt->get_device_id(), value) == -1) {
-                        /* Can't find device */
-                        HA_DEBUG("scene::process: can't find dev %lx -> false\n",
-                                device_rpt->get_device_id());
-                        all_cond_satisfied = false;
-                    }
-                    else {
-                        /* Found device, evaluate new value with old value */
-                        switch (input_p->cond) {
-
-                        case COND_CHANGE_VAL:
-                            if (device_rpt->get_value() == value) {
-                                all_cond_satisfied = false;
-                            }
-                            break;
-
-                        case COND_CHANGE_VAL_OVER_THR:
-                            if (abs(device_rpt->get_value() - value) <= input_p->dev_val.value){
-                                /* change was not over threshold */
-                                all_cond_satisfied = false;
-                            }
-                            break;
-                        }
-                    }/* end evaluating new and old value */
-                }
-                else { /* the device was not changed */
+            case COND_GREATER_THAN_THR:
+                if (value <= input_p->dev_val.value) {
                     all_cond_satisfied = false;
                 }
+                break;
 
-                HA_DEBUG("scene::process: acs %hd, hts %hd, dev_rpt %lx, val %hd,"
-                        "dev_i %lx, thres %hd\n",
-                        all_cond_satisfied, has_trigger_src,
-                        device_rpt->get_device_id(), value,
-                        input_p->dev_val.device_id, input_p->dev_val.value);
-
+            case COND_GREATER_OR_EQUAL_THR:
+                if (value < input_p->dev_val.value) {
+                    all_cond_satisfied = false;
+                }
                 break;
 
             default:
                 break;
-            }/* end switch input's conditions*/
+            }
 
-            if (!all_cond_satisfied) {
-                /* No need to check anymore */
+            HA_DEBUG("scene::process: acs %hd, hts %hd, dev_rpt %lx, val %hd,"
+                    "dev_i %lx, thres %hd\n",
+                    all_cond_satisfied, has_trigger_src,
+                    device_rpt->get_device_id(), value,
+                    input_p->dev_val.device_id, input_p->dev_val.value);
+            break;
+
+        case COND_CHANGE_VAL:
+        case COND_CHANGE_VAL_OVER_THR:
+            switch (input_p->cond) {
+            case COND_CHANGE_VAL:
+                HA_DEBUG("scene::process: COND_CHANGE_VAL\n");
+                break;
+            case COND_CHANGE_VAL_OVER_THR:
+                HA_DEBUG("scene::process: COND_CHANGE_VAL_OVER_THR\n");
                 break;
             }
-        }
 
-        /* process outputs */
-        if (all_cond_satisfied && has_trigger_src) {
-            HA_DEBUG("scene::process: Processing output...\n");
+            if (trigger_by_report &&
+                (device_rpt->get_device_id() == input_p->dev_val.device_id)) {
+                has_trigger_src = true;
 
-            for (c_out = 0; c_out < rules_list[c_rule].num_out; c_out++) {
-                output_t *output_p = &rules_list[c_rule].outputs[c_out];
+                /* compare new value of this device with old value */
+                if (cur_device_mng->get_dev_val(device_rpt->get_device_id(), value) == -1) {
+                    /* Can't find device */
+                    HA_DEBUG("scene::process: can't find dev %lx -> false\n",
+                            device_rpt->get_device_id());
+                    all_cond_satisfied = false;
+                }
+                else {
+                    /* Found device, evaluate new value with old value */
+                    switch (input_p->cond) {
 
-                switch (output_p->action) {
-                case ACT_SET_DEV_VAL:
-                    HA_DEBUG("scene::process: ACT_SET_DEV_VAL, dev %lx, val %hd\n",
-                            output_p->dev_val.device_id, output_p->dev_val.value);
+                    case COND_CHANGE_VAL:
+                        if (device_rpt->get_value() == value) {
+                            all_cond_satisfied = false;
+                        }
+                        break;
 
-                    /* pack gff frame */
-                    act_gff[ha_ns::GFF_LEN_POS] = ha_ns::SET_DEV_VAL_DATA_LEN;
-                    uint162buf(ha_ns::SET_DEV_VAL, &act_gff[ha_ns::GFF_CMD_POS]);
-                    uint322buf(output_p->dev_val.device_id, &act_gff[ha_ns::GFF_DATA_POS]);
-                    uint162buf((uint16_t)output_p->dev_val.value, &act_gff[ha_ns::GFF_DATA_POS + 4]);
+                    case COND_CHANGE_VAL_OVER_THR:
+                        if (abs(device_rpt->get_value() - value) <= input_p->dev_val.value){
+                            /* change was not over threshold */
+                            all_cond_satisfied = false;
+                        }
+                        break;
+                    }
+                }/* end evaluating new and old value */
+            }
+            else { /* the device was not changed */
+                all_cond_satisfied = false;
+            }
 
-                    /* push to out_queue */
-                    out_queue->add_data(act_gff, ha_ns::SET_DEV_VAL_DATA_LEN +
-                            ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
+            HA_DEBUG("scene::process: acs %hd, hts %hd, dev_rpt %lx, val %hd,"
+                    "dev_i %lx, thres %hd\n",
+                    all_cond_satisfied, has_trigger_src,
+                    device_rpt->get_device_id(), value,
+                    input_p->dev_val.device_id, input_p->dev_val.value);
 
-                    /* send GFF pending message */
-                    mesg.type = ha_ns::GFF_PENDING;
-                    mesg.content.ptr = (char *)out_queue;
+            break;
 
-                    msg_send(&mesg, out_pid, false);
+        default:
+            break;
+        }/* end switch input's conditions*/
 
-                    HA_DEBUG("scene::process: Sent SET_DEV_VAL gff message\n");
-                    break;
+        if (!all_cond_satisfied) {
+            /* No need to check anymore */
+            break;
+        }
+    }
+
+    /* process outputs */
+    if (all_cond_satisfied && has_trigger_src) {
+        HA_DEBUG("scene::process: Processing output...\n");
+
+        for (c_out = 0; c_out < rules_list[c_rule].num_out; c_out++) {
+            output_t *output_p = &rules_list[c_rule].outputs[c_out];
 
-                default:
-                    HA_DEBUG("scene::process: unknown action %hu\n", output_p->action);
+            switch (output_p->action) {
+            case ACT_SET_DEV_VAL:
+                HA_DEBUG("scene::process: ACT_SET_DEV_VAL, dev %lx, val %hd\n",
+                        output_p->dev_val.device_id, output_p->dev_val.value);
+
+                /* pack gff frame directly in out_queue */
+                act_gff = out_queue->reserve(ha_ns::SET_DEV_VAL_DATA_LEN +
+                        ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
+                if (act_gff == NULL) {
+                    HA_DEBUG("scene::process: out_queue is full, action dropped\n");
                     break;
                 }
-            }/* end for, all outputs processed */
-        }/* end if for outputs */
+                act_gff[ha_ns::GFF_LEN_POS] = ha_ns::SET_DEV_VAL_DATA_LEN;
+                uint162buf(ha_ns::SET_DEV_VAL, &act_gff[ha_ns::GFF_CMD_POS]);
+                uint322buf(output_p->dev_val.device_id, &act_gff[ha_ns::GFF_DATA_POS]);
+                uint162buf((uint16_t)output_p->dev_val.value, &act_gff[ha_ns::GFF_DATA_POS + 4]);
+
+                /* GFF pending message with handle of the frame, sent with
+                 * the actions of the other rules at the end of process() */
+                out_mesgs[num_out_mesgs].type = ha_ns::GFF_PENDING;
+                out_mesgs[num_out_mesgs].content.value = out_queue->commit();
+                num_out_mesgs++;
+                if (num_out_mesgs == scene_out_batch_size) {
+                    send_out_mesgs(out_mesgs, num_out_mesgs, out_pid);
+                }
+
+                HA_DEBUG("scene::process: Queued SET_DEV_VAL gff message\n");
+                break;
 
-    }/* end for, all rules processed */
+            default:
+                HA_DEBUG("scene::process: unknown action %hu\n", output_p->action);
+                break;
+            }
+        }/* end for, all outputs processed */
+    }/* end if for outputs */
+
+}
+
+/*----------------------------------------------------------------------------*/
+void scene::send_out_mesgs(msg_t *out_mesgs, uint8_t &num_out_mesgs, kernel_pid_t out_pid)
+{
+    /* one context switch for all actions */
+    if (num_out_mesgs > 0) {
+        msg_send_batch(out_mesgs, num_out_mesgs, out_pid, false);
+        num_out_mesgs = 0;
+    }
 }
 
 /*----------------------------------------------------------------------------*/
@@ -706,3 +834,88 @@ void scene::clear_all_rules(void)
         rules_list[count].is_valid = false;
     }
 }
+
+/*----------------------------------------------------------------------------*/
+void scene::build_index(void)
+{
+    uint16_t c_rule, c_in, count, pos, section_start;
+    uint16_t num_rules;
+    uint16_t section_size[3] = {0, 0, 0};
+    uint32_t key;
+    uint8_t rule, section;
+    input_t *input_p;
+
+    num_dev_refs = 0;
+    num_abs_refs = 0;
+    num_day_refs = 0;
+
+    num_rules = (cur_num_rules < scene_max_rules) ? cur_num_rules : scene_max_rules;
+
+    /* count refs in each section */
+    for (c_rule = 0; c_rule < num_rules; c_rule++) {
+        if (!rules_list[c_rule].is_valid || !rules_list[c_rule].is_active) {
+            continue;
+        }
+
+        for (c_in = 0; c_in < rules_list[c_rule].num_in; c_in++) {
+            switch (rules_list[c_rule].inputs[c_in].cond) {
+            case COND_IN_RANGE:
+                num_abs_refs++;
+                break;
+            case COND_IN_RANGE_EVDAY:
+                num_day_refs++;
+                break;
+            default:
+                num_dev_refs++;
+                break;
+            }
+        }
+    }
+
+    /* insert refs to their sections, keeping each section sorted by (key, rule) */
+    for (c_rule = 0; c_rule < num_rules; c_rule++) {
+        if (!rules_list[c_rule].is_valid || !rules_list[c_rule].is_active) {
+            continue;
+        }
+
+        for (c_in = 0; c_in < rules_list[c_rule].num_in; c_in++) {
+            input_p = &rules_list[c_rule].inputs[c_in];
+
+            switch (input_p->cond) {
+            case COND_IN_RANGE:
+                section = 1;
+                section_start = num_dev_refs;
+                key = input_p->time_range.start;
+                break;
+            case COND_IN_RANGE_EVDAY:
+                section = 2;
+                section_start = num_dev_refs + num_abs_refs;
+                key = input_p->time_range.start & 0xFFFF;
+                break;
+            default:
+                section = 0;
+                section_start = 0;
+                key = input_p->dev_val.device_id;
+                break;
+            }
+
+            /* rules are visited in order, so only key has to be compared */
+            rule = (uint8_t)c_rule;
+            pos = section_start + section_size[section];
+            for (count = pos; count > section_start && refs_key[count - 1] > key; count--) {
+                refs_key[count] = refs_key[count - 1];
+                refs_rule[count] = refs_rule[count - 1];
+            }
+            refs_key[count] = key;
+            refs_rule[count] = rule;
+
+            section_size[section]++;
+        }
+    }
+
+    index_valid = true;
+    time_synced = false;
+
+    HA_DEBUG("scene::build_index: dev refs %hu, abs refs %hu, day refs %hu\n",
+            num_dev_refs, num_abs_refs, num_day_refs);
+}
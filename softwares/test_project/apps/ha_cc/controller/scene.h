@@ -22,18 +22,27 @@ extern "C" {
 #include "msg.h"
 }
 
-#include "cir_queue.h"
+#include "gff_queue.h"
 #include "ha_device_mng.h"
 #include "MB1_rtc.h"
 
 namespace scene_ns {
 
-const uint8_t rule_max_input = 2;
-const uint8_t rule_max_output = 2;
+const uint8_t rule_max_input = 4;
+const uint8_t rule_max_output = 4;
 
 const uint8_t scene_max_name_chars = 20;
 const uint8_t scene_max_name_chars_wout_folders = 8 + 1;
-const uint16_t scene_max_rules = 25;
+const uint16_t scene_max_rules = 40; /* <= 255, rule index is held in uint8_t in rules index */
+const uint16_t scene_max_refs = scene_max_rules * rule_max_input;
+
+/* GFF_PENDING messages of all rules evaluated in one process() call are sent together
+ * in batches of this size, message queue of out_pid must hold a batch */
+const uint8_t scene_out_batch_size = 16;
+
+/* scene file snapshot, records are rule_t */
+const uint32_t scene_snapshot_magic = 0x524E4353; /* "SCNR" */
+const uint16_t scene_snapshot_version = 1;
 
 /*-------------------------- CONDITION DEFINITIONS ---------------------------*/
 enum cond_e: uint8_t {
@@ -206,6 +215,11 @@ public:
 
     /**
      * @brief   Process rules and output action to out_queue (in SET_DEV_VAL GFF format).
+     *          Only affected rules will be evaluated:
+     *          - triggered by report, rules having inputs with reported device id.
+     *          - triggered by time, rules having COND_IN_RANGE(_EVDAY) inputs whose
+     *          start time has been crossed since the last time triggered process
+     *          (all rules having time inputs on the first call or after rules changed).
      *
      * @param[in]   trigger_by_report, true if this process action was triggered by report,
      *              otherwise, it was triggered by time.
@@ -215,22 +229,23 @@ public:
      * @param[in]   *rtc_obj, rtc object.
      * @param[out]  *out_queue, output action (SET_DEV_VAL) will be pushed to this queue.
      * @param[in]   out_pid, GFF_PENDING message will be sent to this thread for
-     *              every output action.
+     *              every output action, all of them with one msg_send_batch() (per
+     *              scene_out_batch_size actions) at the end.
      */
     void process(bool trigger_by_report,
             ha_device *a_device_rpt, ha_device_mng *cur_device_mng,
             rtc *rtc_obj,
-            cir_queue *out_queue, kernel_pid_t out_pid);
+            gff_queue *out_queue, kernel_pid_t out_pid);
 
     /**
-     * @brief   Save data to file.
+     * @brief   Save data to file (binary snapshot, see snapshot.h).
      *
      * @return  0 if success, -1 on error.
      */
     int8_t save(void);
 
     /**
-     * @brief   Read data from file.
+     * @brief   Read data from file. Scene file in old text format will be imported.
      *
      * @return  0 if success, -1 on error.
      */
@@ -250,6 +265,47 @@ private:
      */
     void clear_all_rules(void);
 
+    /**
+     * @brief   Import scene file in old text format.
+     *
+     * @return  0 if success, -1 on error.
+     */
+    int8_t restore_text(void);
+
+    /**
+     * @brief   Rebuild rules index from rules_list: sorted device ids of rules' inputs,
+     *          sorted start times of COND_IN_RANGE and COND_IN_RANGE_EVDAY inputs.
+     */
+    void build_index(void);
+
+    /**
+     * @brief   Evaluate a rule, parameters are the same as process().
+     *
+     * @param[in]   c_rule, index of rule in rules_list.
+     * @param[in/out]   out_mesgs, num_out_mesgs, GFF_PENDING messages not sent yet.
+     */
+    void process_rule(uint16_t c_rule, bool trigger_by_report,
+            ha_device *device_rpt, ha_device_mng *cur_device_mng,
+            rtc *rtc_obj,
+            gff_queue *out_queue, kernel_pid_t out_pid,
+            msg_t *out_mesgs, uint8_t &num_out_mesgs);
+
+    /**
+     * @brief   Evaluate rules in a range of rules index with key in [key_from, key_to].
+     *          Each rule will be evaluated only once (marked in rules_marks).
+     */
+    void process_refs(uint16_t refs_start, uint16_t refs_end,
+            uint32_t key_from, uint32_t key_to, uint8_t *rules_marks,
+            bool trigger_by_report, ha_device *device_rpt, ha_device_mng *cur_device_mng,
+            rtc *rtc_obj,
+            gff_queue *out_queue, kernel_pid_t out_pid,
+            msg_t *out_mesgs, uint8_t &num_out_mesgs);
+
+    /**
+     * @brief   Send GFF_PENDING messages collected by process_rule() with one context switch.
+     */
+    void send_out_mesgs(msg_t *out_mesgs, uint8_t &num_out_mesgs, kernel_pid_t out_pid);
+
     /* @brief   Print input.
      *
      * @param[in]   input, an input to be printed.
@@ -269,6 +325,21 @@ private:
     rule_t rules_list[scene_max_rules];
 
     uint16_t last_invalid_index;
+
+    /* Rules index, sorted by key then rule index in 3 sections:
+     * [0, num_dev_refs): device id of inputs,
+     * [num_dev_refs, + num_abs_refs): start time of COND_IN_RANGE,
+     * [num_dev_refs + num_abs_refs, + num_day_refs): start time (& 0xFFFF) of COND_IN_RANGE_EVDAY */
+    bool index_valid;
+    uint16_t num_dev_refs;
+    uint16_t num_abs_refs;
+    uint16_t num_day_refs;
+    uint32_t refs_key[scene_max_refs];
+    uint8_t refs_rule[scene_max_refs];
+
+    /* packed time of the last time triggered process */
+    bool time_synced;
+    uint32_t last_time;
 };
 
 #endif // SCENE_H_
@@ -53,7 +53,7 @@ using namespace scene_mng_ns;
 
 /*----------------------------------------------------------------------------*/
 scene_mng::scene_mng(ha_device_mng *cur_device_mng_p, rtc *rtc_obj_p,
-            kernel_pid_t *out_pid_p, cir_queue *out_cir_queue_p)
+            kernel_pid_t *out_pid_p, gff_queue *out_cir_queue_p)
 {
     device_mng_p = cur_device_mng_p;
     rtc_p = rtc_obj_p;
@@ -23,7 +23,7 @@ extern "C" {
 }
 
 #include "scene.h"
-#include "cir_queue.h"
+#include "gff_queue.h"
 #include "ha_device_mng.h"
 
 namespace scene_mng_ns {
@@ -50,17 +50,17 @@ public:
      * @param[in]   cur_device_mng_p, pointer to a device manager object.
      * @param[in]   rtc_obj_p, pointer to a rtc object.
      * @param[in]   out_pid_p, pointer to pid of thread will be sent messages to.
-     * @param[in]   out_cir_queue_p, pointer to cir_queue will be pushed actions into.
+     * @param[in]   out_cir_queue_p, pointer to gff_queue will be pushed actions into.
      */
     scene_mng(ha_device_mng *cur_device_mng_p, rtc *rtc_obj_p,
-            kernel_pid_t *out_pid_p, cir_queue *out_cir_queue_p);
+            kernel_pid_t *out_pid_p, gff_queue *out_cir_queue_p);
 
     /**
      * @brief   Process default scenes and user's scene.
      *
      * @param[in]   trigger_by_rpt, true if this has been triggered by report.
      *              false if this has been triggered by time.
-     * @param[in]   &out_cir_queue, cir_queue will be pushed actions into.
+     * @param[in]   &out_cir_queue, gff_queue will be pushed actions into.
      */
     void process(bool trigger_by_rpt, ha_device *a_device_rpt);
 
@@ -235,7 +235,7 @@ private:
     ha_device_mng *device_mng_p;
     rtc *rtc_p;
     kernel_pid_t *out_pid_p;
-    cir_queue *out_queue_p;
+    gff_queue *out_queue_p;
     scenes_list_obj_t scenes_list[max_num_scenes];
 };
 
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        snapshot.cpp
+ * @brief       Binary snapshot files (header + packed records, CRC32 protected).
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#include <string.h>
+
+#include "snapshot.h"
+#include "MB1_System.h"
+#include "ff.h"
+#include "shell_cmds_fatfs.h"
+
+#define HA_NOTIFICATION (1)
+#define HA_DEBUG_EN (0)
+#include "ha_debug.h"
+
+using namespace snapshot_ns;
+
+static const char tmp_extension[] = ".tmp";
+
+/**
+ * @brief   Get temporary file name (file name with extension replaced by .tmp).
+ *
+ * @return  0 if success, -1 if file name is too long.
+ */
+static int8_t get_tmp_filename(const char *filename, char *tmp_filename);
+
+/*----------------------------------------------------------------------------*/
+int8_t snapshot_save(const char *filename, uint32_t magic, uint16_t version,
+        void *records, uint16_t record_size, uint16_t num_records)
+{
+    FIL file;
+    FRESULT fres;
+    UINT bw;
+    header_t header;
+    uint32_t data_size;
+    char tmp_filename[max_filename_chars];
+
+    data_size = (uint32_t)record_size * num_records;
+    if (data_size > 0xFFFF || get_tmp_filename(filename, tmp_filename) != 0) {
+        return SNAPSHOT_ERR;
+    }
+
+    header.magic = magic;
+    header.version = version;
+    header.record_size = record_size;
+    header.num_records = num_records;
+    header.reserved = 0;
+    MB1_crc.crc_start();
+    header.crc = MB1_crc.crc32_block_cal((uint8_t *)records, (uint16_t)data_size);
+
+    /* write to temporary file */
+    fres = f_open(&file, tmp_filename, FA_WRITE | FA_CREATE_ALWAYS);
+    if (fres != FR_OK) {
+        HA_DEBUG("snapshot_save: Error when open file %s\n", tmp_filename);
+        print_ferr(fres);
+        return SNAPSHOT_ERR;
+    }
+
+    fres = f_write(&file, &header, sizeof(header_t), &bw);
+    if (fres == FR_OK && bw == sizeof(header_t)) {
+        fres = f_write(&file, records, data_size, &bw);
+    }
+    if (fres != FR_OK || bw != data_size) {
+        HA_DEBUG("snapshot_save: Error when write file %s\n", tmp_filename);
+        f_close(&file);
+        f_unlink(tmp_filename);
+        return SNAPSHOT_ERR;
+    }
+
+    fres = f_close(&file);
+    if (fres != FR_OK) {
+        HA_DEBUG("snapshot_save: Error when close file %s\n", tmp_filename);
+        print_ferr(fres);
+        return SNAPSHOT_ERR;
+    }
+
+    /* replace old file, f_rename won't overwrite an existing file */
+    fres = f_unlink(filename);
+    if (fres != FR_OK && fres != FR_NO_FILE) {
+        HA_DEBUG("snapshot_save: Error when remove file %s\n", filename);
+        print_ferr(fres);
+        return SNAPSHOT_ERR;
+    }
+
+    fres = f_rename(tmp_filename, filename);
+    if (fres != FR_OK) {
+        HA_DEBUG("snapshot_save: Error when rename %s to %s\n", tmp_filename, filename);
+        print_ferr(fres);
+        return SNAPSHOT_ERR;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int32_t snapshot_restore(const char *filename, uint32_t magic, uint16_t version,
+        void *records, uint16_t record_size, uint16_t max_records)
+{
+    FIL file;
+    FRESULT fres;
+    UINT br;
+    header_t header;
+    uint32_t data_size;
+    char tmp_filename[max_filename_chars];
+
+    if (get_tmp_filename(filename, tmp_filename) != 0) {
+        return SNAPSHOT_ERR;
+    }
+
+    fres = f_open(&file, filename, FA_READ | FA_OPEN_EXISTING);
+    if (fres == FR_NO_FILE) {
+        /* save was interrupted after removing old file */
+        fres = f_open(&file, tmp_filename, FA_READ | FA_OPEN_EXISTING);
+        if (fres == FR_NO_FILE) {
+            return SNAPSHOT_NOT_FOUND;
+        }
+    }
+    if (fres != FR_OK) {
+        HA_DEBUG("snapshot_restore: Error when open file %s\n", filename);
+        print_ferr(fres);
+        return SNAPSHOT_ERR;
+    }
+
+    /* check header */
+    fres = f_read(&file, &header, sizeof(header_t), &br);
+    if (fres != FR_OK) {
+        f_close(&file);
+        return SNAPSHOT_ERR;
+    }
+
+    if (br != sizeof(header_t) || header.magic != magic) {
+        HA_DEBUG("snapshot_restore: %s is not a snapshot\n", filename);
+        f_close(&file);
+        return SNAPSHOT_LEGACY;
+    }
+
+    if (header.version != version || header.record_size != record_size
+            || header.num_records > max_records) {
+        HA_DEBUG("snapshot_restore: %s, unsupported version %hu, record size %hu, "
+                "num of records %hu\n",
+                filename, header.version, header.record_size, header.num_records);
+        f_close(&file);
+        return SNAPSHOT_ERR;
+    }
+
+    /* read all records */
+    data_size = (uint32_t)record_size * header.num_records;
+    fres = f_read(&file, records, data_size, &br);
+    f_close(&file);
+    if (fres != FR_OK || br != data_size) {
+        HA_DEBUG("snapshot_restore: Error when read file %s\n", filename);
+        return SNAPSHOT_ERR;
+    }
+
+    MB1_crc.crc_start();
+    if (!MB1_crc.crc_check((uint8_t *)records, (uint16_t)data_size, header.crc)) {
+        HA_NOTIFY("snapshot_restore: %s, CRC mismatched\n", filename);
+        return SNAPSHOT_ERR;
+    }
+
+    return header.num_records;
+}
+
+/*----------------------------------------------------------------------------*/
+static int8_t get_tmp_filename(const char *filename, char *tmp_filename)
+{
+    size_t len;
+    const char *slash_p, *dot_p;
+
+    len = strlen(filename);
+    if (len + sizeof(tmp_extension) > max_filename_chars) {
+        return -1;
+    }
+
+    memcpy(tmp_filename, filename, len + 1);
+
+    /* replace extension (if any) of the last path component */
+    slash_p = strrchr(filename, '/');
+    dot_p = strrchr(filename, '.');
+    if (dot_p != NULL && (slash_p == NULL || dot_p > slash_p)) {
+        len = dot_p - filename;
+    }
+
+    memcpy(&tmp_filename[len], tmp_extension, sizeof(tmp_extension));
+
+    return 0;
+}
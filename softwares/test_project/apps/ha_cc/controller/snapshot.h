@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        snapshot.h
+ * @brief       Binary snapshot files (header + packed records, CRC32 protected).
+ *
+ * File format:
+ * | magic (4) | version (2) | record size (2) | num of records (2) | reserved (2) | crc32 (4) |
+ * | record 0 | record 1 | ... |
+ * CRC32 is calculated over all records by hardware CRC unit.
+ *
+ * Snapshot is written to a temporary file (same name with .tmp extension), then
+ * the old file is replaced by the temporary file.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <stdint.h>
+
+namespace snapshot_ns {
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint16_t num_records;
+    uint16_t reserved;
+    uint32_t crc;
+} header_t;
+
+enum errcode_e: int8_t {
+    SNAPSHOT_ERR = -1,          /* IO error or corrupted snapshot */
+    SNAPSHOT_NOT_FOUND = -2,    /* neither file nor temporary file exists */
+    SNAPSHOT_LEGACY = -3,       /* file exists but it is not a snapshot (old text format) */
+};
+
+const uint8_t max_filename_chars = 32;
+
+}
+
+/**
+ * @brief   Save records to snapshot file.
+ *
+ * @param[in]   filename, snapshot file name.
+ * @param[in]   magic, magic number of this kind of snapshot.
+ * @param[in]   version, version of record's format.
+ * @param[in]   records, pointer to records buffer.
+ * @param[in]   record_size, size of a record in bytes.
+ * @param[in]   num_records, number of records in records buffer.
+ *
+ * @return      0 if success, SNAPSHOT_ERR on error.
+ */
+int8_t snapshot_save(const char *filename, uint32_t magic, uint16_t version,
+        void *records, uint16_t record_size, uint16_t num_records);
+
+/**
+ * @brief   Restore records from snapshot file with a single read. If the file doesn't
+ *          exist, the temporary file (left by an interrupted save) will be used.
+ *
+ * @param[in]   filename, snapshot file name.
+ * @param[in]   magic, magic number of this kind of snapshot.
+ * @param[in]   version, version of record's format.
+ * @param[out]  records, pointer to records buffer.
+ * @param[in]   record_size, size of a record in bytes.
+ * @param[in]   max_records, max number of records in records buffer.
+ *
+ * @return      number of records restored,
+ *              or SNAPSHOT_ERR, SNAPSHOT_NOT_FOUND, SNAPSHOT_LEGACY.
+ */
+int32_t snapshot_restore(const char *filename, uint32_t magic, uint16_t version,
+        void *records, uint16_t record_size, uint16_t max_records);
+
+#endif // SNAPSHOT_H_
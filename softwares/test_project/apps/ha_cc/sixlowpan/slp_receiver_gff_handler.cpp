@@ -25,14 +25,18 @@ void slp_received_GFF_handler(uint8_t *GFF_buffer)
 {
     HA_DEBUG("slp_received_GFF_handler, forward to controller\n");
 
-    /* Push data to queue */
-    controller_ns::slp_to_controller_queue.add_data(
-            GFF_buffer,
-            ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE + GFF_buffer[ha_ns::GFF_LEN_POS]);
-    /* send message to controller */
+    /* Push frame to queue, drop the frame if the controller can't keep up */
+    int32_t handle = controller_ns::slp_to_controller_queue.add_frame(GFF_buffer);
+    if (handle == gff_queue_ns::invalid_handle) {
+        HA_NOTIFY("slp_received_GFF_handler: controller queue is full, frame dropped (%lu)\n",
+                controller_ns::slp_to_controller_queue.get_drops());
+        return;
+    }
+
+    /* send handle of the frame to controller */
     msg_t mesg;
     mesg.type = ha_cc_ns::SLP_GFF_PENDING;
-    mesg.content.ptr = (char *) &controller_ns::slp_to_controller_queue;
+    mesg.content.value = (uint32_t) handle;
 
     msg_send(&mesg, controller_ns::controller_pid, false);
 
@@ -0,0 +1,354 @@
+/**
+ * @file ep_config_cache.cpp
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @date 17-Oct-2026
+ * @brief Binary cache of end point configurations, records and text file parsing.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "ep_config_cache.h"
+#include "ha_device_handler.h"
+#include "ha_gff_misc.h"
+#include "device_id.h"
+#include "crc32_sw.h"
+#include "ff.h"
+
+#define HA_NOTIFICATION (1)
+#define HA_DEBUG_EN (0)
+#include "ha_debug.h"
+
+using namespace ep_config_ns;
+
+static const uint32_t record_crc_size = offsetof(record_t, crc);
+
+/**
+ * @brief Read record of an end point from ep_config_file_name and check it.
+ *
+ * @param[in] dev_id Device ID.
+ * @param[out] record Record read.
+ *
+ * @return true if the record has a good CRC and belongs to dev_id, otherwise false.
+ */
+static bool record_read(uint32_t dev_id, record_t *record);
+
+/**
+ * @brief Compute CRC of a record and write it to ep_config_file_name.
+ *
+ * @param[in] ep_id End point ID.
+ * @param[in] record Record to write, record->crc is set.
+ *
+ * @return true if success, otherwise false.
+ */
+static bool record_write(uint8_t ep_id, record_t *record);
+
+/**
+ * @brief Parse text config file of a device into a record (without stamp and CRC).
+ *
+ * @param[in] dev_id Device ID.
+ * @param[out] record Parsed record.
+ *
+ * @return true if success, otherwise false.
+ */
+static bool text_parse(uint32_t dev_id, record_t *record);
+
+/**
+ * @brief Parse equation lines of an ADC sensor text file (after the header).
+ *
+ * @param[in] fil Opened text file.
+ * @param[out] sensor Record to fill, num_equation and num_params are set.
+ *
+ * @return true if success, otherwise false.
+ */
+static bool sensor_equations_parse(FIL *fil, sensor_record_t *sensor);
+
+/*---------------------Implementation-----------------------*/
+
+uint8_t ep_config_kind(uint32_t dev_id)
+{
+    switch (((uint8_t) dev_id) & 0xF8) {
+    case ha_ns::ADC_SENSOR:
+        return sensor_config;
+    case ha_ns::EVT_SENSOR:
+    case ha_ns::ON_OFF_OPUT:
+        return gpio_config;
+    default:
+        break;
+    }
+
+    switch (parse_devtype_deviceid(dev_id)) {
+    case ha_ns::SWITCH:
+    case ha_ns::BUTTON:
+        return gpio_config;
+    case ha_ns::DIMMER:
+        return adc_config;
+    case ha_ns::LEVEL_BULB:
+    case ha_ns::SERVO_SG90:
+        return pwm_config;
+    case ha_ns::RGB_LED:
+        return rgb_config;
+    default:
+        break;
+    }
+
+    return no_config;
+}
+
+bool ep_config_load(uint32_t dev_id, record_t *record)
+{
+    char f_name[4];
+    FILINFO finfo;
+
+    if (ep_config_kind(dev_id) == no_config
+            || parse_ep_deviceid(dev_id) >= ha_host_ns::max_end_point) {
+        return false;
+    }
+
+    get_file_name_from_dev_id(dev_id, f_name);
+    if (f_stat(f_name, &finfo) != FR_OK) {
+        HA_DEBUG("Error on getting status of config file\n");
+        return false;
+    }
+
+    if (record_read(dev_id, record) && record->text_size == finfo.fsize
+            && record->text_date == finfo.fdate
+            && record->text_time == finfo.ftime) {
+        return true;
+    }
+
+    /* no record yet or text file changed */
+    HA_NOTIFY("-EP%d: parsing config file.\n", parse_ep_deviceid(dev_id));
+    if (!text_parse(dev_id, record)) {
+        return false;
+    }
+    record->text_size = finfo.fsize;
+    record->text_date = finfo.fdate;
+    record->text_time = finfo.ftime;
+
+    /* text file is still used if the record can't be written */
+    record_write(parse_ep_deviceid(dev_id), record);
+
+    return true;
+}
+
+bool ep_config_rebuild(uint32_t dev_id)
+{
+    char f_name[4];
+    FILINFO finfo;
+    record_t record;
+    uint8_t ep_id = parse_ep_deviceid(dev_id);
+
+    if (ep_id >= ha_host_ns::max_end_point) {
+        return false;
+    }
+
+    if (ep_config_kind(dev_id) == no_config) {
+        /* belongs to no device */
+        memset(&record, 0, sizeof(record));
+        return record_write(ep_id, &record);
+    }
+
+    get_file_name_from_dev_id(dev_id, f_name);
+    if (f_stat(f_name, &finfo) != FR_OK) {
+        HA_DEBUG("Error on getting status of config file\n");
+        return false;
+    }
+    if (!text_parse(dev_id, &record)) {
+        return false;
+    }
+    record.text_size = finfo.fsize;
+    record.text_date = finfo.fdate;
+    record.text_time = finfo.ftime;
+
+    return record_write(ep_id, &record);
+}
+
+static bool record_read(uint32_t dev_id, record_t *record)
+{
+    FIL fil;
+    UINT byte_read;
+
+    if (f_open(&fil, ep_config_file_name, FA_READ)) {
+        HA_DEBUG("Error on opening config record file\n");
+        return false;
+    }
+    if (f_lseek(&fil, parse_ep_deviceid(dev_id) * sizeof(record_t))
+            || f_read(&fil, record, sizeof(record_t), &byte_read)
+            || byte_read != sizeof(record_t)) {
+        f_close(&fil);
+        HA_DEBUG("Error on reading config record\n");
+        return false;
+    }
+    f_close(&fil);
+
+    if (record->crc != crc32_sw::block_cal((uint8_t *) record, record_crc_size)) {
+        HA_DEBUG("Config record CRC error\n");
+        return false;
+    }
+
+    return record->dev_id == dev_id && record->kind == ep_config_kind(dev_id);
+}
+
+static bool record_write(uint8_t ep_id, record_t *record)
+{
+    FIL fil;
+    UINT byte_written;
+
+    record->crc = crc32_sw::block_cal((uint8_t *) record, record_crc_size);
+
+    /* records of other end points are kept, the file grows up to the written one */
+    if (f_open(&fil, ep_config_file_name, FA_WRITE | FA_OPEN_ALWAYS)) {
+        HA_DEBUG("Error on opening config record file\n");
+        return false;
+    }
+    if (f_lseek(&fil, ep_id * sizeof(record_t))
+            || f_write(&fil, record, sizeof(record_t), &byte_written)
+            || byte_written != sizeof(record_t)) {
+        f_close(&fil);
+        HA_DEBUG("Error on writing config record\n");
+        return false;
+    }
+    f_close(&fil);
+
+    return true;
+}
+
+static bool text_parse(uint32_t dev_id, record_t *record)
+{
+    char f_name[4];
+    FIL fil;
+    UINT byte_read;
+    uint8_t kind = ep_config_kind(dev_id);
+
+    char config_str[ha_host_ns::dev_pattern_maxsize];
+    char port_c[3] = { '0', '0', '0' };
+    uint16_t pin[3] = { 0, 0, 0 };
+    uint16_t unit[3] = { 0, 0, 0 };
+    uint16_t chann[3] = { 0, 0, 0 };
+    uint16_t at_wp[3] = { 0, 0, 0 };
+    char mode_c = '0';
+    int thres[3] = { 0, 0, 0 };
+    uint16_t num_equation = 0;
+    uint16_t num_params = 0;
+
+    /* padding bytes are covered by CRC */
+    memset(record, 0, sizeof(record_t));
+    record->dev_id = dev_id;
+    record->kind = kind;
+
+    get_file_name_from_dev_id(dev_id, f_name);
+    if (f_open(&fil, f_name, FA_READ)) {
+        HA_DEBUG("Error on opening config file\n");
+        return false;
+    }
+
+    if (kind == sensor_config) {
+        /* header lines, equation lines follow */
+        config_str[0] = '\0';
+        for (uint8_t line = 0, len = 0; line < 3; line++) {
+            if (!f_gets(&config_str[len], sizeof(config_str) - len, &fil)) {
+                break;
+            }
+            len = strlen(config_str);
+        }
+    } else {
+        if (f_read(&fil, config_str, sizeof(config_str) - 1, &byte_read)) {
+            f_close(&fil);
+            HA_DEBUG("Error on reading config file\n");
+            return false;
+        }
+        config_str[byte_read] = '\0';
+    }
+
+    switch (kind) {
+    case gpio_config:
+        sscanf(config_str, ha_host_ns::gpio_dev_config_pattern, &port_c[0],
+                &pin[0], &mode_c);
+        record->gpio.port = port_c[0];
+        record->gpio.pin = pin[0];
+        record->gpio.mode = mode_c;
+        break;
+    case adc_config:
+        sscanf(config_str, ha_host_ns::adc_dev_config_pattern, &port_c[0],
+                &pin[0], &unit[0], &chann[0]);
+        break;
+    case pwm_config:
+        sscanf(config_str, ha_host_ns::pwm_dev_config_pattern, &port_c[0],
+                &pin[0], &unit[0], &chann[0]);
+        break;
+    case rgb_config:
+        sscanf(config_str, ha_host_ns::rgb_config_pattern, &port_c[0], &pin[0],
+                &unit[0], &chann[0], &port_c[1], &pin[1], &unit[1], &chann[1],
+                &port_c[2], &pin[2], &unit[2], &chann[2], &at_wp[0], &at_wp[1],
+                &at_wp[2]);
+        for (uint8_t i = 0; i < 3; i++) {
+            record->rgb.led[i].port = port_c[i];
+            record->rgb.led[i].pin = pin[i];
+            record->rgb.led[i].unit = unit[i];
+            record->rgb.led[i].channel = chann[i];
+            record->rgb.at_wp[i] = at_wp[i];
+        }
+        break;
+    case sensor_config:
+        sscanf(config_str, ha_host_ns::adc_sensor_config_pattern, &port_c[0],
+                &pin[0], &unit[0], &chann[0], &thres[0], &thres[1], &thres[2],
+                &num_equation, &num_params);
+        if (num_equation > equa_type_max || num_params > equa_params_max) {
+            f_close(&fil);
+            HA_NOTIFY("-EP%d: too many equations or parameters.\n",
+                    parse_ep_deviceid(dev_id));
+            return false;
+        }
+        record->sensor.filter_thres = thres[0];
+        record->sensor.under_thres = thres[1];
+        record->sensor.over_thres = thres[2];
+        record->sensor.num_equation = num_equation;
+        record->sensor.num_params = num_params;
+        if (!sensor_equations_parse(&fil, &record->sensor)) {
+            f_close(&fil);
+            return false;
+        }
+        break;
+    default:
+        break;
+    }
+    f_close(&fil);
+
+    if (kind == adc_config || kind == pwm_config || kind == sensor_config) {
+        io_record_t *io = (kind == pwm_config) ? &record->pwm :
+                          (kind == adc_config) ? &record->adc : &record->sensor.adc;
+        io->port = port_c[0];
+        io->pin = pin[0];
+        io->unit = unit[0];
+        io->channel = chann[0];
+    }
+
+    return true;
+}
+
+static bool sensor_equations_parse(FIL *fil, sensor_record_t *sensor)
+{
+    char config_str[ha_host_ns::dev_pattern_maxsize];
+    uint8_t index;
+
+    for (index = 0; index < sensor->num_equation; index++) {
+        if (!f_gets(config_str, sizeof(config_str), fil)) {
+            HA_DEBUG("Missing equation type in config file\n");
+            return false;
+        }
+        sensor->equa_type[index] = config_str[0];
+    }
+
+    for (index = 0; index < sensor->num_params; index++) {
+        if (!f_gets(config_str, sizeof(config_str), fil)) {
+            HA_DEBUG("Missing equation parameter in config file\n");
+            return false;
+        }
+        sensor->equa_params[index] = strtof(config_str, NULL);
+    }
+
+    return true;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file ep_config_cache.h
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @date 17-Oct-2026
+ * @brief Binary cache of end point configurations.
+ *
+ *        The text config file of an end point (file "ep_id", written by the device
+ *        config shell commands) is parsed once into a fixed size record, saved in
+ *        ep_config_file_name at offset ep_id * sizeof(record_t). An end point thread
+ *        then loads its configuration with one f_read, without sscanf/strtof.
+ *
+ *        A record is used only if its CRC32 is good, its dev_id is the requested one and
+ *        size, date and time of the text file (f_stat) are the ones it was parsed from.
+ *        Otherwise the text file is parsed and the record is rewritten, so records are
+ *        built at the first start of each end point and after a text file is changed.
+ *        The shell commands rewrite the record with the text file, see ep_config_rebuild().
+ */
+#ifndef __EP_CONFIG_CACHE_H_
+#define __EP_CONFIG_CACHE_H_
+
+#include <stdint.h>
+
+namespace ep_config_ns {
+const char ep_config_file_name[] = "ep_cfg";
+
+/* limits of senadc -t and -P */
+const uint8_t equa_type_max = 8;
+const uint8_t equa_params_max = 32;
+
+typedef enum {
+    no_config = 0,
+    gpio_config = 1,
+    adc_config = 2,
+    pwm_config = 3,
+    rgb_config = 4,
+    sensor_config = 5
+} config_kind_t;
+
+/* values as in text files, port 'A'..'G' */
+typedef struct {
+    char port;
+    uint8_t pin;
+    char mode;
+} gpio_record_t;
+
+typedef struct {
+    char port;
+    uint8_t pin;
+    uint8_t unit;               // ADC number (1..3) or timer number
+    uint8_t channel;
+} io_record_t;
+
+typedef struct {
+    io_record_t led[3];         // red, green, blue
+    uint16_t at_wp[3];          // red, green, blue at white point
+} rgb_record_t;
+
+typedef struct {
+    io_record_t adc;
+    int32_t filter_thres;
+    int32_t under_thres;
+    int32_t over_thres;
+    uint8_t num_equation;
+    uint8_t num_params;
+    char equa_type[equa_type_max];
+    float equa_params[equa_params_max];
+} sensor_record_t;
+
+typedef struct {
+    uint32_t dev_id;
+    uint32_t text_size;         // f_stat of the text file the record was parsed from
+    uint16_t text_date;
+    uint16_t text_time;
+    uint8_t kind;               // config_kind_t
+    union {
+        gpio_record_t gpio;
+        io_record_t adc;
+        io_record_t pwm;
+        rgb_record_t rgb;
+        sensor_record_t sensor;
+    };
+    uint32_t crc;               // CRC32 of all bytes above
+} record_t;
+}
+
+/**
+ * @brief Get the configuration kind of a device.
+ *
+ * @param[in] dev_id Device ID.
+ *
+ * @return config_kind_t of the device, no_config if it has no config file.
+ */
+uint8_t ep_config_kind(uint32_t dev_id);
+
+/**
+ * @brief Load configuration of a device, from its record if it's valid, otherwise from
+ * its text file (and the record is rewritten).
+ *
+ * @param[in] dev_id Device ID.
+ * @param[out] record Configuration, record->kind is ep_config_kind(dev_id).
+ *
+ * @return true if success, otherwise false.
+ */
+bool ep_config_load(uint32_t dev_id, ep_config_ns::record_t *record);
+
+/**
+ * @brief Parse text file of a device and rewrite its record. Called after the text file
+ * or the device list is changed. A device without configuration clears its record.
+ *
+ * @param[in] dev_id Device ID.
+ *
+ * @return true if success, otherwise false.
+ */
+bool ep_config_rebuild(uint32_t dev_id);
+
+#endif //__EP_CONFIG_CACHE_H_
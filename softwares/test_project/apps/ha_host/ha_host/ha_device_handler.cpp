@@ -10,9 +10,11 @@
 
 extern "C" {
 #include "msg.h"
+#include "mutex.h"
 }
 
 #include "ha_device_handler.h"
+#include "ep_config_cache.h"
 #include "ha_device_status.h"
 #include "ha_sixlowpan.h"
 #include "ha_gff_misc.h"
@@ -26,19 +28,11 @@ extern "C" {
 
 static const uint8_t queue_handler_size = 16;
 
-/* common functions */
-/**
- * @brief Read configuration from EP-file into a string.
- *
- * @param[in] dev_id Device ID used to open config file.
- * @param[out] config_str The pointer to string that contains device configuration.
- * @param[in] str_len Size of config_str.
- *
- * @return true if success, otherwise false.
- */
-static bool read_config_file(uint32_t dev_id, char *config_str,
-        uint8_t str_len);
+/* sixlowpan_sender_gff_queue is a single producer queue, but all end point threads
+ * forward frames to it */
+static mutex_t slp_sender_queue_mutex = MUTEX_INIT;
 
+/* common functions */
 /**
  * @brief return a port_t from port_c parsed from file.
  *
@@ -86,34 +80,10 @@ static bool check_dev_type_value(uint32_t msg_value, uint8_t dev_type);
 static void forward_data_msg_to_6lowpan(uint16_t cmd, uint32_t dev_id,
         uint16_t value);
 
-/* functions for ADC_sensors */
-/**
- * @brief Read configuration for ADC sensor device.
- *
- * @param[in] dev_id Device ID.
- * @param[out] adc_ss The pointer to instance of an ADC-sensor device.
- * @param[out] num_equation Number of equation types.
- * @param[out] num_params Number of equation parameters.
- *
- * @return true if success, other false.
- */
-static bool sensor_read_config(uint32_t dev_id, adc_sensor_instance* adc_ss,
-        uint16_t *num_equation, uint16_t *num_params);
-
 /**
- * @brief Read equation type and parameter from file.
- *
- * @param[in] dev_id Device ID.
- * @param[out] equa_type_buff The given buffer to save equation types.
- * @param[in] e_type_buff_len The size of equa_type_buff.
- * @param[out] equa_params_buff The given buffer to save equation parameters.
- * @param[in] e_params_buff_len The size of equa_params_buff.
- *
- * @return true if success, other false.
+ * @brief Send one NODE_ALIVE frame for all running devices of this node to 6loWPAN thread.
  */
-static bool sensor_read_equa_type_and_params(uint32_t dev_id,
-        char* equa_type_buff, uint8_t e_type_buff_len, float* equa_params_buff,
-        uint8_t e_params_buff_len);
+static void send_node_alive(void);
 
 /*---------------------Implementation-----------------------*/
 
@@ -125,9 +95,17 @@ void* end_point_handler(void* arg)
     msg_init_queue(msg_q, queue_handler_size);
 
     msg_t msg;
+    uint8_t ep_id;
     while (1) {
         msg_receive(&msg);
         if (msg.type == ha_host_ns::NEW_DEVICE) {
+            /* device is running until its handler returns */
+            ep_id = parse_ep_deviceid(msg.content.value);
+            if (ep_id < ha_host_ns::max_end_point
+                    && parse_devtype_deviceid(msg.content.value) != ha_ns::NO_DEVICE) {
+                ha_host_ns::end_point_dev_id[ep_id] = msg.content.value;
+            }
+
             switch (get_dev_common_subtype(msg.content.value)) {
             case ha_ns::ADC_SENSOR:
                 adc_sensor_handler(msg.content.value);
@@ -167,6 +145,10 @@ void* end_point_handler(void* arg)
             default:
                 break;
             }
+
+            if (ep_id < ha_host_ns::max_end_point) {
+                ha_host_ns::end_point_dev_id[ep_id] = 0;
+            }
         }
     }
 
@@ -206,7 +188,7 @@ void button_handler(uint32_t dev_id)
             }
             break;
         case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
+            send_node_alive();
             break;
         case ha_host_ns::NEW_DEVICE:
             msg_send_to_self(&msg);
@@ -248,7 +230,7 @@ void switch_handler(uint32_t dev_id)
             }
             break;
         case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
+            send_node_alive();
             break;
         case ha_host_ns::NEW_DEVICE:
             msg_send_to_self(&msg);
@@ -306,7 +288,7 @@ void on_off_output_handler(uint32_t dev_id)
             }
             break;
         case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
+            send_node_alive();
             break;
         case ha_host_ns::NEW_DEVICE:
             on_off_dev.dev_turn_off();
@@ -340,7 +322,7 @@ void dimmer_handler(uint32_t dev_id)
                     (uint16_t) msg.content.value);
             break;
         case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
+            send_node_alive();
             break;
         case ha_host_ns::NEW_DEVICE:
             msg_send_to_self(&msg);
@@ -393,7 +375,7 @@ void level_bulb_handler(uint32_t dev_id)
             }
             break;
         case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
+            send_node_alive();
             break;
         case ha_host_ns::NEW_DEVICE:
             level_bulb.set_level_intensity(0); //turn off before removing device
@@ -436,7 +418,7 @@ void servo_sg90_handler(uint32_t dev_id)
                     (uint16_t) sg90.get_angle());
             break;
         case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
+            send_node_alive();
             break;
         case ha_host_ns::NEW_DEVICE:
             sg90.stop();
@@ -450,21 +432,31 @@ void servo_sg90_handler(uint32_t dev_id)
 
 void adc_sensor_handler(uint32_t dev_id)
 {
-    /* create and configure linear sensor instance */
-    adc_sensor_instance adc_sensor;
-    uint16_t num_equation = 0;
-    uint16_t num_params = 0;
-    if (!sensor_read_config(dev_id, &adc_sensor, &num_equation, &num_params)) {
+    /* get sensor configuration, equation buffers are used while sensor runs */
+    ep_config_ns::record_t config;
+    if (!ep_config_load(dev_id, &config)
+            || config.kind != ep_config_ns::sensor_config) {
         return;
     }
 
-    char e_type[num_equation];
-    float params[num_params];
-    sensor_read_equa_type_and_params(dev_id, e_type, num_equation, params,
-            num_params);
+    adc_config_params_t adc_params;
+    adc_params.device_port = get_port(config.sensor.adc.port);
+    adc_params.device_pin = config.sensor.adc.pin;
+    adc_params.adc_x = (adc_t) (config.sensor.adc.unit - 1);
+    adc_params.adc_channel = config.sensor.adc.channel;
+
+    /* create and configure linear sensor instance */
+    adc_sensor_instance adc_sensor;
+    adc_sensor.set_delta_threshold(config.sensor.filter_thres);
+    adc_sensor.set_underflow_threshold(config.sensor.under_thres);
+    adc_sensor.set_overflow_threshold(config.sensor.over_thres);
+    adc_sensor.device_configure(&adc_params);
 
-    adc_sensor.set_equation_type(e_type, num_equation);
-    adc_sensor.set_equation_params(params, num_params);
+    adc_sensor.set_equation_type(config.sensor.equa_type,
+            config.sensor.num_equation);
+    adc_sensor.set_equation_params(config.sensor.equa_params,
+            config.sensor.num_params);
+    adc_sensor.compile_equations();
 
     adc_sensor.start_sensor();
 
@@ -478,7 +470,7 @@ void adc_sensor_handler(uint32_t dev_id)
                     (uint16_t) msg.content.value);
             break;
         case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
+            send_node_alive();
             break;
         case ha_host_ns::NEW_DEVICE:
             msg_send_to_self(&msg);
@@ -519,7 +511,7 @@ void event_sensor_handler(uint32_t dev_id)
             }
             break;
         case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
+            send_node_alive();
             break;
         case ha_host_ns::NEW_DEVICE:
             msg_send_to_self(&msg);
@@ -564,7 +556,7 @@ void rgb_led_handler(uint32_t dev_id)
                     (uint16_t) rgb_led.get_current_color());
             break;
         case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
+            send_node_alive();
             break;
         case ha_host_ns::NEW_DEVICE:
             rgb_led.rgb_set_color(0x0000);
@@ -585,26 +577,19 @@ int get_file_name_from_dev_id(uint32_t dev_id, char* file_name)
 
 bool gpio_common_get_config(uint32_t dev_id, gpio_config_params_t *gpio_params)
 {
-    char config_str[sizeof(ha_host_ns::gpio_dev_config_pattern)];
-    if (!read_config_file(dev_id, config_str,
-            sizeof(ha_host_ns::gpio_dev_config_pattern))) {
+    ep_config_ns::record_t config;
+    if (!ep_config_load(dev_id, &config)
+            || config.kind != ep_config_ns::gpio_config) {
         return false;
     }
 
-    char port_c = '0';
-    uint16_t pin = 0;
-    char mode_c = '0';
-
-    sscanf(config_str, ha_host_ns::gpio_dev_config_pattern, &port_c, &pin,
-            &mode_c);
-
-    gpio_params->device_port = get_port(port_c);
-    gpio_params->device_pin = pin;
+    gpio_params->device_port = get_port(config.gpio.port);
+    gpio_params->device_pin = config.gpio.pin;
 
     uint8_t mode = (uint8_t) gpio_ns::out_push_pull;
-    if (mode_c == 'p') {
+    if (config.gpio.mode == 'p') {
         mode = (uint8_t) gpio_ns::out_push_pull;
-    } else if (mode_c == 'o') {
+    } else if (config.gpio.mode == 'o') {
         mode = (uint8_t) gpio_ns::out_open_drain;
     }
     gpio_params->mode = mode;
@@ -614,104 +599,55 @@ bool gpio_common_get_config(uint32_t dev_id, gpio_config_params_t *gpio_params)
 
 bool adc_common_get_config(uint32_t dev_id, adc_config_params_t *adc_params)
 {
-    char config_str[sizeof(ha_host_ns::adc_dev_config_pattern)];
-    if (!read_config_file(dev_id, config_str,
-            sizeof(ha_host_ns::adc_dev_config_pattern))) {
+    ep_config_ns::record_t config;
+    if (!ep_config_load(dev_id, &config)
+            || config.kind != ep_config_ns::adc_config) {
         return false;
     }
 
-    char port_c = '0';
-    uint16_t pin = 0;
-    uint16_t adc = 0;
-    uint16_t chann = 0;
-
-    sscanf(config_str, ha_host_ns::adc_dev_config_pattern, &port_c, &pin, &adc,
-            &chann);
-
-    adc_params->device_port = get_port(port_c);
-    adc_params->device_pin = pin;
-    adc_params->adc_x = (adc_t) (adc - 1);
-    adc_params->adc_channel = chann;
+    adc_params->device_port = get_port(config.adc.port);
+    adc_params->device_pin = config.adc.pin;
+    adc_params->adc_x = (adc_t) (config.adc.unit - 1);
+    adc_params->adc_channel = config.adc.channel;
 
     return true;
 }
 
 bool pwm_common_get_config(uint32_t dev_id, pwm_config_params_t *pwm_params)
 {
-    char config_str[sizeof(ha_host_ns::pwm_dev_config_pattern)];
-    if (!read_config_file(dev_id, config_str,
-            sizeof(ha_host_ns::pwm_dev_config_pattern))) {
+    ep_config_ns::record_t config;
+    if (!ep_config_load(dev_id, &config)
+            || config.kind != ep_config_ns::pwm_config) {
         return false;
     }
 
-    char port_c = '0';
-    uint16_t pin = 0;
-    uint16_t timer = 0;
-    uint16_t chann = 0;
-
-    sscanf(config_str, ha_host_ns::pwm_dev_config_pattern, &port_c, &pin,
-            &timer, &chann);
-
-    pwm_params->device_port = get_port(port_c);
-    pwm_params->device_pin = pin;
-    pwm_params->timer_x = get_pwm_timer(timer);
-    pwm_params->pwm_channel = chann;
+    pwm_params->device_port = get_port(config.pwm.port);
+    pwm_params->device_pin = config.pwm.pin;
+    pwm_params->timer_x = get_pwm_timer(config.pwm.unit);
+    pwm_params->pwm_channel = config.pwm.channel;
 
     return true;
 }
 
 bool rgb_get_config(uint32_t dev_id, rgb_instance *rgb)
 {
-    char config_str[sizeof(ha_host_ns::rgb_config_pattern)];
-    if (!read_config_file(dev_id, config_str,
-            sizeof(ha_host_ns::rgb_config_pattern))) {
+    ep_config_ns::record_t config;
+    if (!ep_config_load(dev_id, &config)
+            || config.kind != ep_config_ns::rgb_config) {
         return false;
     }
 
-    char r_port_c = '0';
-    uint16_t r_pin = 0;
-    uint16_t r_timer = 0;
-    uint16_t r_chnn = 0;
-
-    char g_port_c = '0';
-    uint16_t g_pin = 0;
-    uint16_t g_timer = 0;
-    uint16_t g_chnn = 0;
-
-    char b_port_c = '0';
-    uint16_t b_pin = 0;
-    uint16_t b_timer = 0;
-    uint16_t b_chnn = 0;
-
-    uint16_t red_at_wp = 0;
-    uint16_t green_at_wp = 0;
-    uint16_t blue_at_wp = 0;
-
-    sscanf(config_str, ha_host_ns::rgb_config_pattern, &r_port_c, &r_pin,
-            &r_timer, &r_chnn, &g_port_c, &g_pin, &g_timer, &g_chnn, &b_port_c,
-            &b_pin, &b_timer, &b_chnn, &red_at_wp, &green_at_wp, &blue_at_wp);
-
-    pwm_config_params_t red_params;
-    pwm_config_params_t green_params;
-    pwm_config_params_t blue_params;
-
-    red_params.device_port = get_port(r_port_c);
-    red_params.device_pin = r_pin;
-    red_params.timer_x = get_pwm_timer(r_timer);
-    red_params.pwm_channel = r_chnn;
-
-    green_params.device_port = get_port(g_port_c);
-    green_params.device_pin = g_pin;
-    green_params.timer_x = get_pwm_timer(g_timer);
-    green_params.pwm_channel = g_chnn;
-
-    blue_params.device_port = get_port(b_port_c);
-    blue_params.device_pin = b_pin;
-    blue_params.timer_x = get_pwm_timer(b_timer);
-    blue_params.pwm_channel = b_chnn;
+    pwm_config_params_t led_params[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        led_params[i].device_port = get_port(config.rgb.led[i].port);
+        led_params[i].device_pin = config.rgb.led[i].pin;
+        led_params[i].timer_x = get_pwm_timer(config.rgb.led[i].unit);
+        led_params[i].pwm_channel = config.rgb.led[i].channel;
+    }
 
-    rgb->set_white_point(red_at_wp, green_at_wp, blue_at_wp);
-    rgb->device_configure(&red_params, &green_params, &blue_params);
+    rgb->set_white_point(config.rgb.at_wp[0], config.rgb.at_wp[1],
+            config.rgb.at_wp[2]);
+    rgb->device_configure(&led_params[0], &led_params[1], &led_params[2]);
 
     return true;
 }
@@ -761,30 +697,6 @@ static pwm_timer_t get_pwm_timer(int timer)
     return adv_timer1;
 }
 
-static bool read_config_file(uint32_t dev_id, char *config_string,
-        uint8_t str_len)
-{
-    char f_name[4];
-    get_file_name_from_dev_id(dev_id, f_name);
-
-    FIL fil;
-    if (f_open(&fil, f_name, FA_READ)) {
-        HA_DEBUG("Error on opening config file\n");
-        return false;
-    }
-    f_sync(&fil);
-
-    UINT byte_read;
-    if (f_read(&fil, config_string, str_len, &byte_read)) {
-        f_close(&fil);
-        HA_DEBUG("Error on reading config file\n");
-        return false;
-    }
-    f_close(&fil);
-
-    return true;
-}
-
 static void forward_data_msg_to_6lowpan(uint16_t cmd, uint32_t dev_id,
         uint16_t value)
 {
@@ -793,14 +705,22 @@ static void forward_data_msg_to_6lowpan(uint16_t cmd, uint32_t dev_id,
     case ha_ns::SET_DEV_VAL:
         frame_buff_size += ha_ns::SET_DEV_VAL_DATA_LEN;
         break;
-    case ha_ns::ALIVE:
-        frame_buff_size += ha_ns::ALIVE_DATA_LEN;
-        break;
     default:
         return;
     }
 
-    uint8_t frame_buff[frame_buff_size];
+    uint8_t *frame_buff;
+    msg_t gff_msg;
+
+    /* pack frame directly in sender queue */
+    mutex_lock(&slp_sender_queue_mutex);
+    frame_buff = ha_ns::sixlowpan_sender_gff_queue.reserve(frame_buff_size);
+    if (frame_buff == NULL) {
+        mutex_unlock(&slp_sender_queue_mutex);
+        HA_NOTIFY("forward_data_msg_to_6lowpan: sender queue is full, frame dropped (%lu)\n",
+                ha_ns::sixlowpan_sender_gff_queue.get_drops());
+        return;
+    }
 
     switch (cmd) {
     case ha_ns::SET_DEV_VAL:
@@ -809,20 +729,66 @@ static void forward_data_msg_to_6lowpan(uint16_t cmd, uint32_t dev_id,
         uint322buf(dev_id, &frame_buff[ha_ns::GFF_DATA_POS]);
         uint162buf(value, &frame_buff[ha_ns::GFF_DATA_POS + 4]);
         break;
-    case ha_ns::ALIVE:
-        frame_buff[0] = ha_ns::ALIVE_DATA_LEN;
-        uint162buf(cmd, &frame_buff[ha_ns::GFF_CMD_POS]);
-        uint322buf(dev_id, &frame_buff[ha_ns::GFF_DATA_POS]);
-        break;
-    default:
-        return;
     }
 
-    ha_ns::sixlowpan_sender_gff_queue.add_data(frame_buff, frame_buff_size);
+    gff_msg.type = ha_ns::GFF_PENDING;
+    gff_msg.content.value = ha_ns::sixlowpan_sender_gff_queue.commit();
+    mutex_unlock(&slp_sender_queue_mutex);
+
+    msg_send(&gff_msg, ha_ns::sixlowpan_sender_pid, false);
+}
 
+static void send_node_alive(void)
+{
+    uint8_t num_of_devs = 0, reserved_devs;
+    uint8_t *frame_buff;
+    uint32_t dev_id;
     msg_t gff_msg;
+
+    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
+        if (ha_host_ns::end_point_dev_id[i] != 0) {
+            num_of_devs++;
+        }
+    }
+    if (num_of_devs == 0) {
+        return;
+    }
+    if (num_of_devs > ha_ns::NODE_ALIVE_MAX_RECORDS) {
+        num_of_devs = ha_ns::NODE_ALIVE_MAX_RECORDS;
+    }
+
+    /* | len | NODE_ALIVE | num of devices | device_id * num of devices | */
+    mutex_lock(&slp_sender_queue_mutex);
+    frame_buff = ha_ns::sixlowpan_sender_gff_queue.reserve(ha_ns::GFF_LEN_SIZE
+            + ha_ns::GFF_CMD_SIZE + ha_ns::NODE_ALIVE_HDR_LEN
+            + num_of_devs * ha_ns::NODE_ALIVE_RECORD_LEN);
+    if (frame_buff == NULL) {
+        mutex_unlock(&slp_sender_queue_mutex);
+        HA_NOTIFY("send_node_alive: sender queue is full, frame dropped (%lu)\n",
+                ha_ns::sixlowpan_sender_gff_queue.get_drops());
+        return;
+    }
+
+    /* devices may start or stop meanwhile, list only what fits and is still running */
+    reserved_devs = num_of_devs;
+    num_of_devs = 0;
+    for (uint8_t i = 0; i < ha_host_ns::max_end_point && num_of_devs < reserved_devs; i++) {
+        dev_id = ha_host_ns::end_point_dev_id[i];
+        if (dev_id != 0) {
+            uint322buf(dev_id, &frame_buff[ha_ns::GFF_DATA_POS + ha_ns::NODE_ALIVE_HDR_LEN
+                    + num_of_devs * ha_ns::NODE_ALIVE_RECORD_LEN]);
+            num_of_devs++;
+        }
+    }
+    frame_buff[ha_ns::GFF_LEN_POS] = ha_ns::NODE_ALIVE_HDR_LEN
+            + num_of_devs * ha_ns::NODE_ALIVE_RECORD_LEN;
+    uint162buf(ha_ns::NODE_ALIVE, &frame_buff[ha_ns::GFF_CMD_POS]);
+    frame_buff[ha_ns::GFF_DATA_POS] = num_of_devs;
+
     gff_msg.type = ha_ns::GFF_PENDING;
-    gff_msg.content.ptr = (char *) &ha_ns::sixlowpan_sender_gff_queue;
+    gff_msg.content.value = ha_ns::sixlowpan_sender_gff_queue.commit();
+    mutex_unlock(&slp_sender_queue_mutex);
+
     msg_send(&gff_msg, ha_ns::sixlowpan_sender_pid, false);
 }
 
@@ -840,82 +806,3 @@ static uint8_t get_dev_common_subtype(uint32_t dev_id)
     return ((uint8_t) dev_id) & 0xF8;
 }
 
-static bool sensor_read_config(uint32_t dev_id, adc_sensor_instance* adc_ss,
-        uint16_t *num_equation, uint16_t *num_params)
-{
-    char config_str[sizeof(ha_host_ns::adc_sensor_config_pattern)];
-    if (!read_config_file(dev_id, config_str,
-            sizeof(ha_host_ns::adc_sensor_config_pattern))) {
-        return false;
-    }
-
-    char port_c = '0';
-    uint16_t pin = 0;
-    uint16_t adc = 0;
-    uint16_t chann = 0;
-
-    int filter_thres = 0;
-    int under_thres = 0;
-    int over_thres = 0;
-
-    sscanf(config_str, ha_host_ns::adc_sensor_config_pattern, &port_c, &pin,
-            &adc, &chann, &filter_thres, &under_thres, &over_thres,
-            num_equation, num_params);
-
-    adc_config_params_t adc_params;
-
-    adc_params.device_port = get_port(port_c);
-    adc_params.device_pin = pin;
-    adc_params.adc_x = (adc_t) (adc - 1);
-    adc_params.adc_channel = chann;
-
-    adc_ss->set_delta_threshold(filter_thres);
-    adc_ss->set_underflow_threshold(under_thres);
-    adc_ss->set_overflow_threshold(over_thres);
-    adc_ss->device_configure(&adc_params);
-
-    return true;
-}
-
-static bool sensor_read_equa_type_and_params(uint32_t dev_id,
-        char* equa_type_buff, uint8_t e_type_buff_len, float* equa_params_buff,
-        uint8_t e_params_buff_len)
-{
-    char f_name[4];
-    get_file_name_from_dev_id(dev_id, f_name);
-
-    FIL fil;
-    if (f_open(&fil, f_name, FA_READ)) {
-        HA_DEBUG("Error on opening config file\n");
-        return false;
-    }
-    f_sync(&fil);
-
-    uint8_t equa_line = 0;
-    uint8_t index = 0;
-
-    /* read equation type */
-    char config_str[ha_host_ns::dev_pattern_maxsize];
-    while (f_gets(config_str, ha_host_ns::dev_pattern_maxsize, &fil)) {
-        if (equa_line >= 3) {
-            equa_type_buff[index] = config_str[0];
-            index++;
-        }
-        equa_line++;
-        if (index == e_type_buff_len) {
-            break;
-        }
-    }
-
-    /* continue reading parameter of equations */
-    for (index = 0; index < e_params_buff_len; index++) {
-        if (f_gets(config_str, ha_host_ns::dev_pattern_maxsize, &fil)) {
-            equa_params_buff[index] = strtof(config_str, NULL);
-        } else {
-            break;
-        }
-    }
-    f_close(&fil);
-
-    return true;
-}
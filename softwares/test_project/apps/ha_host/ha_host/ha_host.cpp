@@ -9,22 +9,36 @@
  * Initialize endpoint pid table.
  *
  * (Timer6)
- * Assign callbacks into interrupt of tim6.
+ * Assign callbacks into interrupt of tim6. Button, dimmer and ADC sensor callbacks
+ * only post their work to the work queue thread (ha_workq), which does the sampling.
+ *
+ * (RTC)
+ * Node heartbeat: every send_alive_time_period (+/- jitter) one end point thread
+ * sends a NODE_ALIVE for all running devices of this node. Phase of the first
+ * heartbeat is random per node, so nodes don't send at the same second.
  */
 extern "C" {
 #include "msg.h"
 #include "thread.h"
+#include "irq.h"
 }
 #include "ha_host.h"
+#include "ha_sixlowpan.h"
 #include "MB1_System.h"
+#include "ha_workq.h"
 
 const ISRMgr_ns::ISR_t tim_isr_type = ISRMgr_ns::ISRMgr_TIM6;
 const ISRMgr_ns::ISR_t rtc_isr_type = ISRMgr_ns::ISRMgr_RTC;
 const uint8_t rtc_period = 1; //sec
 const uint32_t send_alive_time_period = 60 / rtc_period; //send alive every 60s.
+const uint32_t send_alive_jitter = 10 / rtc_period; //period is randomized by +/- 5s.
 
 uint32_t time_cycle_count = 0;
+static uint32_t next_alive_count = 0; //0: not scheduled yet.
+static uint32_t alive_rand_state = 0;
+static bool alive_seeded = false;
 kernel_pid_t ha_host_ns::end_point_pid[max_end_point];
+volatile uint32_t ha_host_ns::end_point_dev_id[max_end_point];
 
 /**
  * @brief Initialize pid_table.
@@ -36,21 +50,29 @@ static void endpoint_pid_table_init(void);
  */
 static void send_alive_callback(void);
 
+/**
+ * @brief Pseudo random number for heartbeat jitter, seeded by ha_host_ns::seed_alive.
+ */
+static uint32_t alive_rand(void);
+
 void ha_host_init(void)
 {
     endpoint_pid_table_init();
 
+    /* Start work queue thread for device sampling */
+    ha_workq_start();
+
     /* Assign send-alive callback function into interrupt timer */
     MB1_ISRs.subISR_assign(rtc_isr_type, &send_alive_callback);
 
     /* Assign button & switch callback function into interrupt timer */
-    MB1_ISRs.subISR_assign(tim_isr_type, &btn_sw_callback_timer_isr);
+    MB1_ISRs.subISR_TIM6_tick_assign(&btn_sw_callback_timer_isr, btn_sw_callback_period);
 
     /* Assign dimmer callback function into interrupt timer */
-    MB1_ISRs.subISR_assign(tim_isr_type, &dimmer_callback_timer_isr);
+    MB1_ISRs.subISR_TIM6_tick_assign(&dimmer_callback_timer_isr, dimmer_callback_period);
 
     /* Assign ADC linear-sensor callback function into interrupt timer */
-    MB1_ISRs.subISR_assign(tim_isr_type, &adc_sensor_callback_timer_isr);
+    MB1_ISRs.subISR_TIM6_tick_assign(&adc_sensor_callback_timer_isr, adc_sensor_callback_period);
 
     /* Assign On/Off bulb blink callback function into interrupt timer */
     MB1_ISRs.subISR_assign(tim_isr_type, &on_off_blink_callback_timer_isr);
@@ -63,20 +85,59 @@ static void endpoint_pid_table_init(void)
 {
     for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
         ha_host_ns::end_point_pid[i] = KERNEL_PID_UNDEF;
+        ha_host_ns::end_point_dev_id[i] = 0;
     }
 }
 
+void ha_host_ns::seed_alive(uint16_t node_id)
+{
+    unsigned state = disableIRQ();
+
+    alive_rand_state = node_id * 2654435761u + 1;
+
+    /* pick the first heartbeat phase again with the new seed */
+    time_cycle_count = 0;
+    next_alive_count = 0;
+    alive_seeded = true;
+
+    restoreIRQ(state);
+}
+
+static uint32_t alive_rand(void)
+{
+    alive_rand_state = alive_rand_state * 1103515245 + 12345;
+
+    return alive_rand_state >> 16;
+}
+
 static void send_alive_callback(void)
 {
+    if (!alive_seeded) {
+        /* 6LoWPAN stack has not been started, node id is unknown */
+        return;
+    }
+
     time_cycle_count = time_cycle_count + 1;
-    if (time_cycle_count == send_alive_time_period) {
-        time_cycle_count = 0;
-        for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-            if (ha_host_ns::end_point_pid[i] != KERNEL_PID_UNDEF) {
-                msg_t msg;
-                msg.type = ha_host_ns::SEND_ALIVE;
-                msg_send(&msg, ha_host_ns::end_point_pid[i], false);
-            }
+
+    if (next_alive_count == 0) {
+        /* random phase of the first heartbeat in [1, send_alive_time_period] */
+        next_alive_count = 1 + alive_rand() % send_alive_time_period;
+    }
+    if (time_cycle_count < next_alive_count) {
+        return;
+    }
+    time_cycle_count = 0;
+    next_alive_count = send_alive_time_period - send_alive_jitter / 2
+            + alive_rand() % (send_alive_jitter + 1);
+
+    /* one end point thread with a running device sends NODE_ALIVE for all devices */
+    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
+        if (ha_host_ns::end_point_pid[i] != KERNEL_PID_UNDEF
+                && ha_host_ns::end_point_dev_id[i] != 0) {
+            msg_t msg;
+            msg.type = ha_host_ns::SEND_ALIVE;
+            msg_send(&msg, ha_host_ns::end_point_pid[i], false);
+            break;
         }
     }
 }
@@ -15,6 +15,15 @@ extern "C" {
 namespace ha_host_ns {
 const uint8_t max_end_point = 8;
 extern kernel_pid_t end_point_pid[max_end_point];
+
+/* id of the device running in each end point, 0 if there is no running device */
+extern volatile uint32_t end_point_dev_id[max_end_point];
+
+/**
+ * @brief Seed heartbeat jitter with node id, called when 6LoWPAN stack is (re)started.
+ *        No heartbeat is scheduled before that.
+ */
+void seed_alive(uint16_t node_id);
 }
 
 #endif //__HA_HOST_GLB_H
@@ -11,6 +11,7 @@
 #include <ctype.h>
 
 #include "shell_cmds_dev_config.h"
+#include "ep_config_cache.h"
 #include "shell_cmds_fatfs.h"
 #include "ha_sixlowpan.h"
 #include "ha_gff_misc.h"
@@ -114,7 +115,8 @@ static bool check_port(char src, char* port);
 static bool check_devid(uint32_t dev_id);
 
 /**
- * @brief Modify dev_list file when an EP has been reconfigured.
+ * @brief Modify dev_list file when an EP has been reconfigured, then rewrite the
+ * binary config record of the EP from its text file.
  *
  * @param[in] ep_id EP_ID needed to modify.
  * @param[in] dev_type Device type of the new device in EP ID.
@@ -683,6 +685,11 @@ void adc_sensor_config(int argc, char** argv)
                     printf("ERR: missing parameters in -t option.\n");
                     return;
                 }
+                if (num_equation > ep_config_ns::equa_type_max) {
+                    printf("ERR: too many equations, max %d.\n",
+                            ep_config_ns::equa_type_max);
+                    return;
+                }
                 count--;
                 break;
             case 'P':
@@ -702,6 +709,11 @@ void adc_sensor_config(int argc, char** argv)
                     num_params++;
                     count++;
                 }
+                if (num_params > ep_config_ns::equa_params_max) {
+                    printf("ERR: too many parameters, max %d.\n",
+                            ep_config_ns::equa_params_max);
+                    return;
+                }
                 count--;
                 break;
             case 'f':
@@ -1355,6 +1367,10 @@ static void modify_dev_list_file(uint8_t ep_id, uint8_t dev_type)
     }
     f_close(&fil);
 
+    if (!ep_config_rebuild(dev_list[ep_id])) {
+        printf("ERR: can't write binary config of EP%d.\n", ep_id);
+    }
+
     return;
 }
 
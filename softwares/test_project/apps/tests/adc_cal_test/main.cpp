@@ -0,0 +1,135 @@
+#include "stdio.h"
+#include "stdint.h"
+#include "math.h"
+
+#include "adc_cal.h"
+
+#ifdef ADC_CAL_TEST_DWT
+#define DWT_CTRL        (*(volatile uint32_t *) 0xE0001000)
+#define DWT_CYCCNT      (*(volatile uint32_t *) 0xE0001004)
+#define DEMCR           (*(volatile uint32_t *) 0xE000EDFC)
+#endif
+
+const uint16_t adc_codes = 1 << adc_cal_ns::adc_bits;
+const float volt_per_code = 3.3f / adc_codes;
+
+typedef struct {
+    const char *name;
+    const char *types;
+    uint8_t num_equations;
+    float params[12];
+    uint8_t num_params;
+} chain_t;
+
+/* chains as in sensor config files */
+const chain_t chains[] = {
+    {"linear", "l", 1, {100, -50}, 2},
+    {"rational", "lrl", 3, {-1, 3.4f, 0.002f, 0.001f, 0, 1, -273.15f}, 7},
+    {"polynomial", "p", 1, {500, -1.4f, 0}, 3},
+    {"square", "p", 1, {20, 2, 5}, 3},
+    {"table", "lt", 2, {1, 0, 0, 0, 1, 10, 2, 50, 3.3f, 60}, 10},
+    {"chain", "lpl", 3, {2, 0.1f, 1, 1.5f, 0, 10, -3}, 7},
+};
+
+volatile float sink;
+
+static uint32_t cycles_now(void)
+{
+#ifdef ADC_CAL_TEST_DWT
+    return DWT_CYCCNT;
+#elif defined(__i386__) || defined(__x86_64__)
+    return (uint32_t) __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static bool chain_check(const chain_t *chain)
+{
+    adc_cal_plan plan;
+    float ref, value, error, max_error = 0, tolerance;
+    uint16_t compiled_codes = 0, max_error_code = 0;
+    uint32_t start, ref_cycles, plan_cycles;
+    bool passed = true;
+
+    start = cycles_now();
+    plan.compile(chain->types, chain->num_equations, chain->params, chain->num_params,
+            volt_per_code);
+    printf("%s: compile %lu cycles\n", chain->name, (unsigned long) (cycles_now() - start));
+
+    /* compiled plan vs float reference, full ADC range */
+    for (uint16_t code = 0; code < adc_codes; code++) {
+        ref = adc_cal_evaluate(code * volt_per_code, chain->types, chain->num_equations,
+                chain->params, chain->num_params);
+        if (!plan.evaluate(code, value)) {
+            continue;
+        }
+        compiled_codes++;
+
+        /* the compiler checks 3 points per segment, allow twice its tolerance */
+        error = fabs(value - ref);
+        tolerance = fabs(ref) * adc_cal_ns::rel_tolerance;
+        if (tolerance < adc_cal_ns::abs_tolerance) {
+            tolerance = adc_cal_ns::abs_tolerance;
+        }
+        if (!(error <= 2 * tolerance)) {
+            printf("%s: code %u, plan %f, reference %f\n", chain->name, code,
+                    (double) value, (double) ref);
+            passed = false;
+        }
+        if (error > max_error) {
+            max_error = error;
+            max_error_code = code;
+        }
+    }
+
+    /* per sample cycles, whole ADC range */
+    start = cycles_now();
+    for (uint16_t code = 0; code < adc_codes; code++) {
+        sink = adc_cal_evaluate(code * volt_per_code, chain->types, chain->num_equations,
+                chain->params, chain->num_params);
+    }
+    ref_cycles = cycles_now() - start;
+
+    start = cycles_now();
+    for (uint16_t code = 0; code < adc_codes; code++) {
+        if (plan.evaluate(code, value)) {
+            sink = value;
+        }
+        else {
+            sink = adc_cal_evaluate(code * volt_per_code, chain->types,
+                    chain->num_equations, chain->params, chain->num_params);
+        }
+    }
+    plan_cycles = cycles_now() - start;
+
+    printf("%s: %u/%u codes compiled, max error %f at code %u\n", chain->name,
+            compiled_codes, adc_codes, (double) max_error, max_error_code);
+    printf("%s: float %lu cycles/sample, plan %lu cycles/sample\n", chain->name,
+            (unsigned long) (ref_cycles / adc_codes), (unsigned long) (plan_cycles / adc_codes));
+
+    return passed;
+}
+
+int main(void)
+{
+    bool passed = true;
+
+#ifdef ADC_CAL_TEST_DWT
+    DEMCR |= 1 << 24; // TRCENA
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= 1;
+#endif
+
+    for (uint8_t i = 0; i < sizeof(chains) / sizeof(chains[0]); i++) {
+        passed = chain_check(&chains[i]) && passed;
+    }
+
+    if (!passed) {
+        printf("adc_cal test FAILED\n");
+        return 1;
+    }
+    printf("adc_cal test PASSED\n");
+
+    return 0;
+}
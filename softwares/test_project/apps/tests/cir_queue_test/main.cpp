@@ -1,5 +1,6 @@
 #include "stdio.h"
 #include "stdint.h"
+#include "string.h"
 
 #include "cir_queue.h"
 
@@ -12,20 +13,24 @@ uint8_t data_ret[data_size];
 cir_queue a_queue(queue_buffer, queue_size);
 
 int main(void) {
-    while (1) {
+    for (uint16_t round = 0; round < 100; round++) {
         /* add data */
         a_queue.add_data(data, data_size);
 
         /* get data */
         if (a_queue.get_size() != data_size) {
             printf("queue_size %lu != data_size %u\n", a_queue.get_size(), data_size);
-            break;
+            printf("cir_queue test FAILED\n");
+            return 1;
         }
 
         a_queue.get_data(data_ret, data_size);
-        for (int8_t count = 0; count < data_size; count++) {
-            printf("%d ", data_ret[count]);
+        if (memcmp(data, data_ret, data_size) != 0) {
+            printf("cir_queue test FAILED\n");
+            return 1;
         }
-        printf("\n");
     }
+    printf("cir_queue test PASSED\n");
+
+    return 0;
 }
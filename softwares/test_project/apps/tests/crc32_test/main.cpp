@@ -0,0 +1,131 @@
+#include "stdio.h"
+#include "stdint.h"
+#include "string.h"
+
+extern "C" {
+#include "vtimer.h"
+}
+
+#include "crc32_sw.h"
+
+#ifdef CRC32_TEST_HW
+#include "MB1_System.h"
+#endif
+
+const uint16_t block_size = 1024;
+const uint16_t num_of_rounds = 200;
+const uint16_t num_of_checks = 2000;
+
+/* extra bytes for unaligned start */
+uint8_t block[block_size + 8];
+
+static uint32_t rand_state = 1;
+static uint32_t rand_next(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 16;
+}
+
+/* bit by bit reference */
+static uint32_t crc32_ref(const uint8_t *data, uint32_t data_size)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (data_size-- > 0) {
+        crc ^= *data++;
+        for (uint8_t count = 0; count < 8; count++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+    }
+
+    return ~crc;
+}
+
+static bool crc32_check(const char *name,
+        uint32_t (*update)(uint32_t crc, const uint8_t *data, uint32_t data_size))
+{
+    uint32_t offset, size, split, crc;
+
+    if (update(0, (const uint8_t *)"123456789", 9) != 0xCBF43926) {
+        printf("%s: wrong CRC32 of \"123456789\"\n", name);
+        return false;
+    }
+
+    /* random alignment, size, and split point of incremental update */
+    for (uint16_t count = 0; count < num_of_checks; count++) {
+        offset = rand_next() % 8;
+        size = rand_next() % (block_size + 1);
+        split = rand_next() % (size + 1);
+
+        crc = update(update(0, &block[offset], split), &block[offset + split], size - split);
+        if (crc != crc32_ref(&block[offset], size)) {
+            printf("%s: wrong CRC32, offset %lu, size %lu, split %lu\n", name,
+                    (unsigned long) offset, (unsigned long) size, (unsigned long) split);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void crc32_bench(const char *name,
+        uint32_t (*update)(uint32_t crc, const uint8_t *data, uint32_t data_size))
+{
+    timex_t start, end;
+    uint64_t usec;
+    uint32_t crc = 0;
+
+    vtimer_now(&start);
+    for (uint16_t round = 0; round < num_of_rounds; round++) {
+        crc = update(crc, block, block_size);
+    }
+    vtimer_now(&end);
+
+    usec = timex_uint64(timex_sub(end, start));
+    if (usec == 0) {
+        usec = 1;
+    }
+    printf("%s: %lu bytes in %lu us, %lu KB/s (crc %08lx)\n", name,
+            (unsigned long) block_size * num_of_rounds, (unsigned long) usec,
+            (unsigned long) (((uint64_t) block_size * num_of_rounds * 1000000 / usec) >> 10),
+            (unsigned long) crc);
+}
+
+#ifdef CRC32_TEST_HW
+static uint32_t crc32_hw_update(uint32_t crc, const uint8_t *data, uint32_t data_size)
+{
+    return MB1_crc.crc32_update(crc, data, data_size);
+}
+#endif
+
+int main(void) {
+    bool passed = true;
+
+    for (uint16_t count = 0; count < sizeof(block); count++) {
+        block[count] = rand_next();
+    }
+
+#ifdef CRC32_TEST_HW
+    MB1_crc.crc_start();
+#endif
+
+    passed = crc32_check("slice-by-8", crc32_sw::update) && passed;
+    passed = crc32_check("bytewise", crc32_sw::update_bytewise) && passed;
+#ifdef CRC32_TEST_HW
+    passed = crc32_check("crc_hw", crc32_hw_update) && passed;
+#endif
+
+    if (!passed) {
+        printf("crc32 test FAILED\n");
+        return 1;
+    }
+    printf("crc32 test PASSED\n");
+
+    crc32_bench("slice-by-8", crc32_sw::update);
+    crc32_bench("bytewise", crc32_sw::update_bytewise);
+#ifdef CRC32_TEST_HW
+    crc32_bench("crc_hw", crc32_hw_update);
+#endif
+
+    return 0;
+}
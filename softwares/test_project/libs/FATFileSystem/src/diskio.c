@@ -0,0 +1,391 @@
+/*-----------------------------------------------------------------------*/
+/* Low level disk I/O module glue functions         (C)ChaN, 2014        */
+/*-----------------------------------------------------------------------*/
+/* Write-back sector cache between FatFs and the SD card (sd_spi_stm32.c),
+ * Pham Huu Dang Nhat, 2026.
+ *
+ * - Single sector reads/writes (FAT, directory and _FS_TINY win[]) are
+ *   cached, writes stay in cache until eviction or CTRL_SYNC.
+ * - Multiple sector reads/writes (file data) bypass the cache, cached
+ *   copies are used/updated so the card and the cache stay consistent.
+ * - A dirty sector is written back together with its dirty neighbours in
+ *   the cache, consecutive sectors go in one CMD25 multi-block write.
+ */
+
+#include <string.h>
+
+#include "diskio.h"
+#include "ffconf.h"
+
+#if DISK_CACHE_SETS > 0
+
+#define DISK_CACHE_SIZE		(DISK_CACHE_SETS * DISK_CACHE_WAYS)
+
+typedef struct {
+	DWORD	sector;			/* Cached sector number */
+	DWORD	stamp;			/* Last access, for LRU */
+	BYTE	valid;
+	BYTE	dirty;
+} CACHE_ENTRY;
+
+static CACHE_ENTRY cache_entries[DISK_CACHE_SIZE];
+static BYTE cache_data[DISK_CACHE_SIZE][_MAX_SS];
+static DWORD cache_stamp;
+static DISK_CACHE_STATS cache_stats;
+
+
+/*-----------------------------------------------------------------------*/
+/* Find cached sector, return index or -1                                */
+/*-----------------------------------------------------------------------*/
+
+static
+int cache_find (
+	DWORD sector
+)
+{
+	UINT i = (sector % DISK_CACHE_SETS) * DISK_CACHE_WAYS;
+	UINT end = i + DISK_CACHE_WAYS;
+
+	for (; i < end; i++) {
+		if (cache_entries[i].valid && cache_entries[i].sector == sector) {
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Write back a dirty sector with its consecutive dirty sectors          */
+/*-----------------------------------------------------------------------*/
+
+static
+DRESULT cache_write_back (
+	BYTE drv,
+	UINT idx			/* Index of a dirty entry */
+)
+{
+	const BYTE *blocks[DISK_CACHE_SIZE];
+	BYTE entries[DISK_CACHE_SIZE];
+	DWORD first = cache_entries[idx].sector;
+	UINT count = 0, n;
+	int i;
+	DRESULT res;
+
+	/* Lowest sector of the dirty run */
+	while (first > 0) {
+		i = cache_find(first - 1);
+		if (i < 0 || !cache_entries[i].dirty) break;
+		first--;
+	}
+
+	/* Collect the run */
+	while (count < DISK_CACHE_SIZE) {
+		i = cache_find(first + count);
+		if (i < 0 || !cache_entries[i].dirty) break;
+		entries[count] = (BYTE)i;
+		blocks[count] = cache_data[i];
+		count++;
+	}
+
+	res = sd_disk_write_blocks(drv, blocks, first, count);
+	if (res == RES_OK) {
+		for (n = 0; n < count; n++) {
+			cache_entries[entries[n]].dirty = 0;
+		}
+		cache_stats.write_backs += count;
+		cache_stats.write_cmds++;
+	}
+
+	return res;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Get an entry for sector in its set, write back LRU entry if dirty     */
+/*-----------------------------------------------------------------------*/
+
+static
+int cache_alloc (
+	BYTE drv,
+	DWORD sector
+)
+{
+	UINT i = (sector % DISK_CACHE_SETS) * DISK_CACHE_WAYS;
+	UINT end = i + DISK_CACHE_WAYS;
+	UINT victim = i;
+
+	for (; i < end; i++) {
+		if (!cache_entries[i].valid) {
+			victim = i;
+			break;
+		}
+		if (cache_entries[i].stamp - cache_entries[victim].stamp > 0x7FFFFFFF) {
+			victim = i;		/* Older, wrap-around safe */
+		}
+	}
+
+	if (cache_entries[victim].valid && cache_entries[victim].dirty) {
+		if (cache_write_back(drv, victim) != RES_OK) return -1;
+	}
+
+	cache_entries[victim].valid = 0;
+	cache_entries[victim].sector = sector;
+
+	return (int)victim;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Write back all dirty sectors                                          */
+/*-----------------------------------------------------------------------*/
+
+static
+DRESULT cache_flush (
+	BYTE drv
+)
+{
+	UINT i;
+
+	for (i = 0; i < DISK_CACHE_SIZE; i++) {
+		if (cache_entries[i].valid && cache_entries[i].dirty) {
+			if (cache_write_back(drv, i) != RES_OK) return RES_ERROR;
+		}
+	}
+
+	return RES_OK;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Initialize a Drive                                                    */
+/*-----------------------------------------------------------------------*/
+
+DSTATUS disk_initialize (
+	BYTE pdrv				/* Physical drive number (0..) */
+)
+{
+	/* Card may have been changed, drop cached sectors */
+	memset(cache_entries, 0, sizeof(cache_entries));
+
+	return sd_disk_initialize(pdrv);
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Read Sector(s)                                                        */
+/*-----------------------------------------------------------------------*/
+
+DRESULT disk_read (
+	BYTE pdrv,		/* Physical drive number (0..) */
+	BYTE *buff,		/* Data buffer to store read data */
+	DWORD sector,	/* Sector address (LBA) */
+	UINT count		/* Number of sectors to read (1..128) */
+)
+{
+	UINT run;
+	int i;
+
+	if (pdrv || !count) return RES_PARERR;
+	if (disk_status(pdrv) & STA_NOINIT) return RES_NOTRDY;
+
+	if (count == 1) {
+		i = cache_find(sector);
+		if (i >= 0) {
+			cache_stats.read_hits++;
+		} else {
+			cache_stats.read_misses++;
+			i = cache_alloc(pdrv, sector);
+			if (i < 0) return RES_ERROR;
+			if (sd_disk_read(pdrv, cache_data[i], sector, 1) != RES_OK) return RES_ERROR;
+			cache_entries[i].valid = 1;
+			cache_entries[i].dirty = 0;
+		}
+		cache_entries[i].stamp = ++cache_stamp;
+		memcpy(buff, cache_data[i], _MAX_SS);
+		return RES_OK;
+	}
+
+	/* Multiple sectors: cached ones from cache, runs of others from card */
+	while (count) {
+		i = cache_find(sector);
+		if (i >= 0) {
+			cache_stats.read_hits++;
+			memcpy(buff, cache_data[i], _MAX_SS);
+			run = 1;
+		} else {
+			for (run = 1; run < count && cache_find(sector + run) < 0; run++) ;
+			cache_stats.read_misses += run;
+			if (sd_disk_read(pdrv, buff, sector, run) != RES_OK) return RES_ERROR;
+		}
+		buff += run * _MAX_SS;
+		sector += run;
+		count -= run;
+	}
+
+	return RES_OK;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Write Sector(s)                                                       */
+/*-----------------------------------------------------------------------*/
+
+#if _USE_WRITE
+DRESULT disk_write (
+	BYTE pdrv,			/* Physical drive number (0..) */
+	const BYTE *buff,	/* Data to be written */
+	DWORD sector,		/* Sector address (LBA) */
+	UINT count			/* Number of sectors to write (1..128) */
+)
+{
+	DSTATUS stat;
+	UINT n;
+	int i;
+
+	if (pdrv || !count) return RES_PARERR;
+	stat = disk_status(pdrv);
+	if (stat & STA_NOINIT) return RES_NOTRDY;
+	if (stat & STA_PROTECT) return RES_WRPRT;
+
+	if (count == 1) {
+		i = cache_find(sector);
+		if (i >= 0) {
+			cache_stats.write_hits++;
+		} else {
+			cache_stats.write_misses++;
+			i = cache_alloc(pdrv, sector);
+			if (i < 0) return RES_ERROR;
+		}
+		memcpy(cache_data[i], buff, _MAX_SS);
+		cache_entries[i].valid = 1;
+		cache_entries[i].dirty = 1;
+		cache_entries[i].stamp = ++cache_stamp;
+		return RES_OK;
+	}
+
+	/* Multiple sectors: written to card, cached copies become clean */
+	if (sd_disk_write(pdrv, buff, sector, count) != RES_OK) return RES_ERROR;
+
+	for (n = 0; n < count; n++) {
+		i = cache_find(sector + n);
+		if (i >= 0) {
+			cache_stats.write_hits++;
+			memcpy(cache_data[i], buff + n * _MAX_SS, _MAX_SS);
+			cache_entries[i].dirty = 0;
+		} else {
+			cache_stats.write_misses++;
+		}
+	}
+
+	return RES_OK;
+}
+#endif
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Miscellaneous Functions                                               */
+/*-----------------------------------------------------------------------*/
+
+#if _USE_IOCTL
+DRESULT disk_ioctl (
+	BYTE pdrv,		/* Physical drive number (0..) */
+	BYTE cmd,		/* Control code */
+	void *buff		/* Buffer to send/receive control data */
+)
+{
+	DWORD *range;
+	UINT i;
+
+	switch (cmd) {
+	case CTRL_SYNC:			/* Dirty sectors to card, then wait for card ready */
+		if (cache_flush(pdrv) != RES_OK) return RES_ERROR;
+		break;
+
+	case CTRL_POWER:		/* Flush before power off */
+		if (*(BYTE*)buff == 0 && cache_flush(pdrv) != RES_OK) return RES_ERROR;
+		break;
+
+	case CTRL_ERASE_SECTOR:	/* Erased sectors are not valid in cache any more */
+		range = (DWORD*)buff;
+		for (i = 0; i < DISK_CACHE_SIZE; i++) {
+			if (cache_entries[i].sector >= range[0] && cache_entries[i].sector <= range[1]) {
+				cache_entries[i].valid = 0;
+			}
+		}
+		break;
+	}
+
+	return sd_disk_ioctl(pdrv, cmd, buff);
+}
+#endif
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Cache Statistics                                                      */
+/*-----------------------------------------------------------------------*/
+
+void disk_cache_stats (
+	DISK_CACHE_STATS* stats
+)
+{
+	UINT i;
+
+	*stats = cache_stats;
+	stats->dirty = 0;
+	for (i = 0; i < DISK_CACHE_SIZE; i++) {
+		if (cache_entries[i].valid && cache_entries[i].dirty) stats->dirty++;
+	}
+	stats->size = DISK_CACHE_SIZE;
+}
+
+void disk_cache_stats_reset (void)
+{
+	memset(&cache_stats, 0, sizeof(cache_stats));
+}
+
+#else /* DISK_CACHE_SETS == 0 */
+
+DSTATUS disk_initialize (BYTE pdrv)
+{
+	return sd_disk_initialize(pdrv);
+}
+
+DRESULT disk_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+	return sd_disk_read(pdrv, buff, sector, count);
+}
+
+#if _USE_WRITE
+DRESULT disk_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+	return sd_disk_write(pdrv, buff, sector, count);
+}
+#endif
+
+#if _USE_IOCTL
+DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void *buff)
+{
+	return sd_disk_ioctl(pdrv, cmd, buff);
+}
+#endif
+
+void disk_cache_stats (DISK_CACHE_STATS* stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
+void disk_cache_stats_reset (void)
+{
+}
+
+#endif /* DISK_CACHE_SETS > 0 */
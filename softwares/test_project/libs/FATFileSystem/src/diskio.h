@@ -87,6 +87,35 @@ void disk_timerproc_10ms (void);
 
 /* Martin Thomas end */
 
+/* Low level SD card functions (sd_spi_stm32.c), called by diskio.c */
+DSTATUS sd_disk_initialize (BYTE pdrv);
+DRESULT sd_disk_read (BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
+DRESULT sd_disk_write (BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
+DRESULT sd_disk_write_blocks (BYTE pdrv, const BYTE* const* blocks, DWORD sector, UINT count);
+DRESULT sd_disk_ioctl (BYTE pdrv, BYTE cmd, void* buff);
+
+
+/* Write-back sector cache (diskio.c) between FatFs and the SD card.
+/  Sector n is cached in set (n % DISK_CACHE_SETS), LRU eviction in a set.
+/  RAM: DISK_CACHE_SETS * DISK_CACHE_WAYS * (512 + 12) bytes. */
+
+#define DISK_CACHE_SETS		2	/* Number of sets, 0: no cache */
+#define DISK_CACHE_WAYS		4	/* Sectors per set (N-way) */
+
+typedef struct {
+	DWORD	read_hits;		/* Sectors read from cache */
+	DWORD	read_misses;	/* Sectors read from card */
+	DWORD	write_hits;		/* Sector writes to an already cached sector */
+	DWORD	write_misses;	/* Sector writes which allocate or bypass the cache */
+	DWORD	write_backs;	/* Dirty sectors written to card */
+	DWORD	write_cmds;		/* Write commands (CMD24/CMD25) of write backs */
+	UINT	dirty;			/* Dirty sectors in cache now */
+	UINT	size;			/* Sectors in cache */
+} DISK_CACHE_STATS;
+
+void disk_cache_stats (DISK_CACHE_STATS* stats);
+void disk_cache_stats_reset (void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -36,12 +36,18 @@
 #include "ffconf.h"
 #include "diskio.h"
 
+/* RIOT's includes, waiting for the card/DMA lets other threads run */
+#include "irq.h"
+#include "thread.h"
+#include "vtimer.h"
+
 // demo uses a command line option to define this (see Makefile):
-// #define STM32_SD_USE_DMA
+// MBoard-1 transfers data blocks by DMA1 channel 4 (SPI2 RX) and 5 (SPI2 TX).
+#define STM32_SD_USE_DMA
 
 #ifdef STM32_SD_USE_DMA
 // #warning "Information only: using DMA"
-#pragma message "*** Using DMA ***"
+// #pragma message "*** Using DMA ***"
 #endif
 
 /* set to 1 to provide a disk_ioctrl function even if not needed by the FatFs */
@@ -69,6 +75,15 @@
 #define RCC_APBPeriph_SPI_SD     RCC_APB1Periph_SPI2
 /* - for SPI2 and full-speed APB1: 36MHz/4 */
 #define SPI_BaudRatePrescaler_SPI_SD  SPI_BaudRatePrescaler_4
+#define DMA_Channel_SPI_SD_RX    DMA1_Channel4
+#define DMA_Channel_SPI_SD_TX    DMA1_Channel5
+#define DMA_FLAG_SPI_SD_TC_RX    DMA1_FLAG_TC4
+#define DMA_FLAG_SPI_SD_TC_TX    DMA1_FLAG_TC5
+#define DMA_FLAG_SPI_SD_GL_RX    DMA1_FLAG_GL4
+#define DMA_FLAG_SPI_SD_GL_TX    DMA1_FLAG_GL5
+#define DMA_IRQn_SPI_SD_RX       DMA1_Channel4_IRQn
+/* - index of SPI2 in MB1_SPI, which owns the DMA1 channel 4 ISR */
+#define DMA_SPI_SD_INDEX         1
 /* End MBoard-1, SD card on SPI2 */
 
 #if defined(USE_EK_STM32F)
@@ -386,17 +401,33 @@ BYTE rcvr_spi (void)
 /* Wait for card ready                                                   */
 /*-----------------------------------------------------------------------*/
 
+/* busy polls before sleeping between polls (card is programming a block) */
+#define WAIT_READY_FAST_POLLS   64
+#define WAIT_READY_SLEEP_US     500
+
+/* Thread may sleep, i.e. not in ISR and interrupts are enabled */
+static
+BOOL can_sleep (void)
+{
+	return !inISR() && (__get_PRIMASK() == 0);
+}
+
 static
 BYTE wait_ready (void)
 {
 	BYTE res;
+	UINT n = 0;
 
 
 	Timer2 = 50;	/* Wait for ready in timeout of 500ms */
 	rcvr_spi();
-	do
+	do {
 		res = rcvr_spi();
-	while ((res != 0xFF) && Timer2);
+		/* Programming takes up to a few hundred ms, let other threads run */
+		if ((res != 0xFF) && (++n >= WAIT_READY_FAST_POLLS) && can_sleep()) {
+			vtimer_usleep(WAIT_READY_SLEEP_US);
+		}
+	} while ((res != 0xFF) && Timer2);
 
 	return res;
 }
@@ -415,6 +446,28 @@ void release_spi (void)
 }
 
 #ifdef STM32_SD_USE_DMA
+/* DMA state, dma_waiter sleeps until RX transfer complete interrupt */
+static volatile BOOL dma_done;
+static volatile kernel_pid_t dma_waiter = KERNEL_PID_UNDEF;
+
+/* provided by MB1_SPI (C linkage), DMA1 channel 4 ISR is shared with SPI2 objects */
+void SPI_DMA_RX_callback_assign(uint8_t spi_index, void (*callback)(void));
+
+/*-----------------------------------------------------------------------*/
+/* DMA RX Transfer Complete, called from ISR                             */
+/*-----------------------------------------------------------------------*/
+static
+void stm32_dma_isr (void)
+{
+	DMA_ITConfig(DMA_Channel_SPI_SD_RX, DMA_IT_TC, DISABLE);
+	DMA_ClearFlag(DMA_FLAG_SPI_SD_GL_RX);
+
+	dma_done = TRUE;
+	if (dma_waiter != KERNEL_PID_UNDEF) {
+		thread_wakeup(dma_waiter);
+	}
+}
+
 /*-----------------------------------------------------------------------*/
 /* Transmit/Receive Block using DMA (Platform dependent. STM32 here)     */
 /*-----------------------------------------------------------------------*/
@@ -428,7 +481,10 @@ void stm32_dma_transfer(
 )
 {
 	DMA_InitTypeDef DMA_InitStructure;
-	WORD rw_workbyte[] = { 0xffff };
+	static const BYTE fill_byte = 0xff;	/* sent while receiving */
+	static BYTE discard_byte;			/* received while transmitting */
+	BOOL wait_in_thread;
+	unsigned irq_state;
 
 	/* shared DMA configuration values */
 	DMA_InitStructure.DMA_PeripheralBaseAddr = (DWORD)(&(SPI_SD->DR));
@@ -454,7 +510,7 @@ void stm32_dma_transfer(
 
 		/* DMA1 channel3 configuration SPI1 TX ---------------------------------------------*/
 		/* DMA1 channel5 configuration SPI2 TX ---------------------------------------------*/
-		DMA_InitStructure.DMA_MemoryBaseAddr = (DWORD)rw_workbyte;
+		DMA_InitStructure.DMA_MemoryBaseAddr = (DWORD)&fill_byte;
 		DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
 		DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Disable;
 		DMA_Init(DMA_Channel_SPI_SD_TX, &DMA_InitStructure);
@@ -464,7 +520,7 @@ void stm32_dma_transfer(
 #if _FS_READONLY == 0
 		/* DMA1 channel2 configuration SPI1 RX ---------------------------------------------*/
 		/* DMA1 channel4 configuration SPI2 RX ---------------------------------------------*/
-		DMA_InitStructure.DMA_MemoryBaseAddr = (DWORD)rw_workbyte;
+		DMA_InitStructure.DMA_MemoryBaseAddr = (DWORD)&discard_byte;
 		DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
 		DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Disable;
 		DMA_Init(DMA_Channel_SPI_SD_RX, &DMA_InitStructure);
@@ -479,6 +535,25 @@ void stm32_dma_transfer(
 
 	}
 
+	/* Drop a byte left in DR, RX DMA would take it as the first data byte */
+	if (SPI_I2S_GetFlagStatus(SPI_SD, SPI_I2S_FLAG_RXNE) != RESET) {
+		SPI_I2S_ReceiveData(SPI_SD);
+	}
+	DMA_ClearFlag(DMA_FLAG_SPI_SD_GL_RX | DMA_FLAG_SPI_SD_GL_TX);
+
+	/* Sleep only if the interrupt can wake this thread up */
+	wait_in_thread = can_sleep();
+
+	irq_state = disableIRQ();
+
+	dma_done = FALSE;
+	if (wait_in_thread) {
+		dma_waiter = thread_getpid();
+		/* the ISR is shared with SPI2 objects, take it for this transfer only */
+		SPI_DMA_RX_callback_assign(DMA_SPI_SD_INDEX, stm32_dma_isr);
+		DMA_ITConfig(DMA_Channel_SPI_SD_RX, DMA_IT_TC, ENABLE);
+	}
+
 	/* Enable DMA RX Channel */
 	DMA_Cmd(DMA_Channel_SPI_SD_RX, ENABLE);
 	/* Enable DMA TX Channel */
@@ -487,12 +562,21 @@ void stm32_dma_transfer(
 	/* Enable SPI TX/RX request */
 	SPI_I2S_DMACmd(SPI_SD, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, ENABLE);
 
-	/* Wait until DMA1_Channel 3 Transfer Complete */
-	/// not needed: while (DMA_GetFlagStatus(DMA_FLAG_SPI_SD_TC_TX) == RESET) { ; }
-	/* Wait until DMA1_Channel 2 Receive Complete */
-	while (DMA_GetFlagStatus(DMA_FLAG_SPI_SD_TC_RX) == RESET) { ; }
-	// same w/o function-call:
-	// while ( ( ( DMA1->ISR ) & DMA_FLAG_SPI_SD_TC_RX ) == RESET ) { ; }
+	/* Wait until DMA RX Channel Receive Complete, TX is complete before */
+	if (wait_in_thread) {
+		/* thread_sleep() enables interrupts after the thread is marked as sleeping,
+		   the wake up can't be lost */
+		while (!dma_done) {
+			thread_sleep();
+			disableIRQ();
+		}
+		dma_waiter = KERNEL_PID_UNDEF;
+		SPI_DMA_RX_callback_assign(DMA_SPI_SD_INDEX, NULL);
+	} else {
+		while (DMA_GetFlagStatus(DMA_FLAG_SPI_SD_TC_RX) == RESET) { ; }
+	}
+
+	restoreIRQ(irq_state);
 
 	/* Disable DMA RX Channel */
 	DMA_Cmd(DMA_Channel_SPI_SD_RX, DISABLE);
@@ -501,6 +585,8 @@ void stm32_dma_transfer(
 
 	/* Disable SPI RX/TX request */
 	SPI_I2S_DMACmd(SPI_SD, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, DISABLE);
+
+	DMA_ClearFlag(DMA_FLAG_SPI_SD_GL_RX | DMA_FLAG_SPI_SD_GL_TX);
 }
 #endif /* STM32_SD_USE_DMA */
 
@@ -570,6 +656,17 @@ void power_on (void)
 #ifdef STM32_SD_USE_DMA
 	/* enable DMA clock */
 	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+	/* DMA RX transfer complete interrupt wakes up the waiting thread */
+	{
+		NVIC_InitTypeDef NVIC_InitStructure;
+
+		NVIC_InitStructure.NVIC_IRQChannel = DMA_IRQn_SPI_SD_RX;
+		NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+		NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+		NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+		NVIC_Init(&NVIC_InitStructure);
+	}
 #endif
 }
 
@@ -742,7 +839,7 @@ BYTE send_cmd (
 /* Initialize Disk Drive                                                 */
 /*-----------------------------------------------------------------------*/
 
-DSTATUS disk_initialize (
+DSTATUS sd_disk_initialize (
 	BYTE drv		/* Physical drive number (0) */
 )
 {
@@ -811,7 +908,7 @@ DSTATUS disk_status (
 /* Read Sector(s)                                                        */
 /*-----------------------------------------------------------------------*/
 
-DRESULT disk_read (
+DRESULT sd_disk_read (
 	BYTE drv,			/* Physical drive number (0) */
 	BYTE *buff,			/* Pointer to the data buffer to store read data */
 	DWORD sector,		/* Start sector number (LBA) */
@@ -854,13 +951,17 @@ DRESULT disk_read (
 
 #if _FS_READONLY == 0
 
-DRESULT disk_write (
+static
+DRESULT sd_write (
 	BYTE drv,			/* Physical drive number (0) */
-	const BYTE *buff,	/* Pointer to the data to be written */
+	const BYTE *buff,	/* Pointer to the data to be written (contiguous) */
+	const BYTE *const *blocks,	/* or pointers to each data block, NULL: use buff */
 	DWORD sector,		/* Start sector number (LBA) */
 	UINT count			/* Sector count (1..255) */
 )
 {
+	UINT n = 0;
+
 	if (drv || !count) return RES_PARERR;
 	if (Stat & STA_NOINIT) return RES_NOTRDY;
 	if (Stat & STA_PROTECT) return RES_WRPRT;
@@ -869,14 +970,14 @@ DRESULT disk_write (
 
 	if (count == 1) {	/* Single block write */
 		if ((send_cmd(CMD24, sector) == 0)	/* WRITE_BLOCK */
-			&& xmit_datablock(buff, 0xFE))
+			&& xmit_datablock(blocks ? blocks[0] : buff, 0xFE))
 			count = 0;
 	}
 	else {				/* Multiple block write */
 		if (CardType & CT_SDC) send_cmd(ACMD23, count);
 		if (send_cmd(CMD25, sector) == 0) {	/* WRITE_MULTIPLE_BLOCK */
 			do {
-				if (!xmit_datablock(buff, 0xFC)) break;
+				if (!xmit_datablock(blocks ? blocks[n++] : buff, 0xFC)) break;
 				buff += 512;
 			} while (--count);
 			if (!xmit_datablock(0, 0xFD))	/* STOP_TRAN token */
@@ -887,6 +988,27 @@ DRESULT disk_write (
 
 	return count ? RES_ERROR : RES_OK;
 }
+
+DRESULT sd_disk_write (
+	BYTE drv,			/* Physical drive number (0) */
+	const BYTE *buff,	/* Pointer to the data to be written */
+	DWORD sector,		/* Start sector number (LBA) */
+	UINT count			/* Sector count (1..255) */
+)
+{
+	return sd_write(drv, buff, 0, sector, count);
+}
+
+/* Same as sd_disk_write, but blocks are scattered, e.g. sectors of a cache */
+DRESULT sd_disk_write_blocks (
+	BYTE drv,			/* Physical drive number (0) */
+	const BYTE *const *blocks,	/* Pointers to 512 byte data blocks to be written */
+	DWORD sector,		/* Start sector number (LBA) */
+	UINT count			/* Sector count (1..255) */
+)
+{
+	return sd_write(drv, 0, blocks, sector, count);
+}
 #endif /* _READONLY == 0 */
 
 
@@ -896,7 +1018,7 @@ DRESULT disk_write (
 /*-----------------------------------------------------------------------*/
 
 #if (STM32_SD_DISK_IOCTRL == 1)
-DRESULT disk_ioctl (
+DRESULT sd_disk_ioctl (
 	BYTE drv,		/* Physical drive number (0) */
 	BYTE ctrl,		/* Control code */
 	void *buff		/* Buffer to send/receive control data */
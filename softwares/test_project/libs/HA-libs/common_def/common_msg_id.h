@@ -17,6 +17,8 @@ enum common_msg_id: uint16_t {
 
     /* 6lowpan communications */
     SIXLOWPAN_RESTART,
+    SIXLOWPAN_ACK_RECEIVED, /* receiver -> sender, content.value: node id << 16 | credits */
+    SIXLOWPAN_SEND_ACK,     /* receiver -> sender, content.value: node id to ack */
 
     /* this will be used to chain with other enum of CC and node */
     /* ALWAYS KEEP it at THE END */
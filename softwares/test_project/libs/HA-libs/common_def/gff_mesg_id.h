@@ -26,6 +26,7 @@ enum mesg_type_e: uint16_t { /* in GFF format */
     SET_NEW_SCENE = 0x0009,
     SET_REMOVE_SCENE = 0x000A,
     SET_RENAME_INACT_SCENE = 0x000B,
+    SET_DEVS_DUMP = 0x000C,
 
     GET_DEV_VAL = 0x0100,
     GET_NUM_OF_DEVS = 0x0101,
@@ -36,8 +37,12 @@ enum mesg_type_e: uint16_t { /* in GFF format */
     GET_NUM_OF_RULES = 0x0106,
     GET_RULE_WITH_INDEXS = 0x0107,
     GET_ZONE_NAME = 0x0108,
+    GET_DEVS_DUMP = 0x0109,
 
     ALIVE = 0x0200,
+    NODE_ALIVE = 0x0201, /* one heartbeat for all devices of a node */
+
+    SLP_ACK = 0x0400, /* 6LoWPAN transport only, never forwarded to threads */
 };
 
 const uint16_t GFF_MAX_DATA_SIZE = 255;
@@ -52,6 +57,7 @@ const uint8_t GFF_DATA_POS = GFF_CMD_POS + GFF_CMD_SIZE;
 enum gff_data_len_e: uint8_t {
     SET_DEV_VAL_DATA_LEN = 6, /* device_id + value */
     ALIVE_DATA_LEN = 4, /* device_id */
+    SLP_ACK_DATA_LEN = 3, /* credits + node id of acking node */
 
     SET_NUM_OF_DEVS_DATA_LEN = 4,
     SET_DEVICE_WITH_INDEX_DATA_LEN = 10,
@@ -73,8 +79,39 @@ enum gff_data_len_e: uint8_t {
     SET_NEW_SCENE_DATA_LEN = 8,
     SET_REMOVE_SCENE_DATA_LEN = 8,
     SET_RENAME_INACT_SCENE_DATA_LEN = 16,
+
+    GET_DEVS_DUMP_DATA_LEN = 6, /* start index (2) + since seq (4) */
+    DEVS_DUMP_HDR_LEN = 8, /* seq (4) + flags (1) + next index (2) + num of records (1) */
+    DEVS_DUMP_RECORD_LEN = 8, /* device_id (4) + value (2) + ttl (2) */
+
+    NODE_ALIVE_HDR_LEN = 1, /* num of devices (1) */
+    NODE_ALIVE_RECORD_LEN = 4, /* device_id (4) */
 };
 
+/*
+ * Bulk dump of devices (paged).
+ * GET_DEVS_DUMP: | start index (2) | since seq (4) |
+ *      since seq = 0 for a full dump, otherwise only devices changed after since seq.
+ * SET_DEVS_DUMP: | seq (4) | flags (1) | next index (2) | num of records (1) | records |
+ *      seq: current change sequence number, client should keep seq of the first page
+ *      and use it as since seq for the next delta dump. Its 8 MSBs are a boot epoch,
+ *      since seq of an earlier boot always gets a full dump.
+ *      next index: start index for the next page, DEVS_DUMP_NO_MORE_PAGE if this is the last page.
+ *      flags: DEVS_DUMP_FULL if this is a full dump (delta was not available), client
+ *      should drop devices not listed.
+ */
+const uint8_t DEVS_DUMP_MAX_RECORDS = (GFF_MAX_DATA_SIZE - DEVS_DUMP_HDR_LEN) / DEVS_DUMP_RECORD_LEN;
+const uint16_t DEVS_DUMP_NO_MORE_PAGE = 0xFFFF;
+const uint8_t DEVS_DUMP_FULL = 0x01;
+
+/*
+ * Node heartbeat.
+ * NODE_ALIVE: | num of devices (1) | device_id (4) * num of devices |
+ *      sent by a node once per alive period for all of its running devices, instead of
+ *      one ALIVE frame per device.
+ */
+const uint8_t NODE_ALIVE_MAX_RECORDS = (GFF_MAX_DATA_SIZE - NODE_ALIVE_HDR_LEN) / NODE_ALIVE_RECORD_LEN;
+
 const uint32_t SET_DEV_WITH_INDEX_ALL_DEVS = 0xFFFFFFFF;
 
 };
@@ -4,6 +4,11 @@
  * @version 1.0
  * @date 21-10-2014
  * @brief This is header file for ADC device class for HA system.
+ *
+ * ADC devices share one scan of ADC1: the channels of all devices configured by
+ * adc_dev_scan_configure are converted continuously, DMA keeps the last
+ * samples of each channel in memory. Reading a value doesn't touch the ADC.
+ * ADC3 only channels (ADC3_IN4..IN9 on port F) are polled as before.
  */
 #ifndef __HA_ADC_DEVICE_H_
 #define __HA_ADC_DEVICE_H_
@@ -43,7 +48,43 @@ protected:
      * @return Converted ADC value.
      */
     uint16_t adc_dev_get_value(void);
+
+    /**
+     * @brief Initialize GPIO and add the channel to the shared ADC1 scan.
+     *
+     * @param[in] port      The port has a functional ADC.
+     * @param[in] pin       The pin has a functional ADC.
+     * @param[in] adc_x     Chosen ADC (ADC1, ADC2 or ADC3).
+     * @param[in] channel   The specified channel on the chosen ADC.
+     */
+    void adc_dev_scan_configure(port_t port, uint8_t pin, adc_t adc_x,
+            uint8_t channel);
+
+    /**
+     * @brief Remove the channel from the shared ADC1 scan.
+     */
+    void adc_dev_scan_remove(void);
+
+    /**
+     * @brief Get the latest converted adc value of the channel.
+     *
+     * @return Converted ADC value.
+     */
+    uint16_t adc_dev_get_latest(void);
+
+    /**
+     * @brief Get average of the last adc_scan_oversampling converted values of
+     * the channel.
+     *
+     * @return Averaged ADC value.
+     */
+    uint16_t adc_dev_get_average(void);
 private:
+    adc_config_params_t scan_params;
+    bool scan_configured = false;   // configured by adc_dev_scan_configure
+    bool scan_polled = false;       // channel isn't on ADC1, polled instead
+
+    uint16_t adc_dev_poll_value(void);
 };
 
 #endif //__HA_ADC_DEVICE_H_
@@ -5,8 +5,35 @@
  * @date 21-10-2014
  * @brief This is source file for ADC device class for HA system.
  */
+extern "C" {
+#include "mutex.h"
+}
+
 #include "ADC_device.h"
 
+/* shared ADC1 scan */
+const static uint8_t adc_scan_oversampling = 16; //samples kept per channel
+const static uint8_t adc_scan_sample_time = ADC_SampleTime_239Cycles5; //21us per conversion
+
+static adc scan_adc;
+static mutex_t scan_mutex = MUTEX_INIT;
+static uint8_t scan_channels[adc_ns::scan_channels_max];
+static uint8_t scan_users[adc_ns::scan_channels_max]; //number of devices on each channel
+static uint8_t scan_channel_count = 0;
+static volatile uint16_t scan_buffer[adc_ns::scan_channels_max * adc_scan_oversampling];
+
+/**
+ * @brief Restart the shared scan with the current channel list. scan_mutex must be locked.
+ */
+static void scan_restart(void);
+
+/**
+ * @brief Find rank of channel in the shared scan. scan_mutex must be locked.
+ *
+ * @return rank, or -1 if the channel isn't scanned.
+ */
+static int8_t scan_find(uint8_t channel);
+
 adc_dev_class::adc_dev_class(void)
 {
 
@@ -45,3 +72,153 @@ uint16_t adc_dev_class::adc_dev_get_value(void)
 {
     return adc_convert();
 }
+
+void adc_dev_class::adc_dev_scan_configure(port_t port, uint8_t pin, adc_t adc_x,
+        uint8_t channel)
+{
+    gpio_params_t gpio_params;
+    int8_t rank;
+
+    adc_dev_scan_remove();
+
+    scan_params.device_port = port;
+    scan_params.device_pin = pin;
+    scan_params.adc_x = adc_x;
+    scan_params.adc_channel = channel;
+    scan_configured = true;
+
+    /* ADC1/ADC2 channels and ADC3_IN0..3, IN10..13 are on the same pins as ADC1's */
+    scan_polled = (adc_x == adc3) && (channel >= 4) && (channel <= 9);
+    if (scan_polled) {
+        return;
+    }
+
+    gpio_params.port = port;
+    gpio_params.pin = pin;
+    gpio_params.mode = in_analog;
+    gpio_init(&gpio_params);
+
+    mutex_lock(&scan_mutex);
+
+    rank = scan_find(channel);
+    if (rank >= 0) {
+        scan_users[rank]++;
+    } else if (scan_channel_count < adc_ns::scan_channels_max) {
+        scan_channels[scan_channel_count] = channel;
+        scan_users[scan_channel_count] = 1;
+        scan_channel_count++;
+        scan_restart();
+    }
+
+    mutex_unlock(&scan_mutex);
+}
+
+void adc_dev_class::adc_dev_scan_remove(void)
+{
+    int8_t rank;
+
+    if (!scan_configured) {
+        return;
+    }
+    scan_configured = false;
+
+    if (scan_polled) {
+        return;
+    }
+
+    mutex_lock(&scan_mutex);
+
+    rank = scan_find(scan_params.adc_channel);
+    if (rank >= 0 && --scan_users[rank] == 0) {
+        for (uint8_t i = rank; i < scan_channel_count - 1; i++) {
+            scan_channels[i] = scan_channels[i + 1];
+            scan_users[i] = scan_users[i + 1];
+        }
+        scan_channel_count--;
+        scan_restart();
+    }
+
+    mutex_unlock(&scan_mutex);
+}
+
+uint16_t adc_dev_class::adc_dev_get_latest(void)
+{
+    uint16_t value = 0;
+    int8_t rank;
+
+    if (!scan_configured) {
+        return 0;
+    }
+    if (scan_polled) {
+        return adc_dev_poll_value();
+    }
+
+    mutex_lock(&scan_mutex);
+    rank = scan_find(scan_params.adc_channel);
+    if (rank >= 0) {
+        value = scan_adc.adc_scan_latest(rank);
+    }
+    mutex_unlock(&scan_mutex);
+
+    return value;
+}
+
+uint16_t adc_dev_class::adc_dev_get_average(void)
+{
+    uint16_t value = 0;
+    int8_t rank;
+
+    if (!scan_configured) {
+        return 0;
+    }
+    if (scan_polled) {
+        return adc_dev_poll_value();
+    }
+
+    mutex_lock(&scan_mutex);
+    rank = scan_find(scan_params.adc_channel);
+    if (rank >= 0) {
+        value = scan_adc.adc_scan_average(rank);
+    }
+    mutex_unlock(&scan_mutex);
+
+    return value;
+}
+
+uint16_t adc_dev_class::adc_dev_poll_value(void)
+{
+    /* reconfigure, the ADC may be used by another device */
+    adc_dev_configure(scan_params.device_port, scan_params.device_pin,
+            scan_params.adc_x, scan_params.adc_channel);
+
+    return adc_dev_get_value();
+}
+
+static void scan_restart(void)
+{
+    adc_scan_params_t params;
+
+    scan_adc.adc_scan_stop();
+    if (scan_channel_count == 0) {
+        return;
+    }
+
+    params.adc = adc1;
+    params.channels = scan_channels;
+    params.num_channels = scan_channel_count;
+    params.adc_sample_time = adc_scan_sample_time;
+    params.buffer = scan_buffer;
+    params.num_samples = adc_scan_oversampling;
+    scan_adc.adc_scan_start(&params);
+}
+
+static int8_t scan_find(uint8_t channel)
+{
+    for (uint8_t i = 0; i < scan_channel_count; i++) {
+        if (scan_channels[i] == channel) {
+            return i;
+        }
+    }
+
+    return -1;
+}
@@ -24,6 +24,7 @@ extern "C" {
 #endif //AUTO_UPDATE
 
 #include "ADC_device.h"
+#include "adc_cal.h"
 
 namespace adc_sensor_ns {
 typedef enum {
@@ -75,6 +76,16 @@ public:
      */
     void set_equation_params(float* equation_params_buff, uint8_t buff_size);
 
+    /**
+     * @brief Compile equations set by set_equation_type/set_equation_params into a
+     * fixed-point plan (adc_cal_plan), used by get_sensor_value from now on.
+     * Buffers of equations must stay valid, they are used for codes the plan
+     * doesn't cover.
+     *
+     * @return true if compiled, otherwise equations are interpreted in float.
+     */
+    bool compile_equations(void);
+
     /**
      * @brief Get value calculated from the equations.
      *
@@ -131,8 +142,7 @@ public:
     kernel_pid_t get_pid(void);
 #endif //SND_MSG
 private:
-    float get_voltage_value(void);
-    float cal_iterative_equations(float first_value);
+    float get_voltage_value(uint16_t adc_value);
 
     float* equation_params_buffer = NULL;
     char* equation_type_buffer = NULL;
@@ -141,6 +151,8 @@ private:
 
     adc_config_params_t adc_params;
 
+    adc_cal_plan* cal_plan = NULL;
+
 #if AUTO_UPDATE
     bool is_under_or_overflow;
     uint16_t delta_thres = 0;
@@ -166,15 +178,10 @@ private:
 };
 
 #if AUTO_UPDATE
+/* adc_sensor_callback_timer_isr() is called every adc_sensor_callback_period TIM6 ticks (ms) */
+const uint16_t adc_sensor_callback_period = 100;
+
 void adc_sensor_callback_timer_isr(void);
 #endif //AUTO_UPDATE
 
-float linear_equation_calculate(float x_value, float a, float b); //y = ax+b;
-
-float rational_equation_calculate(float x_value, float a, float b, float c); //y = 1/(ax+b)+c;
-
-float polynomial_equation_calculate(float x_value, float a, float b, float c); //y = ax^b+c;
-
-float lookup_table(float value, float* defined_table, uint8_t table_size);
-
 #endif //__HA_ADC_SENSOR_DRIVER_H_
@@ -92,6 +92,9 @@ private:
     void remove_btn_sw(void);
 };
 
+/* btn_sw_callback_timer_isr() is called every btn_sw_callback_period TIM6 ticks (ms) */
+const uint16_t btn_sw_callback_period = 10;
+
 void btn_sw_callback_timer_isr(void);
 
 #endif //__HA_BUTTON_SWITCH_DRIVER_H_
@@ -76,6 +76,9 @@ private:
 };
 
 #if AUTO_UPDATE
+/* dimmer_callback_timer_isr() is called every dimmer_callback_period TIM6 ticks (ms) */
+const uint16_t dimmer_callback_period = 100;
+
 void dimmer_callback_timer_isr(void);
 #endif
 
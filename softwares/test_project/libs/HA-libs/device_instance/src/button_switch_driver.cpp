@@ -7,17 +7,17 @@
  */
 #include "button_switch_driver.h"
 #include "ha_host_glb.h"
+#include "ha_workq.h"
 
 using namespace btn_sw_ns;
 
 /* configurable variables */
 const uint8_t btn_sw_active_state = 0; //active low-level
 const static uint8_t timer_period = 1; //ms
-const uint8_t btn_sw_sampling_time_cycle = 10 / timer_period; //sampling every 10ms (tim6_period = 1ms)
+const uint8_t btn_sw_sampling_time_cycle = btn_sw_callback_period / timer_period; //sampling every 10ms (tim6_period = 1ms)
 const uint16_t btn_hold_time = 1 * 1000 / btn_sw_sampling_time_cycle; //btn is on hold after holding 1s.
 
 button_switch_instance* btn_sw_table[ha_host_ns::max_end_point]; //button&switch table
-static uint8_t time_cycle_count = 0;
 static bool table_init = false;
 
 /**
@@ -195,31 +195,36 @@ static void btn_sw_table_init(void)
     }
 }
 
-void btn_sw_callback_timer_isr(void)
+/**
+ * @brief Buttons/switches debounce, runs in work queue thread.
+ */
+static void btn_sw_work_func(void)
 {
-    time_cycle_count = time_cycle_count + 1;
-
-    if (time_cycle_count == btn_sw_sampling_time_cycle) {
-        time_cycle_count = 0;
-        for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-            if (btn_sw_table[i] != NULL) {
-                btn_sw_table[i]->btn_sw_processing();
+    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
+        if (btn_sw_table[i] != NULL) {
+            btn_sw_table[i]->btn_sw_processing();
 #if SND_MSG
-                if (btn_sw_table[i]->is_changed_status()) {
-                    msg_t msg;
-                    msg.type = BTN_SW_MSG;
-                    msg.content.value =
-                            (uint32_t) btn_sw_table[i]->get_status();
-                    kernel_pid_t pid = btn_sw_table[i]->get_pid();
-                    if (pid == KERNEL_PID_UNDEF) {
-                        return;
-                    }
-                    msg_send(&msg, pid, false);
+            if (btn_sw_table[i]->is_changed_status()) {
+                msg_t msg;
+                msg.type = BTN_SW_MSG;
+                msg.content.value =
+                        (uint32_t) btn_sw_table[i]->get_status();
+                kernel_pid_t pid = btn_sw_table[i]->get_pid();
+                if (pid == KERNEL_PID_UNDEF) {
+                    return;
                 }
-#endif //SND_MSG
+                msg_send(&msg, pid, false);
             }
-        } //end for()
-    } //end if()
+#endif //SND_MSG
+        }
+    } //end for()
+}
+
+static ha_workq_ns::work_t btn_sw_work = HA_WORK_INIT(btn_sw_work_func);
+
+void btn_sw_callback_timer_isr(void)
+{
+    ha_workq_post(&btn_sw_work);
 }
 
 #if SND_MSG
@@ -9,6 +9,7 @@
 #include "dimmer_driver.h"
 #if AUTO_UPDATE
 #include "ha_host_glb.h"
+#include "ha_workq.h"
 #endif
 
 using namespace dimmer_ns;
@@ -16,13 +17,10 @@ using namespace dimmer_ns;
 #if AUTO_UPDATE
 /* configurable variables */
 const static uint8_t delta_threshold = 3; //delta = 3%;
-const static uint8_t timer_period = 1; //ms
-const static uint16_t dimmer_sampling_time_cycle = 100 / timer_period; //sampling every 100ms (tim6_period = 1ms)
 
 /* internal variables */
 static bool table_init = false;
 static dimmer_instance* dimmer_table[ha_host_ns::max_end_point];
-static uint16_t time_cycle_count = 0;
 
 /* internal function */
 static void dimmer_table_init(void);
@@ -49,15 +47,16 @@ dimmer_instance::~dimmer_instance()
 #if AUTO_UPDATE
     this->remove_dimmer();
 #endif //AUTO_UPDATE
+    adc_dev_scan_remove();
 }
 
 void dimmer_instance::device_configure(adc_config_params_t *adc_config_params)
 {
-    adc_dev_configure(adc_config_params->device_port,
+    adc_dev_scan_configure(adc_config_params->device_port,
             adc_config_params->device_pin, adc_config_params->adc_x,
             adc_config_params->adc_channel);
 
-    memcpy(&adc_params, adc_config_params, sizeof(adc_config_params));
+    memcpy(&adc_params, adc_config_params, sizeof(*adc_config_params));
 #if AUTO_UPDATE
     this->assign_dimmer();
 #endif //AUTO_UPDATE
@@ -67,11 +66,7 @@ uint8_t dimmer_instance::get_percent(void)
 {
     uint16_t adc_value;
 
-    adc_dev_configure(adc_params.device_port,
-                adc_params.device_pin, adc_params.adc_x,
-                adc_params.adc_channel);
-
-    adc_value = adc_dev_get_value();
+    adc_value = adc_dev_get_latest();
 
     return adc_value * 100 / adc_value_max;
 }
@@ -141,30 +136,35 @@ void dimmer_instance::remove_dimmer(void)
     }
 }
 
-void dimmer_callback_timer_isr(void)
+/**
+ * @brief Dimmers sampling, runs in work queue thread.
+ */
+static void dimmer_work_func(void)
 {
-    time_cycle_count = time_cycle_count + 1;
-
-    if (time_cycle_count == dimmer_sampling_time_cycle) {
-        time_cycle_count = 0;
-        for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-            if (dimmer_table[i] != NULL) {
-                uint8_t new_value = dimmer_table[i]->dimmer_processing();
+    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
+        if (dimmer_table[i] != NULL) {
+            uint8_t new_value = dimmer_table[i]->dimmer_processing();
 #if SND_MSG
-                if (dimmer_table[i]->is_over_delta_thres() || dimmer_table[i]->is_first_send) {
-                    dimmer_table[i]->is_first_send = false;
-                    msg_t msg;
-                    msg.type = DIMMER_MSG;
-                    msg.content.value = new_value;
-                    kernel_pid_t pid = dimmer_table[i]->get_pid();
-                    if (pid == KERNEL_PID_UNDEF) {
-                        return;
-                    }
-                    msg_send(&msg, pid, false);
+            if (dimmer_table[i]->is_over_delta_thres() || dimmer_table[i]->is_first_send) {
+                dimmer_table[i]->is_first_send = false;
+                msg_t msg;
+                msg.type = DIMMER_MSG;
+                msg.content.value = new_value;
+                kernel_pid_t pid = dimmer_table[i]->get_pid();
+                if (pid == KERNEL_PID_UNDEF) {
+                    return;
                 }
-#endif //SND_MSG
+                msg_send(&msg, pid, false);
             }
+#endif //SND_MSG
         }
     }
 }
+
+static ha_workq_ns::work_t dimmer_work = HA_WORK_INIT(dimmer_work_func);
+
+void dimmer_callback_timer_isr(void)
+{
+    ha_workq_post(&dimmer_work);
+}
 #endif //AUTO_UPDATE
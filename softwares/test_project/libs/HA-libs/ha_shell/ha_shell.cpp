@@ -34,9 +34,12 @@ const shell_command_t shell_commands[] = {
     {"cd", "Change working directory", cd},
     {"pwd", "Print name of current/working directory", pwd},
     {"mv", "Rename file/folder", mv},
+    {"fscache", "Print disk sector cache hit/miss counters", fscache},
+    {"fsbench", "Measure FAT FS sequential/random 512-byte I/O speed", fsbench},
 
     /* time cmds */
     {"date", "Print or set the system date and time", date},
+    {"tickstat", "Print TIM6 sub ISRs period, phase and max duration", tickstat},
 
     /* sixlowpan cmds */
 //    {"6lowpan", "6LoWPAN network stack configurations", sixlowpan_config},
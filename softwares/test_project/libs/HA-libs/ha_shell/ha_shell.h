@@ -18,6 +18,7 @@ extern "C" {
 
 /* Includes other shell commands modules */
 #include "shell_cmds_fatfs.h"
+#include "shell_cmds_fatfs_bench.h"
 #include "shell_cmds_time.h"
 
 #ifdef HA_HOST
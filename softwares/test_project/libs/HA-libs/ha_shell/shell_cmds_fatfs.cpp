@@ -61,6 +61,11 @@ const char pwd_usage[] = "Usage:\n"
         "Note: total path name is limited to ";
 const uint16_t PWD_MAX_PATH_LEN = 64;
 
+const char fscache_usage[] = "Usage:\n"
+        "fscache, print hit/miss counters of disk sector cache.\n"
+        "fscache -r, reset counters.\n"
+        "fscache -h, get this help.\n";
+
 /*------------------- Global var for FAT FS ----------------------------------*/
 static FATFS fatfs;
 
@@ -470,6 +475,45 @@ void pwd(int argc, char** argv) {
     printf("%s\n", path);
 }
 
+/*----------------------------------------------------------------------------*/
+void fscache(int argc, char** argv)
+{
+    DISK_CACHE_STATS stats;
+    uint32_t reads, writes;
+
+    if (argc > 2) {
+        printf("Err: wrong number of arguments\n");
+        return;
+    }
+    if (argc == 2) {
+        switch ((argv[1][0] == '-') ? argv[1][1] : 0) {
+        case 'h':
+            printf("%s", fscache_usage);
+            return;
+        case 'r':
+            disk_cache_stats_reset();
+            return;
+        default:
+            printf("Err: unknow option.\n");
+            return;
+        }
+    }
+
+    disk_cache_stats(&stats);
+    reads = stats.read_hits + stats.read_misses;
+    writes = stats.write_hits + stats.write_misses;
+
+    printf("cache: %u sectors, %u dirty\n", stats.size, stats.dirty);
+    printf("read: %lu hits, %lu misses, hit rate %lu%%\n",
+            stats.read_hits, stats.read_misses,
+            (reads != 0) ? stats.read_hits * 100 / reads : 0);
+    printf("write: %lu hits, %lu misses, hit rate %lu%%\n",
+            stats.write_hits, stats.write_misses,
+            (writes != 0) ? stats.write_hits * 100 / writes : 0);
+    printf("write back: %lu sectors in %lu commands\n",
+            stats.write_backs, stats.write_cmds);
+}
+
 /*----------------------------------------------------------------------------*/
 void print_ferr(FRESULT res)
 {
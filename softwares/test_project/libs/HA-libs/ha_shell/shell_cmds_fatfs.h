@@ -123,6 +123,17 @@ void cd(int argc, char** argv);
  */
 void pwd(int argc, char** argv);
 
+/**
+ * @brief   Print hit/miss counters of disk sector cache (diskio.c).
+ *
+ * @details Usage: fscache [-r]
+ *                 `fscache -r` reset the counters.
+ *
+ * @param[in] argc  Argument count
+ * @param[in] argv  Arguments
+ */
+void fscache(int argc, char** argv);
+
 /**
  * @brief   Print error of FAT file system module.
  *
@@ -0,0 +1,215 @@
+/**
+ * @file shell_cmds_fatfs_bench.cpp
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @date 17-Oct-2026
+ * @brief Implementation for FAT-FS throughput benchmark shell command.
+ * Each sector sized f_read/f_write is passed by FatFs directly to disk_read/disk_write
+ * (_FS_TINY), so results show the SD/SPI driver speed plus FatFs overhead.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+extern "C" {
+#include "vtimer.h"
+}
+
+#include "shell_cmds_fatfs_bench.h"
+#include "shell_cmds_fatfs.h"
+#include "ff.h"
+
+/*------------------- Const and Definitions ----------------------------------*/
+const char fsbench_usage[] = "Usage:\n"
+        "fsbench [size in KB], measure sequential and random 512-byte I/O speed\n"
+        "with a temporary file (default 128 KB).\n"
+        "fsbench -h, get this help.\n";
+const char fsbench_file[] = "0:/fsbench.tmp";
+const uint16_t fsbench_io_size = 512;
+const uint32_t fsbench_default_size = 128; //KB
+const uint32_t fsbench_max_size = 4096; //KB
+
+/*------------------- Static vars and functions ------------------------------*/
+static uint8_t fsbench_buf[fsbench_io_size];
+static uint32_t fsbench_rand_state;
+
+typedef enum : uint8_t {
+    seq_write,
+    seq_read,
+    rand_read,
+    rand_write
+} fsbench_test_t;
+
+static const char* const fsbench_test_names[] = {
+        "seq write", "seq read", "rand read", "rand write"
+};
+
+static uint32_t fsbench_rand(void);
+static void fsbench_fill(uint32_t block);
+static bool fsbench_check(uint32_t block);
+static FRESULT fsbench_run(FIL *file, fsbench_test_t test, uint32_t num_of_blocks,
+        uint32_t &errors);
+static void fsbench_print(fsbench_test_t test, uint32_t bytes, uint32_t usec);
+
+/*----------------------------------------------------------------------------*/
+void fsbench(int argc, char** argv)
+{
+    uint32_t size = fsbench_default_size;
+    uint32_t num_of_blocks, errors;
+    timex_t start, end;
+    FRESULT fres;
+    FIL file;
+
+    if (argc > 2) {
+        printf("Err: wrong number of arguments\n");
+        return;
+    }
+    if (argc == 2) {
+        if (argv[1][0] == '-') {
+            if (argv[1][1] == 'h') {
+                printf("%s", fsbench_usage);
+            }
+            else {
+                printf("Err: unknow option.\n");
+            }
+            return;
+        }
+
+        size = strtoul(argv[1], NULL, 10);
+        if (size == 0 || size > fsbench_max_size) {
+            printf("Err: size must be 1..%lu KB\n", (unsigned long) fsbench_max_size);
+            return;
+        }
+    }
+    num_of_blocks = size * 1024 / fsbench_io_size;
+
+    fres = f_open(&file, fsbench_file, FA_CREATE_ALWAYS | FA_READ | FA_WRITE);
+    if (fres != FR_OK) {
+        print_ferr(fres);
+        return;
+    }
+
+    fsbench_rand_state = 1;
+    errors = 0;
+    for (uint8_t test = seq_write; test <= rand_write; test++) {
+        vtimer_now(&start);
+        fres = fsbench_run(&file, (fsbench_test_t) test, num_of_blocks, errors);
+        vtimer_now(&end);
+
+        if (fres != FR_OK) {
+            print_ferr(fres);
+            break;
+        }
+        fsbench_print((fsbench_test_t) test, num_of_blocks * fsbench_io_size,
+                (uint32_t) timex_uint64(timex_sub(end, start)));
+    }
+
+    if (errors != 0) {
+        printf("Err: %lu sectors read back with wrong data\n", (unsigned long) errors);
+    }
+
+    f_close(&file);
+    f_unlink(fsbench_file);
+}
+
+/*----------------------------------------------------------------------------*/
+static uint32_t fsbench_rand(void)
+{
+    fsbench_rand_state = fsbench_rand_state * 1103515245 + 12345;
+
+    return fsbench_rand_state >> 16;
+}
+
+/*----------------------------------------------------------------------------*/
+static void fsbench_fill(uint32_t block)
+{
+    for (uint16_t count = 0; count < fsbench_io_size; count++) {
+        fsbench_buf[count] = (uint8_t)(block + count);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static bool fsbench_check(uint32_t block)
+{
+    for (uint16_t count = 0; count < fsbench_io_size; count++) {
+        if (fsbench_buf[count] != (uint8_t)(block + count)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+static FRESULT fsbench_run(FIL *file, fsbench_test_t test, uint32_t num_of_blocks,
+        uint32_t &errors)
+{
+    FRESULT fres;
+    UINT bytes;
+    uint32_t block;
+
+    if (test == seq_write || test == seq_read) {
+        fres = f_lseek(file, 0);
+        if (fres != FR_OK) {
+            return fres;
+        }
+    }
+
+    for (uint32_t count = 0; count < num_of_blocks; count++) {
+        if (test == seq_write || test == seq_read) {
+            block = count;
+        }
+        else {
+            block = fsbench_rand() % num_of_blocks;
+            fres = f_lseek(file, block * fsbench_io_size);
+            if (fres != FR_OK) {
+                return fres;
+            }
+        }
+
+        if (test == seq_write || test == rand_write) {
+            fsbench_fill(block);
+            fres = f_write(file, fsbench_buf, fsbench_io_size, &bytes);
+        }
+        else {
+            fres = f_read(file, fsbench_buf, fsbench_io_size, &bytes);
+            if (fres == FR_OK && !fsbench_check(block)) {
+                errors++;
+            }
+        }
+
+        if (fres != FR_OK) {
+            return fres;
+        }
+        if (bytes != fsbench_io_size) {
+            return FR_DENIED; /* disk full */
+        }
+    }
+
+    /* written data is on the card when the test ends */
+    if (test == seq_write || test == rand_write) {
+        return f_sync(file);
+    }
+
+    return FR_OK;
+}
+
+/*----------------------------------------------------------------------------*/
+static void fsbench_print(fsbench_test_t test, uint32_t bytes, uint32_t usec)
+{
+    uint32_t kbps;
+
+    if (usec == 0) {
+        usec = 1;
+    }
+    kbps = (uint32_t)(((uint64_t) bytes * 1000000 / usec) >> 10);
+
+    printf("%s: %lu bytes in %lu us, %lu.%03lu MB/s\n",
+            fsbench_test_names[test],
+            (unsigned long) bytes,
+            (unsigned long) usec,
+            (unsigned long) (kbps >> 10),
+            (unsigned long) ((kbps & 0x3FF) * 1000 >> 10));
+}
@@ -0,0 +1,25 @@
+/**
+ * @file shell_cmds_fatfs_bench.h
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @date 17-Oct-2026
+ * @brief Header files for FAT-FS throughput benchmark shell command.
+ */
+
+#ifndef SHELL_CMDS_FATFS_BENCH_H_
+#define SHELL_CMDS_FATFS_BENCH_H_
+
+/**
+ * @brief   Measure SD card throughput through FAT FS, 512-byte (1 sector) I/O.
+ *
+ * @details Usage: fsbench [size in KB]
+ *                 Write a temporary file sequentially, read it sequentially, then
+ *                 read and write random sectors of it, and print MB/s of each test.
+ *                 Temporary file is removed afterwards.
+ *
+ * @param[in] argc  Argument count
+ * @param[in] argv  Arguments
+ */
+void fsbench(int argc, char** argv);
+
+#endif /* SHELL_CMDS_FATFS_BENCH_H_ */
@@ -14,10 +14,16 @@
 #include "shell_cmds_time.h"
 #include "MB1_System.h"
 
+extern uint32_t SystemCoreClock;
+
 const char date_usage[] = "Usage:\n"
         "date, show current system time.\n"
         "date mm dd yyyy hh mm ss, set system time to give time.\n";
 
+const char tickstat_usage[] = "Usage:\n"
+        "tickstat, show TIM6 sub ISRs period/phase (ms), calls and max duration.\n"
+        "tickstat -r, reset calls and max duration.\n";
+
 const char dayows[][4] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
 const char date_line[] = "%s, %u-%u-%u %02u:%02u:%02u\n";
 
@@ -50,3 +56,32 @@ void date(int argc, char** argv)
         printf("%s", date_usage);
     }
 }
+
+void tickstat(int argc, char** argv)
+{
+    ISRMgr_ns::tick_stats_t stats[ISRMgr_ns::numOfTickSubISR_max];
+    uint8_t count;
+
+    if (argc == 2 && strcmp(argv[1], "-r") == 0) {
+        MB1_ISRs.subISR_TIM6_tick_stats_reset();
+        return;
+    }
+    if (argc != 1) {
+        printf("%s", tickstat_usage);
+        return;
+    }
+
+    count = MB1_ISRs.subISR_TIM6_tick_stats(stats, ISRMgr_ns::numOfTickSubISR_max);
+
+    printf("%-10s %6s %6s %10s %10s %8s\n", "sub ISR", "period", "phase",
+            "calls", "max cyc", "max us");
+    for (uint8_t i = 0; i < count; i++) {
+        printf("%-10p %6u %6u %10lu %10lu %8lu\n",
+                (void*) stats[i].subISR_p,
+                stats[i].period,
+                stats[i].phase,
+                (unsigned long) stats[i].calls,
+                (unsigned long) stats[i].max_cycles,
+                (unsigned long) (stats[i].max_cycles / (SystemCoreClock / 1000000)));
+    }
+}
@@ -20,4 +20,16 @@
  */
 void date(int argc, char** argv);
 
+/**
+ * @brief   Print TIM6 tick scheduled sub ISRs.
+ *
+ * @details Usage:  tickstat, show period, phase, run count and max duration
+ *                  of each sub ISR.
+ *                  tickstat -r, reset run counts and max durations.
+ *
+ * @param[in] argc  Argument count
+ * @param[in] argv  Arguments
+ */
+void tickstat(int argc, char** argv);
+
 #endif /* SHELL_CMDS_TIME_H_ */
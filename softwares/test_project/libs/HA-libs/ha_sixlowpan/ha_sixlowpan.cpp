@@ -199,6 +199,16 @@ int16_t ha_slp_init(uint8_t interface, transceiver_type_t transceiver,
     return 0;
 }
 
+/*----------------------------------------------------------------------------*/
+void ha_slp_node_id_to_ipaddr(ipv6_addr_t *ipaddr, uint16_t node_id)
+{
+    /* RFC 6282 Section 3.2.2, hardware address is set to (uint8_t)node_id in ha_slp_init */
+    ipv6_addr_init(ipaddr,
+            NTOHS(ha_ns::sixlowpan_ipaddr.uint16[0]), NTOHS(ha_ns::sixlowpan_ipaddr.uint16[1]),
+            NTOHS(ha_ns::sixlowpan_ipaddr.uint16[2]), NTOHS(ha_ns::sixlowpan_ipaddr.uint16[3]),
+            0x0000, 0x00ff, 0xfe00, (uint8_t)node_id);
+}
+
 /*----------------------------------------------------------------------------*/
 void ha_slp_start_on_reset(Button *btn_p, const char *btn_prompt)
 {
@@ -10,6 +10,16 @@
  * | to node id (*) (2) | frame len (1) | flags (1) | index (2) | data |
  * (8) to node id: just a work around because without ND, we must send to multicast address.
  * flags: 0x00 if data, 0x01 if ack.
+ *
+ * Sixlowpan datagram format (in use):
+ * | to node id (2) | GFF frame | GFF frame | ... |
+ * All GFF frames in a datagram are for the same node, sender will coalesce them up to
+ * sixlowpan_payload_maxsize. Receiver answers every datagram holding data with a SLP_ACK
+ * GFF frame, each ack gives back sender a credit to send one more datagram.
+ *
+ * Datagrams are sent to unicast address of a node (see ha_slp_node_id_to_ipaddr) if that node
+ * has been heard recently, otherwise all nodes multicast address is used. to node id is still
+ * kept in datagram, so nodes can drop multicast datagrams which are not for them.
  */
 
 #ifndef HA_SIXLOWPAN_H_
@@ -25,7 +35,7 @@ extern "C" {
 #include "slp_sender.h"
 #include "slp_receiver.h"
 #include "common_msg_id.h"
-#include "cir_queue.h"
+#include "gff_queue.h"
 
 #include "MB1_System.h"
 
@@ -46,7 +56,7 @@ const transceiver_type_t sixlowpan_default_transceiver = TRANSCEIVER_DEFAULT;
 
 /* 6LoWPAN sender and receiver threads */
 extern kernel_pid_t sixlowpan_sender_pid;
-extern cir_queue sixlowpan_sender_gff_queue;
+extern gff_queue sixlowpan_sender_gff_queue;  /* GFF_PENDING messages carry handle of the frame */
 
 extern kernel_pid_t sixlowpan_receiver_pid;
 
@@ -59,6 +69,17 @@ extern char sixlowpan_netdev_type;
 
 const uint16_t sixlowpan_payload_maxsize = 256;
 const uint16_t sixlowpan_receiving_port = 1001;
+const uint8_t sixlowpan_node_id_size = 2;
+
+/* Neighbor cache for unicast, nodes which haven't been heard in sixlowpan_neighbor_ttl, or
+ * haven't answered sixlowpan_neighbor_max_unacked unicast datagrams will be sent with multicast */
+const uint8_t sixlowpan_neighbor_cache_size = 8;
+const uint32_t sixlowpan_neighbor_ttl = 300; /* in second */
+const uint8_t sixlowpan_neighbor_max_unacked = 3;
+
+/* Credit-based pacing for sender */
+const uint8_t sixlowpan_sender_max_credits = 4;
+const uint32_t sixlowpan_sender_credit_timeout = 20000; /* in us, a credit is given back if no ack */
 
 /* Frame format (for now, it will not be used) */
 const uint8_t sixlowpan_header_len = 4;
@@ -110,6 +131,16 @@ int16_t ha_slp_readconfig(const char* path, const char* pattern, uint16_t patter
 int16_t ha_slp_init(uint8_t interface, transceiver_type_t transceiver,
         uint16_t* prefixes_p, uint16_t node_id, char netdev_type, uint16_t channel);
 
+/**
+ * @brief   Build unicast address of a node from 64-bit prefix in sixlowpan_ipaddr and node id.
+ *          Address is built the same way ha_slp_init builds our own address
+ *          (short address mode, EUI-64 from hardware address).
+ *
+ * @param[out]  ipaddr, unicast address of the node.
+ * @param[in]   node_id, node id in 6LoWPAN network.
+ */
+void ha_slp_node_id_to_ipaddr(ipv6_addr_t *ipaddr, uint16_t node_id);
+
 /**
  * @brief   Reset sixlowpan network on reset if a given button has not been pressed in 3s.
  *
@@ -14,6 +14,7 @@ extern "C" {
 
 #include "ha_sixlowpan.h"
 #include "ha_gff_misc.h"
+#include "gff_mesg_id.h"
 
 #include "slp_receiver.h"
 
@@ -58,6 +59,7 @@ void slp_receiver_start(void)
 /* Prototypes */
 static int16_t filter_node_id(uint16_t node_id, uint8_t* payload_buffer, int32_t &recsize);
 static void start_receiver_loop(void);
+static void process_gff_frames(uint8_t* payload_buffer, int32_t recsize);
 
 /**
  * @brief   6lowpan receiver thread's function.
@@ -132,8 +134,8 @@ static void start_receiver_loop(void)
             }
             HA_DEBUG("\n");
 
-            /* processing GFF message */
-            slp_received_GFF_handler(payload_buffer);
+            /* processing GFF messages */
+            process_gff_frames(payload_buffer, recsize);
         }
     }
 
@@ -169,3 +171,71 @@ static int16_t filter_node_id(uint16_t node_id, uint8_t* payload_buffer, int32_t
 
     return 0;
 }
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Process every GFF frame in a datagram. SLP_ACK will give credits back to sender
+ *          thread, other frames will be passed to slp_received_GFF_handler and an ack
+ *          will be sent back to the peer.
+ *
+ * @param[in]   payload_buffer, datagram without node id.
+ * @param[in]   recsize, size of the datagram.
+ */
+static void process_gff_frames(uint8_t* payload_buffer, int32_t recsize)
+{
+    int32_t pos = 0;
+    uint16_t frame_size;
+    uint16_t cmd_id;
+    uint16_t peer_node_id = 0;
+    bool has_data = false;
+    msg_t mesg;
+
+    while (pos + ha_ns::GFF_LEN_SIZE + ha_ns::GFF_CMD_SIZE <= recsize) {
+        frame_size = payload_buffer[pos + ha_ns::GFF_LEN_POS] + ha_ns::GFF_LEN_SIZE
+                + ha_ns::GFF_CMD_SIZE;
+        if (pos + frame_size > recsize) {
+            HA_DEBUG("process_gff_frames: truncated GFF frame at %ld, dropped\n", pos);
+            break;
+        }
+
+        cmd_id = buf2uint16(&payload_buffer[pos + ha_ns::GFF_CMD_POS]);
+        if (cmd_id == ha_ns::SLP_ACK) {
+            mesg.type = ha_ns::SIXLOWPAN_ACK_RECEIVED;
+            mesg.content.value = ((uint32_t)buf2uint16(&payload_buffer[pos + ha_ns::GFF_DATA_POS + 1]) << 16)
+                    | payload_buffer[pos + ha_ns::GFF_DATA_POS];
+            msg_send(&mesg, ha_ns::sixlowpan_sender_pid, false);
+        }
+        else {
+            if (!has_data) {
+#ifdef HA_CC
+                /* node id is in 2 MSBs of device id */
+                if (cmd_id == ha_ns::NODE_ALIVE) {
+                    /* device ids follow num of devices, take the first one */
+                    if (frame_size >= ha_ns::GFF_LEN_SIZE + ha_ns::GFF_CMD_SIZE
+                            + ha_ns::NODE_ALIVE_HDR_LEN + ha_ns::NODE_ALIVE_RECORD_LEN) {
+                        peer_node_id = buf2uint16(&payload_buffer[pos + ha_ns::GFF_DATA_POS
+                                + ha_ns::NODE_ALIVE_HDR_LEN]);
+                    }
+                }
+                else {
+                    peer_node_id = buf2uint16(&payload_buffer[pos + ha_ns::GFF_DATA_POS]);
+                }
+#endif
+#ifdef HA_HOST
+                peer_node_id = ha_ns::sixlowpan_ha_cc_node_id;
+#endif
+                has_data = true;
+            }
+            slp_received_GFF_handler(&payload_buffer[pos]);
+        }
+
+        pos += frame_size;
+    }
+
+    /* ack the datagram */
+    if (has_data && peer_node_id != 0) {
+        mesg.type = ha_ns::SIXLOWPAN_SEND_ACK;
+        mesg.content.value = peer_node_id;
+        msg_send(&mesg, ha_ns::sixlowpan_sender_pid, false);
+    }
+}
@@ -10,6 +10,7 @@ extern "C" {
 #include "thread.h"
 #include "msg.h"
 #include "socket_base/socket.h"
+#include "vtimer.h"
 }
 
 #include "ha_sixlowpan.h"
@@ -18,9 +19,13 @@ extern "C" {
 
 #include "slp_sender.h"
 
-#include "cir_queue.h"
+#include "gff_queue.h"
 #include "ff.h"
 
+#ifdef HA_HOST
+#include "ha_host_glb.h"
+#endif
+
 /*--------------------- Global variable --------------------------------------*/
 namespace ha_ns {
 kernel_pid_t sixlowpan_sender_pid;
@@ -32,10 +37,20 @@ const uint16_t sixlowpan_sender_gff_queue_size =
 #ifdef HA_CC
         1024;
 #endif
+const uint8_t sixlowpan_sender_gff_queue_slots = /* power of 2 */
+#ifdef HA_HOST
+        16;
+#endif
+#ifdef HA_CC
+        32;
+#endif
 uint8_t sixlowpan_sender_gff_queue_buf[sixlowpan_sender_gff_queue_size];
-cir_queue sixlowpan_sender_gff_queue(
+gff_queue_ns::slot_t sixlowpan_sender_gff_queue_slots_buf[sixlowpan_sender_gff_queue_slots];
+gff_queue sixlowpan_sender_gff_queue(
         sixlowpan_sender_gff_queue_buf,
-        sixlowpan_sender_gff_queue_size);
+        sixlowpan_sender_gff_queue_size,
+        sixlowpan_sender_gff_queue_slots_buf,
+        sixlowpan_sender_gff_queue_slots);
     /* This queue will hold data in GFF format from */
     /* controller thread to 6lowpan sender thread */
 }
@@ -50,9 +65,35 @@ static const uint16_t slp_sender_stacksize = 1536;
 static char slp_sender_stack[slp_sender_stacksize];
 static void *slp_sender_func(void *arg);
 
+/* On ha_cc it must hold a batch of GFF_PENDING messages sent by scenes
+ * (scene_ns::scene_out_batch_size = 16) besides ACK messages */
 static const char slp_sender_msgqueue_size = 32;
 static msg_t slp_sender_msgqueue[slp_sender_msgqueue_size];
 
+/* Socket is opened when network stack is restarted and kept for the stack's lifetime */
+static int slp_sender_sock = -1;
+
+/* Datagrams waiting for credits, GFF frames for the same node are coalesced here */
+static const uint8_t slp_sender_max_pending_dgrams = 4;
+typedef struct {
+    uint16_t node_id;
+    uint16_t len; /* 0 if free */
+    uint8_t buf[ha_ns::sixlowpan_payload_maxsize];
+} slp_pending_dgram_t;
+static slp_pending_dgram_t slp_pending_dgrams[slp_sender_max_pending_dgrams];
+
+static uint8_t slp_sender_credits = ha_ns::sixlowpan_sender_max_credits;
+static gff_queue *slp_sender_gff_queue_p = NULL;
+
+/* Neighbor cache, nodes heard recently will be sent with unicast */
+typedef struct {
+    uint16_t node_id; /* 0 if free */
+    ipv6_addr_t ipaddr;
+    uint32_t last_heard; /* in second */
+    uint8_t unacked;
+} slp_neighbor_t;
+static slp_neighbor_t slp_neighbor_cache[ha_ns::sixlowpan_neighbor_cache_size];
+
 /*--------------------- Public functions -------------------------------------*/
 /**
  * @brief   Create and start 6lowpan sender thread.
@@ -73,8 +114,16 @@ void slp_sender_start(void)
 /*--------------------- Static functions -------------------------------------*/
 /* Prototypes */
 static int16_t restart_sixlowpan(void);
-static int16_t send_data_gff(cir_queue *gff_cir_queue);
-static void insert_node_id(uint8_t* payload_buffer, uint16_t node_id);
+static int16_t send_data_gff(gff_queue *gff_frame_queue);
+static int16_t flush_pending_dgrams(void);
+static bool has_pending_dgrams(void);
+static slp_pending_dgram_t *get_free_dgram(void);
+static int16_t sendto_node(uint8_t *payload_buffer, uint16_t len, uint16_t node_id,
+        bool expect_ack);
+static int16_t send_ack(uint16_t node_id, uint8_t credits);
+static void add_credits(uint8_t credits);
+static void neighbor_heard(uint16_t node_id);
+static slp_neighbor_t *neighbor_find(uint16_t node_id);
 
 /**
  * @brief   6lowpan sender thread's function.
@@ -87,8 +136,19 @@ static void *slp_sender_func(void *arg)
     msg_init_queue(slp_sender_msgqueue, slp_sender_msgqueue_size);
 
     while (1) {
-        /* wait for message */
-        msg_receive(&mesg);
+        /* wait for message, out of credits with pending datagrams will be waited with timeout */
+        if (has_pending_dgrams() && slp_sender_credits == 0) {
+            if (vtimer_msg_receive_timeout(&mesg,
+                    timex_set(0, ha_ns::sixlowpan_sender_credit_timeout)) < 0) {
+                HA_DEBUG("slp_sender: No ack in time, take back a credit.\n");
+                add_credits(1);
+                send_data_gff(slp_sender_gff_queue_p);
+                continue;
+            }
+        }
+        else {
+            msg_receive(&mesg);
+        }
 
         switch (mesg.type) {
         case ha_ns::SIXLOWPAN_RESTART:
@@ -100,7 +160,22 @@ static void *slp_sender_func(void *arg)
 
         case ha_ns::GFF_PENDING:
             HA_DEBUG("slp_sender: Received GFF_PENDING.\n");
-            send_data_gff((cir_queue*)mesg.content.ptr);
+            /* frames are coalesced, so all pending frames are sent, not only mesg's one */
+            slp_sender_gff_queue_p = &ha_ns::sixlowpan_sender_gff_queue;
+            send_data_gff(slp_sender_gff_queue_p);
+            break;
+
+        case ha_ns::SIXLOWPAN_ACK_RECEIVED:
+            HA_DEBUG("slp_sender: Received SIXLOWPAN_ACK_RECEIVED (%lx).\n", mesg.content.value);
+            neighbor_heard((uint16_t)(mesg.content.value >> 16));
+            add_credits((uint8_t)mesg.content.value);
+            send_data_gff(slp_sender_gff_queue_p);
+            break;
+
+        case ha_ns::SIXLOWPAN_SEND_ACK:
+            HA_DEBUG("slp_sender: Received SIXLOWPAN_SEND_ACK (%lu).\n", mesg.content.value);
+            neighbor_heard((uint16_t)mesg.content.value);
+            send_ack((uint16_t)mesg.content.value, 1);
             break;
 
         default:
@@ -156,6 +231,26 @@ static int16_t restart_sixlowpan(void)
         return -1;
     }
 
+    /* (re)open sending socket */
+    if (slp_sender_sock >= 0) {
+        socket_base_close(slp_sender_sock);
+    }
+    slp_sender_sock = socket_base_socket(PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    if (slp_sender_sock < 0) {
+        HA_NOTIFY("rst_slp: Error creating socket.\n");
+        return -1;
+    }
+
+    /* drop datagrams and neighbors of the old network */
+    memset(slp_pending_dgrams, 0, sizeof(slp_pending_dgrams));
+    memset(slp_neighbor_cache, 0, sizeof(slp_neighbor_cache));
+    slp_sender_credits = ha_ns::sixlowpan_sender_max_credits;
+
+#ifdef HA_HOST
+    /* node id is known from now on */
+    ha_host_ns::seed_alive(node_id);
+#endif
+
     HA_NOTIFY("6LoWPAN stack restarted.\n");
 
     return 0;
@@ -164,102 +259,312 @@ static int16_t restart_sixlowpan(void)
 /*----------------------------------------------------------------------------*/
 /**
  * @brief   Send data in GFF format to 6lowpan.
+ *          Every complete GFF frame in queue will be moved to pending datagrams, frames for
+ *          the same node will be coalesced into one datagram. Pending datagrams will be sent
+ *          as long as there are credits left.
  *          Using following global variables:
  *          - sixlowpan_payload_maxsize
  *          - sixlowpan_default_interface
  *          in ha_sixlowpan.h
  *
- * @param[in]   gff_cir_queue, pointer to cir_queue object holding GFF frames.
+ * @param[in]   gff_frame_queue, pointer to gff_queue object holding GFF frames.
  *
  * @return  -1 if error.
  */
-static int16_t send_data_gff(cir_queue *gff_cir_queue)
+static int16_t send_data_gff(gff_queue *gff_frame_queue)
 {
-    uint8_t payload_buffer[ha_ns::sixlowpan_payload_maxsize];
-    uint8_t gff_data_size;
+    uint8_t *gff_frame;
+    uint16_t gff_frame_size;
     uint16_t node_id, gff_cmd_id;
-    ipv6_addr_t ipaddr;
-    sockaddr6_t saddr;
-    int sock;
-
-    int32_t bytes_sent;
+    uint8_t count;
+    slp_pending_dgram_t *dgram_p;
 
-    /* get data from queue */
-    gff_data_size = gff_cir_queue->preview_data(false);
-    if (gff_cir_queue->get_size() < (gff_data_size + 2 + 1)) {
-        HA_DEBUG("send_data_gff: Size of GFF frame in queue(%ld) < gff_data_size(%hu) + 3\n",
-                gff_cir_queue->get_size(), gff_data_size);
-        return -1;
+    if (gff_frame_queue == NULL) {
+        return flush_pending_dgrams();
     }
 
-    gff_cir_queue->get_data(payload_buffer, gff_data_size + 3);
+    while ((gff_frame = gff_frame_queue->get_frame()) != NULL) {
+        /* parse frame in place */
+        gff_frame_size = gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
+                + ha_ns::GFF_LEN_SIZE;
 
-    /* check kind of message */
-    gff_cmd_id = buf2uint16(&payload_buffer[1]);
+        /* check kind of message */
+        gff_cmd_id = buf2uint16(&gff_frame[ha_ns::GFF_CMD_POS]);
 
-    switch (gff_cmd_id) {
-    case ha_ns::SET_DEV_VAL:
-        HA_DEBUG("send_data_gff: SET_DEV_VAL message (%hu, %lx, %hd).\n",
-                payload_buffer[0], buf2uint32(&payload_buffer[3]),
-                (int16_t)buf2uint16(&payload_buffer[7]));
+        switch (gff_cmd_id) {
+        case ha_ns::SET_DEV_VAL:
 #ifdef HA_CC
-        node_id = parse_node_deviceid(buf2uint32(&payload_buffer[3]));
+            /* node id is in 2 MSBs of device id */
+            node_id = buf2uint16(&gff_frame[ha_ns::GFF_DATA_POS]);
 #endif
 #ifdef HA_HOST
-        node_id = ha_ns::sixlowpan_ha_cc_node_id;
+            node_id = ha_ns::sixlowpan_ha_cc_node_id;
 #endif
-        break;
-    case ha_ns::ALIVE:
-        HA_DEBUG("send_data_gff: ALIVE message.\n");
-        node_id = ha_ns::sixlowpan_ha_cc_node_id;
-        break;
-    default:
-        HA_DEBUG("send_data_gff: unknow GFF command id %x\n", gff_cmd_id);
-        return -1;
+            break;
+        case ha_ns::ALIVE:
+        case ha_ns::NODE_ALIVE:
+            node_id = ha_ns::sixlowpan_ha_cc_node_id;
+            break;
+        default:
+            HA_DEBUG("send_data_gff: unknow GFF command id %x, dropped\n", gff_cmd_id);
+            gff_frame_queue->release();
+            continue;
+        }
+
+        /* find a pending datagram for this node which still has room for the frame */
+        dgram_p = NULL;
+        for (count = 0; count < slp_sender_max_pending_dgrams; count++) {
+            if (slp_pending_dgrams[count].len != 0
+                    && slp_pending_dgrams[count].node_id == node_id
+                    && slp_pending_dgrams[count].len + gff_frame_size
+                            <= ha_ns::sixlowpan_payload_maxsize) {
+                dgram_p = &slp_pending_dgrams[count];
+                break;
+            }
+        }
+
+        /* or a free one, send pending datagrams to make room if there are credits */
+        if (dgram_p == NULL) {
+            dgram_p = get_free_dgram();
+            if (dgram_p == NULL) {
+                flush_pending_dgrams();
+                dgram_p = get_free_dgram();
+            }
+
+            if (dgram_p != NULL) {
+                dgram_p->node_id = node_id;
+                dgram_p->len = ha_ns::sixlowpan_node_id_size;
+                uint162buf(node_id, dgram_p->buf);
+            }
+        }
+
+        if (dgram_p == NULL) {
+            HA_DEBUG("send_data_gff: out of credits, wait for ack\n");
+            break;
+        }
+
+        HA_DEBUG("send_data_gff: GFF (%x) to %hu coalesced at %hu\n",
+                gff_cmd_id, node_id, dgram_p->len);
+        memcpy(&dgram_p->buf[dgram_p->len], gff_frame, gff_frame_size);
+        gff_frame_queue->release();
+        dgram_p->len += gff_frame_size;
+    }
+
+    return flush_pending_dgrams();
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Send pending datagrams as long as there are credits.
+ *
+ * @return  -1 if error.
+ */
+static int16_t flush_pending_dgrams(void)
+{
+    uint8_t count;
+    int16_t retval = 0;
+
+    for (count = 0; count < slp_sender_max_pending_dgrams; count++) {
+        if (slp_sender_credits == 0) {
+            break;
+        }
+
+        if (slp_pending_dgrams[count].len == 0) {
+            continue;
+        }
+
+        if (sendto_node(slp_pending_dgrams[count].buf, slp_pending_dgrams[count].len,
+                slp_pending_dgrams[count].node_id, true) < 0) {
+            retval = -1;
+        }
+        slp_pending_dgrams[count].len = 0;
+        slp_sender_credits--;
+    }
+
+    return retval;
+}
+
+/*----------------------------------------------------------------------------*/
+static bool has_pending_dgrams(void)
+{
+    uint8_t count;
+
+    for (count = 0; count < slp_sender_max_pending_dgrams; count++) {
+        if (slp_pending_dgrams[count].len != 0) {
+            return true;
+        }
     }
 
-    /* insert node id */
-    insert_node_id(payload_buffer, node_id);
+    return false;
+}
+
+/*----------------------------------------------------------------------------*/
+static slp_pending_dgram_t *get_free_dgram(void)
+{
+    uint8_t count;
+
+    for (count = 0; count < slp_sender_max_pending_dgrams; count++) {
+        if (slp_pending_dgrams[count].len == 0) {
+            return &slp_pending_dgrams[count];
+        }
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Send a datagram (node id included) to a node with opened socket.
+ *          Unicast will be used if node is in neighbor cache, otherwise (or if unicast failed),
+ *          all nodes multicast address will be used.
+ *
+ * @param[in]   expect_ack, true for data datagrams, which count as unacked until the node
+ *              answers. Acks are not answered, so they don't count.
+ *
+ * @return  -1 if error.
+ */
+static int16_t sendto_node(uint8_t *payload_buffer, uint16_t len, uint16_t node_id,
+        bool expect_ack)
+{
+    sockaddr6_t saddr;
+    int32_t bytes_sent = -1;
+    slp_neighbor_t *neighbor_p;
 
-    /* Set address to send data */
-    ipv6_addr_set_all_nodes_addr(&ipaddr);
+    if (slp_sender_sock < 0) {
+        HA_DEBUG("sendto_node: 6LoWPAN stack has not been started.\n");
+        return -1;
+    }
 
-    /* open a socket and send data */
     memset(&saddr, 0, sizeof(saddr));
     saddr.sin6_family = AF_INET6;
-    memcpy(&saddr.sin6_addr, &ipaddr, 16);
     saddr.sin6_port = HTONS(ha_ns::sixlowpan_receiving_port);
 
-    sock = socket_base_socket(PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
-    if (sock < 0) {
-        HA_DEBUG("send_data_gff: Error Creating Socket.\n");
-        return -1;
+    /* unicast */
+    neighbor_p = neighbor_find(node_id);
+    if (neighbor_p != NULL) {
+        memcpy(&saddr.sin6_addr, &neighbor_p->ipaddr, 16);
+        bytes_sent = socket_base_sendto(slp_sender_sock, payload_buffer, len, 0,
+                &saddr, sizeof(saddr));
+        if (bytes_sent >= 0) {
+            if (expect_ack) {
+                neighbor_p->unacked++;
+            }
+            HA_DEBUG("sendto_node: %ld bytes sent to %hu (unicast)\n", bytes_sent, node_id);
+            return 0;
+        }
+        HA_DEBUG("sendto_node: unicast to %hu failed, fall back to multicast\n", node_id);
     }
 
-    bytes_sent = socket_base_sendto(sock, payload_buffer, gff_data_size + 3 + 2, 0,
+    /* multicast */
+    ipv6_addr_set_all_nodes_addr(&saddr.sin6_addr);
+    bytes_sent = socket_base_sendto(slp_sender_sock, payload_buffer, len, 0,
             &saddr, sizeof(saddr));
     if (bytes_sent >= 0) {
-        HA_DEBUG("send_data_gff: %ld bytes sent to %hu\n", bytes_sent, node_id);
+        HA_DEBUG("sendto_node: %ld bytes sent to %hu (multicast)\n", bytes_sent, node_id);
     }
     else {
-        HA_NOTIFY("send_data_gff: Error when send data to %hu\n", node_id);
+        HA_NOTIFY("sendto_node: Error when send data to %hu\n", node_id);
+        return -1;
     }
 
-    socket_base_close(sock);
+    return 0;
+}
 
-    /* WORKAROUND: sleep to 10ms so it will not make receiver buffer overflow
-     * TODO(later): apply CoAP with flow control will resolve this issue */
-    vtimer_usleep(10000);
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Send SLP_ACK to a node. Ack will not consume credit.
+ *
+ * @return  -1 if error.
+ */
+static int16_t send_ack(uint16_t node_id, uint8_t credits)
+{
+    uint8_t ack_buffer[ha_ns::sixlowpan_node_id_size + ha_ns::GFF_LEN_SIZE
+            + ha_ns::GFF_CMD_SIZE + ha_ns::SLP_ACK_DATA_LEN];
 
-    return 0;
+    uint162buf(node_id, ack_buffer);
+    ack_buffer[ha_ns::sixlowpan_node_id_size + ha_ns::GFF_LEN_POS] = ha_ns::SLP_ACK_DATA_LEN;
+    uint162buf(ha_ns::SLP_ACK, &ack_buffer[ha_ns::sixlowpan_node_id_size + ha_ns::GFF_CMD_POS]);
+    ack_buffer[ha_ns::sixlowpan_node_id_size + ha_ns::GFF_DATA_POS] = credits;
+    uint162buf(ha_ns::sixlowpan_node_id,
+            &ack_buffer[ha_ns::sixlowpan_node_id_size + ha_ns::GFF_DATA_POS + 1]);
+
+    return sendto_node(ack_buffer, sizeof(ack_buffer), node_id, false);
 }
 
 /*----------------------------------------------------------------------------*/
-static void insert_node_id(uint8_t* payload_buffer, uint16_t node_id)
+static void add_credits(uint8_t credits)
 {
-    /* get node_id */
-    memmove(&payload_buffer[2], &payload_buffer[0], payload_buffer[0] + 3);
+    if (credits > ha_ns::sixlowpan_sender_max_credits - slp_sender_credits) {
+        slp_sender_credits = ha_ns::sixlowpan_sender_max_credits;
+    }
+    else {
+        slp_sender_credits += credits;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Node has been heard (data or ack), add it to neighbor cache or refresh it.
+ *          Least recently heard node will be replaced if cache is full.
+ */
+static void neighbor_heard(uint16_t node_id)
+{
+    uint8_t count;
+    slp_neighbor_t *neighbor_p = NULL;
+    timex_t now;
+
+    if (node_id == 0 || node_id == ha_ns::sixlowpan_node_id) {
+        return;
+    }
+
+    vtimer_now(&now);
+
+    for (count = 0; count < ha_ns::sixlowpan_neighbor_cache_size; count++) {
+        if (slp_neighbor_cache[count].node_id == node_id) {
+            neighbor_p = &slp_neighbor_cache[count];
+            break;
+        }
 
-    payload_buffer[0] = (uint8_t)(node_id >> 8);
-    payload_buffer[1] = (uint8_t)(node_id);
+        if (neighbor_p == NULL || slp_neighbor_cache[count].node_id == 0
+                || (neighbor_p->node_id != 0
+                        && slp_neighbor_cache[count].last_heard < neighbor_p->last_heard)) {
+            neighbor_p = &slp_neighbor_cache[count];
+        }
+    }
+
+    if (neighbor_p->node_id != node_id) {
+        HA_DEBUG("neighbor_heard: %hu added (replaced %hu)\n", node_id, neighbor_p->node_id);
+        neighbor_p->node_id = node_id;
+        ha_slp_node_id_to_ipaddr(&neighbor_p->ipaddr, node_id);
+    }
+
+    neighbor_p->last_heard = now.seconds;
+    neighbor_p->unacked = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Find a node which can be sent with unicast in neighbor cache.
+ *
+ * @return  NULL if node is unknown, hasn't been heard in sixlowpan_neighbor_ttl or
+ *          hasn't answered too many unicast datagrams.
+ */
+static slp_neighbor_t *neighbor_find(uint16_t node_id)
+{
+    uint8_t count;
+    timex_t now;
+
+    for (count = 0; count < ha_ns::sixlowpan_neighbor_cache_size; count++) {
+        if (slp_neighbor_cache[count].node_id == node_id) {
+            vtimer_now(&now);
+            if ((now.seconds - slp_neighbor_cache[count].last_heard > ha_ns::sixlowpan_neighbor_ttl)
+                    || (slp_neighbor_cache[count].unacked >= ha_ns::sixlowpan_neighbor_max_unacked)) {
+                return NULL;
+            }
+
+            return &slp_neighbor_cache[count];
+        }
+    }
+
+    return NULL;
 }
@@ -17,7 +17,7 @@ extern "C" {
 #include "thread.h"
 }
 
-#include "cir_queue.h"
+#include "gff_queue.h"
 
 /**
  * @brief   Create and start 6lowpan thread.
@@ -0,0 +1,183 @@
+/**
+ * @file gff_queue.cpp
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @date 17-Oct-2026
+ * @brief Single producer, single consumer queue of whole GFF frames.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "gff_queue.h"
+#include "gff_mesg_id.h"
+
+using namespace gff_queue_ns;
+
+/* index of own side: relaxed, index of the other side: acquire, publish own side: release */
+#define LOAD_OWN(index)         __atomic_load_n(&(index), __ATOMIC_RELAXED)
+#define LOAD_OTHER(index)       __atomic_load_n(&(index), __ATOMIC_ACQUIRE)
+#define PUBLISH(index, value)   __atomic_store_n(&(index), (value), __ATOMIC_RELEASE)
+
+/*----------------------------------------------------------------------------*/
+gff_queue::gff_queue(uint8_t *buf, uint16_t buf_size, slot_t *slots, uint8_t num_slots)
+{
+    uint16_t size = 1;
+
+    /* largest power of 2 <= num_slots */
+    while ((size << 1) <= num_slots) {
+        size <<= 1;
+    }
+
+    this->buf_p = buf;
+    this->buf_size = buf_size;
+    this->slots_p = slots;
+    this->slot_mask = size - 1;
+
+    data_wr = 0;
+    reserved_offset = 0;
+    reserved_size = 0;
+    slot_head = 0;
+
+    data_rd = 0;
+    slot_tail = 0;
+
+    drops = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+uint8_t *gff_queue::reserve(uint16_t frame_size)
+{
+    uint16_t rd, offset;
+
+    rd = LOAD_OTHER(data_rd);
+
+    if (frame_size == 0 || frame_size > buf_size
+            || (uint16_t)(LOAD_OWN(slot_head) - LOAD_OTHER(slot_tail)) > slot_mask) {
+        drops++;
+        return NULL;
+    }
+
+    /*
+     * data_wr >= data_rd: used space is [data_rd, data_wr), frame goes after data_wr
+     * or to the beginning of the buffer.
+     * data_wr < data_rd: used space is [data_rd, end) and [0, data_wr). data_wr never
+     * reaches data_rd, data_wr == data_rd means empty.
+     */
+    if (data_wr >= rd) {
+        if ((uint32_t)data_wr + frame_size <= buf_size) {
+            offset = data_wr;
+        }
+        else if (frame_size < rd) {
+            offset = 0;
+        }
+        else {
+            drops++;
+            return NULL;
+        }
+    }
+    else {
+        if ((uint32_t)data_wr + frame_size < rd) {
+            offset = data_wr;
+        }
+        else {
+            drops++;
+            return NULL;
+        }
+    }
+
+    reserved_offset = offset;
+    reserved_size = frame_size;
+
+    return &buf_p[offset];
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t gff_queue::commit(void)
+{
+    uint16_t head, size;
+    slot_t *slot;
+
+    head = LOAD_OWN(slot_head);
+    slot = &slots_p[head & slot_mask];
+
+    /* frame may be shorter than the reserved space */
+    size = buf_p[reserved_offset + ha_ns::GFF_LEN_POS] + ha_ns::GFF_LEN_SIZE
+            + ha_ns::GFF_CMD_SIZE;
+    if (size > reserved_size) {
+        size = reserved_size;
+    }
+
+    slot->offset = reserved_offset;
+    slot->size = size;
+    data_wr = reserved_offset + size;
+
+    /* frame and slot are visible to consumer from here */
+    PUBLISH(slot_head, (uint16_t)(head + 1));
+
+    return head;
+}
+
+/*----------------------------------------------------------------------------*/
+int32_t gff_queue::add_frame(uint8_t *frame)
+{
+    uint16_t frame_size;
+    uint8_t *frame_p;
+
+    frame_size = frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_LEN_SIZE + ha_ns::GFF_CMD_SIZE;
+
+    frame_p = reserve(frame_size);
+    if (frame_p == NULL) {
+        return invalid_handle;
+    }
+
+    memcpy(frame_p, frame, frame_size);
+
+    return commit();
+}
+
+/*----------------------------------------------------------------------------*/
+uint8_t *gff_queue::get_frame(void)
+{
+    uint16_t tail;
+
+    tail = LOAD_OWN(slot_tail);
+    if (tail == LOAD_OTHER(slot_head)) {
+        return NULL;
+    }
+
+    return &buf_p[slots_p[tail & slot_mask].offset];
+}
+
+/*----------------------------------------------------------------------------*/
+uint8_t *gff_queue::get_frame(uint16_t handle)
+{
+    /* frames newer than handle will come with their own messages */
+    if ((int16_t)(LOAD_OWN(slot_tail) - handle) > 0) {
+        return NULL;
+    }
+
+    return get_frame();
+}
+
+/*----------------------------------------------------------------------------*/
+void gff_queue::release(void)
+{
+    uint16_t tail;
+    slot_t *slot;
+
+    tail = LOAD_OWN(slot_tail);
+    if (tail == LOAD_OTHER(slot_head)) {
+        return;
+    }
+
+    slot = &slots_p[tail & slot_mask];
+    PUBLISH(data_rd, (uint16_t)(slot->offset + slot->size));
+    PUBLISH(slot_tail, (uint16_t)(tail + 1));
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t gff_queue::get_num_frames(void)
+{
+    return (uint16_t)(LOAD_OTHER(slot_head) - LOAD_OTHER(slot_tail));
+}
@@ -0,0 +1,140 @@
+/**
+ * @file gff_queue.h
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @date 17-Oct-2026
+ * @brief Single producer, single consumer queue of whole GFF frames.
+ *
+ *        Each frame is stored contiguously in the data buffer (a frame never wraps
+ *        around the end of the buffer) and is described by a slot (offset, size), so
+ *        the consumer can parse it in place without copying it out.
+ *
+ *        A frame is visible to the consumer only after commit(), a partially written
+ *        frame or a frame rejected because the queue is full can't desynchronize
+ *        the queue. Rejected frames are counted in drops.
+ *
+ *        Every committed frame has a handle (16 bits sequence number), which is sent
+ *        in msg_t.content.value instead of a pointer to the queue.
+ *
+ *        Only one thread may add frames and only one thread may get/release frames
+ *        at a time.
+ */
+
+#ifndef GFF_QUEUE_H_
+#define GFF_QUEUE_H_
+
+#include <stdint.h>
+
+namespace gff_queue_ns {
+
+typedef struct {
+    uint16_t offset;    /* offset of the frame in data buffer */
+    uint16_t size;      /* size of the frame, including len and cmd */
+} slot_t;
+
+const int32_t invalid_handle = -1;
+
+}
+
+class gff_queue {
+public:
+    /**
+     * @brief   constructor, user must allocate data buffer and slots for the queue.
+     *
+     * @param[in]   buf, pointer to data buffer. Frames larger than half of the buffer
+     *              may be rejected even when the queue is empty.
+     * @param[in]   buf_size, size of data buffer.
+     * @param[in]   slots, pointer to slots buffer.
+     * @param[in]   num_slots, max number of frames in the queue, MUST be a power of 2
+     *              (otherwise only the largest power of 2 <= num_slots will be used).
+     */
+    gff_queue(uint8_t *buf, uint16_t buf_size, gff_queue_ns::slot_t *slots,
+            uint8_t num_slots);
+
+    /**
+     * @brief   get contiguous space for a frame (producer). The frame must be written
+     *          to this space, then added to the queue by commit().
+     *
+     * @param[in]   frame_size, size of the frame (len + cmd + data).
+     *
+     * @return  pointer to the space, or NULL if the queue is full (drops will be
+     *          increased).
+     */
+    uint8_t *reserve(uint16_t frame_size);
+
+    /**
+     * @brief   add the reserved frame to the queue (producer). Size of the frame is
+     *          taken from its len field, it may be less than the reserved size.
+     *
+     * @return  handle of the frame.
+     */
+    uint16_t commit(void);
+
+    /**
+     * @brief   copy a frame to the queue (producer).
+     *
+     * @param[in]   frame, GFF frame, size is taken from its len field.
+     *
+     * @return  handle of the frame, or gff_queue_ns::invalid_handle if the queue is full
+     *          (drops will be increased).
+     */
+    int32_t add_frame(uint8_t *frame);
+
+    /**
+     * @brief   get the oldest frame in place (consumer). The frame stays in the queue
+     *          until release().
+     *
+     * @return  pointer to the frame, or NULL if the queue is empty.
+     */
+    uint8_t *get_frame(void);
+
+    /**
+     * @brief   get the oldest frame in place if it isn't newer than handle (consumer).
+     *          Frames whose messages have been lost are processed with a later handle.
+     *
+     * @param[in]   handle, handle received in msg_t.content.value.
+     *
+     * @return  pointer to the frame, or NULL if there is no such frame.
+     */
+    uint8_t *get_frame(uint16_t handle);
+
+    /**
+     * @brief   remove the oldest frame from the queue (consumer).
+     */
+    void release(void);
+
+    /**
+     * @brief   get number of frames in the queue.
+     *
+     * @return  number of frames.
+     */
+    uint16_t get_num_frames(void);
+
+    /**
+     * @brief   get number of frames rejected because the queue was full.
+     *
+     * @return  number of dropped frames.
+     */
+    uint32_t get_drops(void) { return drops; }
+
+private:
+    uint8_t *buf_p;
+    uint16_t buf_size;
+    gff_queue_ns::slot_t *slots_p;
+    uint16_t slot_mask;
+
+    /* producer side */
+    uint16_t data_wr;           /* where the next frame will be written */
+    uint16_t reserved_offset;
+    uint16_t reserved_size;
+    volatile uint16_t slot_head;
+
+    /* consumer side */
+    volatile uint16_t data_rd;  /* end of the last released frame */
+    volatile uint16_t slot_tail;
+
+    /* error indicators */
+    volatile uint32_t drops;
+};
+
+#endif // GFF_QUEUE_H_
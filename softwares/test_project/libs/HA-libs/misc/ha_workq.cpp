@@ -0,0 +1,123 @@
+/**
+ * @file ha_workq.cpp
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @date 17-Oct-2026
+ * @brief Deferred work queue, worker thread and lock-free posting.
+ */
+
+extern "C" {
+#include "thread.h"
+#include "irq.h"
+#include "stm32f10x.h"
+}
+
+#include "ha_workq.h"
+
+using namespace ha_workq_ns;
+
+/*--------------------- Configurations ---------------------------------------*/
+#define HA_NOTIFICATION (1)
+#define HA_DEBUG_EN (0)
+#include "ha_debug.h"
+
+/* above end point threads, below transceiver thread (PRIORITY_MAIN-3) */
+static const char ha_workq_prio = PRIORITY_MAIN-2;
+static const uint16_t ha_workq_stacksize = 1024;
+static char ha_workq_stack[ha_workq_stacksize];
+
+/*--------------------- Internal variables -----------------------------------*/
+static kernel_pid_t ha_workq_pid = KERNEL_PID_UNDEF;
+
+/* pending list, last posted item first (address of work_t, 0 if empty) */
+static volatile uint32_t ha_workq_head = 0;
+
+static void *ha_workq_func(void *arg);
+
+/*--------------------- Public functions -------------------------------------*/
+void ha_workq_start(void)
+{
+    ha_workq_pid = thread_create(ha_workq_stack, ha_workq_stacksize, ha_workq_prio,
+            CREATE_STACKTEST, ha_workq_func, NULL, "ha_workq");
+    if (ha_workq_pid > 0) {
+        HA_NOTIFY("Work queue thread created.\n");
+    }
+    else {
+        ha_workq_pid = KERNEL_PID_UNDEF;
+        HA_NOTIFY("Can't create work queue thread.\n");
+    }
+}
+
+bool ha_workq_post(work_t *work)
+{
+    uint32_t head;
+
+    /* mark pending, an ISR may preempt us and post the same item */
+    do {
+        if (__LDREXW(&work->pending) != 0) {
+            __CLREX();
+            return false;
+        }
+    } while (__STREXW(1, &work->pending) != 0);
+
+    /* push to pending list */
+    do {
+        head = __LDREXW(&ha_workq_head);
+        work->next = head;
+    } while (__STREXW((uint32_t)(uintptr_t)work, &ha_workq_head) != 0);
+
+    /* worker only sleeps when the list is empty */
+    if (head == 0 && ha_workq_pid != KERNEL_PID_UNDEF) {
+        thread_wakeup(ha_workq_pid);
+    }
+
+    return true;
+}
+
+/*--------------------- Static functions -------------------------------------*/
+/**
+ * @brief   Worker thread's function. Takes the whole pending list, then runs it
+ *          oldest item first.
+ */
+static void *ha_workq_func(void *arg)
+{
+    work_t *batch, *work, *next;
+    unsigned irq_state;
+
+    (void) arg;
+
+    while (1) {
+        irq_state = disableIRQ();
+
+        /* thread_sleep() enables interrupts after the thread is marked as sleeping,
+           the wake up can't be lost */
+        while (ha_workq_head == 0) {
+            thread_sleep();
+            disableIRQ();
+        }
+        work = (work_t *)(uintptr_t) ha_workq_head;
+        ha_workq_head = 0;
+
+        restoreIRQ(irq_state);
+
+        /* reverse to posting order */
+        batch = NULL;
+        while (work != NULL) {
+            next = (work_t *)(uintptr_t) work->next;
+            work->next = (uint32_t)(uintptr_t) batch;
+            batch = work;
+            work = next;
+        }
+
+        while (batch != NULL) {
+            work = batch;
+            batch = (work_t *)(uintptr_t) work->next;
+
+            /* may be posted again from now on, also while running */
+            work->pending = 0;
+            work->func();
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file ha_workq.h
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @date 17-Oct-2026
+ * @brief Deferred work queue. ISRs post work items, the worker thread runs them.
+ *
+ *        An ISR only links a work item into the pending list (lock-free, LDREX/STREX),
+ *        the slow part (ADC conversion, float math, msg_send...) is done later by the
+ *        worker thread, which takes all pending items at once and runs them in the
+ *        order they were posted.
+ *
+ *        A work item is posted at most once until it runs: posting an item which is
+ *        still pending does nothing, so a slow work item can't fill up the queue.
+ *        Work items must be static, they are linked into the queue by pointer.
+ */
+
+#ifndef HA_WORKQ_H_
+#define HA_WORKQ_H_
+
+#include <stdint.h>
+
+namespace ha_workq_ns {
+
+typedef struct work_s {
+    void (*func)(void);             /* work function, runs in worker thread */
+    volatile uint32_t next;         /* next pending item, internal */
+    volatile uint32_t pending;      /* 1 while item is in the queue, internal */
+} work_t;
+
+}
+
+/**
+ * @brief   Static initializer of a work item.
+ *
+ *          Example: static ha_workq_ns::work_t btn_sw_work = HA_WORK_INIT(btn_sw_work_func);
+ */
+#define HA_WORK_INIT(work_func)     { (work_func), 0, 0 }
+
+/**
+ * @brief   Create and start the worker thread. Items posted before it starts are run
+ *          when it starts.
+ */
+void ha_workq_start(void);
+
+/**
+ * @brief   Queue a work item to be run by the worker thread. Safe to call from ISRs
+ *          (of any priority) and threads.
+ *
+ * @param[in]   work, pointer to a static work item.
+ *
+ * @return  true if the item is queued, false if it was already pending.
+ */
+bool ha_workq_post(ha_workq_ns::work_t *work);
+
+#endif /* HA_WORKQ_H_ */
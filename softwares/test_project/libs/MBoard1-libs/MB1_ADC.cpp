@@ -14,11 +14,20 @@ ADC_TypeDef *adc_x[] = { ADC1, ADC2, ADC3 };
 const uint32_t adc_rcc[] = { RCC_APB2Periph_ADC1, RCC_APB2Periph_ADC2,
         RCC_APB2Periph_ADC3 };
 
+/* DMA requests: ADC1 -> DMA1 channel 1, ADC3 -> DMA2 channel 5, ADC2 has none */
+DMA_Channel_TypeDef *adc_dma_chn[] = { DMA1_Channel1, NULL, DMA2_Channel5 };
+const uint32_t adc_dma_rcc[] = { RCC_AHBPeriph_DMA1, 0, RCC_AHBPeriph_DMA2 };
+const uint32_t adc_dma_tc_flag[] = { DMA1_FLAG_TC1, 0, DMA2_FLAG_TC5 };
+
 adc::adc(void)
 {
     this->poll_data = false;
     /* ADC1 as default */
     this->adc_num = 0;
+
+    this->scan_buffer = NULL;
+    this->scan_num_channels = 0;
+    this->scan_num_samples = 0;
 }
 
 void adc::adc_init(const adc_params_t *adc_params)
@@ -56,7 +65,9 @@ void adc::adc_init(const adc_params_t *adc_params)
         //TODO
         break;
     case scan_mode:
-        //TODO
+        adc_init_struct.ADC_ContinuousConvMode = ENABLE;
+        adc_init_struct.ADC_ScanConvMode = ENABLE;
+        adc_init_struct.ADC_NbrOfChannel = this->scan_num_channels;
         break;
     default:
         return;
@@ -78,6 +89,8 @@ void adc::adc_init(const adc_params_t *adc_params)
 
     switch (adc_params->data_access) {
     case dma_request:
+        /* DMA is enabled by adc_scan_start after calibration */
+        poll_data = false;
         break;
     case adc_irq:
         //TODO
@@ -132,6 +145,126 @@ uint16_t adc::adc_convert(void)
     return adc_converted_value;
 }
 
+bool adc::adc_scan_start(const adc_scan_params_t *scan_params)
+{
+    adc_params_t adc_params;
+    DMA_InitTypeDef dma_init_struct;
+    DMA_Channel_TypeDef *dma_chn;
+    uint16_t num_transfers;
+    uint8_t rank;
+
+    if (adc_dma_chn[scan_params->adc] == NULL || scan_params->buffer == NULL
+            || scan_params->num_channels == 0
+            || scan_params->num_channels > scan_channels_max
+            || scan_params->num_samples == 0) {
+        return false;
+    }
+
+    adc_scan_stop();
+
+    this->scan_num_channels = scan_params->num_channels;
+    this->scan_num_samples = scan_params->num_samples;
+    num_transfers = scan_params->num_channels * scan_params->num_samples;
+
+    /* regular sequence, rank 1 is configured by adc_init */
+    adc_params.adc_mode = independent;
+    adc_params.adc = scan_params->adc;
+    adc_params.adc_channel = scan_params->channels[0];
+    adc_params.conv_mode = scan_mode;
+    adc_params.channel_type = regular_channel;
+    adc_params.option = no_option;
+    adc_params.adc_sample_time = scan_params->adc_sample_time;
+    adc_params.data_access = dma_request;
+    adc_init(&adc_params);
+
+    for (rank = 1; rank < scan_params->num_channels; rank++) {
+        ADC_RegularChannelConfig(adc_x[this->adc_num], scan_params->channels[rank],
+                rank + 1, scan_params->adc_sample_time);
+    }
+
+    /* calibrate before DMA is enabled, calibration factor is left in DR */
+    adc_start();
+
+    for (uint16_t i = 0; i < num_transfers; i++) {
+        scan_params->buffer[i] = 0;
+    }
+
+    dma_chn = adc_dma_chn[this->adc_num];
+    RCC_AHBPeriphClockCmd(adc_dma_rcc[this->adc_num], ENABLE);
+    DMA_DeInit(dma_chn);
+
+    dma_init_struct.DMA_PeripheralBaseAddr = (uint32_t) &(adc_x[this->adc_num]->DR);
+    dma_init_struct.DMA_MemoryBaseAddr = (uint32_t) scan_params->buffer;
+    dma_init_struct.DMA_DIR = DMA_DIR_PeripheralSRC;
+    dma_init_struct.DMA_BufferSize = num_transfers;
+    dma_init_struct.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    dma_init_struct.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    dma_init_struct.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+    dma_init_struct.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+    dma_init_struct.DMA_Mode = DMA_Mode_Circular;
+    dma_init_struct.DMA_Priority = DMA_Priority_Medium;
+    dma_init_struct.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(dma_chn, &dma_init_struct);
+    DMA_ClearFlag(adc_dma_tc_flag[this->adc_num]);
+    DMA_Cmd(dma_chn, ENABLE);
+
+    ADC_DMACmd(adc_x[this->adc_num], ENABLE);
+    ADC_SoftwareStartConvCmd(adc_x[this->adc_num], ENABLE);
+
+    /* wait until buffer is filled once, averages are valid from now on */
+    while (!DMA_GetFlagStatus(adc_dma_tc_flag[this->adc_num])) {
+        ;
+    }
+    this->scan_buffer = scan_params->buffer;
+
+    return true;
+}
+
+void adc::adc_scan_stop(void)
+{
+    if (this->scan_buffer == NULL) {
+        return;
+    }
+    this->scan_buffer = NULL;
+
+    ADC_DMACmd(adc_x[this->adc_num], DISABLE);
+    DMA_Cmd(adc_dma_chn[this->adc_num], DISABLE);
+    adc_stop();
+}
+
+uint16_t adc::adc_scan_latest(uint8_t rank)
+{
+    uint16_t num_transfers, last, offset;
+
+    if (this->scan_buffer == NULL || rank >= this->scan_num_channels) {
+        return 0;
+    }
+    num_transfers = this->scan_num_channels * this->scan_num_samples;
+
+    /* CNDTR counts the transfers left before wrapping, find the last written
+     * sample, then go back to the last sample of rank */
+    last = (2 * num_transfers - adc_dma_chn[this->adc_num]->CNDTR - 1) % num_transfers;
+    offset = (last % this->scan_num_channels + this->scan_num_channels - rank)
+            % this->scan_num_channels;
+
+    return this->scan_buffer[(last + num_transfers - offset) % num_transfers];
+}
+
+uint16_t adc::adc_scan_average(uint8_t rank)
+{
+    uint32_t sum = 0;
+
+    if (this->scan_buffer == NULL || rank >= this->scan_num_channels) {
+        return 0;
+    }
+
+    for (uint16_t i = 0; i < this->scan_num_samples; i++) {
+        sum += this->scan_buffer[rank + i * this->scan_num_channels];
+    }
+
+    return (sum + this->scan_num_samples / 2) / this->scan_num_samples;
+}
+
 void adc::adc_en_dis(FunctionalState new_state)
 {
     RCC_APB2PeriphClockCmd(adc_rcc[this->adc_num], new_state);
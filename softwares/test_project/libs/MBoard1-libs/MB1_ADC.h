@@ -8,12 +8,19 @@
  *  _independent ADC.
  *  _continuous mode.
  *  _poll to get converted data.
+ *  _scan mode, DMA writes the regular sequence to a circular buffer (ADC1, ADC3).
  * @How to use:
  *  -Declare an adc-class instance.
  *  -Initialize GPIO as analog input for ADC channel.
  *  -Enter value to an "adc_params_t"
  *  -Pass above struct into adc_init method to initialize ADC.
  *  -Call adc_convert method to get converted data.
+ * @How to use scan mode:
+ *  -Initialize GPIOs as analog input for ADC channels.
+ *  -Enter channels and a buffer to an "adc_scan_params_t".
+ *  -Pass above struct into adc_scan_start method, ADC converts the channels
+ *   continuously from now on.
+ *  -Call adc_scan_latest/adc_scan_average methods to read data from the buffer.
  *  Note: DMA can only serve ADC1 and ADC3. ADCCLK: 0.6->14MHz.
  */
 #ifndef __MB1_ADC_H_
@@ -67,6 +74,17 @@ typedef struct {
     uint8_t adc_sample_time;
     adc_access_t data_access;
 } adc_params_t;
+
+const uint8_t scan_channels_max = 16;
+
+typedef struct {
+    adc_t adc;                  // adc1 or adc3, adc2 has no DMA
+    const uint8_t *channels;    // regular sequence, rank 0 first
+    uint8_t num_channels;       // 1..scan_channels_max
+    uint8_t adc_sample_time;
+    volatile uint16_t *buffer;  // user allocated, num_channels * num_samples
+    uint16_t num_samples;       // samples kept in buffer for each channel
+} adc_scan_params_t;
 }
 
 class adc {
@@ -99,10 +117,48 @@ public:
      * @return The converted data.
      */
     uint16_t adc_convert(void);
+
+    /**
+     * @brief Initialize ADC in scan mode and start converting. DMA (circular mode)
+     * writes every conversion to the buffer, the newest num_samples samples of each
+     * channel are kept. Returns after the buffer is filled once.
+     *
+     * @param[in] scan_params Channels of the regular sequence and the buffer.
+     *
+     * @return true if started, false if the ADC has no DMA or params are invalid.
+     */
+    bool adc_scan_start(const adc_ns::adc_scan_params_t *scan_params);
+
+    /**
+     * @brief Stop scan mode, DMA and ADC.
+     */
+    void adc_scan_stop(void);
+
+    /**
+     * @brief Get the latest converted data of a channel in scan mode.
+     *
+     * @param[in] rank Index of the channel in the regular sequence.
+     *
+     * @return The converted data.
+     */
+    uint16_t adc_scan_latest(uint8_t rank);
+
+    /**
+     * @brief Get average of the samples of a channel in buffer (oversampling).
+     *
+     * @param[in] rank Index of the channel in the regular sequence.
+     *
+     * @return The averaged data.
+     */
+    uint16_t adc_scan_average(uint8_t rank);
 private:
     bool poll_data;
     uint8_t adc_num;
 
+    volatile uint16_t *scan_buffer;
+    uint8_t scan_num_channels;
+    uint16_t scan_num_samples;
+
     /**
      * @brief The private common method used to en/dis an ADC.
      *
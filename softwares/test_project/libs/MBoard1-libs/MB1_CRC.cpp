@@ -37,46 +37,75 @@ void crc_hw::crc_clear(void)
     CRC->CR = CRC_CR_RESET;
 }
 
-uint32_t crc_hw::reverse_bit(uint32_t data, uint16_t num_bits)
-{
-    uint32_t retval = 0;
+/* CRC32 polynomial in CRC peripheral bit order (MSB first) */
+static const uint32_t crc32_poly = 0x04C11DB7;
+
+/* below this number of aligned words, table is faster than loading the peripheral */
+static const uint32_t crc_hw_min_words = 4;
 
-    for (int i = 0; i < num_bits; i++) {
-        retval |= ((data >> i) & 1) << (num_bits - 1 - i);
+/**
+ * @brief	Inverse of what CRC peripheral does to DR when 0 is written
+ * 			(DR = DR * x^32 mod polynomial), i.e. 32 steps of the CRC shift register backward.
+ */
+static uint32_t crc_unshift32(uint32_t remainder)
+{
+    for (int i = 0; i < 32; i++) {
+        if (remainder & 1) {
+            /* bit 0 of the polynomial is 1, so the bit shifted out was 1 */
+            remainder = ((remainder ^ crc32_poly) >> 1) | 0x80000000;
+        } else {
+            remainder = remainder >> 1;
+        }
     }
 
-    return retval;
+    return remainder;
 }
 
-uint32_t crc_hw::crc32_block_cal(uint8_t* data, uint16_t data_size)
+void crc_hw::crc_load(uint32_t remainder)
 {
-    uint32_t *data_ptr = (uint32_t*) data;
-    uint32_t crc32, data_tmp;
-    uint32_t crc_reg = 0xFFFFFFFF;
-    uint16_t len;
-
     crc_clear();
+    if (remainder != 0xFFFFFFFF) {
+        /* DR = f(0xFFFFFFFF ^ written word) */
+        CRC->DR = 0xFFFFFFFF ^ crc_unshift32(remainder);
+    }
+}
 
-    /* Calculate CRC32 of 4*[integer] bytes in the given data pool */
-    for (len = data_size; len >= 4; len = len - 4) {
-        data_tmp = *data_ptr++;
-        /* Reverse bit before calculating CRC */
-        data_tmp = reverse_bit(data_tmp, 32);
-        crc_reg = CRC_CalcCRC(data_tmp);
+uint32_t crc_hw::crc32_update(uint32_t crc, const uint8_t *data, uint32_t data_size)
+{
+    const uint32_t *data_ptr;
+    uint32_t remainder = ~crc; //reflected, without final XorOut
+    uint32_t len;
+
+    /* Bytes before the first 4-byte aligned address */
+    len = (4 - ((uintptr_t) data & 0x03)) & 0x03;
+    if (len > data_size || data_size - len < 4 * crc_hw_min_words) {
+        return ~crc32_sw::update_remainder(remainder, data, data_size);
     }
-    crc32 = reverse_bit(crc_reg, 32);
-
-    /* If remaining bytes are less than 4bytes, keeping calculating CRC32 */
-    if (len > 0) { //3, 2 or 1 byte.
-        CRC_CalcCRC(crc_reg);
-        data_tmp = (*data_ptr & (0xFFFFFFFF >> (32 - 8 * len))) ^ crc32;
-        data_tmp = reverse_bit(data_tmp, 32);
-        crc_reg = CRC_CalcCRC(data_tmp >> (32 - 8 * len));
-        crc_reg = reverse_bit(crc_reg, 32);
-        crc32 = (crc32 >> (8 * len)) ^ crc_reg;
+    remainder = crc32_sw::update_remainder(remainder, data, len);
+    data += len;
+    data_size -= len;
+
+    /*
+     * Aligned words: peripheral shifts MSB first, reflected CRC is LSB first,
+     * so bits of every word and of the remainder are reversed (RBIT, 1 cycle).
+     */
+    crc_load(__RBIT(remainder));
+    data_ptr = (const uint32_t *) data;
+    for (len = data_size >> 2; len > 0; len--) {
+        CRC->DR = __RBIT(*data_ptr++);
     }
+    remainder = __RBIT(CRC->DR);
+
+    /* Remaining 3, 2 or 1 byte */
+    data = (const uint8_t *) data_ptr;
+    remainder = crc32_sw::update_remainder(remainder, data, data_size & 0x03);
 
-    return crc32 ^ 0xFFFFFFFF; //~crc32
+    return ~remainder;
+}
+
+uint32_t crc_hw::crc32_block_cal(uint8_t* data, uint16_t data_size)
+{
+    return crc32_update(0, data, data_size);
 }
 
 bool crc_hw::crc_check(uint8_t *data, uint16_t data_size, uint32_t received_crc)
@@ -23,6 +23,7 @@
 #define __HL_CRC_H
 
 #include "MB1_Glb.h"
+#include "crc32_sw.h"
 
 /**
  * @brief Providing controlling method for CRC peripheral of STM32f1.
@@ -68,6 +69,20 @@ public:
      */
     uint32_t crc32_block_cal(uint8_t *data, uint16_t data_size);
 
+    /**
+     * @brief Continue CRC32 calculation with the given data pool, so CRC32 of streaming
+     * 		data can be calculated piece by piece (crc32_update(0, ...) for the first piece).
+     * 		Aligned words are calculated by CRC peripheral, unaligned head/tail bytes
+     * 		by crc32_sw table.
+     *
+     * @param[in]	crc			CRC32 of previous data, 0 to start a new calculation.
+     * @param[in]	data		A pointer point to a data pool, no alignment requirement.
+     * @param[in]	data_size	The total size of the data pool in byte.
+     *
+     * return CRC32 of previous data followed by the data pool.
+     */
+    uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t data_size);
+
     /**
      * @brief The method used to check error on the given data pool with received CRC32.
      *
@@ -91,14 +106,14 @@ private:
     void crc_clear(void);
 
     /**
-     * @brief	Reverse the order of the bits in data.
+     * @brief	Load CRC data register with the given remainder, so that the next words
+     * 			continue from it.
      *
-     * @param[in]	data		Data needed to reverse.
-     * @param[in]	num_bits	Number of bits can be reversed in data.
+     * @param[in]	remainder	Remainder in CRC peripheral bit order (not reflected).
      *
-     * @return	The value of data after being reversed.
+     * @return	none.
      */
-    uint32_t reverse_bit(uint32_t data, uint16_t num_bits);
+    void crc_load(uint32_t remainder);
 };
 //end class
 
@@ -10,6 +10,7 @@
 /* Includes */
 #include "MB1_ISR.h"
 #include "thread.h" /* RIOT's header */
+#include "irq.h" /* RIOT's header */
 
 using namespace ISRMgr_ns;
 
@@ -28,9 +29,35 @@ void (*SysTick_subISR_table[numOfSubISR_max])(void);
 void (*RTC_subISR_table[numOfSubISR_max])(void);
 /**< SysTick sub ISR table */
 
-/**< TIM6 sub ISR table */
-void (*TIM6_subISR_table[numOfSubISR_max])(void);
-/**< TIM6 sub ISR table */
+/**< TIM6 tick sub ISR table and timer wheel */
+typedef struct {
+    void (*subISR_p)(void);
+    uint32_t due;           // tick of next run
+    uint16_t period;
+    uint16_t phase;
+    uint8_t next;           // next entry in the same wheel slot
+    uint32_t calls;
+    uint32_t max_cycles;
+} tick_entry_t;
+
+const uint8_t tick_none = 0xFF;
+const uint8_t wheel_bits = 6;
+const uint32_t wheel_size = 1 << wheel_bits; // ticks per slot of level 1
+const uint32_t wheel_mask = wheel_size - 1;
+
+tick_entry_t TIM6_tick_table[numOfTickSubISR_max];
+uint8_t TIM6_wheel0[wheel_size];    // 1 tick per slot
+uint8_t TIM6_wheel1[wheel_size];    // wheel_size ticks per slot
+volatile uint32_t TIM6_tick = 0;
+
+/* DWT cycle counter, for sub ISR durations (not defined in this core_cm3.h) */
+#define DWT_CTRL    (*(volatile uint32_t *) 0xE0001000)
+#define DWT_CYCCNT  (*(volatile uint32_t *) 0xE0001004)
+
+static void TIM6_tick_insert(uint8_t index, uint32_t now);
+static void TIM6_tick_unlink(uint8_t index);
+static void TIM6_tick_run(void);
+/**< TIM6 tick sub ISR table and timer wheel */
 
 /**< USART1 sub ISR table */
 void (*USART1_subISR_table[numOfSubISR_max])(void);
@@ -167,6 +194,141 @@ status_t ISRMgr::subISR_remove(ISR_t ISR_type, void (*subISR_p)(void))
     return retval;
 }
 
+/**< TIM6 tick scheduled sub ISRs */
+
+/**
+ * @brief subISR_TIM6_tick_assign. Assign a sub ISR to TIM6 timer wheel, it's called
+ * on ticks t (1 tick = miscTIM period) with t % period == phase.
+ * @param void (* subISR_p)(void) (not a NULL ptr)
+ * @param uint16_t period, in ticks (> 0).
+ * @param uint16_t phase, in ticks (< period), tick_phase_auto to let ISRMgr choose
+ * the least used phase.
+ * @return successful or failed (table full, wrong params).
+ * @attention called from thread context.
+ */
+status_t ISRMgr::subISR_TIM6_tick_assign(void (*subISR_p)(void), uint16_t period,
+        uint16_t phase)
+{
+    uint8_t i;
+    uint32_t first;
+    unsigned irq_state;
+
+    if (subISR_p == NULL || period == 0) {
+        return failed;
+    }
+    if (phase == tick_phase_auto) {
+        phase = TIM6_tick_phase_select(period);
+    }
+    else if (phase >= period) {
+        return failed;
+    }
+
+    for (i = 0; i < numOfTickSubISR_max; i++) {
+        if (TIM6_tick_table[i].subISR_p == NULL) {
+            break;
+        }
+    }
+    if (i == numOfTickSubISR_max) {
+        return failed;
+    }
+
+    irq_state = disableIRQ();
+
+    /* first tick after now with tick % period == phase */
+    first = TIM6_tick + 1;
+    first += (phase + period - first % period) % period;
+
+    TIM6_tick_table[i].subISR_p = subISR_p;
+    TIM6_tick_table[i].due = first;
+    TIM6_tick_table[i].period = period;
+    TIM6_tick_table[i].phase = phase;
+    TIM6_tick_table[i].calls = 0;
+    TIM6_tick_table[i].max_cycles = 0;
+    TIM6_tick_insert(i, TIM6_tick);
+
+    restoreIRQ(irq_state);
+
+    return successful;
+}
+
+/**
+ * @brief subISR_TIM6_tick_remove. Remove a sub ISR from TIM6 timer wheel.
+ * @param void (* subISR_p)(void)
+ * @return successful or failed (not found).
+ */
+status_t ISRMgr::subISR_TIM6_tick_remove(void (*subISR_p)(void))
+{
+    uint8_t i;
+    status_t retval = failed;
+    unsigned irq_state;
+
+    irq_state = disableIRQ();
+
+    for (i = 0; i < numOfTickSubISR_max; i++) {
+        if (subISR_p != NULL && TIM6_tick_table[i].subISR_p == subISR_p) {
+            TIM6_tick_unlink(i);
+            TIM6_tick_table[i].subISR_p = NULL;
+            retval = successful;
+            break;
+        }
+    }
+
+    restoreIRQ(irq_state);
+
+    return retval;
+}
+
+/**
+ * @brief subISR_TIM6_tick_stats. Get period, phase, run count and max duration of
+ * TIM6 sub ISRs.
+ * @param tick_stats_t *stats, buffer for max_stats entries.
+ * @param uint8_t max_stats
+ * @return number of entries filled.
+ */
+uint8_t ISRMgr::subISR_TIM6_tick_stats(tick_stats_t *stats, uint8_t max_stats)
+{
+    uint8_t i, count = 0;
+    unsigned irq_state;
+
+    irq_state = disableIRQ();
+
+    for (i = 0; i < numOfTickSubISR_max && count < max_stats; i++) {
+        tick_entry_t *entry = &TIM6_tick_table[i];
+        if (entry->subISR_p != NULL) {
+            stats[count].subISR_p = entry->subISR_p;
+            stats[count].period = entry->period;
+            stats[count].phase = entry->phase;
+            stats[count].calls = entry->calls;
+            stats[count].max_cycles = entry->max_cycles;
+            count++;
+        }
+    }
+
+    restoreIRQ(irq_state);
+
+    return count;
+}
+
+/**
+ * @brief subISR_TIM6_tick_stats_reset. Clear run count and max duration of TIM6 sub ISRs.
+ * @return None.
+ */
+void ISRMgr::subISR_TIM6_tick_stats_reset(void)
+{
+    uint8_t i;
+    unsigned irq_state;
+
+    irq_state = disableIRQ();
+
+    for (i = 0; i < numOfTickSubISR_max; i++) {
+        TIM6_tick_table[i].calls = 0;
+        TIM6_tick_table[i].max_cycles = 0;
+    }
+
+    restoreIRQ(irq_state);
+}
+/**< TIM6 tick scheduled sub ISRs */
+
 /**< SysTick private */
 
 /**
@@ -300,65 +462,95 @@ void ISRMgr::RTC_subISR_table_init(void)
 /**< TIM6 private */
 
 /**
- * @brief subISR_TIM6_assign. assign a sub ISR func ptr to TIM6_subISR_table.
+ * @brief subISR_TIM6_assign. assign a sub ISR func ptr to TIM6 tick table, it's
+ * called every tick.
  * @param void (* subISR_p)(void)
  * @return None.
  */
 status_t ISRMgr::subISR_TIM6_assign(void (*subISR_p)(void))
 {
-    uint8_t i;
-    bool found = false;
-
-    for (i = 0; i < numOfSubISR_max; i++) {
-        if (TIM6_subISR_table[i] == NULL) {
-            found = true;
-            TIM6_subISR_table[i] = subISR_p;
-
-            break;
-        }
-    }
-
-    if (found)
-        return successful;
-
-    return failed;
+    return subISR_TIM6_tick_assign(subISR_p, 1, 0);
 }
 
 /**
- * @brief subISR_TIM6_remove. Remove a sub ISR func ptr to TIM6_subISR_table.
+ * @brief subISR_TIM6_remove. Remove a sub ISR func ptr from TIM6 tick table.
  * @param void (* subISR_p)(void)
  * @return None.
  */
 status_t ISRMgr::subISR_TIM6_remove(void (*subISR_p)(void))
 {
-    uint8_t i;
-    bool found = false;
-
-    for (i = 0; i < numOfSubISR_max; i++) {
-        if (TIM6_subISR_table[i] == subISR_p) {
-            found = true;
-            TIM6_subISR_table[i] = NULL;
+    return subISR_TIM6_tick_remove(subISR_p);
+}
 
-            break;
-        }
+/**
+ * @brief TIM6_subISR_table_init. Init TIM6 tick table and timer wheel, start DWT
+ * cycle counter.
+ * @return None.
+ */
+void ISRMgr::TIM6_subISR_table_init(void)
+{
+    uint8_t a_count;
+    for (a_count = 0; a_count < numOfTickSubISR_max; a_count++) {
+        TIM6_tick_table[a_count].subISR_p = NULL;
+    }
+    for (a_count = 0; a_count < wheel_size; a_count++) {
+        TIM6_wheel0[a_count] = tick_none;
+        TIM6_wheel1[a_count] = tick_none;
     }
 
-    if (found)
-        return successful;
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= 0x01; // CYCCNTENA
+}
 
-    return failed;
+static uint16_t gcd(uint16_t a, uint16_t b)
+{
+    uint16_t tmp;
+
+    while (b != 0) {
+        tmp = a % b;
+        a = b;
+        b = tmp;
+    }
+
+    return a;
 }
 
 /**
- * @brief TIM6_subISR_table_init. Init all value in TIM6_subISR_table.
- * @return None.
+ * @brief TIM6_tick_phase_select. Phase for a new sub ISR, so that it shares ticks
+ * with the fewest sub ISRs (those with period 1 run on every tick, not counted).
+ * 2 sub ISRs with periods p1, p2 and phases f1, f2 meet iff f1 = f2 (mod gcd(p1, p2)).
+ * @param uint16_t period
+ * @return phase.
  */
-void ISRMgr::TIM6_subISR_table_init(void)
+uint16_t ISRMgr::TIM6_tick_phase_select(uint16_t period)
 {
-    uint8_t a_count;
-    for (a_count = 0; a_count < numOfSubISR_max; a_count++) {
-        TIM6_subISR_table[a_count] = NULL;
+    uint16_t phase, best_phase = 0;
+    uint8_t count, best_count = 0xFF;
+    uint8_t i;
+
+    for (phase = 0; phase < period; phase++) {
+        count = 0;
+        for (i = 0; i < numOfTickSubISR_max; i++) {
+            tick_entry_t *entry = &TIM6_tick_table[i];
+            if (entry->subISR_p == NULL || entry->period <= 1) {
+                continue;
+            }
+            uint16_t g = gcd(period, entry->period);
+            if (phase % g == entry->phase % g) {
+                count++;
+            }
+        }
+        if (count < best_count) {
+            best_count = count;
+            best_phase = phase;
+            if (count == 0) {
+                break;
+            }
+        }
     }
+
+    return best_phase;
 }
 /**< TIM6 private */
 
@@ -591,18 +783,107 @@ void isr_rtc(void)
     return;
 }
 
+/**< TIM6 timer wheel */
+
+/**
+ * @brief TIM6_tick_insert. Put an entry to the wheel slot of its due tick: level 0
+ * if due in less than wheel_size ticks, level 1 otherwise (cascaded to level 0 when
+ * level 0 wraps).
+ * @attention interrupts must be disabled (or in TIM6 ISR).
+ */
+static void TIM6_tick_insert(uint8_t index, uint32_t now)
+{
+    uint32_t due = TIM6_tick_table[index].due;
+    uint8_t *slot;
+
+    if (due - now < wheel_size) {
+        slot = &TIM6_wheel0[due & wheel_mask];
+    }
+    else {
+        slot = &TIM6_wheel1[(due >> wheel_bits) & wheel_mask];
+    }
+
+    TIM6_tick_table[index].next = *slot;
+    *slot = index;
+}
+
+/**
+ * @brief TIM6_tick_unlink. Remove an entry from its wheel slot.
+ * @attention interrupts must be disabled.
+ */
+static void TIM6_tick_unlink(uint8_t index)
+{
+    uint8_t *slot;
+    uint8_t a_count;
+
+    for (a_count = 0; a_count < 2 * wheel_size; a_count++) {
+        slot = (a_count < wheel_size) ? &TIM6_wheel0[a_count] : &TIM6_wheel1[a_count - wheel_size];
+        while (*slot != tick_none) {
+            if (*slot == index) {
+                *slot = TIM6_tick_table[index].next;
+                return;
+            }
+            slot = &TIM6_tick_table[*slot].next;
+        }
+    }
+}
+
+/**
+ * @brief TIM6_tick_run. Advance the wheel 1 tick, run sub ISRs due at this tick.
+ */
+static void TIM6_tick_run(void)
+{
+    uint32_t now = ++TIM6_tick;
+    uint32_t start, cycles;
+    uint8_t index, next;
+    tick_entry_t *entry;
+
+    /* level 0 wrapped, move entries of this level 1 slot down */
+    if ((now & wheel_mask) == 0) {
+        index = TIM6_wheel1[(now >> wheel_bits) & wheel_mask];
+        TIM6_wheel1[(now >> wheel_bits) & wheel_mask] = tick_none;
+        while (index != tick_none) {
+            next = TIM6_tick_table[index].next;
+            TIM6_tick_insert(index, now);
+            index = next;
+        }
+    }
+
+    index = TIM6_wheel0[now & wheel_mask];
+    TIM6_wheel0[now & wheel_mask] = tick_none;
+    while (index != tick_none) {
+        entry = &TIM6_tick_table[index];
+        next = entry->next;
+        if (entry->subISR_p == NULL) { // removed by a sub ISR run before
+            index = next;
+            continue;
+        }
+
+        start = DWT_CYCCNT;
+        entry->subISR_p();
+        cycles = DWT_CYCCNT - start;
+
+        entry->calls++;
+        if (cycles > entry->max_cycles) {
+            entry->max_cycles = cycles;
+        }
+
+        if (entry->subISR_p != NULL) { // not removed by itself
+            entry->due += entry->period;
+            TIM6_tick_insert(index, now);
+        }
+        index = next;
+    }
+}
+/**< TIM6 timer wheel */
+
 /* Changed from TIM6_IRQHandler to isr_tim6 to comply with RIOT */
 void isr_tim6(void)
 {
-    uint8_t a_count;
     /**< clear IT flag */
     TIM_ClearFlag(TIM6, TIM_FLAG_Update);
 
-    for (a_count = 0; a_count < numOfSubISR_max; a_count++) {
-        if (TIM6_subISR_table[a_count] != NULL) {
-            TIM6_subISR_table[a_count]();
-        }
-    }
+    TIM6_tick_run();
 
     /* RIOT specific code */
     if (sched_context_switch_request) {
@@ -5,6 +5,10 @@
  * @date 21-10-2013
  * @brief This is header file for interrupt handlers for MBoard-1.
  *
+ * TIM6 (1 ms tick) sub ISRs are run by a 2 level timer wheel. Each sub ISR has
+ * a period and a phase (in ticks), it's called only on ticks t with
+ * t % period == phase. Auto phase puts a new sub ISR on the ticks shared with
+ * the fewest other sub ISRs. Run count and max duration are kept per sub ISR.
  */
 
 #ifndef __MB1_ISR_H_
@@ -20,6 +24,18 @@ namespace ISRMgr_ns {
 
 const uint8_t numOfSubISR_max = 8;
 
+/* TIM6 tick scheduled sub ISRs */
+const uint8_t numOfTickSubISR_max = 16;
+const uint16_t tick_phase_auto = 0xFFFF;
+
+typedef struct {
+    void (*subISR_p)(void);
+    uint16_t period;        // ticks
+    uint16_t phase;         // ticks
+    uint32_t calls;
+    uint32_t max_cycles;    // longest run in CPU cycles
+} tick_stats_t;
+
 typedef enum {
     successful,
     failed
@@ -57,6 +73,14 @@ public:
     ISRMgr_ns::status_t subISR_assign (ISRMgr_ns::ISR_t ISR_type, void (* subISR_p)(void) );
     ISRMgr_ns::status_t subISR_remove (ISRMgr_ns::ISR_t ISR_type, void (* subISR_p)(void) );
 
+    /**< TIM6 tick scheduled sub ISRs */
+    ISRMgr_ns::status_t subISR_TIM6_tick_assign (void (* subISR_p)(void), uint16_t period,
+            uint16_t phase = ISRMgr_ns::tick_phase_auto);
+    ISRMgr_ns::status_t subISR_TIM6_tick_remove (void (* subISR_p)(void));
+    uint8_t subISR_TIM6_tick_stats (ISRMgr_ns::tick_stats_t *stats, uint8_t max_stats);
+    void subISR_TIM6_tick_stats_reset (void);
+    /**< TIM6 tick scheduled sub ISRs */
+
 private:
     /**< SysTick */
     void SysTick_subISR_table_init (void);
@@ -74,6 +98,7 @@ private:
     void TIM6_subISR_table_init (void);
     ISRMgr_ns::status_t subISR_TIM6_assign ( void (* subISR_p) (void) );
     ISRMgr_ns::status_t subISR_TIM6_remove ( void (* subISR_p) (void) );
+    uint16_t TIM6_tick_phase_select (uint16_t period);
     /**< TIM6 */
 
     /**< USART1 */
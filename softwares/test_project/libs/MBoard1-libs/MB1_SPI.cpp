@@ -9,6 +9,8 @@
  */
 
 #include "MB1_SPI.h"
+#include "irq.h"    /* RIOT's header */
+#include "thread.h" /* RIOT's header */
 
 using namespace SPI_ns;
 
@@ -50,6 +52,21 @@ const uint16_t hard_NSS_pins [numOfSPIs][2] = {   {GPIO_Pin_4, GPIO_Pin_15},  //
                                                         {GPIO_Pin_12, 0} };            //SPI2
 uint32_t hard_NSS_RCCs [numOfSPIs][2] = {         {RCC_APB2Periph_GPIOA, RCC_APB2Periph_GPIOA},   //SPI1
                                                         {RCC_APB2Periph_GPIOB, 0} };                        //SPI2
+
+/* DMA1 channels for SPIx_RX, SPIx_TX (fixed by hardware) */
+DMA_Channel_TypeDef* DMA_RX_channels [numOfSPIs] = {DMA1_Channel2, DMA1_Channel4};
+DMA_Channel_TypeDef* DMA_TX_channels [numOfSPIs] = {DMA1_Channel3, DMA1_Channel5};
+const uint32_t DMA_RX_TC_flags [numOfSPIs] = {DMA1_FLAG_TC2, DMA1_FLAG_TC4};
+const uint32_t DMA_RX_GL_flags [numOfSPIs] = {DMA1_FLAG_GL2, DMA1_FLAG_GL4};
+const uint32_t DMA_TX_GL_flags [numOfSPIs] = {DMA1_FLAG_GL3, DMA1_FLAG_GL5};
+const uint8_t DMA_RX_IRQns [numOfSPIs] = {DMA1_Channel2_IRQn, DMA1_Channel4_IRQn};
+
+/* SPI objects waiting for DMA RX transfer complete, used by DMA ISRs.
+ * Set only while a burst is running, so a SPI shared with a C driver (see
+ * SPI_DMA_RX_callback_assign) is given back after each transfer. */
+SPI* DMA_RX_owners [numOfSPIs] = {NULL, NULL};
+/* C callbacks for SPIs driven without SPI object, used by DMA ISRs, set per transfer too */
+void (*DMA_RX_callbacks [numOfSPIs])(void) = {NULL, NULL};
 /* end sys_conf */
 
 /* Functions implementation for class SPI */
@@ -65,6 +82,11 @@ SPI::SPI (uint16_t usedSPI){
     for (uint8_t count = 0; count < SPI_ns::SSLines_max; count++) {
         soft_nss_gpios[count] = NULL;
     }
+
+    burst_done = true;
+    burst_waiter = KERNEL_PID_UNDEF;
+    burst_fill = 0xFF;
+    burst_discard = 0;
 }
 
 /**
@@ -126,6 +148,28 @@ void SPI::M2F_GPIOs_Deinit (void){
     return;
 }
 
+/**
+  * @brief Init DMA channels for burst transfers, DMA RX transfer complete interrupt is
+  * used to wake up the thread waiting for a burst.
+  * @return None
+  */
+void SPI::M2F_DMA_Init (void){
+    RCC_AHBPeriphClockCmd (RCC_AHBPeriph_DMA1, ENABLE);
+
+    DMA_DeInit (DMA_RX_channels[usedSPI]);
+    DMA_DeInit (DMA_TX_channels[usedSPI]);
+
+    NVIC_InitTypeDef NVIC_InitStructure;
+
+    NVIC_InitStructure.NVIC_IRQChannel = DMA_RX_IRQns[usedSPI];
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init (&NVIC_InitStructure);
+
+    return;
+}
+
 /**
   * @brief Init SPI, base on parameters.
   * @return SPI_ns::status_t.
@@ -166,6 +210,7 @@ status_t SPI::init (const SPI_params_t *params_struct){
 
         case SPI_Direction_2Lines_FullDuplex :
             M2F_GPIOs_Init ();
+            M2F_DMA_Init ();
             break;
 
         default :
@@ -182,6 +227,14 @@ status_t SPI::init (const SPI_params_t *params_struct){
   * @attention I have implemented this function only for master mode, 2 lines, full duplex.
   */
 void SPI::deinit (void){
+    /* Stop taking DMA interrupts of this SPI */
+    unsigned irq_state = disableIRQ();
+    if (DMA_RX_owners[usedSPI] == this) {
+        DMA_ITConfig (DMA_RX_channels[usedSPI], DMA_IT_TC, DISABLE);
+        DMA_RX_owners[usedSPI] = NULL;
+    }
+    restoreIRQ(irq_state);
+
     /* Disable RCC clock of SPI module */
     SPI_Cmd (SPIs[usedSPI], DISABLE);
     (* RCCSPI_FPtrs[usedSPI])(RCCSPIs[usedSPI], DISABLE);
@@ -430,6 +483,140 @@ uint16_t SPI::M2F_sendAndGet_blocking (uint16_t device, uint16_t data){
     return SPI_I2S_ReceiveData (SPIs[usedSPI]);
 }
 
+/**
+  * @brief M2F_burst_transfer, send and receive a burst of bytes by DMA (8 bit data size only).
+  * The calling thread sleeps until DMA RX transfer complete interrupt wakes it up. If it's
+  * called from an ISR or with interrupts disabled, DMA transfer complete flag is polled
+  * instead (bytes are still sent back to back, without per byte TXE/RXNE polling).
+  * @param SPI_ns::uint16_t device : a device id.
+  * @param const uint8_t *tx_buf : data to send, NULL to send fill_byte size times.
+  * @param uint8_t *rx_buf : buffer for received data, NULL to discard received data.
+  * @param uint16_t size : number of bytes.
+  * @param uint8_t fill_byte : byte sent when tx_buf is NULL.
+  * @return SPI_ns::status_t
+  * @attention :
+  * - The device called this function has attached successfully before. Otherwise, there will be an infinite loop.
+  * - Bursts shorter than burst_DMA_minSize are sent by M2F_sendAndGet_blocking.
+  */
+status_t SPI::M2F_burst_transfer (uint16_t device, const uint8_t *tx_buf, uint8_t *rx_buf,
+        uint16_t size, uint8_t fill_byte){
+    /* check device */
+    if (device != SM_deviceInUse){
+        while (1);
+    }
+
+    if (spi_direction != SPI_Direction_2Lines_FullDuplex)
+        return failed;
+
+    /* short burst */
+    if (size < burst_DMA_minSize){
+        uint8_t data;
+
+        for (uint16_t count = 0; count < size; count++){
+            data = M2F_sendAndGet_blocking (device, (tx_buf != NULL) ? tx_buf[count] : fill_byte);
+            if (rx_buf != NULL)
+                rx_buf[count] = data;
+        }
+        return successful;
+    }
+
+    SPI_TypeDef *spi = SPIs[usedSPI];
+    DMA_Channel_TypeDef *rx_channel = DMA_RX_channels[usedSPI];
+    DMA_Channel_TypeDef *tx_channel = DMA_TX_channels[usedSPI];
+    bool wait_in_thread;
+    unsigned irq_state;
+
+    /* wait for the last byte sent by M2F_sendAndGet_blocking, drop stale RX data */
+    while (SPI_I2S_GetFlagStatus(spi, SPI_I2S_FLAG_TXE) == RESET);
+    while (SPI_I2S_GetFlagStatus(spi, SPI_I2S_FLAG_BSY) == SET);
+    (void) SPI_I2S_ReceiveData (spi);
+
+    burst_fill = fill_byte;
+
+    /* RX channel: SPI_DR -> rx_buf (or discard byte) */
+    DMA_InitTypeDef DMA_InitStruct;
+
+    DMA_InitStruct.DMA_PeripheralBaseAddr = (uint32_t) &spi->DR;
+    DMA_InitStruct.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStruct.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStruct.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStruct.DMA_BufferSize = size;
+    DMA_InitStruct.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStruct.DMA_M2M = DMA_M2M_Disable;
+
+    DMA_InitStruct.DMA_MemoryBaseAddr = (rx_buf != NULL) ? (uint32_t) rx_buf : (uint32_t) &burst_discard;
+    DMA_InitStruct.DMA_MemoryInc = (rx_buf != NULL) ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+    DMA_InitStruct.DMA_DIR = DMA_DIR_PeripheralSRC;
+    DMA_InitStruct.DMA_Priority = DMA_Priority_VeryHigh; // RX must not overrun
+    DMA_Init (rx_channel, &DMA_InitStruct);
+
+    /* TX channel: tx_buf (or fill byte) -> SPI_DR */
+    DMA_InitStruct.DMA_MemoryBaseAddr = (tx_buf != NULL) ? (uint32_t) tx_buf : (uint32_t) &burst_fill;
+    DMA_InitStruct.DMA_MemoryInc = (tx_buf != NULL) ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+    DMA_InitStruct.DMA_DIR = DMA_DIR_PeripheralDST;
+    DMA_InitStruct.DMA_Priority = DMA_Priority_High;
+    DMA_Init (tx_channel, &DMA_InitStruct);
+
+    DMA_ClearFlag (DMA_RX_GL_flags[usedSPI] | DMA_TX_GL_flags[usedSPI]);
+
+    /* sleep only if interrupts can wake this thread up */
+    wait_in_thread = !inISR() && (__get_PRIMASK() == 0);
+
+    irq_state = disableIRQ();
+
+    burst_done = false;
+    if (wait_in_thread) {
+        burst_waiter = thread_getpid();
+        DMA_RX_owners[usedSPI] = this;
+        DMA_ITConfig (rx_channel, DMA_IT_TC, ENABLE);
+    }
+
+    /* RX first so that no received byte is missed */
+    DMA_Cmd (rx_channel, ENABLE);
+    DMA_Cmd (tx_channel, ENABLE);
+    SPI_I2S_DMACmd (spi, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, ENABLE);
+
+    if (wait_in_thread) {
+        /* thread_sleep() enables interrupts after this thread is marked as sleeping,
+         * so the wake up can't be lost */
+        while (!burst_done) {
+            thread_sleep();
+            disableIRQ();
+        }
+        burst_waiter = KERNEL_PID_UNDEF;
+        DMA_RX_owners[usedSPI] = NULL;
+    }
+    else {
+        while (DMA_GetFlagStatus (DMA_RX_TC_flags[usedSPI]) == RESET);
+        burst_done = true;
+    }
+
+    restoreIRQ(irq_state);
+
+    /* RX complete means the last byte has been shifted out too */
+    SPI_I2S_DMACmd (spi, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, DISABLE);
+    DMA_Cmd (rx_channel, DISABLE);
+    DMA_Cmd (tx_channel, DISABLE);
+    DMA_ClearFlag (DMA_RX_GL_flags[usedSPI] | DMA_TX_GL_flags[usedSPI]);
+
+    return successful;
+}
+
+/**
+  * @brief M2F_burst_DMA_isr, DMA RX transfer complete, wake up the waiting thread.
+  * @return None
+  * @attention : called from DMA ISR.
+  */
+void SPI::M2F_burst_DMA_isr (void){
+    DMA_ITConfig (DMA_RX_channels[usedSPI], DMA_IT_TC, DISABLE);
+    DMA_ClearFlag (DMA_RX_TC_flags[usedSPI]);
+
+    burst_done = true;
+    if (burst_waiter != KERNEL_PID_UNDEF) {
+        thread_wakeup (burst_waiter);
+    }
+}
+
 /* master 2 lines, full duplex interface */
 
 /* -------------- master mode --------------------------------*/
@@ -450,3 +637,50 @@ uint8_t SPI::misc_MISO_read (void){
 }
 /* -------------- misc functions ------------------------------*/
 
+/* -------------- ISRs ----------------------------------------*/
+
+static void DMA_RX_isr (uint8_t spi_index){
+    if (DMA_RX_owners[spi_index] != NULL) {
+        DMA_RX_owners[spi_index]->M2F_burst_DMA_isr();
+    }
+    else if (DMA_RX_callbacks[spi_index] != NULL) {
+        DMA_RX_callbacks[spi_index]();
+    }
+    else {
+        DMA_ClearFlag (DMA_RX_GL_flags[spi_index]);
+    }
+
+    /* RIOT specific code */
+    if (sched_context_switch_request) {
+        thread_yield();
+    }
+    /* RIOT specific code */
+}
+
+/**
+  * @brief SPI_DMA_RX_callback_assign, assign callback for DMA RX interrupt of a SPI which
+  * is driven without SPI object (e.g. FatFs SD card driver). Callback is called from ISR,
+  * it must clear DMA flags of the channel.
+  * @param spi_index : 0 for SPI1, 1 for SPI2.
+  * @param callback : callback, NULL to remove.
+  * @return None
+  * @attention : assign it right before enabling DMA transfer complete interrupt and remove
+  * it when the transfer is done, SPI objects on the same SPI do the same in M2F_burst_transfer.
+  */
+void SPI_DMA_RX_callback_assign(uint8_t spi_index, void (*callback)(void))
+{
+    if (spi_index < numOfSPIs) {
+        DMA_RX_callbacks[spi_index] = callback;
+    }
+}
+
+void isr_dma1_ch2(void)
+{
+    DMA_RX_isr(0);
+}
+
+void isr_dma1_ch4(void)
+{
+    DMA_RX_isr(1);
+}
+/* -------------- ISRs ----------------------------------------*/
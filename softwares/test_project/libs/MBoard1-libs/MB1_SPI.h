@@ -17,11 +17,15 @@
  *  + attach SPI to a device.
  *  + do somethings.
  *  + after finished, release SPI, so other device can use.
+ *  + bursts (e.g. FIFO of a radio) can be sent/received by DMA with M2F_burst_transfer.
  *
  * @History:
  * 1.4: changed to use gpio class for NSS lines and fixed some typos.
  *      Removed slave select decoding table inside this lib. Thus, users must defined
  *      their own tables, which must link to initial table inside this lib.
+ * 1.5: added DMA burst transfer (master 2 lines, full duplex, 8 bit data size).
+ *      Drivers which use SPI registers directly (e.g. SD card on SPI2) can get DMA RX
+ *      transfer complete interrupt by SPI_DMA_RX_callback_assign.
  */
 
 #ifndef _MB1_SPI_H_
@@ -31,6 +35,7 @@
 #include "MB1_Glb.h"
 #include "MB1_GPIO.h"
 #include "MB1_Misc.h"
+#include "kernel_types.h" /* RIOT's header */
 
 namespace SPI_ns{
 
@@ -39,6 +44,9 @@ const uint8_t numOfSPIs = 2;
 const uint8_t SSLines_max = 3;
 const uint8_t SSDevices_max = 0x01 << SSLines_max;
 
+/* bursts shorter than this are sent byte by byte, DMA setup would cost more */
+const uint16_t burst_DMA_minSize = 4;
+
 /* config (compile-time), we should config at compile time. */
 
 /* SPI_global */
@@ -163,6 +171,11 @@ public:
     /* master 2 lines, full duplex interface */
     uint16_t M2F_sendAndGet_blocking (uint16_t device, uint16_t data);
 
+    SPI_ns::status_t M2F_burst_transfer (uint16_t device, const uint8_t *tx_buf,
+            uint8_t *rx_buf, uint16_t size, uint8_t fill_byte = 0xFF);
+
+    void M2F_burst_DMA_isr (void);
+
     /* master 2 lines, full duplex interface */
 
     /* misc functions */
@@ -181,8 +194,15 @@ private:
 
     void M2F_GPIOs_Init (void);
     void M2F_GPIOs_Deinit (void);
+    void M2F_DMA_Init (void);
     /* end app_conf */
 
+    /* burst transfer (DMA) */
+    volatile bool burst_done;
+    volatile kernel_pid_t burst_waiter;
+    uint8_t burst_fill;
+    uint8_t burst_discard;
+
     /* -------------- master mode --------------------------------*/
 
     /* slave_mgr interface */
@@ -203,4 +223,19 @@ private:
 };
 
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* DMA RX transfer complete callback of a SPI not used by any SPI object */
+void SPI_DMA_RX_callback_assign(uint8_t spi_index, void (*callback)(void));
+
+/* ISRs */
+void isr_dma1_ch2(void); /* SPI1 RX */
+void isr_dma1_ch4(void); /* SPI2 RX */
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // _MB1_SPI_H_
@@ -106,6 +106,12 @@ uint8_t cc110x_txrx(uint8_t value)
     return spi_x->M2F_sendAndGet_blocking(SPI_ns::cc1101_1, value);
 }
 
+void cc110x_txrx_burst(const uint8_t *tx_buf, uint8_t *rx_buf, uint8_t count)
+{
+    /* FIFO bursts by DMA, bytes are sent back to back */
+    spi_x->M2F_burst_transfer(SPI_ns::cc1101_1, tx_buf, rx_buf, count, 0xFF /* NOBYTE */);
+}
+
 void cc110x_spi_cs(void)
 {
     SPI_SELECT();
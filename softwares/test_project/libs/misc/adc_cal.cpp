@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        adc_cal.cpp
+ * @brief       Calibration of ADC sensors, float reference and Q16.16 compiled plan.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ * @}
+ */
+
+#include <math.h>
+#include <stddef.h>
+
+#include "adc_cal.h"
+
+using namespace adc_cal_ns;
+
+/*----------------------------------------------------------------------------*/
+float linear_equation_calculate(float x_value, float a_value, float b_value)
+{
+    /* y = a*x + b */
+    return x_value * a_value + b_value;
+}
+
+float rational_equation_calculate(float x_value, float a_value, float b_value,
+        float c_value)
+{
+    /* y = 1/(a*x +b) + c*/
+    return 1.0f / (x_value * a_value + b_value) + c_value;
+}
+
+float polynomial_equation_calculate(float x_value, float a_value, float b_value,
+        float c_value)
+{
+    /* y = a*x^b + c */
+    return a_value * pow(x_value, b_value) + c_value;
+}
+
+float lookup_table(float value, const float* defined_table, uint8_t table_size)
+{
+    if (!defined_table || (table_size % 2 != 0)) {
+        return value;
+    }
+
+    bool inc_seq = false;
+    if (defined_table[0] < defined_table[table_size - 2]) {
+        inc_seq = true;
+    }
+
+    float a_value = 0;
+    float b_value = 0;
+    /* find segment */
+    uint8_t index = 0;
+    while (index < table_size) {
+        if ((index % 2 == 0)) {
+            /* if finding out exact input value
+             * or input value is greater than max x_value in table,
+             * returning the y_value */
+            if (inc_seq) { //increasing sequence
+                if ((index == table_size - 2)
+                        && (value >= defined_table[index])) {
+                    return defined_table[index + 1];
+                }
+
+                /* x1 <= value <= x2 */
+                if (value >= defined_table[index]
+                        && value <= defined_table[index + 2]) {
+                    break;
+                }
+            } else { //decreasing sequence
+                if ((index == table_size - 2)
+                        && (value <= defined_table[index])) {
+                    return defined_table[index + 1];
+                }
+
+                /* x2 <= value <= x1 */
+                if (value <= defined_table[index]
+                        && value >= defined_table[index + 2]) {
+                    break;
+                }
+            }
+        }
+        index++;
+    }
+
+    if (index == table_size - 1) {
+        return defined_table[1];
+    }
+
+    /* cal the ref value by linearing input value in the found out segment */
+    a_value = (defined_table[index + 3] - defined_table[index + 1])
+            / (defined_table[index + 2] - defined_table[index]); //a = (y2-y1)/(x2-x1)
+    b_value = (defined_table[index + 1] * defined_table[index + 2]
+            - defined_table[index + 3] * defined_table[index])
+            / (defined_table[index + 2] - defined_table[index]); //b = (y1*x2 - y2*x1)/(x2-x1)
+
+    /* y = a*x + b */
+    return value * a_value + b_value;
+}
+
+float adc_cal_evaluate(float x_value, const char* equation_types, uint8_t num_equations,
+        const float* params, uint8_t num_params)
+{
+    /* check parameters */
+    if (!equation_types || !params) {
+        return 0;
+    }
+    uint8_t consumed_params = 0; // the number of params was consumed.
+    const float* param_ptr = params;
+
+    float retval = x_value;
+    for (uint8_t i = 0; i < num_equations; i++) {
+        switch (equation_types[i]) {
+        case 'l': //linear
+            consumed_params += 2;
+            if (consumed_params > num_params) {
+                return retval;
+            }
+            retval = linear_equation_calculate(retval, param_ptr[0], param_ptr[1]);
+            param_ptr += 2;
+            break;
+        case 'r': //rational
+            consumed_params += 3;
+            if (consumed_params > num_params) {
+                return retval;
+            }
+            retval = rational_equation_calculate(retval, param_ptr[0], param_ptr[1],
+                    param_ptr[2]);
+            param_ptr += 3;
+            break;
+        case 'p': //polynomial
+            consumed_params += 3;
+            if (consumed_params > num_params) {
+                return retval;
+            }
+            retval = polynomial_equation_calculate(retval, param_ptr[0], param_ptr[1],
+                    param_ptr[2]);
+            param_ptr += 3;
+            break;
+        case 't': //table
+            return lookup_table(retval, param_ptr, num_params - consumed_params);
+        default:
+            break;
+        }
+    }
+
+    return retval;
+}
+
+/*----------------------------------------------------------------------------*/
+adc_cal_plan::adc_cal_plan(void)
+{
+    clear();
+}
+
+bool adc_cal_plan::compile(const char* equation_types, uint8_t num_equations,
+        const float* params, uint8_t num_params, float volt_per_code)
+{
+    const float q_max = (float) (1 << (31 - q_bits));
+    float y0, y1, y_value, y_interp, tolerance;
+    uint16_t code;
+    bool valid;
+
+    clear();
+
+    if (!equation_types || !params) {
+        return false;
+    }
+
+    /* one chain evaluation per segment boundary (the last one is code 4096) and
+     * three inside the segment to check interpolation error */
+    y1 = adc_cal_evaluate(0, equation_types, num_equations, params, num_params);
+    for (uint16_t i = 0; i <= num_segments; i++) {
+        y0 = y1;
+        if (y0 > -q_max && y0 < q_max) { // false for NaN
+            table[i] = (int32_t) floor((double) y0 * (1 << q_bits) + 0.5);
+        }
+        if (i == num_segments) {
+            break;
+        }
+
+        y1 = adc_cal_evaluate((float) ((i + 1) << segment_bits) * volt_per_code,
+                equation_types, num_equations, params, num_params);
+        valid = (y0 > -q_max && y0 < q_max) && (y1 > -q_max && y1 < q_max);
+
+        for (uint8_t quarter = 1; valid && quarter < 4; quarter++) {
+            code = (i << segment_bits) + (quarter << (segment_bits - 2));
+            y_value = adc_cal_evaluate((float) code * volt_per_code,
+                    equation_types, num_equations, params, num_params);
+            y_interp = y0 + (y1 - y0) * quarter / 4;
+            tolerance = fabs(y_value) * rel_tolerance;
+            if (tolerance < abs_tolerance) {
+                tolerance = abs_tolerance;
+            }
+            valid = fabs(y_value - y_interp) <= tolerance; // false for NaN
+        }
+
+        if (valid) {
+            segment_valid[i / 32] |= (uint32_t) 1 << (i % 32);
+            compiled = true;
+        }
+    }
+
+    return compiled;
+}
+
+void adc_cal_plan::clear(void)
+{
+    compiled = false;
+    for (uint16_t i = 0; i < table_size; i++) {
+        table[i] = 0;
+    }
+    for (uint16_t i = 0; i < sizeof(segment_valid) / sizeof(segment_valid[0]); i++) {
+        segment_valid[i] = 0;
+    }
+}
+
+bool adc_cal_plan::is_compiled(void)
+{
+    return compiled;
+}
+
+bool adc_cal_plan::evaluate_q16(uint16_t code, int32_t &value)
+{
+    const uint16_t segment_mask = (1 << segment_bits) - 1;
+    uint16_t index;
+    int32_t y0;
+
+    code &= (1 << adc_bits) - 1;
+    index = code >> segment_bits;
+    if (!(segment_valid[index / 32] & ((uint32_t) 1 << (index % 32)))) {
+        return false;
+    }
+    y0 = table[index];
+
+    /* y0 + (y1 - y0) * offset / segment size */
+    value = y0 + (int32_t) ((((int64_t) table[index + 1] - y0) * (code & segment_mask))
+            >> segment_bits);
+
+    return true;
+}
+
+bool adc_cal_plan::evaluate(uint16_t code, float &value)
+{
+    int32_t q_value;
+
+    if (!evaluate_q16(code, q_value)) {
+        return false;
+    }
+    value = (float) q_value / (1 << q_bits);
+
+    return true;
+}
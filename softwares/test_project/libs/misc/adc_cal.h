@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        adc_cal.h
+ * @brief       Calibration of ADC sensors: chain of equations from ADC code to
+ *              sensor value.
+ *
+ *              A chain is a string of equation types, applied in order to the voltage
+ *              of the ADC code, and their parameters:
+ *                  'l' y = a*x + b             (a, b)
+ *                  'r' y = 1/(a*x + b) + c     (a, b, c)
+ *                  'p' y = a*x^b + c           (a, b, c)
+ *                  't' lookup table            (x1, y1, x2, y2, ... all remaining params)
+ *
+ *              adc_cal_evaluate() interprets the chain in float, it's the reference.
+ *
+ *              adc_cal_plan compiles a chain once into a Q16.16 fixed-point table of
+ *              the whole 12-bit ADC domain, one point every 2^segment_bits codes.
+ *              A code is evaluated by direct index of its segment and linear
+ *              interpolation, integer only (no FPU on Cortex-M3).
+ *
+ *              A segment is compiled only if the interpolation matches the chain at
+ *              1/4, 1/2 and 3/4 of the segment within max(abs_tolerance,
+ *              rel_tolerance * |y|). Segments near a pole of 'r' or 'p' (x^-n), out of
+ *              Q16.16 range or too curved aren't, codes in them must be evaluated by
+ *              adc_cal_evaluate().
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef ADC_CAL_H_
+#define ADC_CAL_H_
+
+#include <stdint.h>
+
+namespace adc_cal_ns {
+const uint8_t adc_bits = 12;
+const uint8_t segment_bits = 5;     // 32 ADC codes per segment
+const uint16_t num_segments = 1 << (adc_bits - segment_bits);
+const uint16_t table_size = num_segments + 1;
+const uint8_t q_bits = 16;          // Q16.16, values in (-32768, 32768)
+const float abs_tolerance = 0.25f;
+const float rel_tolerance = 0.0025f;
+}
+
+float linear_equation_calculate(float x_value, float a, float b); //y = ax+b;
+
+float rational_equation_calculate(float x_value, float a, float b, float c); //y = 1/(ax+b)+c;
+
+float polynomial_equation_calculate(float x_value, float a, float b, float c); //y = ax^b+c;
+
+float lookup_table(float value, const float* defined_table, uint8_t table_size);
+
+/**
+ * @brief   Evaluate a chain of equations in float (reference).
+ *
+ * @param[in]   x_value, input of the first equation.
+ * @param[in]   equation_types, equation types ('l', 'r', 'p', 't').
+ * @param[in]   num_equations, number of equation types.
+ * @param[in]   params, parameters of the equations, in order.
+ * @param[in]   num_params, number of parameters.
+ *
+ * @return  output of the last equation. A chain missing its parameters stops there,
+ *          NULL types or params give 0.
+ */
+float adc_cal_evaluate(float x_value, const char* equation_types, uint8_t num_equations,
+        const float* params, uint8_t num_params);
+
+class adc_cal_plan {
+public:
+    adc_cal_plan(void);
+
+    /**
+     * @brief   compile a chain of equations for input x = code * volt_per_code.
+     *
+     * @param[in]   equation_types, equation types ('l', 'r', 'p', 't').
+     * @param[in]   num_equations, number of equation types.
+     * @param[in]   params, parameters of the equations, in order.
+     * @param[in]   num_params, number of parameters.
+     * @param[in]   volt_per_code, input of the chain for ADC code 1.
+     *
+     * @return  true if compiled. false if no segment of the ADC domain has valid
+     *          outputs in Q16.16 range, the plan is then not usable.
+     */
+    bool compile(const char* equation_types, uint8_t num_equations,
+            const float* params, uint8_t num_params, float volt_per_code);
+
+    /**
+     * @brief   clear the plan.
+     */
+    void clear(void);
+
+    /**
+     * @brief   check if the plan is compiled.
+     */
+    bool is_compiled(void);
+
+    /**
+     * @brief   evaluate the plan for an ADC code.
+     *
+     * @param[in]   code, ADC code (0..4095).
+     * @param[out]  value, sensor value, Q16.16.
+     *
+     * @return  false if the segment of code isn't compiled, value is not set.
+     */
+    bool evaluate_q16(uint16_t code, int32_t &value);
+
+    /**
+     * @brief   evaluate the plan for an ADC code.
+     *
+     * @param[in]   code, ADC code (0..4095).
+     * @param[out]  value, sensor value.
+     *
+     * @return  false if the segment of code isn't compiled, value is not set.
+     */
+    bool evaluate(uint16_t code, float &value);
+
+private:
+    int32_t table[adc_cal_ns::table_size];
+    uint32_t segment_valid[(adc_cal_ns::num_segments + 31) / 32];   // bit per segment
+    bool compiled;
+};
+
+#endif /* ADC_CAL_H_ */
+/** @} */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        crc32_sw.h
+ * @brief       Table driven software CRC32 (Ethernet, PKZip, same as crc_hw).
+ *
+ *              Polynomial 0x04C11DB7 (reflected 0xEDB88320), initial remainder
+ *              0xFFFFFFFF, reflect in/out, final XorOut 0xFFFFFFFF.
+ *
+ *              Value passed to and returned by update() is the final CRC of the data
+ *              processed so far (0 for no data), so a CRC can be computed piece by piece:
+ *                  crc = crc32_sw::update(0, part1, size1);
+ *                  crc = crc32_sw::update(crc, part2, size2);
+ *
+ *              Tables are const (placed in flash), 8 KB for slice-by-8, the first 1 KB
+ *              is also used by update_bytewise().
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef CRC32_SW_H_
+#define CRC32_SW_H_
+
+#include <stdint.h>
+
+class crc32_sw {
+public:
+    /**
+     * @brief   continue CRC32 calculation with data, slice-by-8 (8 bytes per step).
+     *
+     * @param[in]   crc, CRC32 of previous data, 0 to start a new calculation.
+     * @param[in]   data, pointer to data, no alignment requirement.
+     * @param[in]   data_size, size of data in bytes.
+     *
+     * @return  CRC32 of previous data followed by data.
+     */
+    static uint32_t update(uint32_t crc, const uint8_t *data, uint32_t data_size);
+
+    /**
+     * @brief   continue CRC32 calculation with data, one table lookup per byte.
+     *          Smaller working set than update(), used for short data.
+     *
+     * @param[in]   crc, CRC32 of previous data, 0 to start a new calculation.
+     * @param[in]   data, pointer to data.
+     * @param[in]   data_size, size of data in bytes.
+     *
+     * @return  CRC32 of previous data followed by data.
+     */
+    static uint32_t update_bytewise(uint32_t crc, const uint8_t *data, uint32_t data_size);
+
+    /**
+     * @brief   CRC32 of a data block.
+     *
+     * @param[in]   data, pointer to data.
+     * @param[in]   data_size, size of data in bytes.
+     *
+     * @return  CRC32 of data.
+     */
+    static uint32_t block_cal(const uint8_t *data, uint32_t data_size)
+    {
+        return update(0, data, data_size);
+    }
+
+    /**
+     * @brief   continue CRC32 calculation with a remainder (not final CRC value),
+     *          one table lookup per byte. Used by crc_hw for unaligned head/tail bytes.
+     *
+     * @param[in]   remainder, current remainder (reflected, no final XorOut).
+     * @param[in]   data, pointer to data.
+     * @param[in]   data_size, size of data in bytes.
+     *
+     * @return  new remainder.
+     */
+    static uint32_t update_remainder(uint32_t remainder, const uint8_t *data,
+            uint32_t data_size);
+};
+
+#endif // CRC32_SW_H_
+/** @} */